@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include "RegisterDiff.h"
+
+// Packed coil / discrete input states, 64 bits per word. Bit i of the block
+// is bit i % 8 of wire byte i / 8, so the Modbus payload maps onto the words
+// without unpacking. Counting, searching and diffing work a word at a time.
+class BitBlock
+{
+public:
+    BitBlock() = default;
+    explicit BitBlock(int size, bool value = false);
+
+    // Builds a block from LSB-first packed bytes as carried by FC01/FC02/FC15
+    static BitBlock fromPackedBytes(const char* data, qsizetype byteCount, int size);
+    QByteArray toPackedBytes() const;
+    // Same bytes written to dest, which must hold packedSize() bytes
+    void toPackedBytes(char* dest) const noexcept;
+    int packedSize() const noexcept;
+
+    int size() const noexcept;
+    bool isEmpty() const noexcept;
+    void resize(int size);
+
+    bool testBit(int index) const noexcept;
+    void setBit(int index, bool value = true) noexcept;
+    void fill(bool value) noexcept;
+
+    // Copy of length bits starting at position, shifted a word at a time
+    BitBlock mid(int position, int length) const;
+
+    // Number of set (or cleared) bits
+    int count(bool on = true) const noexcept;
+
+    // Packed byte holding bits 8 * index .. 8 * index + 7
+    quint8 byteAt(int index) const noexcept;
+
+    // Index of the first set bit at or after from, -1 if there is none
+    int nextSetBit(int from) const noexcept;
+
+    // Ranges of bits that differ from other, offset by baseAddress.
+    // Bits beyond the shorter block count as different.
+    QList<AddressRange> diff(const BitBlock& other, int baseAddress = 0) const;
+
+    bool operator==(const BitBlock& other) const noexcept;
+    bool operator!=(const BitBlock& other) const noexcept { return !(*this == other); }
+
+private:
+    void clearPadding() noexcept;
+
+    QVector<quint64> m_words;
+    int m_size = 0;
+};
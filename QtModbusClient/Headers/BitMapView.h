@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QWidget>
+#include <QImage>
+#include <QHash>
+#include <QQueue>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "BitBlock.h"
+
+// Grid of up to 65536 coil / discrete input states, one cell per bit. The
+// grid is kept as a one-pixel-per-bit image that is scaled when painted;
+// updates only rewrite the changed pixels and repaint the tiles holding them.
+// Recently changed bits stay highlighted for a while.
+class BitMapView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit BitMapView(QWidget* parent = nullptr);
+
+    // Resets the view to count unknown bits starting at startAddress
+    void setRange(int startAddress, int count);
+
+    // Applies bits read for addresses startAddress + offset onwards
+    void updateBits(int offset, const BitBlock& bits);
+
+    int startAddress() const noexcept;
+    int bitCount() const noexcept;
+    const BitBlock& bits() const noexcept;
+    int highlightedCount() const noexcept;
+
+    void setHighlightDuration(int msec);
+
+    QSize sizeHint() const override;
+    QSize minimumSizeHint() const override;
+
+signals:
+    void bitsChanged(int changedCount);
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    bool event(QEvent* event) override;
+
+private:
+    struct Highlight {
+        int index;
+        qint64 expiry;
+    };
+
+    void renderCell(int index);
+    void markDirty(int index);
+    void flushDirtyTiles();
+    void expireHighlights();
+
+    int tileColumns() const;
+    int cellSize() const;
+    int indexAt(const QPoint& pos) const;
+
+    QImage m_image;
+    BitBlock m_bits;
+    BitBlock m_known;
+    int m_startAddress = 0;
+    int m_columns = 8;
+
+    // Latest expiry per highlighted bit; the queue holds every highlight in time order
+    QHash<int, qint64> m_highlightExpiry;
+    QQueue<Highlight> m_highlightQueue;
+    QElapsedTimer m_clock;
+    QTimer m_highlightTimer;
+    int m_highlightDuration = 2000;
+
+    QList<int> m_dirtyTiles;
+    BitBlock m_dirtyTileMask;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QWidget>
+#include <QTimer>
+#include "ui_BitMapWidget.h"
+#include "ModbusConnection.h"
+
+class QModbusReply;
+
+// Scans a large coil or discrete input range in protocol-sized chunks and
+// shows it as a bit map, optionally rescanning on an interval
+class BitMapWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit BitMapWidget(QWidget* parent = nullptr);
+
+    void setModbusConnection(ModbusConnection* connection);
+
+private slots:
+    void onReadClicked();
+    void onAutoRefreshToggled(bool checked);
+    void handleBitsChanged(int changedCount);
+
+private:
+    void initUI();
+    void setupConnections();
+    void startScan();
+    void readNextChunk();
+    void handleChunkReply(quint64 generation, int offset, QModbusReply* reply);
+    void finishScan();
+    void updateSummary();
+
+    ModbusConnection::RegisterType selectedType() const;
+
+    Ui::BitMapWidget ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    QTimer m_refreshTimer;
+
+    ModbusConnection::RegisterType m_scanType = ModbusConnection::Coils;
+    ModbusConnection::RegisterType m_viewType = ModbusConnection::Coils;
+    int m_scanOffset = 0;
+    bool m_scanning = false;
+    quint64 m_generation = 0;
+    int m_lastChanges = 0;
+};
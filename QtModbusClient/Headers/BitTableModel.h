@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QAbstractTableModel>
+#include "BitBlock.h"
+
+// Table view over a packed BitBlock: one row per bit with address, the packed
+// byte value on every eighth row, and the bit state. Rows are generated on
+// demand, so large ranges cost no per-row objects. Bits changed by the last
+// update are highlighted.
+class BitTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        AddressColumn,
+        HexColumn,
+        BinaryColumn,
+        ColumnCount
+    };
+
+    explicit BitTableModel(QObject* parent = nullptr);
+
+    // Write tables expose the hex column as a check box per bit
+    void setCheckable(bool checkable);
+
+    // Replaces the content; when the range is unchanged only differing rows are refreshed
+    void setBits(int startAddress, const BitBlock& bits);
+    void resize(int startAddress, int count);
+    void fill(bool value);
+
+    const BitBlock& bits() const noexcept;
+    int startAddress() const noexcept;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    void emitRowsChanged(int firstRow, int lastRow);
+
+    BitBlock m_bits;
+    BitBlock m_changed;
+    int m_startAddress = 0;
+    bool m_checkable = false;
+};
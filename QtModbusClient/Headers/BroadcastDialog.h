@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QDialog>
+#include "ui_BroadcastDialog.h"
+#include "ModbusConnection.h"
+
+// Sends one write to every slave at once (slave ID 0) and shows how many
+// unicast round trips the broadcasts replaced
+class BroadcastDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit BroadcastDialog(QWidget* parent = nullptr);
+    ~BroadcastDialog();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+private slots:
+    void onSend();
+    void onReset();
+    void updateStatistics();
+
+private:
+    void initUI();
+    void setupConnections();
+
+    Ui::BroadcastDialog ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QDialog>
+#include <QStandardItemModel>
+#include <QHash>
+#include "ui_BusScanDialog.h"
+#include "ModbusConnection.h"
+#include "SerialPortScanner.h"
+#include "BusScanner.h"
+
+// Scans the selected serial ports in parallel for slaves and their settings
+class BusScanDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit BusScanDialog(QWidget* parent = nullptr);
+    ~BusScanDialog();
+
+    void setModbusConnection(ModbusConnection* connection);
+    void setPortScanner(SerialPortScanner* scanner);
+
+signals:
+    // Emitted before connecting to a result, with its characterised ranges if any
+    void slaveSelected(const BusScanResult& result);
+
+private slots:
+    void onStart();
+    void onStop();
+    void onConnect();
+    void updatePortList(const QStringList& ports);
+    void handleSlaveFound(const BusScanResult& result);
+    void handleSlaveCharacterized(const BusScanResult& result);
+    void handleScannerFinished();
+
+private:
+    void initUI();
+    void setupConnections();
+    QList<BusScanSettings> selectedSettings(bool* ok) const;
+    int findResultRow(const QString& portName, int slaveID) const;
+    void setRunning(bool running);
+    void updateProgress();
+
+    Ui::BusScanDialog ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    SerialPortScanner* m_portScanner = nullptr;
+    QList<BusScanner*> m_scanners;
+    QList<BusScanResult> m_results;
+    QHash<BusScanner*, QPair<int, int>> m_progress;   // done and total probes per port
+    QStandardItemModel* m_resultModel = nullptr;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <QObject>
+#include <QModbusRtuSerialClient>
+#include <QSerialPort>
+#include <QMap>
+#include <functional>
+#include "ModbusConnection.h"
+#include "RegisterDiff.h"
+
+// One serial setting to try
+struct BusScanSettings
+{
+    qint32 baudRate = QSerialPort::Baud9600;
+    QSerialPort::Parity parity = QSerialPort::NoParity;
+    QSerialPort::DataBits dataBits = QSerialPort::Data8;
+    QSerialPort::StopBits stopBits = QSerialPort::OneStop;
+
+    QString description() const;   // e.g. "19200 8E1"
+};
+
+struct BusScanResult
+{
+    QString portName;
+    BusScanSettings settings;
+    int slaveID = 0;
+    // Readable address ranges per register type, filled by characterisation
+    QMap<ModbusConnection::RegisterType, QList<AddressRange>> ranges;
+};
+
+// Finds the slaves on one serial port. Settings are tried in the given order
+// with a timeout just long enough for the shortest request/response pair;
+// all devices on a bus share one setting, so the first setting that gets a
+// valid answer is scanned to the end and the rest are skipped. Every found
+// slave can then be characterised: each register type is sampled coarsely
+// and the edges between readable and rejected addresses are located by
+// binary search. Scanners for different ports run side by side.
+class BusScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BusScanner(QObject* parent = nullptr);
+    ~BusScanner();
+
+    void setCharacterize(bool enabled) noexcept;
+
+    bool start(const QString& portName, const QList<BusScanSettings>& settings, int firstID, int lastID);
+    void cancel();
+    bool isRunning() const noexcept;
+    QString portName() const;
+
+    // Response timeout for a one-register read at this setting
+    static int probeTimeout(const BusScanSettings& settings);
+
+signals:
+    void progress(int done, int total);
+    void statusChanged(const QString& text);
+    void slaveFound(const BusScanResult& result);
+    void slaveCharacterized(const BusScanResult& result);
+    void finished(int slavesFound);
+
+private:
+    enum class ProbeResult { Answered, Rejected, IllegalFunction, NoResponse };
+    using ProbeCallback = std::function<void(ProbeResult)>;
+
+    bool openSettings(int index);
+    void probeNextID();
+    void finishSettings();
+    void probe(ModbusConnection::RegisterType type, int slaveID, int address, ProbeCallback done);
+
+    void characterizeNext();
+    void sampleNext();
+    void searchNextEdge();
+    void finishType();
+    void finish();
+
+    QModbusRtuSerialClient* m_client = nullptr;
+    QString m_portName;
+    QList<BusScanSettings> m_settings;
+    int m_firstID = 1;
+    int m_lastID = 247;
+    bool m_characterize = true;
+    bool m_running = false;
+    quint64 m_generation = 0;   // replies from a cancelled run are ignored
+
+    // Discovery
+    int m_settingsIndex = 0;
+    int m_nextID = 0;
+    bool m_settingsLocked = false;
+    int m_probesDone = 0;
+    int m_probesTotal = 0;
+    QList<BusScanResult> m_found;
+
+    // Characterisation of m_found[m_resultIndex], one register type at a time
+    struct Point { int address; bool readable; };
+    int m_resultIndex = 0;
+    int m_typeIndex = 0;
+    QList<Point> m_points;
+    int m_sampleIndex = 0;
+    int m_edgeIndex = 0;
+    int m_edgeLow = 0;
+    int m_edgeHigh = 0;
+};
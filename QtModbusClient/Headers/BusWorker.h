@@ -0,0 +1,132 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMutex>
+#include <QQueue>
+#include <QSerialPort>
+#include <QTimer>
+#include <QVector>
+#include "ModbusConnection.h"
+#include "RegisterSnapshot.h"
+
+// One polled device on a bus
+struct BusDeviceConfig
+{
+    QString name;
+    int slaveID = 1;
+    QList<SnapshotRange> ranges;
+    int intervalMs = 1000;
+};
+
+// One independent link: an RS-485 segment or a Modbus/TCP endpoint
+struct BusConfig
+{
+    enum Kind { Serial, Tcp };
+
+    QString name;
+    Kind kind = Serial;
+    QString address;                // serial port name or TCP host
+    quint16 tcpPort = 502;
+    qint32 baudRate = QSerialPort::Baud9600;
+    QSerialPort::DataBits dataBits = QSerialPort::Data8;
+    QSerialPort::Parity parity = QSerialPort::NoParity;
+    QSerialPort::StopBits stopBits = QSerialPort::OneStop;
+    bool nativeTransport = false;
+    bool adaptiveTimeout = false;   // client timeout follows the measured round trip
+    QList<BusDeviceConfig> devices;
+
+    QString description() const;    // e.g. "/dev/ttyUSB0 19200 8E1" or "10.0.0.5:502"
+
+    QJsonObject toJson() const;
+    static bool fromJson(const QJsonObject& object, BusConfig* config, QString* errorMessage = nullptr);
+};
+
+struct BusDeviceStatistics
+{
+    quint64 requests = 0;
+    quint64 responses = 0;          // including exceptions
+    quint64 exceptions = 0;
+    quint64 timeouts = 0;
+    quint64 failures = 0;           // other errors
+    double averageMs = 0;           // smoothed round trip
+    bool online = false;
+    QString lastError;
+    QList<QVector<quint16>> values; // last good values of each range, bits as 0/1
+};
+
+struct BusSnapshot
+{
+    enum State { Stopped, Connecting, Connected, Reconnecting, Failed };
+
+    State state = Stopped;
+    QString lastError;
+    QList<BusDeviceStatistics> devices;
+
+    static QString stateName(State state);
+};
+
+// Polls the devices of one bus through its own ModbusConnection, so every
+// link gets reconnect, adaptive timeout and pooled callback reads. Lives on
+// a pool thread next to other buses: all I/O is asynchronous, so one event
+// loop serves many links. Ranges are split into requests within the
+// protocol limits; a device whose previous cycle is still on the bus skips
+// a cycle instead of queueing up, and offline devices are retried slowly so
+// they do not take bus time from the ones that answer. snapshot() may be
+// called from any thread.
+class BusWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BusWorker(const BusConfig& config, QObject* parent = nullptr);
+    ~BusWorker();
+
+    const BusConfig& config() const noexcept;
+    BusSnapshot snapshot() const;
+
+    // Called on the worker's thread; the connection is created there
+    void start();
+    void stop();
+
+private:
+    // One read request of a device's poll cycle
+    struct Block
+    {
+        int device = 0;
+        int range = 0;
+        int offset = 0;             // within the range's values
+        ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+        int start = 0;
+        int count = 0;
+        qint64 sentAt = 0;
+    };
+
+    void connectBus();
+    void tick();
+    void pump();
+    static void handleRead(void* context, quint64 tag, const ModbusConnection::RequestResult& result);
+    void setState(BusSnapshot::State state);
+
+    const BusConfig m_config;
+    QVector<Block> m_blocks;
+    QVector<QList<int>> m_deviceBlocks;
+    QVector<qint64> m_due;              // next cycle of each device on m_clock
+    QVector<int> m_outstanding;         // blocks of the current cycle not yet answered
+    QVector<int> m_failureRun;
+    QQueue<int> m_queue;
+    int m_inFlight = 0;
+    int m_maxInFlight = 1;
+    bool m_running = false;
+    bool m_pumping = false;
+    quint64 m_generation = 0;           // answers from before a stop are ignored
+
+    ModbusConnection* m_connection = nullptr;
+    QTimer* m_tickTimer = nullptr;
+    QTimer* m_retryTimer = nullptr;
+    QElapsedTimer m_clock;
+
+    mutable QMutex m_snapshotMutex;
+    BusSnapshot m_snapshot;
+};
@@ -2,9 +2,9 @@
 
 #include <QWidget>
 #include <QModbusReply>
-#include <QStandardItemModel>
 #include "ui_CoilWidget.h"
 #include "ModbusConnection.h"
+#include "BitTableModel.h"
 
 class CoilWidget : public QWidget
 {
@@ -26,6 +26,7 @@ private slots:
     void handleMultipleCoilsReadResult();
     void onWriteMultipleCoils();
     void handleMultipleCoilsWriteResult();
+    void handleCoilsWriteVerified(int startAddr, const BitBlock& readBack, const QList<AddressRange>& mismatches);
 
     void onSelectAllChanged(int state);
 
@@ -36,7 +37,6 @@ private:
     void initTableModels();
 
     void updateCoilsWriteTable();
-    void handleCoilWriteItemChanged(QStandardItem* item);
 
     Ui::CoilWidget ui;
 
@@ -47,6 +47,10 @@ private:
     QModbusReply* m_multipleCoilsReply = nullptr;
     QModbusReply* m_multipleCoilsWriteReply = nullptr;
 
-    QStandardItemModel* m_coilsReadModel = nullptr;
-    QStandardItemModel* m_coilsWriteModel = nullptr;
+    // Range of this widget's write awaiting read-back, see HRWidget
+    int m_verifyStart = -1;
+    int m_verifyCount = 0;
+
+    BitTableModel* m_coilsReadModel = nullptr;
+    BitTableModel* m_coilsWriteModel = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QObject>
+#include <QMap>
+#include <QList>
+#include <QThread>
+#include "BusWorker.h"
+
+// Many independent buses, serial segments and Modbus/TCP endpoints alike,
+// each with its own connection. The buses run on a small pool of worker
+// threads, each thread's event loop hosting several of them, and are
+// spread over the threads by device count. Configuration is done here on
+// the GUI thread; statistics are collected from the workers on demand.
+class ConnectionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Sums over all buses
+    struct Totals {
+        int buses = 0;
+        int connected = 0;
+        int devices = 0;
+        int online = 0;
+        quint64 requests = 0;
+        quint64 responses = 0;
+        quint64 exceptions = 0;
+        quint64 timeouts = 0;
+        quint64 failures = 0;
+        double averageMs = 0;       // weighted by responses
+    };
+
+    explicit ConnectionManager(QObject* parent = nullptr);
+    ~ConnectionManager();
+
+    // Takes effect on the next start()
+    void setWorkerCount(int count);
+    int workerCount() const noexcept;
+    static int defaultWorkerCount();
+
+    int addBus(const BusConfig& config);
+    void removeBus(int id);
+    void clear();
+    QList<int> busIds() const;
+    BusConfig busConfig(int id) const;
+    BusSnapshot snapshot(int id) const;
+    Totals totals() const;
+
+    void start();
+    void stop();
+    bool isRunning() const noexcept;
+
+    // Site file: worker count and every bus with its devices, as JSON
+    bool loadSite(const QString& fileName, QString* errorMessage = nullptr);
+    bool saveSite(const QString& fileName, QString* errorMessage = nullptr) const;
+
+signals:
+    void busesChanged();
+
+private:
+    struct Bus
+    {
+        BusConfig config;
+        BusWorker* worker = nullptr;
+        int thread = -1;
+        BusSnapshot lastSnapshot;   // kept while stopped
+    };
+
+    void startBus(Bus& bus);
+    void stopBus(Bus& bus);
+
+    QMap<int, Bus> m_buses;
+    int m_nextID = 1;
+    int m_workerCount = defaultWorkerCount();
+
+    QList<QThread*> m_threads;
+    QList<int> m_threadLoad;        // devices polled on each thread
+    bool m_running = false;
+};
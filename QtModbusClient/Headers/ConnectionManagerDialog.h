@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QDialog>
+#include <QElapsedTimer>
+#include <QTimer>
+#include "ui_ConnectionManagerDialog.h"
+#include "ConnectionManager.h"
+#include "SerialPortScanner.h"
+
+// Device tree of every managed bus, device and range with live statistics
+class ConnectionManagerDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ConnectionManagerDialog(QWidget* parent = nullptr);
+    ~ConnectionManagerDialog();
+
+    void setPortScanner(SerialPortScanner* scanner);
+
+private slots:
+    void onAddSerialBus();
+    void onAddTcpEndpoint();
+    void onRemove();
+    void onLoadSite();
+    void onSaveSite();
+    void onStart();
+    void onStop();
+    void rebuildTree();
+    void updateStatus();
+
+private:
+    void initUI();
+    void setupConnections();
+    bool askDevices(int defaultSlaveID, QList<BusDeviceConfig>* devices);
+    void setRunning(bool running);
+
+    Ui::ConnectionManagerDialog ui;
+
+    ConnectionManager* m_manager = nullptr;
+    SerialPortScanner* m_portScanner = nullptr;
+    QTimer m_statusTimer;
+
+    // Request rate from the change of the request total
+    QElapsedTimer m_rateClock;
+    quint64 m_lastRequests = 0;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QPointer>
+#include <functional>
+#include "ModbusConnection.h"
+
+class QLocalServer;
+class QLocalSocket;
+class QTimer;
+
+// JSON-RPC 2.0 control socket for automation, one JSON message per line of
+// at most 1 MiB; a client that sends a longer line is disconnected. A batch
+// (JSON array) is answered with a single array once every call in it has
+// completed; calls go through the same ModbusConnection as the GUI.
+//
+// Methods:
+//   read        {type, address, count, slave?}          -> [values]
+//   write       {type, address, values}                 -> true
+//   snapshot    {ranges: "HR:0-9; COIL:0-15"}           -> [{type, start, values}]
+//   subscribe   {type, address, count, interval, slave?} -> subscription id,
+//               then "update" notifications {subscription, slave, address, values}
+//   unsubscribe {subscription}                          -> true
+//   status      {}                                      -> {connected, port, slave}
+class ControlServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ControlServer(QObject* parent = nullptr);
+    ~ControlServer();
+
+    static QString defaultName();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+    bool listen(const QString& name, QString* errorMessage = nullptr);
+    void close();
+    bool isListening() const;
+    QString fullServerName() const;
+
+private:
+    using Completion = std::function<void(const QJsonValue& result, const QJsonObject& error)>;
+
+    struct Subscription {
+        QLocalSocket* socket = nullptr;
+        QTimer* timer = nullptr;
+        ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+        int slaveID = 1;
+        int address = 0;
+        int count = 0;
+        bool inFlight = false;
+        QJsonArray lastValues;
+    };
+
+    void handleNewConnection();
+    void handleReadyRead(QLocalSocket* socket);
+    void handleDisconnected(QLocalSocket* socket);
+
+    void handleMessage(QLocalSocket* socket, const QByteArray& line);
+    void dispatch(QLocalSocket* socket, const QJsonObject& request, const Completion& done);
+
+    void callRead(const QJsonObject& params, const Completion& done);
+    void callWrite(const QJsonObject& params, const Completion& done);
+    void callReadWrite(const QJsonObject& params, const Completion& done);
+    void callMaskWrite(const QJsonObject& params, const Completion& done);
+    void callSnapshot(const QJsonObject& params, const Completion& done);
+    void callSubscribe(QLocalSocket* socket, const QJsonObject& params, const Completion& done);
+    void callUnsubscribe(QLocalSocket* socket, const QJsonObject& params, const Completion& done);
+    void pollSubscription(int id);
+
+    void readValues(ModbusConnection::RegisterType type, int address, int count, int slaveID,
+        const std::function<void(const QJsonArray& values, const QString& error)>& done);
+
+    static bool isValidRequest(const QJsonValue& request);
+    static QJsonObject makeError(int code, const QString& message);
+    static QJsonObject makeResponse(const QJsonValue& id, const QJsonValue& result, const QJsonObject& error);
+    static void send(QLocalSocket* socket, const QJsonValue& message);
+
+    QLocalServer* m_server = nullptr;
+    ModbusConnection* m_modbusConnection = nullptr;
+    QHash<QLocalSocket*, QByteArray> m_buffers;
+    QHash<int, Subscription> m_subscriptions;
+    int m_nextSubscription = 1;
+};
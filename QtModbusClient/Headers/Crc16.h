@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QString>
+#include <QList>
+
+// CRC-16/Modbus (reflected polynomial 0xA001, initial value 0xFFFF) as used
+// by the RTU framing. Several implementations of the same function are kept:
+// the bitwise one is the reference, the others trade table memory or CPU
+// features for speed. checksum() uses the fastest one this CPU supports,
+// picked once on first use.
+namespace Crc16
+{
+    enum class Implementation {
+        Bitwise,    // reference, one bit per step
+        Table,      // one 256-entry table, one byte per step
+        SliceBy8,   // eight tables, eight bytes per step
+        Clmul       // carry-less multiply folding (x86 PCLMULQDQ), 64 bytes per step
+    };
+
+    constexpr quint16 initialValue = 0xFFFF;
+
+    // Pass the result of a previous call as crc to continue over split buffers
+    quint16 checksum(const void* data, qsizetype size, quint16 crc = initialValue) noexcept;
+    quint16 checksum(Implementation implementation, const void* data, qsizetype size,
+        quint16 crc = initialValue) noexcept;
+
+    Implementation activeImplementation() noexcept;
+    bool isAvailable(Implementation implementation) noexcept;
+    QString implementationName(Implementation implementation);
+    QList<Implementation> availableImplementations();
+
+    // Compares every available implementation against the reference over all
+    // 16-bit inputs, every length up to a few hundred bytes at every start
+    // offset, and random buffers split at random points. Mismatches are logged.
+    bool selfTest();
+
+    struct BenchmarkResult
+    {
+        Implementation implementation = Implementation::Bitwise;
+        qsizetype blockSize = 0;
+        double megabytesPerSecond = 0;
+        double nanosecondsPerCall = 0;
+    };
+
+    // Throughput of every available implementation for each block size
+    QList<BenchmarkResult> benchmark(const QList<qsizetype>& blockSizes, qint64 millisecondsPerRun = 200);
+}
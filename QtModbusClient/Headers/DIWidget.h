@@ -4,8 +4,8 @@
 #include <QWidget>
 #include "ui_DIWidget.h"
 #include "ModbusConnection.h"
+#include "BitTableModel.h"
 
-class QStandardItemModel;
 class QModbusReply;
 
 class DIWidget : public QWidget
@@ -31,11 +31,10 @@ private:
     void processSingleDIResult(QModbusReply* reply);
     void processMultipleDIResult(QModbusReply* reply);
     void setupConnections();
-    void updateHexColumn(const QVector<quint8>& bytes, int byteCount);
 
     Ui::DIWidget ui;
     ModbusConnection* m_modbusConnection = nullptr;
-    QStandardItemModel* m_diModel = nullptr;
+    BitTableModel* m_diModel = nullptr;
     QModbusReply* m_singleDIReadReply = nullptr;
     QModbusReply* m_multipleDIReadReply = nullptr;
 };
\ No newline at end of file
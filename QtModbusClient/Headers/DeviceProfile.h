@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QHash>
+#include <QDateTime>
+#include <QJsonObject>
+#include "ModbusConnection.h"
+#include "RegisterDiff.h"
+#include "TagDatabase.h"
+
+// What was learnt about a device model: its FC43 identification, response
+// timing, which function codes it implements and which addresses can be read
+struct DeviceProfile
+{
+    QString key;                // identity the profile is stored under
+    QString vendor;
+    QString productCode;
+    QString revision;
+    int slaveID = 1;
+
+    double responseMs = 0;              // smoothed round trip
+    double responseDeviationMs = 0;
+    int turnaroundMs = 0;               // idle time kept after broadcasts
+
+    QSet<int> supportedFunctions;
+    QSet<int> unsupportedFunctions;
+    // Readable ranges of each characterised register type; absent types are unknown
+    QMap<ModbusConnection::RegisterType, QList<AddressRange>> readableRanges;
+    QDateTime lastSeen;
+
+    bool isIdentified() const noexcept;
+    QString description() const;       // e.g. "ACME PX-200 1.04"
+    // Unreadable addresses of the characterised types, ready for the read planner
+    QList<AddressHole> holes() const;
+
+    QJsonObject toJson() const;
+    static DeviceProfile fromJson(const QJsonObject& object);
+
+    // Units of the same model can sit behind different links, so the slave ID is part of it
+    static QString identityKey(const QString& vendor, const QString& productCode, const QString& revision,
+        int slaveID);
+    // Fallback for devices without FC43, valid only on the same adapter and slave ID
+    static QString locationKey(const QString& adapter, int slaveID);
+};
+
+// Device profiles persisted as one JSON file in the application data directory
+class DeviceProfileCache
+{
+public:
+    explicit DeviceProfileCache(const QString& fileName = defaultFileName());
+
+    static QString defaultFileName();
+
+    bool load(QString* errorMessage = nullptr);
+    bool save(QString* errorMessage = nullptr) const;
+
+    bool contains(const QString& key) const;
+    DeviceProfile profile(const QString& key) const;
+    void store(const DeviceProfile& profile);
+    int size() const noexcept;
+
+private:
+    QString m_fileName;
+    QHash<QString, DeviceProfile> m_profiles;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QObject>
+#include <QMap>
+#include <QPointer>
+#include "ModbusConnection.h"
+#include "DeviceProfile.h"
+#include "BusScanner.h"
+
+// Identifies the connected slave with FC43/14 and keeps its profile in the
+// on-disk cache, keyed by identity and slave ID. A known device is ready
+// straight away: the adaptive timeout, when enabled, starts from the cached
+// round trip and the read planner gets the unreadable ranges. For a new device the basic read functions are probed once and the
+// profile is filled in from what the session observes.
+class DeviceProfiler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DeviceProfiler(QObject* parent = nullptr);
+    ~DeviceProfiler();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+    // Starts identification; adapter names the serial adapter for devices without FC43
+    void identify(int slaveID, const QString& adapter);
+    // Register map found by the bus scanner, attached when that slave is identified
+    void setScanResult(const BusScanResult& result);
+
+    bool hasProfile() const noexcept;
+    const DeviceProfile& profile() const noexcept;
+    QList<AddressHole> knownHoles() const;
+
+signals:
+    void profileReady(const DeviceProfile& profile, bool fromCache);
+
+private:
+    void requestObjects(quint64 generation, int objectID);
+    void handleObjects(quint64 generation, QModbusReply* reply);
+    void resolveProfile();
+    void probeFunctions();
+    void handleFunctionSupported(int slaveID, int functionCode, bool supported);
+    void saveProfile();
+
+    QPointer<ModbusConnection> m_modbusConnection;
+    DeviceProfileCache m_cache;
+    bool m_cacheLoaded = false;
+
+    quint64 m_generation = 0;
+    int m_slaveID = 0;
+    QString m_adapter;
+    QMap<int, QByteArray> m_objects;
+    int m_objectRequests = 0;
+    bool m_hasProfile = false;
+    bool m_dirty = false;
+    DeviceProfile m_profile;
+    QMap<int, BusScanResult> m_scanResults;     // by slave ID
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QDialog>
+#include <QTimer>
+#include "ui_GatewayDialog.h"
+#include "ModbusConnection.h"
+#include "ModbusGateway.h"
+
+class GatewayDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit GatewayDialog(QWidget* parent = nullptr);
+    ~GatewayDialog();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+private slots:
+    void onStart();
+    void onStop();
+    void updateStatus();
+    void updateClientList();
+
+private:
+    void initUI();
+    void setupConnections();
+
+    Ui::GatewayDialog ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    ModbusGateway* m_gateway = nullptr;
+    QTimer m_statusTimer;
+};
@@ -6,6 +6,7 @@
 #include <QStandardItemModel>
 #include "ui_HRWidget.h"
 #include "ModbusConnection.h"
+#include "RegisterCodec.h"
 
 class HRWidget : public QWidget
 {
@@ -26,12 +27,15 @@ private slots:
     void handleMultipleHRReadResult();
     void onWriteMultipleHR();
     void handleMultipleHRWriteResult(); // ȷȷ
+    void handleWriteVerified(ModbusConnection::RegisterType type, int startAddr,
+        const QVector<quint16>& readBack, const QList<AddressRange>& mismatches);
 
 private:
     void initUI();
     void initTableModels();
     void safeDeleteReply(QModbusReply* reply);
     void updateWriteTable();
+    void refreshReadTable();
     void handleWriteItemChanged(QStandardItem* item);
     void setupConnections();
 
@@ -41,8 +45,17 @@ private:
     QStandardItemModel* m_hrReadModel = nullptr;
     QStandardItemModel* m_hrWriteModel = nullptr;
 
+    // Last multiple read, kept so the table can be re-decoded without a new request
+    QVector<quint16> m_lastReadValues;
+    int m_lastReadStart = 0;
+
     QPointer<QModbusReply> m_singleHRReadReply;
     QPointer<QModbusReply> m_singleHRWriteReply;
     QPointer<QModbusReply> m_multipleHRReadReply;
     QPointer<QModbusReply> m_multipleHRWriteReply;
+
+    // Range of this widget's write awaiting read-back; verifications of writes
+    // issued elsewhere on the connection (scripts, gateway, RPC) are ignored
+    int m_verifyStart = -1;
+    int m_verifyCount = 0;
 };
\ No newline at end of file
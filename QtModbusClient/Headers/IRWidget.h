@@ -5,6 +5,7 @@
 #include <QStandardItemModel>
 #include "ui_IRWidget.h"
 #include "ModbusConnection.h"
+#include "RegisterCodec.h"
 
 class IRWidget : public QWidget
 {
@@ -30,10 +31,13 @@ private:
     void processMultipleIRResult(QModbusReply* reply);
     void setupConnections();
     void updateHexColumn(const QVector<quint16>& values, int startAddr);
+    void refreshReadTable();
 
     Ui::IRWidget ui;
     ModbusConnection* m_modbusConnection = nullptr;
     QStandardItemModel* m_irModel = nullptr;
+    QVector<quint16> m_lastReadValues;
+    int m_lastReadStart = 0;
     QModbusReply* m_singleIRReadReply = nullptr;
     QModbusReply* m_multipleIRReadReply = nullptr;
 };
\ No newline at end of file
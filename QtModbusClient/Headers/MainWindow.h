@@ -6,11 +6,25 @@
 
 #include "ui_MainWindow.h"
 #include "ModbusConfigDialog.h"
+#include "SerialPortScanner.h"
 #include "ModbusConnection.h"
 #include "CoilWidget.h"
 #include "DIWidget.h"
 #include "IRWidget.h"
 #include "HRWidget.h"
+#include "TagWidget.h"
+#include "BitMapWidget.h"
+#include "RegisterImageDialog.h"
+#include "SnapshotDialog.h"
+#include "ScriptDialog.h"
+#include "BusScanDialog.h"
+#include "ConnectionManagerDialog.h"
+#include "BroadcastDialog.h"
+#include "RecordTransferDialog.h"
+#include "GatewayDialog.h"
+#include "SharedRegisterImage.h"
+#include "ControlServer.h"
+#include "DeviceProfiler.h"
 
 class MainWindow : public QMainWindow
 {
@@ -27,19 +41,51 @@ private slots:
     void onConnectTriggered();
     void onDisconnectTriggered();
     void onConnected();
+    void onProfileReady(const DeviceProfile& profile, bool fromCache);
+    void onTabChanged(int index);
+    void onPortAdded(const SerialPortEntry& entry);
+    void onPortRemoved(const SerialPortEntry& entry);
+    void onWriteImageTriggered();
+    void onSnapshotsTriggered();
+    void onScriptsTriggered();
+    void onBusScanTriggered();
+    void onConnectionManagerTriggered();
+    void onBroadcastTriggered();
+    void onRecordTransferTriggered();
+    void onGatewayTriggered();
+    void onSharedImageToggled(bool enabled);
+    void onControlSocketToggled(bool enabled);
 
 private:
     void setupCoilTab();
     void setupDITab();
     void setupIRTab();
     void setupHRTab();
+    void setupTagTab();
+    void setupBitMapTab();
+    void ensureTabCreated(int index);
     void setupConnections();
 
     Ui::MainWindow ui;
     QScopedPointer<ModbusConfigDialog> modbusDialog;
+    QPointer<RegisterImageDialog> m_imageDialog;
+    QPointer<SnapshotDialog> m_snapshotDialog;
+    QPointer<ScriptDialog> m_scriptDialog;
+    QPointer<BusScanDialog> m_busScanDialog;
+    QPointer<ConnectionManagerDialog> m_connectionManagerDialog;
+    QPointer<BroadcastDialog> m_broadcastDialog;
+    QPointer<RecordTransferDialog> m_recordTransferDialog;
+    QPointer<GatewayDialog> m_gatewayDialog;
+    QPointer<SharedRegisterImage> m_sharedImage;
+    QPointer<ControlServer> m_controlServer;
     ModbusConnection* m_connection = nullptr;
+    SerialPortScanner* m_portScanner = nullptr;
+    DeviceProfiler* m_profiler = nullptr;
+    QString m_reconnectIdentity;    // adapter to reconnect to when it reappears, empty after a manual disconnect
     CoilWidget* m_coilWidget = nullptr;
     DIWidget* m_diWidget = nullptr;
     IRWidget* m_irWidget = nullptr;
 	HRWidget* m_hrWidget = nullptr;
+    TagWidget* m_tagWidget = nullptr;
+    BitMapWidget* m_bitMapWidget = nullptr;
 };
\ No newline at end of file
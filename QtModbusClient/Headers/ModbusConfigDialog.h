@@ -3,6 +3,7 @@
 #include <QDialog>
 #include <qserialport.h>
 #include "ui_ModbusConfigDialog.h"
+#include "SerialPortScanner.h"
 
 class ModbusConfigDialog : public QDialog
 {
@@ -12,6 +13,9 @@ public:
 	explicit ModbusConfigDialog(QWidget* parent = nullptr);
 	~ModbusConfigDialog();
 
+	// Ports come from the shared scanner instead of a blocking scan here
+	void setPortScanner(SerialPortScanner* scanner);
+
 	// Getters for configuration parameters
 	QString getPort() const noexcept;
 	qint32 getBaudRate() const noexcept;
@@ -29,6 +33,7 @@ protected:
 private slots:
 	//Slot functions for interface interactions
 	void refreshPorts();
+	void updatePortList(const QStringList& ports);
 	void applyConfiguration();
 
 private:
@@ -39,4 +44,6 @@ private:
 	void initComboBoxes();
 	void initRefreshPortsBtn();
 	void setupConnections();
+
+	SerialPortScanner* m_portScanner = nullptr;
 };
\ No newline at end of file
@@ -2,9 +2,21 @@
 
 #include <QObject>
 #include <QModbusRtuSerialClient>
+#include <QModbusTcpClient>
 #include <QSerialPort>
 #include <QMutex>
 #include <QPointer>
+#include <QTimer>
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QHash>
+#include <functional>
+#include "RegisterDiff.h"
+#include "BitBlock.h"
+#include "PduBuilder.h"
+#include "NativeRtuTransport.h"
+#include "TransactionPool.h"
 
 class ModbusConnection : public QObject
 {
@@ -18,6 +30,21 @@ public:
         HoldingRegisters = QModbusDataUnit::HoldingRegisters
     };
     Q_ENUM(RegisterType)
+
+    // What happens after a successful multiple write
+    enum WriteVerification {
+        VerifyNone,         // trust the write response
+        VerifyReadBack,     // read the written range back and report it
+        VerifyReadBackDiff  // read back and compare against the written values
+    };
+    Q_ENUM(WriteVerification)
+
+    // Which code drives the serial line
+    enum SerialTransport {
+        QtSerialPort,       // QModbusRtuSerialClient on QSerialPort
+        NativeTransport     // NativeRtuTransport, Linux only; falls back to QtSerialPort elsewhere
+    };
+    Q_ENUM(SerialTransport)
         
         explicit ModbusConnection(QObject* parent = nullptr);
     ~ModbusConnection();
@@ -30,31 +57,258 @@ public:
         QSerialPort::StopBits stopBits,
         int slaveID
     );
+    // Modbus/TCP endpoint, for gateways and Ethernet devices; slaveID is the unit identifier
+    void connectToTcpDevice(const QString& host, quint16 port, int slaveID);
     void closeConnection();
+    // Connect again with the last parameters, on portName when the adapter was renamed
+    void reopen(const QString& portName = QString());
+    // True while the link is up or being re-established by auto reconnect
     bool isConnected() const;
 
-	// Getters for connection parameters
+    // After an unexpected drop, reconnect with exponential backoff. Requests
+    // made meanwhile return a placeholder reply that is completed once the
+    // request has been replayed, or fails with TimeoutError at its deadline.
+    void setAutoReconnect(bool enabled);
+    bool autoReconnect() const noexcept;
+    bool isReconnecting() const noexcept;
+    // Drop the link as if the cable was pulled, e.g. when the adapter disappeared
+    void notifyLinkLost();
+    void setHoldTimeout(int msec) noexcept;
+    int heldRequestCount() const noexcept;
+
+	// Getters for connection parameters; the port name is the host of a TCP endpoint
     QString getPortName() const noexcept;
     qint32 getBaudRate() const noexcept;
+    quint16 getTcpPort() const noexcept;
+    bool isTcp() const noexcept;
     int getSlaveID() const noexcept;
 
+    // Takes effect with the next connect
+    void setSerialTransport(SerialTransport transport) noexcept;
+    SerialTransport serialTransport() const noexcept;
+
+    void setWriteVerification(WriteVerification verification) noexcept;
+    WriteVerification writeVerification() const noexcept;
+
 	//Modbus operations
 	QModbusReply* readRegister(RegisterType type, int startAddr, quint16 count);
+    QModbusReply* readRegister(RegisterType type, int startAddr, quint16 count, int slaveID);
     QModbusReply* writeCoil(int addr, bool value);
     QModbusReply* writeSingleRegister(int addr, quint16 value);
     QModbusReply* writeMultipleRegisters(RegisterType type, int startAddr, const QVector<quint16>& values);
+    QModbusReply* writeMultipleRegisters(RegisterType type, int startAddr, const QVector<quint16>& values,
+        WriteVerification verification);
+
+    // Packed-bit access for coils and discrete inputs, sent as raw FC01/FC02/FC15
+    // so the payload bytes are never expanded to one value per bit
+    QModbusReply* readBits(RegisterType type, int startAddr, quint16 count);
+    QModbusReply* readBits(RegisterType type, int startAddr, quint16 count, int slaveID);
+    QModbusReply* writeMultipleCoils(int startAddr, const BitBlock& bits);     // up to 1968 coils
+    static BitBlock bitsFromReply(const QModbusReply* reply);
+    static int startAddressOf(const QModbusReply* reply);
+
+    // FC23: writes the values, then reads the read range, in one transaction;
+    // result() of the reply holds the registers read after the write
+    QModbusReply* readWriteMultipleRegisters(int readStart, quint16 readCount,
+        int writeStart, const QVector<quint16>& values);
+    QModbusReply* readWriteMultipleRegisters(int readStart, quint16 readCount,
+        int writeStart, const QVector<quint16>& values, int slaveID);
+    // FC22: the slave sets register = (register & andMask) | (orMask & ~andMask)
+    QModbusReply* maskWriteRegister(int addr, quint16 andMask, quint16 orMask);
+    QModbusReply* maskWriteRegister(int addr, quint16 andMask, quint16 orMask, int slaveID);
+
+    // FC20/FC21 file records: one sub-request per call. A record read fits
+    // at most 124 registers in a PDU, a record write 122
+    QModbusReply* readFileRecord(int fileNumber, int recordNumber, quint16 length, int slaveID);
+    QModbusReply* writeFileRecord(int fileNumber, int recordNumber, const QVector<quint16>& values, int slaveID);
+    static QVector<quint16> fileRecordFromReply(const QModbusReply* reply);
+
+    // FC24: returns up to 31 queued registers; the device pops what it sent
+    QModbusReply* readFifoQueue(int fifoAddress, int slaveID);
+    static QVector<quint16> fifoFromReply(const QModbusReply* reply, bool* ok = nullptr);
+
+    // FC43/14 basic device identification (vendor, product code, revision)
+    QModbusReply* readDeviceIdentification(int slaveID, int objectID = 0);
+    // Objects by ID; nextObjectID is set when the device has more to send
+    static QMap<int, QByteArray> deviceIdentificationFromReply(const QModbusReply* reply, int* nextObjectID = nullptr);
+
+    // Response times of unicast requests, smoothed like a TCP retransmission
+    // timer, for the link and for each slave. The adaptive timeout is off by
+    // default; when on, the client timeout follows the link estimate.
+    struct ResponseTimeStats {
+        double smoothedMs = 0;
+        double deviationMs = 0;
+        quint64 samples = 0;
+        int timeoutMs = 1000;
+    };
+
+    void setAdaptiveTimeout(bool enabled);
+    bool adaptiveTimeout() const noexcept;
+    ResponseTimeStats responseTimeStats() const noexcept;
+    // Estimate from the answers of one slave only; timeoutMs is not maintained
+    ResponseTimeStats responseTimeStats(int slaveID) const;
+    // Seeds the estimate, e.g. from a cached device profile
+    void primeResponseTime(double smoothedMs, double deviationMs);
+
+    // Forwards an arbitrary request PDU unchanged, used by the TCP gateway
+    QModbusReply* sendRawRequest(const QModbusRequest& request, int slaveID);
+
+    // Sends any function code with the given data bytes, vendor-specific codes
+    // included; the reply is Raw. Payloads over 252 bytes are rejected.
+    QModbusReply* sendRequest(quint8 functionCode, QByteArrayView payload, int slaveID);
+    QModbusReply* sendRequest(const PduBuilder& pdu, int slaveID);
+    // RTU responses carry no length, so the client must be told how long the
+    // data of a non-standard function code is before it can frame the answer.
+    // Codes Qt already frames are rejected; exception answers are always sized
+    // here. Safe to call while connections run on other threads.
+    using ResponseSizeFunction = int (*)(const QModbusResponse&);
+    static bool registerFunctionCode(quint8 functionCode, ResponseSizeFunction responseSize);
+    // Shorthand for function codes whose response data always has the same length
+    static bool registerFunctionCode(quint8 functionCode, int responseDataSize);
+    static bool isCustomFunctionCode(quint8 functionCode) noexcept;
+
+    // Outcome of submitRead()/submitReadWrite()/submitRequest(). data points into the transport's
+    // record and is only valid inside the callback.
+    struct RequestResult
+    {
+        int slaveID = 0;
+        QModbusDevice::Error error = QModbusDevice::NoError;
+        QString errorText;
+        quint8 functionCode = 0;    // exception bit included
+        QByteArrayView data;        // response data after the function code
+        bool isException() const noexcept { return functionCode & QModbusPdu::ExceptionByte; }
+    };
+    using RequestCallback = void (*)(void* context, quint64 tag, const RequestResult& result);
+
+    // Requests without a QModbusReply each, for code that polls at high rates.
+    // On the native transport they run on pooled records end to end; on
+    // QSerialPort, and while reconnecting, a reply is used internally. The
+    // callback runs once, later, on this thread; false means nothing was queued.
+    bool submitRead(RegisterType type, int startAddr, quint16 count, int slaveID,
+        RequestCallback callback, void* context, quint64 tag = 0);
+    // FC23 in place of a holding register read; the result decodes like the read alone
+    bool submitReadWrite(int readStart, quint16 readCount, int writeStart, const QVector<quint16>& values,
+        int slaveID, RequestCallback callback, void* context, quint64 tag = 0);
+    bool submitRequest(const QModbusRequest& request, int slaveID,
+        RequestCallback callback, void* context, quint64 tag = 0);
+    // Drops the callbacks still due to context, e.g. before it is destroyed
+    void cancelRequests(const void* context);
+    // Registers, or one value per bit, of a successful read; false if the answer does not hold count values
+    static bool decodeRead(RegisterType type, const RequestResult& result, quint16* values, int count);
+
+    // Broadcast writes to slave 0: one frame reaches every slave, nothing is
+    // answered, and the reply finishes once the turnaround delay has passed
+    struct BroadcastStatistics {
+        quint64 frames = 0;
+        quint64 failed = 0;
+        quint64 pduBytes = 0;
+        qint64 busTimeMs = 0;       // time the bus was held, turnaround included
+        quint64 deliveries = 0;     // frames times the configured fan-out
+        quint64 roundTripsSaved() const noexcept { return deliveries > frames ? deliveries - frames : 0; }
+    };
+
+    QModbusReply* broadcastCoil(int addr, bool value);
+    QModbusReply* broadcastRegister(int addr, quint16 value);
+    // Up to 1968 coils or 123 registers, as for the unicast writes; nullptr beyond
+    QModbusReply* broadcastCoils(int startAddr, const BitBlock& bits);
+    QModbusReply* broadcastRegisters(int startAddr, const QVector<quint16>& values);
+    QModbusReply* broadcastRequest(const QModbusRequest& request);
+
+    void setBroadcastTurnaround(int msec);
+    int broadcastTurnaround() const noexcept;
+    // Number of slaves a broadcast is expected to reach, only used for accounting
+    void setBroadcastFanOut(int slaves) noexcept;
+    int broadcastFanOut() const noexcept;
+    BroadcastStatistics broadcastStatistics() const noexcept;
+    void resetBroadcastStatistics() noexcept;
 
 signals:
     void connectionOpened();
     void connectionError(const QString& errorMessage);
     void connectionClosed();
+    void connectionLost();
+    void reconnecting(int attempt, int delayMs);
+
+    // Read-back result of a verified multiple write; mismatches is only filled for VerifyReadBackDiff
+    void writeVerified(ModbusConnection::RegisterType type, int startAddr,
+        const QVector<quint16>& readBack, const QList<AddressRange>& mismatches);
+    void writeVerificationFailed(ModbusConnection::RegisterType type, int startAddr, const QString& errorMessage);
+    void coilsWriteVerified(int startAddr, const BitBlock& readBack, const QList<AddressRange>& mismatches);
+
+    // Every successful read, only tracked while something is connected to them
+    void registersRead(int slaveID, ModbusConnection::RegisterType type, int startAddr, const QVector<quint16>& values);
+    void bitsRead(int slaveID, ModbusConnection::RegisterType type, int startAddr, const BitBlock& bits);
+
+    // A write of any kind, from any caller, was acknowledged; slaveID is 0 after a broadcast
+    void registersWritten(int slaveID, int functionCode);
+
+    // A slave answered a function code normally (true) or with an IllegalFunction exception
+    void functionSupported(int slaveID, int functionCode, bool supported);
 
 private slots:
     void handleStateChanged(QModbusDevice::State state);
     void handleErrorOccurred(QModbusDevice::Error error);
 
 private:
-    QModbusRtuSerialClient* m_client = nullptr;
+    // One callback request, also the context of its native transport record
+    struct PendingCall
+    {
+        ModbusConnection* owner = nullptr;
+        RequestCallback callback = nullptr;
+        void* context = nullptr;
+        quint64 tag = 0;
+        int slaveID = 0;
+        int functionCode = 0;
+        RegisterType type = HoldingRegisters;
+        int startAddr = 0;
+        int count = 0;                  // values of a read, 0 for other requests
+        qint64 sentAt = 0;
+        PendingCall* prev = nullptr;    // calls in flight
+        PendingCall* next = nullptr;    // calls in flight, or the pool's free list
+    };
+
+    // A held read repeated before the link is back, e.g. by a poll timer, joins
+    // the one already held, so each distinct read goes out once on reconnect
+    struct HeldRequest
+    {
+        std::function<QModbusReply*()> send;
+        QList<QPointer<QModbusReply>> placeholders;
+        QDeadlineTimer deadline;
+        QByteArray readKey;     // reply type, slave and read PDU; empty for anything that is not a read
+    };
+
+    bool isLinkUp() const;
+    bool openClient();
+    void createTransport();
+    void setClientTimeout(int msec);
+    QModbusReply* sendReadUnit(const QModbusDataUnit& read, int slaveID);
+    QModbusReply* sendWriteUnit(const QModbusDataUnit& write, int slaveID);
+    QModbusReply* sendReadWriteUnits(const QModbusDataUnit& read, const QModbusDataUnit& write, int slaveID);
+    QModbusReply* sendRawPdu(const QModbusRequest& request, int slaveID);
+    QModbusReply* track(QModbusReply* reply, int functionCode, int slaveID);
+    void noteCompletion(qint64 sentAt, QModbusDevice::Error error, int exceptionCode, int functionCode, int slaveID);
+    bool startCall(PendingCall* call, quint8 functionCode, QByteArrayView data);
+    static void nativeCallDone(void* context, const NativeRtuTransport::Transaction& transaction);
+    void finishCall(PendingCall* call, const RequestResult& result);
+    void addResponseSample(qint64 elapsedMs, int slaveID);
+    void updateTimeout();
+    QModbusReply* holdRequest(QModbusReply::ReplyType type, int slaveID, std::function<QModbusReply*()> send,
+        QByteArrayView readPdu = {});
+    void scheduleReconnect();
+    void attemptReconnect();
+    void replayHeldRequests();
+    void expireHeldRequests();
+    void failHeldRequests(QModbusDevice::Error error, const QString& errorText);
+
+    void verifyWrite(RegisterType type, int startAddr, const QVector<quint16>& written,
+        WriteVerification verification);
+    void verifyCoilsWrite(int startAddr, const BitBlock& written, WriteVerification verification);
+
+    // Exactly one of m_client (RTU or TCP) and m_native exists; m_device is whichever it is
+    QModbusClient* m_client = nullptr;
+    NativeRtuTransport* m_native = nullptr;
+    QModbusDevice* m_device = nullptr;
+    SerialTransport m_serialTransport = QtSerialPort;
 	mutable QMutex m_mutex; // Mutex for thread safety
 
 	// Connection parameters
@@ -63,5 +317,31 @@ private:
     QSerialPort::DataBits m_dataBits;
     QSerialPort::Parity m_parity;
     QSerialPort::StopBits m_stopBits;
+    bool m_tcp = false;
+    quint16 m_tcpPort = 502;
     int m_slaveID = 1;
+    WriteVerification m_writeVerification = VerifyNone;
+
+    // Auto reconnect state
+    bool m_autoReconnect = false;
+    bool m_reconnecting = false;
+    bool m_everConnected = false;   // only links that were up once are reconnected
+    bool m_userClosed = false;
+    int m_reconnectAttempt = 0;
+    int m_holdTimeout = 60000;
+
+    int m_broadcastTurnaround = 100;    // Modbus over serial line recommends 100-200 ms
+    int m_broadcastFanOut = 1;
+    BroadcastStatistics m_broadcastStats;
+    bool m_autoTimeout = false;
+    ResponseTimeStats m_responseTime;
+    QHash<int, ResponseTimeStats> m_slaveResponseTime;
+    QElapsedTimer m_responseClock;
+    qint64 m_lastCompletion = 0;        // when the previous reply finished, on m_responseClock
+    QTimer m_reconnectTimer;
+    QTimer m_expiryTimer;
+    QList<HeldRequest> m_heldRequests;
+
+    TransactionPool<PendingCall> m_calls;
+    PendingCall* m_activeCalls = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QQueue>
+#include <QTcpServer>
+#include <QModbusPdu>
+#include "ModbusConnection.h"
+#include "ResponseCache.h"
+
+class QTcpSocket;
+
+// Modbus/TCP server that forwards the requests of any number of clients onto
+// the single RTU bus of a ModbusConnection. Each client has its own queue and
+// queues are served round robin, one bus transaction at a time, so a busy
+// client cannot starve the others. Identical reads can be answered from a
+// short-lived response cache. Unit 255 addresses the configured slave; unit
+// 0 is forwarded as a broadcast and, as on the serial line, never answered.
+class ModbusGateway : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Statistics {
+        int clients = 0;
+        int queued = 0;
+        quint64 requests = 0;
+        quint64 busTransactions = 0;
+        quint64 cacheHits = 0;
+        quint64 exceptions = 0;
+        quint64 rejected = 0;
+    };
+
+    explicit ModbusGateway(QObject* parent = nullptr);
+    ~ModbusGateway();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+    bool listen(quint16 port, QString* errorMessage = nullptr);
+    void close();
+    bool isListening() const;
+
+    // Requests a client may have waiting before it gets "slave busy" exceptions
+    void setMaxQueuePerClient(int maxQueue);
+    void setCacheMaxAge(int maxAgeMs);
+
+    Statistics statistics() const;
+    QStringList clientAddresses() const;
+
+signals:
+    void clientsChanged();
+
+private:
+    struct PendingRequest {
+        quint16 transactionID = 0;
+        quint8 unitID = 0;
+        int slaveID = 1;
+        QModbusRequest request;
+    };
+
+    struct Client {
+        QTcpSocket* socket = nullptr;
+        QByteArray buffer;
+        QQueue<PendingRequest> queue;
+    };
+
+    void handleNewConnection();
+    void handleReadyRead(Client* client);
+    void handleDisconnected(Client* client);
+    static void handleBusResult(void* context, quint64 tag, const ModbusConnection::RequestResult& result);
+    void handleBusResponse(const ModbusConnection::RequestResult& result);
+    void handleRegistersWritten(int slaveID);
+
+    void parseFrames(Client* client);
+    void schedule();
+    Client* nextClient();
+    void respond(Client* client, const PendingRequest& pending, const QModbusResponse& response);
+    void respondException(Client* client, const PendingRequest& pending, QModbusPdu::ExceptionCode code);
+
+    QTcpServer* m_server = nullptr;
+    QPointer<ModbusConnection> m_modbusConnection;
+    ResponseCache m_cache;
+
+    QList<Client*> m_clients;
+    int m_nextClient = 0;
+    int m_maxQueue = 32;
+
+    // The transaction currently on the bus; the client is cleared if it disconnects meanwhile
+    bool m_busBusy = false;
+    Client* m_busClient = nullptr;
+    PendingRequest m_busRequest;
+
+    Statistics m_statistics;
+};
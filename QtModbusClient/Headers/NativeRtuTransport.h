@@ -0,0 +1,151 @@
+#pragma once
+
+#include <QModbusDevice>
+#include <QModbusDataUnit>
+#include <QModbusPdu>
+#include <QModbusReply>
+#include <QSerialPort>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QPointer>
+#include <array>
+#include <atomic>
+#include "TransactionPool.h"
+
+class QThread;
+
+// Modbus RTU directly on a Linux tty: termios in raw mode, the driver's low
+// latency flag set, and a worker thread that puts each frame on the wire and
+// collects the answer with nanosecond poll timeouts instead of going through
+// QSerialPort and the event loop. Frames are separated by t3.5 and, with
+// strict timing on, a gap over t1.5 inside an answer discards it, both
+// derived from the character time (fixed 750/1750 us above 19200 baud).
+// RS-485 direction switching can be left to the kernel with TIOCSRS485.
+//
+// The request side mirrors QModbusClient so ModbusConnection can use either.
+// Underneath, every request is a pooled Transaction record that is handed to
+// the worker and back without allocating; submit() uses them directly with a
+// plain completion function, the QModbusReply methods wrap them.
+// Only Linux is supported; open() fails elsewhere.
+class NativeRtuTransport : public QModbusDevice
+{
+    Q_OBJECT
+
+public:
+    struct Timing
+    {
+        int charTimeUs = 0;
+        int t15Us = 0;      // longest gap allowed between characters of a frame
+        int t35Us = 0;      // silence that separates frames
+    };
+
+    static constexpr int MaxAduSize = 256;
+
+    struct Transaction;
+    // Runs on the owning thread once the transaction is done, failed or aborted;
+    // the record goes back to the pool as soon as it returns
+    using Completion = void (*)(void* context, const Transaction& transaction);
+
+    struct Transaction
+    {
+        // Request, written on the owning thread before it is queued
+        std::array<char, MaxAduSize> adu;       // address + PDU + CRC
+        int aduSize = 0;
+        bool broadcast = false;
+        int timeoutMs = 1000;
+        int retries = 1;
+        int turnaroundMs = 100;
+
+        // Answer, written by the worker
+        QModbusDevice::Error error = QModbusDevice::NoError;
+        QString errorText;
+        std::array<char, MaxAduSize> answer;    // whole ADU as received
+        int answerSize = 0;
+        bool linkLost = false;
+
+        Completion completion = nullptr;
+        void* context = nullptr;
+
+        // Only used by the QModbusReply wrappers
+        QPointer<QModbusReply> reply;
+        QModbusDataUnit unit;                   // shape of the expected result for Common replies
+
+        Transaction* next = nullptr;            // free list, queue or completed list
+
+        // Function code (exception bit included) and data of a valid answer
+        quint8 answerFunctionCode() const noexcept { return answerSize >= 4 ? quint8(answer[1]) : 0; }
+        QByteArrayView answerData() const noexcept
+        {
+            return answerSize >= 4 ? QByteArrayView(answer.data() + 2, answerSize - 4) : QByteArrayView();
+        }
+    };
+
+    explicit NativeRtuTransport(QObject* parent = nullptr);
+    ~NativeRtuTransport();
+
+    static bool isSupported() noexcept;
+    static Timing timingFor(qint32 baudRate, QSerialPort::DataBits dataBits,
+        QSerialPort::Parity parity, QSerialPort::StopBits stopBits);
+
+    QModbusReply* sendReadRequest(const QModbusDataUnit& read, int serverAddress);
+    QModbusReply* sendWriteRequest(const QModbusDataUnit& write, int serverAddress);
+    QModbusReply* sendReadWriteRequest(const QModbusDataUnit& read, const QModbusDataUnit& write, int serverAddress);
+    QModbusReply* sendRawRequest(const QModbusRequest& request, int serverAddress);
+
+    // Queues the PDU without creating any QObject; false when it cannot be
+    // sent, in which case completion is never called
+    bool submit(int serverAddress, quint8 functionCode, QByteArrayView data, Completion completion, void* context);
+    int pooledTransactions() const noexcept;
+
+    void setTimeout(int msec);
+    int timeout() const;
+    void setNumberOfRetries(int retries);
+    void setTurnaroundDelay(int msec);
+    // Discard answers with gaps longer than t1.5; only meaningful on a real UART
+    void setStrictCharacterTiming(bool strict);
+    // Kernel-driven RTS direction control for RS-485 transceivers, applied on open
+    void setRs485(bool enabled, int delayBeforeSendMs = 0, int delayAfterSendMs = 0);
+
+protected:
+    bool open() override;
+    void close() override;
+
+private:
+    Transaction* prepare(int serverAddress, quint8 functionCode, QByteArrayView data);
+    void dispatch(Transaction* transaction);
+    QModbusReply* enqueue(const QModbusRequest& request, int serverAddress,
+        QModbusReply::ReplyType type, const QModbusDataUnit& unit);
+    static void finishReply(void* context, const Transaction& transaction);
+    void deliverCompleted();
+    void finish(Transaction* transaction);
+    void run();
+    void transact(Transaction& transaction);
+    bool waitForSilence();
+    int readFrame(Transaction& transaction, QString* errorText);
+    void stopWorker();
+
+    int m_fd = -1;
+    Timing m_timing;
+    int m_timeout = 1000;
+    int m_retries = 1;
+    int m_turnaround = 100;
+    bool m_strictTiming = false;
+    bool m_rs485 = false;
+    int m_rs485Before = 0;
+    int m_rs485After = 0;
+    int m_savedSerialFlags = -1;    // driver flags to restore on close
+
+    QThread* m_worker = nullptr;
+    QMutex m_queueMutex;
+    QWaitCondition m_queueCondition;
+    // Intrusive lists under m_queueMutex: waiting for the worker, and done
+    // but not yet delivered. One queued call delivers everything completed.
+    Transaction* m_queueHead = nullptr;
+    Transaction* m_queueTail = nullptr;
+    Transaction* m_completedHead = nullptr;
+    Transaction* m_completedTail = nullptr;
+    std::atomic_bool m_stopping{ false };
+    qint64 m_lastActivityNs = 0;    // end of the last byte sent or received, worker only
+
+    TransactionPool<Transaction> m_pool;    // owning thread only
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QModbusPdu>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QtEndian>
+#include <array>
+#include <cstring>
+#include "BitBlock.h"
+
+// Builds a request PDU in a fixed buffer on the stack. Fields are written big
+// endian as the protocol wants them; nothing is allocated until toRequest()
+// copies the finished payload into the request, in one allocation of exactly
+// its size. Writing past the 252 data bytes a PDU can carry sets overflowed().
+class PduBuilder
+{
+public:
+    static constexpr int MaxDataSize = 252;     // 253-byte PDU minus the function code
+
+    explicit PduBuilder(quint8 functionCode) noexcept
+        : m_functionCode(functionCode)
+    {
+    }
+
+    PduBuilder& put8(quint8 value) noexcept
+    {
+        if (reserve(1)) {
+            m_data[m_size++] = char(value);
+        }
+        return *this;
+    }
+
+    PduBuilder& put16(quint16 value) noexcept
+    {
+        if (reserve(2)) {
+            qToBigEndian(value, m_data.data() + m_size);
+            m_size += 2;
+        }
+        return *this;
+    }
+
+    PduBuilder& putBytes(QByteArrayView bytes) noexcept
+    {
+        if (reserve(int(bytes.size()))) {
+            std::memcpy(m_data.data() + m_size, bytes.data(), size_t(bytes.size()));
+            m_size += int(bytes.size());
+        }
+        return *this;
+    }
+
+    // Registers in wire order, converted straight into the buffer
+    PduBuilder& putWords(const quint16* values, int count) noexcept
+    {
+        if (reserve(count * 2)) {
+            qToBigEndian<quint16>(values, count, m_data.data() + m_size);
+            m_size += count * 2;
+        }
+        return *this;
+    }
+
+    // Coils packed LSB first straight into the buffer
+    PduBuilder& putBits(const BitBlock& bits) noexcept
+    {
+        if (reserve(bits.packedSize())) {
+            bits.toPackedBytes(m_data.data() + m_size);
+            m_size += bits.packedSize();
+        }
+        return *this;
+    }
+
+    quint8 functionCode() const noexcept { return m_functionCode; }
+    int size() const noexcept { return m_size; }
+    const char* data() const noexcept { return m_data.data(); }
+    QByteArrayView view() const noexcept { return QByteArrayView(m_data.data(), m_size); }
+    bool overflowed() const noexcept { return m_overflow; }
+
+    QModbusRequest toRequest() const
+    {
+        return QModbusRequest(QModbusPdu::FunctionCode(m_functionCode), QByteArray(m_data.data(), m_size));
+    }
+
+private:
+    bool reserve(int count) noexcept
+    {
+        if (count < 0 || m_size + count > MaxDataSize) {
+            m_overflow = true;
+            return false;
+        }
+        return true;
+    }
+
+    std::array<char, MaxDataSize> m_data;
+    int m_size = 0;
+    quint8 m_functionCode = 0;
+    bool m_overflow = false;
+};
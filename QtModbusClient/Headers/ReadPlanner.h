@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QList>
+#include <QVector>
+#include <QString>
+#include "TagDatabase.h"
+
+// One read transaction of a compiled plan
+struct ReadBlock
+{
+    QString pollClass;
+    int slaveID = 1;
+    ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+    int start = 0;
+    int count = 0;
+};
+
+// Where a tag lives inside the buffers produced by a plan
+struct TagLocation
+{
+    int block = -1;
+    int offset = 0;
+};
+
+struct ReadPlan
+{
+    QList<ReadBlock> blocks;
+    QVector<TagLocation> locations;         // indexed like TagDatabase::tags()
+    QVector<QVector<int>> tagsByBlock;      // tag indexes served by each block
+    QMap<QString, QVector<int>> blocksByClass;
+};
+
+// Protocol limits honoured when merging tags into transactions
+struct PlannerLimits
+{
+    int maxRegisters = 125;     // FC03/FC04
+    int maxBits = 2000;         // FC01/FC02
+    int maxGap = -1;            // unread addresses allowed between tags, -1 for unlimited
+};
+
+class ReadPlanner
+{
+public:
+    // Compiles the tag list into the fewest read transactions per poll class,
+    // slave and register type without spanning any known hole
+    static ReadPlan compile(const TagDatabase& database, const PlannerLimits& limits = PlannerLimits());
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include <QMap>
+#include <QPointer>
+#include <QIODevice>
+#include "ModbusConnection.h"
+
+class QModbusReply;
+
+// Bulk transfer over the function codes made for it: FC20/FC21 file records
+// and FC24 FIFO queues. A file range is split into the largest record
+// sub-requests a PDU allows and up to pipelineDepth of them are queued at
+// once; received registers are streamed in order to a sink as big-endian
+// words and reported through dataReceived, so nothing is held beyond the
+// chunks still in flight. A FIFO is drained until the device reports it empty.
+class RecordTransfer : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Mode {
+        ReadFile,
+        WriteFile,
+        DrainFifo
+    };
+    Q_ENUM(Mode)
+
+    static constexpr int MaxRecordNumber = 9999;
+    static constexpr int MaxReadRecords = 124;
+    static constexpr int MaxWriteRecords = 122;
+
+    explicit RecordTransfer(QObject* parent = nullptr);
+
+    void setModbusConnection(ModbusConnection* connection);
+    void setPipelineDepth(int depth);
+
+    // sink may be null when dataReceived is all that is needed
+    bool startRead(int slaveID, int fileNumber, int firstRecord, int recordCount, QIODevice* sink = nullptr);
+    bool startWrite(int slaveID, int fileNumber, int firstRecord, const QVector<quint16>& values);
+    // maxReads bounds a FIFO that keeps filling up, 0 reads until it is empty
+    bool startFifoDrain(int slaveID, int fifoAddress, QIODevice* sink = nullptr, int maxReads = 0);
+    void cancel();
+
+    bool isRunning() const noexcept;
+    Mode mode() const noexcept;
+    int registersTransferred() const noexcept;
+
+signals:
+    void progress(int done, int total);
+    void dataReceived(int offset, const QVector<quint16>& values);
+    void failed(const QString& errorMessage);
+    void finished(int registers);
+
+private:
+    struct Chunk
+    {
+        int record = 0;     // file mode: record number, FIFO mode: unused
+        int offset = 0;     // index into the whole transfer
+        int count = 0;
+        bool inFlight = false;
+    };
+
+    bool begin(Mode mode, int slaveID);
+    void pump();
+    void handleReply(quint64 generation, int chunkIndex, QModbusReply* reply);
+    void handleFifoReply(quint64 generation, QModbusReply* reply);
+    void deliver(int offset, const QVector<quint16>& values);
+    void fail(const QString& errorMessage);
+    void finish();
+
+    QPointer<ModbusConnection> m_modbusConnection;
+    int m_pipelineDepth = 2;
+
+    Mode m_mode = ReadFile;
+    bool m_running = false;
+    int m_slaveID = 1;
+    int m_fileNumber = 1;
+    int m_fifoAddress = 0;
+    int m_maxReads = 0;
+    int m_fifoReads = 0;
+    QPointer<QIODevice> m_sink;
+    QVector<quint16> m_writeValues;
+
+    QVector<Chunk> m_chunks;
+    int m_nextChunk = 0;
+    int m_nextDelivery = 0;                     // first chunk not yet handed to the sink
+    QMap<int, QVector<quint16>> m_outOfOrder;   // chunks that completed ahead of it
+    int m_inFlight = 0;
+    int m_transferred = 0;
+    quint64 m_generation = 0;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QDialog>
+#include <QFile>
+#include "ui_RecordTransferDialog.h"
+#include "ModbusConnection.h"
+#include "RecordTransfer.h"
+
+// Reads or writes a range of file records (FC20/FC21), or drains a FIFO
+// queue (FC24), streaming the data to or from a binary file of big-endian words
+class RecordTransferDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RecordTransferDialog(QWidget* parent = nullptr);
+    ~RecordTransferDialog();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+private slots:
+    void onModeChanged();
+    void onBrowse();
+    void onStart();
+    void onStop();
+    void handleProgress(int done, int total);
+    void handleData(int offset, const QVector<quint16>& values);
+    void handleFinished(int registers);
+    void handleFailed(const QString& errorMessage);
+
+private:
+    void initUI();
+    void setupConnections();
+    void setRunning(bool running);
+    void closeOutput();
+
+    Ui::RecordTransferDialog ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    RecordTransfer* m_transfer = nullptr;
+    QFile m_output;
+    qint64 m_startTime = 0;
+};
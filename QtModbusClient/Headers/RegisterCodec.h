@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+// Typed decoding of values spread across 16-bit Modbus registers.
+// The bulk kernels operate on whole register buffers so views, recorders
+// and exporters can convert a complete poll result in one pass.
+namespace RegisterCodec
+{
+    enum class DataType {
+        UInt16,
+        Int16,
+        UInt32,
+        Int32,
+        Float32,
+        UInt64,
+        Int64,
+        Float64,
+        Ascii
+    };
+
+    // Byte order of a multi-register value, A being the most significant byte
+    enum class ByteOrder {
+        ABCD,   // big-endian (Modbus default)
+        BADC,   // big-endian words, swapped bytes
+        CDAB,   // little-endian words
+        DCBA    // little-endian
+    };
+
+    // Describes one typed value located inside a register buffer
+    struct FieldDescriptor
+    {
+        int offset = 0;                     // register offset inside the buffer
+        DataType type = DataType::UInt16;
+        ByteOrder order = ByteOrder::ABCD;
+        int length = 1;                     // register count, only used by Ascii
+    };
+
+    // Number of registers occupied by one value of the given type
+    int registerWidth(DataType type, int length = 1) noexcept;
+
+    QString typeName(DataType type);
+    QString orderName(ByteOrder order);
+    QList<DataType> allTypes();
+    QList<ByteOrder> allOrders();
+
+    // Bulk kernels
+    void swapBytes(quint16* data, qsizetype count) noexcept;
+    void reverseWords(quint16* data, qsizetype count, int width) noexcept;
+
+    // Converts count registers holding values of width registers between wire
+    // order and host order in place. The conversion is its own inverse, so it
+    // serves both decoding and encoding.
+    void convertOrder(quint16* data, qsizetype count, int width, ByteOrder order) noexcept;
+
+    // Decodes valueCount consecutive numeric values into out, which must point
+    // to an array of the matching native type (float for Float32, qint32 for Int32...)
+    void decodeArray(const quint16* registers, qsizetype valueCount,
+        DataType type, ByteOrder order, void* out) noexcept;
+
+    // Encodes valueCount native values from in into wire-ordered registers
+    void encodeArray(const void* in, qsizetype valueCount,
+        DataType type, ByteOrder order, quint16* registers) noexcept;
+
+    // Single value access, returns an invalid QVariant if the buffer is too short
+    QVariant decode(const quint16* registers, qsizetype registerCount, const FieldDescriptor& field);
+    QVector<quint16> encode(const QVariant& value, const FieldDescriptor& field);
+
+    // Decodes a whole buffer as consecutive values and formats them for display.
+    // The result has one entry per register; entries that continue a value are empty.
+    QStringList formatBuffer(const QVector<quint16>& registers, DataType type, ByteOrder order);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QVector>
+
+// Contiguous address range reported by comparisons
+struct AddressRange
+{
+    int start = 0;
+    int count = 0;
+
+    int end() const noexcept { return start + count; }
+};
+
+namespace RegisterDiff
+{
+    // Compares two register buffers and returns the ranges that differ.
+    // Equal stretches are skipped eight registers per vector compare.
+    QList<AddressRange> diff(const quint16* a, const quint16* b, qsizetype count, int baseAddress = 0);
+    QList<AddressRange> diff(const QVector<quint16>& a, const QVector<quint16>& b, int baseAddress = 0);
+
+    // Number of registers covered by a list of ranges
+    qsizetype totalCount(const QList<AddressRange>& ranges) noexcept;
+
+    // Short human readable list such as "10, 20-25, ..."
+    QString describe(const QList<AddressRange>& ranges, int maxRanges = 10);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "ModbusConnection.h"
+
+// Contiguous run of values inside a register image
+struct RegisterSegment
+{
+    int start = 0;
+    QVector<quint16> values;    // one entry per register, or per bit for coils
+};
+
+// Register or coil values to be written to a slave, loaded from a file.
+// CSV files hold "address,value" lines and may be sparse; binary files hold a
+// dense image starting at a given address (big-endian words for registers,
+// LSB-first packed bytes for coils).
+class RegisterImage
+{
+public:
+    explicit RegisterImage(ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters);
+
+    bool load(const QString& fileName, int startAddress, QString* errorMessage = nullptr);
+    bool loadCsv(const QString& fileName, QString* errorMessage = nullptr);
+    bool loadBinary(const QString& fileName, int startAddress, QString* errorMessage = nullptr);
+
+    void setType(ModbusConnection::RegisterType type) noexcept;
+    ModbusConnection::RegisterType type() const noexcept;
+
+    const QList<RegisterSegment>& segments() const noexcept;
+    qsizetype valueCount() const noexcept;
+    bool isEmpty() const noexcept;
+
+private:
+    void append(int address, quint16 value);
+
+    ModbusConnection::RegisterType m_type;
+    QList<RegisterSegment> m_segments;
+};
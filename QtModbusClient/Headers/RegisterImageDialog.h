@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QDialog>
+#include "ui_RegisterImageDialog.h"
+#include "ModbusConnection.h"
+#include "RegisterImageWriter.h"
+
+class RegisterImageDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RegisterImageDialog(QWidget* parent = nullptr);
+    ~RegisterImageDialog();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+private slots:
+    void onBrowse();
+    void onStart();
+    void onResume();
+    void onCancel();
+    void handleStateChanged(RegisterImageWriter::State state);
+    void handleProgress(int done, int total);
+    void handleFailed(const QString& errorMessage);
+    void handleFinished(const QList<AddressRange>& mismatches);
+
+private:
+    void initUI();
+    void setupConnections();
+
+    Ui::RegisterImageDialog ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    RegisterImageWriter* m_writer = nullptr;
+};
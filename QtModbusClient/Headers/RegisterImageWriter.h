@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QObject>
+#include <QVector>
+#include "ModbusConnection.h"
+#include "RegisterImage.h"
+#include "RegisterDiff.h"
+
+class QModbusReply;
+
+// Streams a register image to the connected slave as chunked FC15/FC16 writes.
+// Up to pipelineDepth requests are queued on the client at once so the next
+// frame goes out as soon as the previous one completes. An optional read-back
+// pass compares the device content against the image in bulk. After a failure
+// the transfer can be resumed; chunks that were acknowledged are not resent.
+class RegisterImageWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State {
+        Idle,
+        Writing,
+        Verifying,
+        Failed,
+        Finished
+    };
+    Q_ENUM(State)
+
+    explicit RegisterImageWriter(QObject* parent = nullptr);
+
+    void setModbusConnection(ModbusConnection* connection);
+    void setImage(const RegisterImage& image);
+    void setPipelineDepth(int depth);
+    void setVerify(bool verify);
+
+    void start();
+    void resume();
+    void cancel();
+
+    State state() const noexcept;
+
+signals:
+    void stateChanged(RegisterImageWriter::State state);
+    void progress(int done, int total);
+    void failed(const QString& errorMessage);
+    void finished(const QList<AddressRange>& mismatches);
+
+private:
+    struct Chunk
+    {
+        int segment = 0;
+        int offset = 0;     // index inside the segment values
+        int count = 0;
+        bool done = false;
+        bool inFlight = false;
+    };
+
+    QVector<Chunk> buildChunks(int maxCount) const;
+    void setState(State state);
+    void pump();
+    void handleWriteReply(quint64 generation, int chunkIndex, QModbusReply* reply);
+    void handleReadReply(quint64 generation, int chunkIndex, QModbusReply* reply);
+    void finishPhase();
+    int countDone(const QVector<Chunk>& chunks) const;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    RegisterImage m_image;
+    int m_pipelineDepth = 4;
+    bool m_verify = true;
+
+    State m_state = Idle;
+    QVector<Chunk> m_writeChunks;
+    QVector<Chunk> m_readChunks;
+    QList<AddressRange> m_mismatches;
+    QString m_lastError;
+    int m_inFlight = 0;
+    quint64 m_generation = 0;
+};
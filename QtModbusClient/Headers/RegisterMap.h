@@ -0,0 +1,239 @@
+#pragma once
+
+#include <QModbusDataUnit>
+#include <QVector>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include "ModbusConnection.h"
+#include "RegisterCodec.h"
+
+// Compile-time register maps for devices whose layout is known when building.
+//
+//     using DriveStatus = RegisterMap<
+//         RegisterField<100, RegisterCodec::DataType::Float32>,                            // speed
+//         RegisterField<102, RegisterCodec::DataType::UInt16>,                             // state
+//         RegisterField<110, RegisterCodec::DataType::Int32, RegisterCodec::ByteOrder::CDAB> // position
+//     >;
+//
+//     QModbusReply* reply = DriveStatus::read(connection);
+//     ...
+//     const auto [speed, state, position] = DriveStatus::decode(reply->result());
+//
+// Every field decodes with shifts and indexes fixed at compile time, and the
+// whole map is fetched with a single read covering all fields. write() only
+// touches mapped registers: one FC16 per contiguous run of fields.
+namespace RegisterMapDetail
+{
+    template<RegisterCodec::DataType Type>
+    struct TypeTraits;
+
+    template<> struct TypeTraits<RegisterCodec::DataType::UInt16> { using value_type = quint16; using raw_type = quint16; };
+    template<> struct TypeTraits<RegisterCodec::DataType::Int16> { using value_type = qint16; using raw_type = quint16; };
+    template<> struct TypeTraits<RegisterCodec::DataType::UInt32> { using value_type = quint32; using raw_type = quint32; };
+    template<> struct TypeTraits<RegisterCodec::DataType::Int32> { using value_type = qint32; using raw_type = quint32; };
+    template<> struct TypeTraits<RegisterCodec::DataType::Float32> { using value_type = float; using raw_type = quint32; };
+    template<> struct TypeTraits<RegisterCodec::DataType::UInt64> { using value_type = quint64; using raw_type = quint64; };
+    template<> struct TypeTraits<RegisterCodec::DataType::Int64> { using value_type = qint64; using raw_type = quint64; };
+    template<> struct TypeTraits<RegisterCodec::DataType::Float64> { using value_type = double; using raw_type = quint64; };
+
+    constexpr quint16 swapBytes(quint16 v) noexcept
+    {
+        return static_cast<quint16>((v << 8) | (v >> 8));
+    }
+
+    // Index of the register holding word W (0 = most significant) of a value
+    template<RegisterCodec::ByteOrder Order, int Width>
+    constexpr int wordIndex(int w) noexcept
+    {
+        if constexpr (Order == RegisterCodec::ByteOrder::ABCD || Order == RegisterCodec::ByteOrder::BADC) {
+            return w;
+        }
+        else {
+            return Width - 1 - w;
+        }
+    }
+
+    template<RegisterCodec::ByteOrder Order>
+    constexpr quint16 wireWord(quint16 v) noexcept
+    {
+        if constexpr (Order == RegisterCodec::ByteOrder::BADC || Order == RegisterCodec::ByteOrder::DCBA) {
+            return swapBytes(v);
+        }
+        else {
+            return v;
+        }
+    }
+
+    // Contiguous run of mapped registers
+    struct Span
+    {
+        int start = 0;
+        int count = 0;
+    };
+
+    template<std::size_t N>
+    struct SpanList
+    {
+        std::array<Span, N> spans{};
+        int size = 0;
+        int longest = 0;
+    };
+
+    // Fields merged into runs in address order; overlapping and adjacent fields join
+    template<typename... Fields>
+    constexpr SpanList<sizeof...(Fields)> mappedSpans()
+    {
+        std::array<Span, sizeof...(Fields)> fields{ Span{ Fields::address, Fields::width }... };
+        std::sort(fields.begin(), fields.end(), [](const Span& a, const Span& b) { return a.start < b.start; });
+
+        SpanList<sizeof...(Fields)> list;
+        for (const Span& f : fields) {
+            Span* last = list.size > 0 ? &list.spans[list.size - 1] : nullptr;
+            if (last && f.start <= last->start + last->count) {
+                last->count = std::max(last->count, f.start + f.count - last->start);
+            }
+            else {
+                list.spans[list.size++] = f;
+            }
+        }
+        for (int i = 0; i < list.size; ++i) {
+            list.longest = std::max(list.longest, list.spans[i].count);
+        }
+        return list;
+    }
+}
+
+template<int Address, RegisterCodec::DataType Type,
+    RegisterCodec::ByteOrder Order = RegisterCodec::ByteOrder::ABCD>
+struct RegisterField
+{
+    static_assert(Address >= 0 && Address <= 0xFFFF, "Register address out of range");
+    static_assert(Type != RegisterCodec::DataType::Ascii, "Ascii fields are not supported in register maps");
+
+    using value_type = typename RegisterMapDetail::TypeTraits<Type>::value_type;
+    using raw_type = typename RegisterMapDetail::TypeTraits<Type>::raw_type;
+
+    static constexpr int address = Address;
+    static constexpr RegisterCodec::DataType type = Type;
+    static constexpr RegisterCodec::ByteOrder order = Order;
+    static constexpr int width = int(sizeof(raw_type) / sizeof(quint16));
+
+    // Decodes the field from registers pointing at the field's first register
+    static constexpr value_type decode(const quint16* registers) noexcept
+    {
+        return decodeImpl(registers, std::make_integer_sequence<int, width>());
+    }
+
+    // Writes the field into registers pointing at the field's first register
+    static constexpr void encode(value_type value, quint16* registers) noexcept
+    {
+        encodeImpl(std::bit_cast<raw_type>(value), registers, std::make_integer_sequence<int, width>());
+    }
+
+private:
+    template<int... W>
+    static constexpr value_type decodeImpl(const quint16* registers, std::integer_sequence<int, W...>) noexcept
+    {
+        const raw_type raw = (raw_type(0) | ... | (raw_type(RegisterMapDetail::wireWord<Order>(
+            registers[RegisterMapDetail::wordIndex<Order, width>(W)])) << (16 * (width - 1 - W))));
+        return std::bit_cast<value_type>(raw);
+    }
+
+    template<int... W>
+    static constexpr void encodeImpl(raw_type raw, quint16* registers, std::integer_sequence<int, W...>) noexcept
+    {
+        ((registers[RegisterMapDetail::wordIndex<Order, width>(W)] =
+            RegisterMapDetail::wireWord<Order>(quint16(raw >> (16 * (width - 1 - W))))), ...);
+    }
+};
+
+template<typename... Fields>
+class RegisterMap
+{
+    static_assert(sizeof...(Fields) > 0, "A register map needs at least one field");
+
+public:
+    using values_type = std::tuple<typename Fields::value_type...>;
+
+    static constexpr int start = std::min({ Fields::address... });
+    static constexpr int end = std::max({ (Fields::address + Fields::width)... });
+    static constexpr int count = end - start;
+    static constexpr int fieldCount = int(sizeof...(Fields));
+    static constexpr auto spans = RegisterMapDetail::mappedSpans<Fields...>();
+
+    static_assert(count <= 125, "Register map does not fit into a single read request");
+    static_assert(end <= 0x10000, "Register map exceeds the address space");
+
+    template<int I>
+    using field = std::tuple_element_t<I, std::tuple<Fields...>>;
+
+    // Issues the single read that covers every field of the map
+    static QModbusReply* read(ModbusConnection* connection,
+        ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters)
+    {
+        return connection ? connection->readRegister(type, start, quint16(count)) : nullptr;
+    }
+
+    // Decodes all fields from a buffer of count registers starting at start
+    static constexpr values_type decode(const quint16* registers) noexcept
+    {
+        return values_type(Fields::decode(registers + (Fields::address - start))...);
+    }
+
+    // Decodes all fields from a read result, returns default values if it does not match the map
+    static values_type decode(const QModbusDataUnit& unit)
+    {
+        if (unit.startAddress() != start || int(unit.valueCount()) < count) {
+            return values_type();
+        }
+        const QList<quint16> values = unit.values();
+        return decode(values.constData());
+    }
+
+    // Decodes a single field by position
+    template<int I>
+    static constexpr typename field<I>::value_type get(const quint16* registers) noexcept
+    {
+        return field<I>::decode(registers + (field<I>::address - start));
+    }
+
+    // Encodes all fields into a register image covering the map. Registers
+    // between fields are left at zero; write() never sends them.
+    static QVector<quint16> encode(const values_type& values)
+    {
+        QVector<quint16> registers(count, 0);
+        encodeInto(values, registers.data(), std::index_sequence_for<Fields...>());
+        return registers;
+    }
+
+    // Writes the fields back, one FC16 request per contiguous run so registers
+    // the map does not declare keep their values. A null entry is a request
+    // that could not be sent.
+    static QList<QModbusReply*> write(ModbusConnection* connection, const values_type& values)
+    {
+        static_assert(spans.longest <= 123, "A run of fields does not fit into a single write request");
+
+        QList<QModbusReply*> replies;
+        if (!connection) {
+            return replies;
+        }
+        const QVector<quint16> registers = encode(values);
+        for (int i = 0; i < spans.size; ++i) {
+            const RegisterMapDetail::Span& span = spans.spans[i];
+            replies.append(connection->writeMultipleRegisters(ModbusConnection::HoldingRegisters,
+                span.start, registers.mid(span.start - start, span.count)));
+        }
+        return replies;
+    }
+
+private:
+    template<std::size_t... I>
+    static void encodeInto(const values_type& values, quint16* registers, std::index_sequence<I...>)
+    {
+        (field<int(I)>::encode(std::get<I>(values), registers + (field<int(I)>::address - start)), ...);
+    }
+};
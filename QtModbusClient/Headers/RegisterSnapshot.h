@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "ModbusConnection.h"
+#include "BitBlock.h"
+
+// Range of one register type to include in a snapshot
+struct SnapshotRange
+{
+    ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+    int start = 0;
+    int count = 0;
+};
+
+// Captured values of one range; registers for IR/HR, packed bits for coils/DI
+struct SnapshotSegment
+{
+    ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+    int start = 0;
+    QVector<quint16> registers;
+    BitBlock bits;
+
+    bool isBits() const noexcept;
+    int count() const noexcept;
+    int end() const noexcept { return start + count(); }
+};
+
+// Addresses of one register type whose values differ between two snapshots
+struct SnapshotChange
+{
+    ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+    AddressRange range;
+};
+
+// Values of a set of ranges on one slave at one point in time
+class RegisterSnapshot
+{
+public:
+    RegisterSnapshot() = default;
+
+    void setName(const QString& name);
+    QString name() const;
+    void setSlaveID(int slaveID) noexcept;
+    int slaveID() const noexcept;
+    void setTimestamp(const QDateTime& timestamp);
+    QDateTime timestamp() const;
+
+    void addSegment(const SnapshotSegment& segment);
+    const QList<SnapshotSegment>& segments() const noexcept;
+    QList<SnapshotRange> ranges() const;
+    bool isEmpty() const noexcept;
+
+    // Value at an address, bits as 0/1; found is false outside the captured ranges
+    quint16 value(ModbusConnection::RegisterType type, int address, bool* found = nullptr) const;
+
+    bool save(const QString& fileName, QString* errorMessage = nullptr) const;
+    bool load(const QString& fileName, QString* errorMessage = nullptr);
+
+    // Changed ranges over the addresses captured in both snapshots
+    static QList<SnapshotChange> compare(const RegisterSnapshot& before, const RegisterSnapshot& after);
+
+    // Parses "HR:0-99; IR:100-149; COIL:0-1999" style range lists
+    static bool parseRanges(const QString& text, QList<SnapshotRange>* ranges, QString* errorMessage = nullptr);
+
+private:
+    QString m_name;
+    int m_slaveID = 1;
+    QDateTime m_timestamp;
+    QList<SnapshotSegment> m_segments;
+};
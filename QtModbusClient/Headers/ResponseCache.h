@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QModbusPdu>
+
+// Recent read responses keyed by slave and request PDU. A repeated identical
+// read within the maximum age is answered from here instead of the bus; any
+// write to a slave drops that slave's entries.
+class ResponseCache
+{
+public:
+    explicit ResponseCache(int maxAgeMs = 0);
+
+    // 0 disables caching
+    void setMaxAge(int maxAgeMs);
+    int maxAge() const noexcept;
+
+    bool lookup(int slaveID, const QModbusRequest& request, QModbusResponse* response);
+    void store(int slaveID, const QModbusRequest& request, const QModbusResponse& response);
+    void invalidate(int slaveID);
+    void clear();
+
+    int size() const noexcept;
+    quint64 hits() const noexcept;
+    quint64 misses() const noexcept;
+
+    static bool isRead(const QModbusRequest& request);
+
+private:
+    struct Entry {
+        int slaveID = 0;
+        QModbusResponse response;
+        qint64 storedAt = 0;
+    };
+
+    static QByteArray key(int slaveID, const QModbusRequest& request);
+    void evictExpired();
+
+    QHash<QByteArray, Entry> m_entries;
+    QElapsedTimer m_clock;
+    int m_maxAge = 0;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
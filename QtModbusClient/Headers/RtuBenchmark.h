@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+
+// Request/response latency of the RTU transports, measured over a
+// pseudo-terminal pair: a simulated slave answers FC03 reads on the master
+// side while QSerialPort and the native transport each take turns on the
+// slave side. Linux only.
+namespace RtuBenchmark
+{
+    struct Result
+    {
+        QString transport;
+        int transactions = 0;
+        int failures = 0;
+        double meanUs = 0;
+        double medianUs = 0;
+        double p99Us = 0;
+        double maxUs = 0;
+    };
+
+    // Round trips of a 10-register read on each transport, after a short warm-up
+    QList<Result> run(int transactions = 1000, qint32 baudRate = 115200);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QDialog>
+#include <QStandardItemModel>
+#include "ui_ScriptDialog.h"
+#include "ModbusConnection.h"
+#include "ScriptRunner.h"
+
+// Edits and runs test scripts against one or more slaves, with a timing
+// entry for every bus operation the script performs
+class ScriptDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ScriptDialog(QWidget* parent = nullptr);
+    ~ScriptDialog();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+protected:
+    void closeEvent(QCloseEvent* event) override;
+
+private slots:
+    void onLoad();
+    void onSave();
+    void onRun();
+    void onStop();
+    void handleMessage(const QString& text);
+    void handleStepRecorded(const ScriptStep& step);
+    void handleDeviceFinished(int slaveID, bool passed, const QString& errorMessage);
+    void handleFinished(int passed, int failed);
+
+private:
+    void initUI();
+    void setupConnections();
+    void setRunning(bool running);
+
+    Ui::ScriptDialog ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    ScriptRunner* m_runner = nullptr;
+    QStandardItemModel* m_stepModel = nullptr;
+    QString m_compiledSource;   // source the runner currently holds
+};
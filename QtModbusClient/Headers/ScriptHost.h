@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJSValue>
+#include <QList>
+#include <QPointer>
+#include "ModbusConnection.h"
+
+class QJSEngine;
+class QEventLoop;
+
+// Timing of one bus operation made by a script
+struct ScriptStep
+{
+    int slaveID = 0;
+    QString step;           // label set with step() in the script
+    QString operation;
+    double durationMs = 0.0;
+    bool ok = true;
+    QString detail;
+};
+
+// The "modbus" object seen by scripts. Every call blocks the script until the
+// bus operation completes (the GUI, input included, keeps running in a nested
+// event loop), so sequences read top to bottom like awaited code. abort()
+// releases the pending operation and makes it throw, which ends the script.
+class ScriptHost : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScriptHost(QJSEngine* engine, QObject* parent = nullptr);
+
+    void setModbusConnection(ModbusConnection* connection);
+    void setSlaveID(int slaveID);
+    int slaveID() const noexcept;
+
+    void beginRun();
+    void abort();
+    bool isAborted() const noexcept;
+
+    Q_INVOKABLE QJSValue read(const QString& type, int address, int count = 1);
+    Q_INVOKABLE bool write(const QString& type, int address, const QJSValue& values);
+    Q_INVOKABLE QJSValue readWrite(int readAddress, int count, int writeAddress, const QJSValue& values);
+    Q_INVOKABLE bool maskWrite(int address, int andMask, int orMask);
+    Q_INVOKABLE QJSValue request(int functionCode, const QJSValue& bytes, int responseSize = -1);
+    Q_INVOKABLE void wait(int msec);
+    Q_INVOKABLE void check(bool condition, const QString& message);
+    Q_INVOKABLE void step(const QString& name);
+    Q_INVOKABLE void log(const QString& message);
+    Q_INVOKABLE QJSValue decode(const QJSValue& registers, const QString& dataType, const QString& order = QString());
+
+signals:
+    void message(const QString& text);
+    void stepRecorded(const ScriptStep& step);
+
+private:
+    bool awaitReply(QModbusReply* reply);
+    void record(const QString& operation, const QElapsedTimer& timer, bool ok, const QString& detail = QString());
+    void fail(const QString& operation, const QElapsedTimer& timer, const QString& error);
+
+    QJSEngine* m_engine = nullptr;
+    QPointer<ModbusConnection> m_modbusConnection;
+    QEventLoop* m_loop = nullptr;
+    QString m_step;
+    int m_slaveID = 1;
+    bool m_aborted = false;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QObject>
+#include <QJSEngine>
+#include <QJSValue>
+#include "ScriptHost.h"
+
+// Compiles a test script once and runs it against a list of slaves. The script
+// body becomes a function of the slave ID, so each device reuses the same
+// compiled code instead of re-parsing the source.
+class ScriptRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScriptRunner(QObject* parent = nullptr);
+
+    void setModbusConnection(ModbusConnection* connection);
+
+    bool compile(const QString& source, QString* errorMessage = nullptr);
+    bool isCompiled() const;
+
+    // Blocks (with the event loop running) until every slave is done or stop() is called
+    void run(const QList<int>& slaveIDs);
+    void stop();
+    bool isRunning() const noexcept;
+
+    static QList<int> parseSlaveList(const QString& text, bool* ok = nullptr);
+
+signals:
+    void message(const QString& text);
+    void stepRecorded(const ScriptStep& step);
+    void deviceFinished(int slaveID, bool passed, const QString& errorMessage);
+    void finished(int passed, int failed);
+
+private:
+    static QString describeError(const QJSValue& error);
+
+    QJSEngine m_engine;
+    ScriptHost* m_host = nullptr;
+    QJSValue m_function;
+    bool m_running = false;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QObject>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <QSerialPortInfo>
+#include <QStringList>
+#include <QTimer>
+
+class QSocketNotifier;
+
+// One enumerated port with the adapter details needed to recognise it again
+struct SerialPortEntry
+{
+    QString portName;
+    QString systemLocation;
+    QString description;
+    QString manufacturer;
+    QString serialNumber;
+    quint16 vendorId = 0;
+    quint16 productId = 0;
+    bool hasIds = false;
+
+    // Stable across replugs when the adapter reports a serial number; the
+    // port name may change (ttyUSB0 -> ttyUSB1) so it is only the fallback
+    QString identity() const;
+    QString details() const;
+};
+
+// Enumerates serial ports on a pool thread and keeps the last result, so
+// opening the connection dialog never waits on the OS port scan. While
+// monitoring, rescans are triggered by kernel uevents on Linux (polled
+// elsewhere) and reported as added/removed ports.
+class SerialPortScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SerialPortScanner(QObject* parent = nullptr);
+    ~SerialPortScanner();
+
+    QStringList ports() const;
+    QList<SerialPortEntry> entries() const;
+    bool hasResult() const noexcept;
+    bool isScanning() const;
+
+    // Scan again unless the cached list is younger than maxAgeMs
+    void refreshIfStale(int maxAgeMs);
+
+    void startMonitoring();
+    void stopMonitoring();
+    bool isMonitoring() const noexcept;
+
+public slots:
+    void refresh();
+
+signals:
+    void portsUpdated(const QStringList& ports);
+    void portAdded(const SerialPortEntry& entry);
+    void portRemoved(const SerialPortEntry& entry);
+
+private:
+    void handleScanFinished();
+    void handleUevent();
+    bool openUeventSocket();
+    void closeUeventSocket();
+
+    QFutureWatcher<QList<SerialPortEntry>> m_watcher;
+    QList<SerialPortEntry> m_entries;
+    QElapsedTimer m_age;    // invalid until the first scan completes
+    bool m_rescanPending = false;
+
+    bool m_monitoring = false;
+    int m_ueventSocket = -1;
+    QSocketNotifier* m_ueventNotifier = nullptr;
+    QTimer m_debounceTimer;     // coalesces the burst of uevents one plug produces
+    QTimer m_pollTimer;         // fallback when uevents are unavailable
+};
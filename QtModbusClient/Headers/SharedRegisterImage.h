@@ -0,0 +1,105 @@
+#pragma once
+
+#include <QObject>
+#include <QSharedMemory>
+#include <atomic>
+#include "ModbusConnection.h"
+
+// Register image of the polled slaves published in shared memory, so local
+// tools (historians, HMIs) can read current values without their own bus
+// connection and without any syscall per read.
+//
+// Segment layout, native byte order:
+//
+//     SharedImageHeader
+//     SharedSlaveImage[header.slotCount]
+//
+// Every register type of a slave is a separate SharedRegion guarded by a
+// sequence lock. The single writer makes the sequence odd, updates the
+// payload and makes it even again. A reader loads the sequence, retries
+// while it is odd, copies what it needs and accepts the copy only if the
+// sequence is unchanged afterwards.
+namespace SharedImageLayout
+{
+    constexpr quint32 magic = 0x4D42494D;    // "MBIM"
+    constexpr quint32 version = 1;
+    constexpr int addressCount = 65536;
+
+    struct SharedImageHeader {
+        quint32 magic;
+        quint32 version;
+        quint32 slotCount;
+        quint32 slotSize;
+    };
+
+    struct SharedRegion {
+        std::atomic<quint32> sequence;
+        quint32 reserved;
+        qint64 updatedMsecs;                        // ms since epoch of the last publish
+        quint8 valid[addressCount / 8];             // addresses published at least once, LSB first
+    };
+
+    struct SharedRegisterRegion : SharedRegion {
+        quint16 values[addressCount];
+    };
+
+    struct SharedBitRegion : SharedRegion {
+        quint8 bits[addressCount / 8];              // LSB-first packed, as on the wire
+    };
+
+    struct SharedSlaveImage {
+        std::atomic<quint32> slaveID;               // 0 while the slot is free
+        quint32 reserved;
+        SharedBitRegion coils;
+        SharedBitRegion discreteInputs;
+        SharedRegisterRegion inputRegisters;
+        SharedRegisterRegion holdingRegisters;
+    };
+
+    static_assert(std::atomic<quint32>::is_always_lock_free, "Shared image needs lock-free 32-bit atomics");
+}
+
+class SharedRegisterImage : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SharedRegisterImage(QObject* parent = nullptr);
+    ~SharedRegisterImage();
+
+    static QString defaultName();
+
+    // Publisher side: creates a segment with room for slotCount slaves. An
+    // existing image segment is taken over as it is, slot count and values
+    // included; any other existing segment is an error.
+    bool create(const QString& name, int slotCount = 4, QString* errorMessage = nullptr);
+    // Reader side
+    bool attach(const QString& name, QString* errorMessage = nullptr);
+    void detach();
+    bool isAttached() const;
+    QString nativeKey() const;
+
+    // Publishes every successful read made through the connection
+    void setModbusConnection(ModbusConnection* connection);
+
+    void publishRegisters(int slaveID, ModbusConnection::RegisterType type, int startAddr,
+        const QVector<quint16>& values);
+    void publishBits(int slaveID, ModbusConnection::RegisterType type, int startAddr, const BitBlock& bits);
+
+    // Consistent copy of a range; false if the slave is not in the image or
+    // part of the range was never published
+    bool readRegisters(int slaveID, ModbusConnection::RegisterType type, int startAddr, int count,
+        QVector<quint16>* values) const;
+    bool readBits(int slaveID, ModbusConnection::RegisterType type, int startAddr, int count,
+        BitBlock* bits) const;
+
+private:
+    bool adoptExisting(QString* errorMessage);
+    SharedImageLayout::SharedSlaveImage* slot(int slaveID, bool allocate) const;
+    static SharedImageLayout::SharedRegion* region(SharedImageLayout::SharedSlaveImage* slave,
+        ModbusConnection::RegisterType type);
+
+    QSharedMemory m_memory;
+    QPointer<ModbusConnection> m_modbusConnection;
+    bool m_writer = false;
+};
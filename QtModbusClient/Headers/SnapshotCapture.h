@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QObject>
+#include "ModbusConnection.h"
+#include "RegisterSnapshot.h"
+
+class QModbusReply;
+
+// Reads a list of ranges into a RegisterSnapshot, one protocol-sized chunk
+// at a time
+class SnapshotCapture : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SnapshotCapture(QObject* parent = nullptr);
+
+    void setModbusConnection(ModbusConnection* connection);
+
+    bool start(const QList<SnapshotRange>& ranges, const QString& name);
+    void cancel();
+    bool isRunning() const noexcept;
+
+signals:
+    void progress(int done, int total);
+    void finished(const RegisterSnapshot& snapshot);
+    void failed(const QString& errorMessage);
+
+private:
+    void readNextChunk();
+    void handleChunkReply(quint64 generation, int rangeIndex, int offset, QModbusReply* reply);
+    void fail(const QString& errorMessage);
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    QList<SnapshotRange> m_ranges;
+    QList<SnapshotSegment> m_segments;
+    RegisterSnapshot m_snapshot;
+
+    int m_rangeIndex = 0;
+    int m_offset = 0;
+    int m_done = 0;
+    int m_total = 0;
+    bool m_running = false;
+    quint64 m_generation = 0;
+};
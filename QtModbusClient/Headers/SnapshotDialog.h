@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QDialog>
+#include <QStandardItemModel>
+#include "ui_SnapshotDialog.h"
+#include "ModbusConnection.h"
+#include "SnapshotCapture.h"
+
+// Captures register snapshots and lists the ranges that differ between two
+// of them, or between a snapshot and the live device
+class SnapshotDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SnapshotDialog(QWidget* parent = nullptr);
+    ~SnapshotDialog();
+
+    void setModbusConnection(ModbusConnection* connection);
+
+private slots:
+    void onCapture();
+    void onLoad();
+    void onSave();
+    void onCompare();
+    void handleCaptureProgress(int done, int total);
+    void handleCaptureFinished(const RegisterSnapshot& snapshot);
+    void handleCaptureFailed(const QString& errorMessage);
+
+private:
+    void initUI();
+    void setupConnections();
+    void addSnapshot(const RegisterSnapshot& snapshot);
+    void showComparison(const RegisterSnapshot& before, const RegisterSnapshot& after);
+    void setBusy(bool busy);
+
+    Ui::SnapshotDialog ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    SnapshotCapture* m_capture = nullptr;
+    QStandardItemModel* m_diffModel = nullptr;
+
+    QList<RegisterSnapshot> m_snapshots;
+    int m_liveCompareIndex = -1;    // snapshot to compare against once a live capture finishes
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include "ModbusConnection.h"
+#include "RegisterCodec.h"
+
+// A named value on a slave, as listed in a project tag file
+struct Tag
+{
+    QString name;
+    int slaveID = 1;
+    ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+    int address = 0;
+    RegisterCodec::DataType dataType = RegisterCodec::DataType::UInt16;
+    RegisterCodec::ByteOrder order = RegisterCodec::ByteOrder::ABCD;
+    int length = 1;             // register count for ascii tags
+    double scale = 1.0;
+    double offset = 0.0;
+    QString pollClass;
+
+    // Number of registers (or bits) the tag occupies
+    int width() const noexcept;
+};
+
+// Address range on a slave that must never be read, e.g. unmapped registers
+struct AddressHole
+{
+    int slaveID = 1;
+    ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+    int start = 0;
+    int count = 0;
+};
+
+class TagDatabase
+{
+public:
+    TagDatabase();
+
+    // Loads a tag list from a .csv or .json file, replacing the current content
+    bool load(const QString& fileName, QString* errorMessage = nullptr);
+    bool loadCsv(const QString& fileName, QString* errorMessage = nullptr);
+    bool loadJson(const QString& fileName, QString* errorMessage = nullptr);
+
+    void clear();
+    void addTag(const Tag& tag);
+    void addHole(const AddressHole& hole);
+    void setPollInterval(const QString& pollClass, int intervalMs);
+
+    const QList<Tag>& tags() const noexcept;
+    const QList<AddressHole>& holes() const noexcept;
+    int pollInterval(const QString& pollClass) const;
+    QStringList pollClasses() const;
+    int indexOf(const QString& name) const;
+
+    static bool parseRegisterType(const QString& text, ModbusConnection::RegisterType* type);
+    static bool parseDataType(const QString& text, RegisterCodec::DataType* type);
+    static bool parseByteOrder(const QString& text, RegisterCodec::ByteOrder* order);
+
+private:
+    QList<Tag> m_tags;
+    QList<AddressHole> m_holes;
+    QMap<QString, int> m_pollIntervals;
+    QHash<QString, int> m_index;
+};
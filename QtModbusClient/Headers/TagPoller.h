@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+#include "ModbusConnection.h"
+#include "TagDatabase.h"
+#include "ReadPlanner.h"
+
+// Executes a compiled read plan, one timer per poll class. Tag values are
+// decoded straight from the block buffers through their precomputed location.
+// Writes to holding register tags ride on the read of their block as FC23,
+// so the new value is read back in the same transaction; bit updates of
+// 16-bit tags go out as FC22 and are followed by a read of the block.
+class TagPoller : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TagPoller(QObject* parent = nullptr);
+    ~TagPoller();
+
+    void setModbusConnection(ModbusConnection* connection);
+    void setDatabase(const TagDatabase& database, const ReadPlan& plan);
+
+    void start();
+    void stop();
+    bool isRunning() const noexcept;
+
+    const TagDatabase& database() const noexcept;
+    const ReadPlan& plan() const noexcept;
+
+    // Scaled engineering value of a tag, invalid until its block has been read
+    QVariant value(int tagIndex) const;
+
+    // Queues an engineering value for a holding register tag; a newer value
+    // for the same tag replaces one not yet sent. False if the tag is not writable.
+    bool writeTag(int tagIndex, const QVariant& value);
+    // FC22 on a 16-bit holding register tag: register = (register & andMask) | (orMask & ~andMask)
+    bool writeTagBits(int tagIndex, quint16 andMask, quint16 orMask);
+
+signals:
+    void blockUpdated(int blockIndex);
+    void blockFailed(int blockIndex, const QString& errorMessage);
+    void tagWritten(int tagIndex, bool ok, const QString& errorMessage);
+
+private:
+    struct PendingWrite
+    {
+        int tagIndex = -1;
+        QVector<quint16> values;
+    };
+
+    void pollClass(const QString& pollClass);
+    bool issueBlock(int blockIndex);
+    static void handleBlockRead(void* context, quint64 tag, const ModbusConnection::RequestResult& result);
+    static void handleMaskWrite(void* context, quint64 tag, const ModbusConnection::RequestResult& result);
+
+    QPointer<ModbusConnection> m_modbusConnection;
+    TagDatabase m_database;
+    ReadPlan m_plan;
+
+    QVector<QVector<quint16>> m_buffers;
+    QVector<bool> m_inFlight;
+    QVector<QList<PendingWrite>> m_pendingWrites;   // by block
+    QVector<int> m_writingTag;                      // tag whose FC23 is on the bus, by block
+    QList<QTimer*> m_timers;
+    quint64 m_generation = 0;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QWidget>
+#include <QStandardItemModel>
+#include "ui_TagWidget.h"
+#include "ModbusConnection.h"
+#include "TagPoller.h"
+
+class TagWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TagWidget(QWidget* parent = nullptr);
+    ~TagWidget();
+
+    void setModbusConnection(ModbusConnection* connection);
+    // Unreadable ranges known from a device profile, kept out of the read plan
+    void setKnownHoles(const QList<AddressHole>& holes);
+
+private slots:
+    void onLoadTags();
+    void onStartPolling();
+    void onStopPolling();
+    void handleBlockUpdated(int blockIndex);
+    void handleValueEdited(QStandardItem* item);
+    void handleTagWritten(int tagIndex, bool ok, const QString& errorMessage);
+
+private:
+    void initTableModel();
+    void setupConnections();
+    void populateTable();
+    void compilePlan();
+
+    Ui::TagWidget ui;
+
+    ModbusConnection* m_modbusConnection = nullptr;
+    TagPoller* m_poller = nullptr;
+    TagDatabase m_database;                 // as loaded, without the known holes
+    QList<AddressHole> m_knownHoles;
+    QStandardItemModel* m_tagModel = nullptr;
+    bool m_updatingValues = false;          // set while the poller, not the user, changes values
+};
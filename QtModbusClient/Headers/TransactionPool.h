@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QtGlobal>
+#include <memory>
+#include <vector>
+
+// Fixed-size records recycled through an intrusive free list threaded through
+// T::next. Records are allocated in blocks that live as long as the pool, so
+// once it has grown to the working set acquire() and release() never touch
+// the heap, and a record pointer stays valid while it is in use.
+// Not thread safe; hand records between threads under a lock of your own.
+template <typename T>
+class TransactionPool
+{
+public:
+    explicit TransactionPool(int blockSize = 32) : m_blockSize(qMax(1, blockSize)) {}
+    TransactionPool(const TransactionPool&) = delete;
+    TransactionPool& operator=(const TransactionPool&) = delete;
+
+    T* acquire()
+    {
+        if (!m_free) {
+            grow();
+        }
+        T* record = m_free;
+        m_free = record->next;
+        record->next = nullptr;
+        ++m_inUse;
+        return record;
+    }
+
+    // Resets the record to its default state before it is reused
+    void release(T* record)
+    {
+        *record = T();
+        record->next = m_free;
+        m_free = record;
+        --m_inUse;
+    }
+
+    int capacity() const noexcept { return int(m_blocks.size()) * m_blockSize; }
+    int inUse() const noexcept { return m_inUse; }
+
+private:
+    void grow()
+    {
+        auto block = std::make_unique<T[]>(size_t(m_blockSize));
+        for (int i = m_blockSize - 1; i >= 0; --i) {
+            block[i].next = m_free;
+            m_free = &block[i];
+        }
+        m_blocks.push_back(std::move(block));
+    }
+
+    std::vector<std::unique_ptr<T[]>> m_blocks;
+    T* m_free = nullptr;
+    int m_blockSize;
+    int m_inUse = 0;
+};
@@ -0,0 +1,225 @@
+#include "BitBlock.h"
+#include <QtAlgorithms>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+    constexpr int wordBits = 64;
+
+    int wordsFor(int size)
+    {
+        return (size + wordBits - 1) / wordBits;
+    }
+}
+
+BitBlock::BitBlock(int size, bool value)
+    : m_words(wordsFor(qMax(0, size)), value ? ~quint64(0) : 0),
+    m_size(qMax(0, size))
+{
+    clearPadding();
+}
+
+BitBlock BitBlock::fromPackedBytes(const char* data, qsizetype byteCount, int size)
+{
+    BitBlock block(size);
+    const qsizetype usable = qMin<qsizetype>(byteCount, (qsizetype(size) + 7) / 8);
+
+    for (int w = 0; w < block.m_words.size(); ++w) {
+        const qsizetype offset = qsizetype(w) * 8;
+        if (offset >= usable) {
+            break;
+        }
+        uchar bytes[8] = {};
+        std::memcpy(bytes, data + offset, size_t(qMin<qsizetype>(8, usable - offset)));
+        block.m_words[w] = qFromLittleEndian<quint64>(bytes);
+    }
+
+    block.clearPadding();
+    return block;
+}
+
+QByteArray BitBlock::toPackedBytes() const
+{
+    QByteArray bytes(packedSize(), Qt::Uninitialized);
+    toPackedBytes(bytes.data());
+    return bytes;
+}
+
+void BitBlock::toPackedBytes(char* dest) const noexcept
+{
+    const int byteCount = packedSize();
+    for (int w = 0; w < m_words.size(); ++w) {
+        uchar word[8];
+        qToLittleEndian<quint64>(m_words[w], word);
+        const int offset = w * 8;
+        std::memcpy(dest + offset, word, size_t(qMin(8, byteCount - offset)));
+    }
+}
+
+int BitBlock::packedSize() const noexcept
+{
+    return (m_size + 7) / 8;
+}
+
+int BitBlock::size() const noexcept
+{
+    return m_size;
+}
+
+bool BitBlock::isEmpty() const noexcept
+{
+    return m_size == 0;
+}
+
+void BitBlock::resize(int size)
+{
+    m_size = qMax(0, size);
+    m_words.resize(wordsFor(m_size));
+    clearPadding();
+}
+
+bool BitBlock::testBit(int index) const noexcept
+{
+    if (index < 0 || index >= m_size) {
+        return false;
+    }
+    return (m_words[index / wordBits] >> (index % wordBits)) & 1;
+}
+
+void BitBlock::setBit(int index, bool value) noexcept
+{
+    if (index < 0 || index >= m_size) {
+        return;
+    }
+    const quint64 mask = quint64(1) << (index % wordBits);
+    if (value) {
+        m_words[index / wordBits] |= mask;
+    }
+    else {
+        m_words[index / wordBits] &= ~mask;
+    }
+}
+
+void BitBlock::fill(bool value) noexcept
+{
+    m_words.fill(value ? ~quint64(0) : 0);
+    clearPadding();
+}
+
+BitBlock BitBlock::mid(int position, int length) const
+{
+    position = qBound(0, position, m_size);
+    length = qBound(0, length, m_size - position);
+
+    BitBlock block(length);
+    const int first = position / wordBits;
+    const int shift = position % wordBits;
+    for (int w = 0; w < block.m_words.size(); ++w) {
+        quint64 word = m_words[first + w] >> shift;
+        if (shift != 0 && first + w + 1 < m_words.size()) {
+            word |= m_words[first + w + 1] << (wordBits - shift);
+        }
+        block.m_words[w] = word;
+    }
+
+    block.clearPadding();
+    return block;
+}
+
+int BitBlock::count(bool on) const noexcept
+{
+    int set = 0;
+    for (const quint64 word : m_words) {
+        set += qPopulationCount(word);
+    }
+    return on ? set : m_size - set;
+}
+
+quint8 BitBlock::byteAt(int index) const noexcept
+{
+    if (index < 0 || index * 8 >= m_size) {
+        return 0;
+    }
+    return quint8(m_words[index / 8] >> ((index % 8) * 8));
+}
+
+int BitBlock::nextSetBit(int from) const noexcept
+{
+    if (from < 0) {
+        from = 0;
+    }
+    if (from >= m_size) {
+        return -1;
+    }
+
+    int w = from / wordBits;
+    quint64 bits = m_words[w] & (~quint64(0) << (from % wordBits));
+    while (bits == 0) {
+        if (++w >= m_words.size()) {
+            return -1;
+        }
+        bits = m_words[w];
+    }
+    return w * wordBits + int(qCountTrailingZeroBits(bits));
+}
+
+QList<AddressRange> BitBlock::diff(const BitBlock& other, int baseAddress) const
+{
+    const int common = qMin(m_size, other.m_size);
+    const int total = qMax(m_size, other.m_size);
+
+    // XOR of both blocks, with every bit past the shorter block marked as changed
+    auto changedWord = [&](int w) -> quint64 {
+        const quint64 a = w < m_words.size() ? m_words[w] : 0;
+        const quint64 b = w < other.m_words.size() ? other.m_words[w] : 0;
+        quint64 x = a ^ b;
+        const int first = w * wordBits;
+        if (first + wordBits > common && total > common) {
+            const int tailStart = qMax(0, common - first);
+            x |= ~quint64(0) << tailStart;
+        }
+        return x;
+    };
+
+    // First bit at or after from whose changed state equals wanted, or total
+    auto find = [&](int from, bool wanted) -> int {
+        int w = from / wordBits;
+        quint64 bits = wanted ? changedWord(w) : ~changedWord(w);
+        bits &= ~quint64(0) << (from % wordBits);
+        while (bits == 0) {
+            ++w;
+            if (w * wordBits >= total) {
+                return total;
+            }
+            bits = wanted ? changedWord(w) : ~changedWord(w);
+        }
+        return qMin(total, w * wordBits + int(qCountTrailingZeroBits(bits)));
+    };
+
+    QList<AddressRange> ranges;
+    int i = 0;
+    while (i < total) {
+        const int start = find(i, true);
+        if (start >= total) {
+            break;
+        }
+        const int end = find(start, false);
+        ranges.append(AddressRange{ baseAddress + start, end - start });
+        i = end;
+    }
+    return ranges;
+}
+
+bool BitBlock::operator==(const BitBlock& other) const noexcept
+{
+    return m_size == other.m_size && m_words == other.m_words;
+}
+
+// Keeps the bits past size cleared so word-level operations stay exact
+void BitBlock::clearPadding() noexcept
+{
+    const int used = m_size % wordBits;
+    if (used != 0 && !m_words.isEmpty()) {
+        m_words.last() &= (quint64(1) << used) - 1;
+    }
+}
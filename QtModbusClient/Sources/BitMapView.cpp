@@ -0,0 +1,277 @@
+#include "BitMapView.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QHelpEvent>
+#include <QToolTip>
+#include <QtMath>
+
+namespace {
+    constexpr int tileBits = 16;    // tiles are 16 x 16 cells
+    constexpr int maxColumns = 256;
+
+    constexpr QRgb backgroundColor = qRgb(24, 24, 24);
+    constexpr QRgb unknownColor = qRgb(64, 64, 64);
+    constexpr QRgb offColor = qRgb(96, 96, 96);
+    constexpr QRgb onColor = qRgb(46, 204, 64);
+    constexpr QRgb turnedOffColor = qRgb(230, 70, 60);
+    constexpr QRgb turnedOnColor = qRgb(255, 220, 0);
+
+    // Power of two column count that keeps the grid roughly square
+    int columnsFor(int count)
+    {
+        int columns = 8;
+        while (columns < maxColumns && columns * columns < count) {
+            columns *= 2;
+        }
+        return columns;
+    }
+}
+
+BitMapView::BitMapView(QWidget* parent)
+    : QWidget(parent)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMouseTracking(true);
+    m_clock.start();
+
+    m_highlightTimer.setInterval(100);
+    connect(&m_highlightTimer, &QTimer::timeout, this, &BitMapView::expireHighlights);
+
+    setRange(0, 0);
+}
+
+void BitMapView::setRange(int startAddress, int count)
+{
+    count = qBound(0, count, 65536);
+    m_highlightExpiry.clear();
+    m_highlightQueue.clear();
+    m_highlightTimer.stop();
+
+    m_startAddress = startAddress;
+    m_columns = columnsFor(count);
+    m_bits = BitBlock(count);
+    m_known = BitBlock(count);
+
+    const int rows = qMax(1, (count + m_columns - 1) / m_columns);
+    m_image = QImage(m_columns, rows, QImage::Format_RGB32);
+    m_image.fill(backgroundColor);
+    for (int i = 0; i < count; ++i) {
+        renderCell(i);
+    }
+
+    const int tileRows = (rows + tileBits - 1) / tileBits;
+    m_dirtyTileMask = BitBlock(tileColumns() * tileRows);
+    m_dirtyTiles.clear();
+
+    updateGeometry();
+    update();
+}
+
+// Only bits whose state differs from the last known one are redrawn; the
+// first value received for a bit is not treated as a change
+void BitMapView::updateBits(int offset, const BitBlock& bits)
+{
+    const qint64 expiry = m_clock.elapsed() + m_highlightDuration;
+    int changed = 0;
+
+    const int end = qMin(m_bits.size(), offset + bits.size());
+    for (int index = qMax(0, offset); index < end; ++index) {
+        const bool value = bits.testBit(index - offset);
+        const bool known = m_known.testBit(index);
+        if (known && m_bits.testBit(index) == value) {
+            continue;
+        }
+
+        m_bits.setBit(index, value);
+        m_known.setBit(index);
+        if (known) {
+            ++changed;
+            m_highlightExpiry.insert(index, expiry);
+            m_highlightQueue.enqueue(Highlight{ index, expiry });
+        }
+        renderCell(index);
+        markDirty(index);
+    }
+
+    flushDirtyTiles();
+
+    if (changed > 0) {
+        if (!m_highlightTimer.isActive()) {
+            m_highlightTimer.start();
+        }
+        emit bitsChanged(changed);
+    }
+}
+
+int BitMapView::startAddress() const noexcept
+{
+    return m_startAddress;
+}
+
+int BitMapView::bitCount() const noexcept
+{
+    return m_bits.size();
+}
+
+const BitBlock& BitMapView::bits() const noexcept
+{
+    return m_bits;
+}
+
+int BitMapView::highlightedCount() const noexcept
+{
+    return int(m_highlightExpiry.size());
+}
+
+void BitMapView::setHighlightDuration(int msec)
+{
+    m_highlightDuration = qMax(0, msec);
+}
+
+QSize BitMapView::sizeHint() const
+{
+    return QSize(512, 512);
+}
+
+QSize BitMapView::minimumSizeHint() const
+{
+    return QSize(m_image.width(), m_image.height());
+}
+
+void BitMapView::paintEvent(QPaintEvent* event)
+{
+    QPainter painter(this);
+    painter.fillRect(event->rect(), QColor(backgroundColor));
+
+    const int cell = cellSize();
+    const QRect target(0, 0, m_image.width() * cell, m_image.height() * cell);
+    const QRect dirty = event->rect() & target;
+    if (dirty.isEmpty()) {
+        return;
+    }
+
+    // Scale only the part of the image covering the exposed area
+    const QRect source(dirty.left() / cell, dirty.top() / cell,
+        (dirty.right() / cell) - (dirty.left() / cell) + 1,
+        (dirty.bottom() / cell) - (dirty.top() / cell) + 1);
+    const QRect scaled(source.left() * cell, source.top() * cell, source.width() * cell, source.height() * cell);
+    painter.drawImage(scaled, m_image, source);
+
+    // Cell grid once cells are large enough to separate
+    if (cell >= 6) {
+        painter.setPen(QColor(backgroundColor));
+        for (int x = scaled.left(); x <= scaled.right() + 1; x += cell) {
+            painter.drawLine(x, scaled.top(), x, scaled.bottom());
+        }
+        for (int y = scaled.top(); y <= scaled.bottom() + 1; y += cell) {
+            painter.drawLine(scaled.left(), y, scaled.right(), y);
+        }
+    }
+}
+
+bool BitMapView::event(QEvent* event)
+{
+    if (event->type() == QEvent::ToolTip) {
+        auto* helpEvent = static_cast<QHelpEvent*>(event);
+        const int index = indexAt(helpEvent->pos());
+        if (index >= 0) {
+            const QString state = m_known.testBit(index)
+                ? (m_bits.testBit(index) ? QStringLiteral("1") : QStringLiteral("0"))
+                : QStringLiteral("?");
+            QToolTip::showText(helpEvent->globalPos(),
+                tr("Address %1: %2").arg(m_startAddress + index).arg(state), this);
+        }
+        else {
+            QToolTip::hideText();
+            event->ignore();
+        }
+        return true;
+    }
+    return QWidget::event(event);
+}
+
+void BitMapView::renderCell(int index)
+{
+    QRgb color = unknownColor;
+    if (m_known.testBit(index)) {
+        const bool on = m_bits.testBit(index);
+        if (m_highlightExpiry.contains(index)) {
+            color = on ? turnedOnColor : turnedOffColor;
+        }
+        else {
+            color = on ? onColor : offColor;
+        }
+    }
+    reinterpret_cast<QRgb*>(m_image.scanLine(index / m_columns))[index % m_columns] = color;
+}
+
+void BitMapView::markDirty(int index)
+{
+    const int tile = (index / m_columns / tileBits) * tileColumns() + (index % m_columns) / tileBits;
+    if (!m_dirtyTileMask.testBit(tile)) {
+        m_dirtyTileMask.setBit(tile);
+        m_dirtyTiles.append(tile);
+    }
+}
+
+void BitMapView::flushDirtyTiles()
+{
+    const int cell = cellSize();
+    const int columns = tileColumns();
+    for (const int tile : std::as_const(m_dirtyTiles)) {
+        const int x = (tile % columns) * tileBits * cell;
+        const int y = (tile / columns) * tileBits * cell;
+        update(QRect(x, y, tileBits * cell, tileBits * cell));
+        m_dirtyTileMask.setBit(tile, false);
+    }
+    m_dirtyTiles.clear();
+}
+
+// Highlights expire in the order they were set, so only the queue head is checked
+void BitMapView::expireHighlights()
+{
+    const qint64 now = m_clock.elapsed();
+    while (!m_highlightQueue.isEmpty() && m_highlightQueue.head().expiry <= now) {
+        const Highlight highlight = m_highlightQueue.dequeue();
+
+        // A bit that changed again since has a later entry further down the queue
+        const auto it = m_highlightExpiry.constFind(highlight.index);
+        if (it == m_highlightExpiry.cend() || it.value() != highlight.expiry) {
+            continue;
+        }
+        m_highlightExpiry.erase(it);
+        renderCell(highlight.index);
+        markDirty(highlight.index);
+    }
+
+    flushDirtyTiles();
+
+    if (m_highlightQueue.isEmpty()) {
+        m_highlightTimer.stop();
+    }
+}
+
+int BitMapView::tileColumns() const
+{
+    return (m_columns + tileBits - 1) / tileBits;
+}
+
+int BitMapView::cellSize() const
+{
+    if (m_image.isNull()) {
+        return 1;
+    }
+    return qMax(1, qMin(width() / m_image.width(), height() / m_image.height()));
+}
+
+int BitMapView::indexAt(const QPoint& pos) const
+{
+    const int cell = cellSize();
+    const int column = pos.x() / cell;
+    const int row = pos.y() / cell;
+    if (pos.x() < 0 || pos.y() < 0 || column >= m_columns) {
+        return -1;
+    }
+    const int index = row * m_columns + column;
+    return index < m_bits.size() ? index : -1;
+}
@@ -0,0 +1,173 @@
+#include "BitMapWidget.h"
+#include <QMessageBox>
+#include <QModbusReply>
+#include <QDebug>
+
+namespace {
+    constexpr int maxBitsPerRead = 2000;
+}
+
+BitMapWidget::BitMapWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    ui.setupUi(this);
+    initUI();
+    setupConnections();
+}
+
+void BitMapWidget::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+}
+
+void BitMapWidget::initUI()
+{
+    ui.bitMapTypeComboBox->addItem(tr("Coils"), int(ModbusConnection::Coils));
+    ui.bitMapTypeComboBox->addItem(tr("Discrete Inputs"), int(ModbusConnection::DiscreteInputs));
+
+    ui.bitMapAddressSpinBox->setRange(0, 65535);
+    ui.bitMapCountSpinBox->setRange(1, 65536);
+    ui.bitMapCountSpinBox->setValue(4096);
+    ui.bitMapIntervalSpinBox->setRange(100, 60000);
+    ui.bitMapIntervalSpinBox->setValue(1000);
+    ui.bitMapIntervalSpinBox->setSuffix(tr(" ms"));
+
+    m_refreshTimer.setSingleShot(true);
+    updateSummary();
+}
+
+void BitMapWidget::setupConnections()
+{
+    connect(ui.bitMapReadBtn, &QPushButton::clicked, this, &BitMapWidget::onReadClicked);
+    connect(ui.bitMapAutoCheckBox, &QCheckBox::toggled, this, &BitMapWidget::onAutoRefreshToggled);
+    connect(ui.bitMapView, &BitMapView::bitsChanged, this, &BitMapWidget::handleBitsChanged);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &BitMapWidget::startScan);
+}
+
+void BitMapWidget::onReadClicked()
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    startScan();
+}
+
+void BitMapWidget::onAutoRefreshToggled(bool checked)
+{
+    if (!checked) {
+        m_refreshTimer.stop();
+    }
+    else if (!m_scanning) {
+        onReadClicked();
+    }
+}
+
+void BitMapWidget::handleBitsChanged(int changedCount)
+{
+    m_lastChanges += changedCount;
+}
+
+// Starts a pass over the whole range; the view keeps its state when the range is unchanged
+void BitMapWidget::startScan()
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        ui.bitMapAutoCheckBox->setChecked(false);
+        return;
+    }
+
+    const int start = ui.bitMapAddressSpinBox->value();
+    const int count = qMin(ui.bitMapCountSpinBox->value(), 65536 - start);
+    m_scanType = selectedType();
+
+    const bool sameRange = ui.bitMapView->startAddress() == start && ui.bitMapView->bitCount() == count
+        && m_viewType == m_scanType;
+    if (!sameRange) {
+        ui.bitMapView->setRange(start, count);
+        m_viewType = m_scanType;
+    }
+
+    ++m_generation;
+    m_scanOffset = 0;
+    m_lastChanges = 0;
+    m_scanning = true;
+    ui.bitMapReadBtn->setEnabled(false);
+    readNextChunk();
+}
+
+void BitMapWidget::readNextChunk()
+{
+    const int remaining = ui.bitMapView->bitCount() - m_scanOffset;
+    if (remaining <= 0) {
+        finishScan();
+        return;
+    }
+
+    const int count = qMin(remaining, maxBitsPerRead);
+    const int offset = m_scanOffset;
+    QModbusReply* reply = m_modbusConnection
+        ? m_modbusConnection->readBits(m_scanType, ui.bitMapView->startAddress() + offset, quint16(count))
+        : nullptr;
+    if (!reply) {
+        qWarning() << "Bit map read could not be sent at offset" << offset;
+        finishScan();
+        return;
+    }
+
+    m_scanOffset += count;
+    const quint64 generation = m_generation;
+    connect(reply, &QModbusReply::finished, this, [this, generation, offset, reply]() {
+        handleChunkReply(generation, offset, reply);
+        });
+}
+
+void BitMapWidget::handleChunkReply(quint64 generation, int offset, QModbusReply* reply)
+{
+    reply->deleteLater();
+
+    // A newer scan replaced this one
+    if (generation != m_generation) {
+        return;
+    }
+
+    const BitBlock bits = ModbusConnection::bitsFromReply(reply);
+    if (bits.isEmpty()) {
+        qDebug() << "Bit map read error at offset" << offset << ":" << reply->errorString();
+        finishScan();
+        return;
+    }
+
+    ui.bitMapView->updateBits(offset, bits);
+    readNextChunk();
+}
+
+void BitMapWidget::finishScan()
+{
+    m_scanning = false;
+    ui.bitMapReadBtn->setEnabled(true);
+    updateSummary();
+
+    if (ui.bitMapAutoCheckBox->isChecked()) {
+        m_refreshTimer.start(ui.bitMapIntervalSpinBox->value());
+    }
+}
+
+void BitMapWidget::updateSummary()
+{
+    const BitBlock& bits = ui.bitMapView->bits();
+    if (bits.isEmpty()) {
+        ui.bitMapSummaryLabel->setText(tr("No data"));
+        return;
+    }
+
+    ui.bitMapSummaryLabel->setText(tr("%1 bits, %2 on, %3 changed in last scan")
+        .arg(bits.size())
+        .arg(bits.count())
+        .arg(m_lastChanges));
+}
+
+ModbusConnection::RegisterType BitMapWidget::selectedType() const
+{
+    return static_cast<ModbusConnection::RegisterType>(ui.bitMapTypeComboBox->currentData().toInt());
+}
@@ -0,0 +1,163 @@
+#include "BitTableModel.h"
+#include <QBrush>
+#include <QColor>
+
+BitTableModel::BitTableModel(QObject* parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+void BitTableModel::setCheckable(bool checkable)
+{
+    beginResetModel();
+    m_checkable = checkable;
+    endResetModel();
+}
+
+void BitTableModel::setBits(int startAddress, const BitBlock& bits)
+{
+    if (startAddress != m_startAddress || bits.size() != m_bits.size()) {
+        beginResetModel();
+        m_startAddress = startAddress;
+        m_bits = bits;
+        m_changed = BitBlock(bits.size());
+        endResetModel();
+        return;
+    }
+
+    const QList<AddressRange> changes = m_bits.diff(bits);
+    const BitBlock previousChanged = m_changed;
+    m_bits = bits;
+    m_changed = BitBlock(bits.size());
+    for (const AddressRange& range : changes) {
+        for (int i = range.start; i < range.end(); ++i) {
+            m_changed.setBit(i);
+        }
+        emitRowsChanged(range.start, range.end() - 1);
+    }
+
+    // Clear the highlight of rows that changed last time but not now
+    for (int row = previousChanged.nextSetBit(0); row >= 0; row = previousChanged.nextSetBit(row + 1)) {
+        if (!m_changed.testBit(row)) {
+            emitRowsChanged(row, row);
+        }
+    }
+}
+
+void BitTableModel::resize(int startAddress, int count)
+{
+    setBits(startAddress, BitBlock(count));
+}
+
+// Sets every bit at once, word by word
+void BitTableModel::fill(bool value)
+{
+    if (m_bits.isEmpty()) {
+        return;
+    }
+    m_bits.fill(value);
+    emitRowsChanged(0, m_bits.size() - 1);
+}
+
+const BitBlock& BitTableModel::bits() const noexcept
+{
+    return m_bits;
+}
+
+int BitTableModel::startAddress() const noexcept
+{
+    return m_startAddress;
+}
+
+int BitTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_bits.size();
+}
+
+int BitTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant BitTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_bits.size()) {
+        return QVariant();
+    }
+
+    const int row = index.row();
+    const bool value = m_bits.testBit(row);
+
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case AddressColumn:
+            return m_startAddress + row;
+        case HexColumn:
+            if (row % 8 == 0) {
+                return QString("0x%1").arg(m_bits.byteAt(row / 8), 2, 16, QChar('0')).toUpper();
+            }
+            return QVariant();
+        case BinaryColumn:
+            return value ? QStringLiteral("1") : QStringLiteral("0");
+        default:
+            return QVariant();
+        }
+    case Qt::CheckStateRole:
+        if (m_checkable && index.column() == HexColumn) {
+            return value ? Qt::Checked : Qt::Unchecked;
+        }
+        return QVariant();
+    case Qt::BackgroundRole:
+        if (m_changed.testBit(row)) {
+            return QBrush(QColor(255, 236, 179));
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+bool BitTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (!m_checkable || role != Qt::CheckStateRole || index.column() != HexColumn
+        || index.row() >= m_bits.size()) {
+        return false;
+    }
+
+    m_bits.setBit(index.row(), value.toInt() == Qt::Checked);
+    emitRowsChanged(index.row(), index.row());
+    return true;
+}
+
+Qt::ItemFlags BitTableModel::flags(const QModelIndex& index) const
+{
+    Qt::ItemFlags itemFlags = QAbstractTableModel::flags(index);
+    if (m_checkable && index.column() == HexColumn) {
+        itemFlags |= Qt::ItemIsUserCheckable;
+    }
+    return itemFlags;
+}
+
+QVariant BitTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (orientation == Qt::Vertical) {
+        return section + 1;
+    }
+
+    switch (section) {
+    case AddressColumn: return tr("Address");
+    case HexColumn: return tr("Hex");
+    case BinaryColumn: return tr("Binary");
+    default: return QVariant();
+    }
+}
+
+// Also refreshes the hex cells of the bytes containing the rows
+void BitTableModel::emitRowsChanged(int firstRow, int lastRow)
+{
+    emit dataChanged(index(firstRow - firstRow % 8, AddressColumn), index(lastRow, BinaryColumn));
+}
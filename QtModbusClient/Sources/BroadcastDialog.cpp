@@ -0,0 +1,131 @@
+#include "BroadcastDialog.h"
+#include <QMessageBox>
+#include <QModbusReply>
+#include <QDebug>
+
+BroadcastDialog::BroadcastDialog(QWidget* parent)
+    : QDialog(parent)
+{
+    ui.setupUi(this);
+    initUI();
+    setupConnections();
+}
+
+BroadcastDialog::~BroadcastDialog() {}
+
+void BroadcastDialog::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+    if (m_modbusConnection) {
+        ui.broadcastTurnaroundSpinBox->setValue(m_modbusConnection->broadcastTurnaround());
+        ui.broadcastFanOutSpinBox->setValue(m_modbusConnection->broadcastFanOut());
+    }
+    updateStatistics();
+}
+
+void BroadcastDialog::initUI()
+{
+    ui.broadcastTypeComboBox->addItem(tr("Coils"), ModbusConnection::Coils);
+    ui.broadcastTypeComboBox->addItem(tr("Holding Registers"), ModbusConnection::HoldingRegisters);
+    ui.broadcastTypeComboBox->setCurrentIndex(1);
+
+    ui.broadcastAddressSpinBox->setRange(0, 65535);
+    ui.broadcastValuesLineEdit->setPlaceholderText(tr("e.g. 100 or 1,0,1"));
+    ui.broadcastTurnaroundSpinBox->setRange(0, 1000);
+    ui.broadcastTurnaroundSpinBox->setValue(100);
+    ui.broadcastFanOutSpinBox->setRange(1, 247);
+}
+
+void BroadcastDialog::setupConnections()
+{
+    connect(ui.broadcastSendBtn, &QPushButton::clicked, this, &BroadcastDialog::onSend);
+    connect(ui.broadcastResetBtn, &QPushButton::clicked, this, &BroadcastDialog::onReset);
+    connect(ui.broadcastCloseBtn, &QPushButton::clicked, this, &QDialog::reject);
+}
+
+// One value uses FC05/FC06, several use FC15/FC16
+void BroadcastDialog::onSend()
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    const auto type = static_cast<ModbusConnection::RegisterType>(ui.broadcastTypeComboBox->currentData().toInt());
+    const int address = ui.broadcastAddressSpinBox->value();
+
+    QVector<quint16> values;
+    for (const QString& text : ui.broadcastValuesLineEdit->text().split(',', Qt::SkipEmptyParts)) {
+        bool ok = false;
+        const uint value = text.trimmed().toUInt(&ok, 0);
+        if (!ok || value > 0xFFFF || (type == ModbusConnection::Coils && value > 1)) {
+            QMessageBox::warning(this, tr("Error"), tr("Invalid value: %1").arg(text.trimmed()));
+            return;
+        }
+        values.append(quint16(value));
+    }
+    const int limit = type == ModbusConnection::Coils ? 1968 : 123;
+    if (values.isEmpty() || values.size() > limit || address + values.size() > 65536) {
+        QMessageBox::warning(this, tr("Error"), tr("Enter between 1 and %1 values").arg(limit));
+        return;
+    }
+
+    m_modbusConnection->setBroadcastTurnaround(ui.broadcastTurnaroundSpinBox->value());
+    m_modbusConnection->setBroadcastFanOut(ui.broadcastFanOutSpinBox->value());
+
+    QModbusReply* reply = nullptr;
+    if (type == ModbusConnection::Coils) {
+        if (values.size() == 1) {
+            reply = m_modbusConnection->broadcastCoil(address, values[0] != 0);
+        }
+        else {
+            BitBlock bits(int(values.size()));
+            for (int i = 0; i < values.size(); ++i) {
+                bits.setBit(i, values[i] != 0);
+            }
+            reply = m_modbusConnection->broadcastCoils(address, bits);
+        }
+    }
+    else {
+        reply = values.size() == 1
+            ? m_modbusConnection->broadcastRegister(address, values[0])
+            : m_modbusConnection->broadcastRegisters(address, values);
+    }
+
+    if (!reply) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to send broadcast"));
+        return;
+    }
+
+    ui.broadcastSendBtn->setEnabled(false);
+    connect(reply, &QModbusReply::finished, this, [this, reply]() {
+        ui.broadcastSendBtn->setEnabled(true);
+        if (reply->error() != QModbusDevice::NoError) {
+            QMessageBox::critical(this, tr("Error"), tr("Broadcast failed: %1").arg(reply->errorString()));
+        }
+        updateStatistics();
+        reply->deleteLater();
+        });
+}
+
+void BroadcastDialog::onReset()
+{
+    if (m_modbusConnection) {
+        m_modbusConnection->resetBroadcastStatistics();
+    }
+    updateStatistics();
+}
+
+void BroadcastDialog::updateStatistics()
+{
+    if (!m_modbusConnection) {
+        ui.broadcastStatsLabel->clear();
+        return;
+    }
+
+    const ModbusConnection::BroadcastStatistics stats = m_modbusConnection->broadcastStatistics();
+    ui.broadcastStatsLabel->setText(tr("Frames: %1 (%2 failed), PDU bytes: %3, bus time: %4 ms\n"
+        "Deliveries: %5, round trips saved: %6")
+        .arg(stats.frames).arg(stats.failed).arg(stats.pduBytes).arg(stats.busTimeMs)
+        .arg(stats.deliveries).arg(stats.roundTripsSaved()));
+}
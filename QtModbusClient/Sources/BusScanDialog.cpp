@@ -0,0 +1,310 @@
+#include "BusScanDialog.h"
+#include <QMessageBox>
+#include <QHeaderView>
+#include <QSet>
+#include <algorithm>
+#include <QDebug>
+
+namespace {
+    enum Column { PortColumn, SettingsColumn, SlaveColumn, RangesColumn };
+
+    QString typeShortName(ModbusConnection::RegisterType type)
+    {
+        switch (type) {
+        case ModbusConnection::Coils: return QStringLiteral("COIL");
+        case ModbusConnection::DiscreteInputs: return QStringLiteral("DI");
+        case ModbusConnection::InputRegisters: return QStringLiteral("IR");
+        case ModbusConnection::HoldingRegisters: return QStringLiteral("HR");
+        }
+        return QString();
+    }
+}
+
+BusScanDialog::BusScanDialog(QWidget* parent)
+    : QDialog(parent)
+{
+    ui.setupUi(this);
+    initUI();
+    setupConnections();
+}
+
+BusScanDialog::~BusScanDialog()
+{
+    for (BusScanner* scanner : m_scanners) {
+        scanner->cancel();
+    }
+}
+
+void BusScanDialog::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+}
+
+void BusScanDialog::setPortScanner(SerialPortScanner* scanner)
+{
+    m_portScanner = scanner;
+    if (m_portScanner) {
+        connect(m_portScanner, &SerialPortScanner::portsUpdated, this, &BusScanDialog::updatePortList);
+        updatePortList(m_portScanner->ports());
+        m_portScanner->refreshIfStale(2000);
+    }
+}
+
+void BusScanDialog::initUI()
+{
+    ui.busScanBaudLineEdit->setText(QStringLiteral("9600,19200,38400,57600,115200"));
+    ui.busScanFirstIDSpinBox->setRange(1, 247);
+    ui.busScanFirstIDSpinBox->setValue(1);
+    ui.busScanLastIDSpinBox->setRange(1, 247);
+    ui.busScanLastIDSpinBox->setValue(247);
+
+    m_resultModel = new QStandardItemModel(this);
+    m_resultModel->setHorizontalHeaderLabels({ tr("Port"), tr("Settings"), tr("Slave"), tr("Readable Ranges") });
+    ui.busScanResultTableView->setModel(m_resultModel);
+    ui.busScanResultTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    ui.busScanResultTableView->horizontalHeader()->setStretchLastSection(true);
+    ui.busScanResultTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui.busScanResultTableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    ui.busScanResultTableView->setSelectionMode(QAbstractItemView::SingleSelection);
+
+    ui.busScanProgressBar->setValue(0);
+    setRunning(false);
+}
+
+void BusScanDialog::setupConnections()
+{
+    connect(ui.busScanStartBtn, &QPushButton::clicked, this, &BusScanDialog::onStart);
+    connect(ui.busScanStopBtn, &QPushButton::clicked, this, &BusScanDialog::onStop);
+    connect(ui.busScanConnectBtn, &QPushButton::clicked, this, &BusScanDialog::onConnect);
+    connect(ui.busScanCloseBtn, &QPushButton::clicked, this, &QDialog::reject);
+    connect(ui.busScanResultTableView, &QTableView::doubleClicked, this, &BusScanDialog::onConnect);
+}
+
+// Keeps the check state of ports that are still present
+void BusScanDialog::updatePortList(const QStringList& ports)
+{
+    QSet<QString> checked;
+    for (int i = 0; i < ui.busScanPortListWidget->count(); ++i) {
+        QListWidgetItem* item = ui.busScanPortListWidget->item(i);
+        if (item->checkState() == Qt::Checked) {
+            checked.insert(item->text());
+        }
+    }
+
+    ui.busScanPortListWidget->clear();
+    for (const QString& port : ports) {
+        auto item = new QListWidgetItem(port, ui.busScanPortListWidget);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(checked.contains(port) ? Qt::Checked : Qt::Unchecked);
+    }
+}
+
+// Baud rates in the order typed, each with every selected parity
+QList<BusScanSettings> BusScanDialog::selectedSettings(bool* ok) const
+{
+    QList<QSerialPort::Parity> parities;
+    if (ui.busScanNoneCheckBox->isChecked()) parities << QSerialPort::NoParity;
+    if (ui.busScanEvenCheckBox->isChecked()) parities << QSerialPort::EvenParity;
+    if (ui.busScanOddCheckBox->isChecked()) parities << QSerialPort::OddParity;
+
+    QList<BusScanSettings> settings;
+    *ok = !parities.isEmpty();
+    for (const QString& text : ui.busScanBaudLineEdit->text().split(',', Qt::SkipEmptyParts)) {
+        bool valid = false;
+        const int baudRate = text.trimmed().toInt(&valid);
+        if (!valid || baudRate <= 0) {
+            *ok = false;
+            break;
+        }
+        for (const QSerialPort::Parity parity : parities) {
+            BusScanSettings entry;
+            entry.baudRate = baudRate;
+            entry.parity = parity;
+            settings.append(entry);
+        }
+    }
+
+    if (settings.isEmpty()) {
+        *ok = false;
+    }
+    return settings;
+}
+
+void BusScanDialog::onStart()
+{
+    bool ok = false;
+    const QList<BusScanSettings> settings = selectedSettings(&ok);
+    if (!ok) {
+        QMessageBox::warning(this, tr("Error"), tr("Enter baud rates such as 9600,19200 and select at least one parity"));
+        return;
+    }
+
+    const int firstID = ui.busScanFirstIDSpinBox->value();
+    const int lastID = ui.busScanLastIDSpinBox->value();
+    if (lastID < firstID) {
+        QMessageBox::warning(this, tr("Error"), tr("Invalid slave ID range"));
+        return;
+    }
+
+    QStringList ports;
+    for (int i = 0; i < ui.busScanPortListWidget->count(); ++i) {
+        QListWidgetItem* item = ui.busScanPortListWidget->item(i);
+        if (item->checkState() != Qt::Checked) {
+            continue;
+        }
+        // The port held by the main connection cannot be opened a second time
+        if (m_modbusConnection && m_modbusConnection->isConnected()
+            && m_modbusConnection->getPortName() == item->text()) {
+            QMessageBox::warning(this, tr("Error"), tr("%1 is in use by the current connection").arg(item->text()));
+            continue;
+        }
+        ports << item->text();
+    }
+    if (ports.isEmpty()) {
+        QMessageBox::warning(this, tr("Error"), tr("Select at least one serial port"));
+        return;
+    }
+
+    qDeleteAll(m_scanners);
+    m_scanners.clear();
+    m_progress.clear();
+    m_results.clear();
+    m_resultModel->removeRows(0, m_resultModel->rowCount());
+
+    // Every port gets its own scanner so they run side by side
+    for (const QString& port : ports) {
+        auto scanner = new BusScanner(this);
+        scanner->setCharacterize(ui.busScanCharacterizeCheckBox->isChecked());
+        connect(scanner, &BusScanner::progress, this, [this, scanner](int done, int total) {
+            m_progress[scanner] = qMakePair(done, total);
+            updateProgress();
+            });
+        connect(scanner, &BusScanner::statusChanged, ui.busScanStatusLabel, &QLabel::setText);
+        connect(scanner, &BusScanner::slaveFound, this, &BusScanDialog::handleSlaveFound);
+        connect(scanner, &BusScanner::slaveCharacterized, this, &BusScanDialog::handleSlaveCharacterized);
+        connect(scanner, &BusScanner::finished, this, &BusScanDialog::handleScannerFinished);
+        m_scanners.append(scanner);
+
+        if (!scanner->start(port, settings, firstID, lastID)) {
+            qWarning() << "Bus scan could not start on" << port;
+        }
+    }
+
+    // Scanners that failed to open have already reported why in the status line
+    setRunning(std::any_of(m_scanners.cbegin(), m_scanners.cend(),
+        [](const BusScanner* scanner) { return scanner->isRunning(); }));
+}
+
+void BusScanDialog::onStop()
+{
+    for (BusScanner* scanner : m_scanners) {
+        scanner->cancel();
+    }
+    ui.busScanStatusLabel->setText(tr("Stopped"));
+    setRunning(false);
+}
+
+// Connects the main connection with the settings of the selected result
+void BusScanDialog::onConnect()
+{
+    const QModelIndexList rows = ui.busScanResultTableView->selectionModel()->selectedRows();
+    if (rows.isEmpty() || !m_modbusConnection) {
+        QMessageBox::warning(this, tr("Error"), tr("Select a slave to connect to"));
+        return;
+    }
+
+    const int row = rows.first().row();
+    const QString port = m_resultModel->item(row, PortColumn)->text();
+    const int slaveID = m_resultModel->item(row, SlaveColumn)->text().toInt();
+    const int index = int(std::find_if(m_results.cbegin(), m_results.cend(), [&](const BusScanResult& result) {
+        return result.portName == port && result.slaveID == slaveID;
+        }) - m_results.cbegin());
+    if (index >= m_results.size()) {
+        return;
+    }
+
+    for (BusScanner* scanner : m_scanners) {
+        if (scanner->portName() == port) {
+            scanner->cancel();
+        }
+    }
+
+    emit slaveSelected(m_results[index]);
+
+    const BusScanSettings& settings = m_results[index].settings;
+    m_modbusConnection->connectToDevice(port, settings.baudRate, settings.dataBits,
+        settings.parity, settings.stopBits, slaveID);
+}
+
+void BusScanDialog::handleSlaveFound(const BusScanResult& result)
+{
+    m_results.append(result);
+
+    QList<QStandardItem*> row;
+    row << new QStandardItem(result.portName)
+        << new QStandardItem(result.settings.description())
+        << new QStandardItem(QString::number(result.slaveID))
+        << new QStandardItem(ui.busScanCharacterizeCheckBox->isChecked() ? tr("probing...") : QString());
+    m_resultModel->appendRow(row);
+}
+
+void BusScanDialog::handleSlaveCharacterized(const BusScanResult& result)
+{
+    for (BusScanResult& known : m_results) {
+        if (known.portName == result.portName && known.slaveID == result.slaveID) {
+            known.ranges = result.ranges;
+        }
+    }
+
+    const int row = findResultRow(result.portName, result.slaveID);
+    if (row < 0) {
+        return;
+    }
+
+    QStringList parts;
+    for (auto it = result.ranges.cbegin(); it != result.ranges.cend(); ++it) {
+        parts << QString("%1 %2").arg(typeShortName(it.key()), RegisterDiff::describe(it.value()));
+    }
+    m_resultModel->item(row, RangesColumn)->setText(parts.isEmpty() ? tr("none") : parts.join("; "));
+}
+
+void BusScanDialog::handleScannerFinished()
+{
+    const bool anyRunning = std::any_of(m_scanners.cbegin(), m_scanners.cend(),
+        [](const BusScanner* scanner) { return scanner->isRunning(); });
+    if (!anyRunning) {
+        setRunning(false);
+        ui.busScanProgressBar->setValue(ui.busScanProgressBar->maximum());
+        ui.busScanStatusLabel->setText(tr("Scan finished, %n slave(s) found", nullptr, int(m_results.size())));
+    }
+}
+
+void BusScanDialog::updateProgress()
+{
+    int done = 0;
+    int total = 0;
+    for (const QPair<int, int>& entry : std::as_const(m_progress)) {
+        done += entry.first;
+        total += entry.second;
+    }
+    ui.busScanProgressBar->setMaximum(qMax(1, total));
+    ui.busScanProgressBar->setValue(done);
+}
+
+int BusScanDialog::findResultRow(const QString& portName, int slaveID) const
+{
+    for (int row = 0; row < m_resultModel->rowCount(); ++row) {
+        if (m_resultModel->item(row, PortColumn)->text() == portName
+            && m_resultModel->item(row, SlaveColumn)->text().toInt() == slaveID) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+void BusScanDialog::setRunning(bool running)
+{
+    ui.busScanStartBtn->setEnabled(!running);
+    ui.busScanStopBtn->setEnabled(running);
+    ui.busScanPortListWidget->setEnabled(!running);
+}
@@ -0,0 +1,364 @@
+#include "BusScanner.h"
+#include <QModbusReply>
+#include <QModbusDataUnit>
+#include <QVariant>
+#include <QDebug>
+#include <cmath>
+
+namespace {
+    // Time a typical device needs between receiving a request and answering
+    constexpr int deviceTurnaroundMs = 20;
+    // QModbusClient ignores timeouts below this
+    constexpr int minimumTimeoutMs = 10;
+    // Distance between the first readability samples of each register type
+    constexpr int sampleStep = 1024;
+
+    const ModbusConnection::RegisterType characterizeTypes[] = {
+        ModbusConnection::HoldingRegisters,
+        ModbusConnection::InputRegisters,
+        ModbusConnection::Coils,
+        ModbusConnection::DiscreteInputs
+    };
+    constexpr int characterizeTypeCount = int(std::size(characterizeTypes));
+}
+
+QString BusScanSettings::description() const
+{
+    QChar parityChar('N');
+    if (parity == QSerialPort::EvenParity) {
+        parityChar = 'E';
+    }
+    else if (parity == QSerialPort::OddParity) {
+        parityChar = 'O';
+    }
+    return QString("%1 %2%3%4").arg(baudRate).arg(int(dataBits)).arg(parityChar)
+        .arg(stopBits == QSerialPort::TwoStop ? 2 : 1);
+}
+
+BusScanner::BusScanner(QObject* parent)
+    : QObject(parent)
+{
+}
+
+BusScanner::~BusScanner()
+{
+    cancel();
+}
+
+void BusScanner::setCharacterize(bool enabled) noexcept
+{
+    m_characterize = enabled;
+}
+
+bool BusScanner::isRunning() const noexcept
+{
+    return m_running;
+}
+
+QString BusScanner::portName() const
+{
+    return m_portName;
+}
+
+// Request and shortest response (8 + 7 bytes) plus the 3.5 character gaps around them
+int BusScanner::probeTimeout(const BusScanSettings& settings)
+{
+    const int bitsPerChar = 1 + int(settings.dataBits)
+        + (settings.parity == QSerialPort::NoParity ? 0 : 1)
+        + (settings.stopBits == QSerialPort::TwoStop ? 2 : 1);
+    const double charMs = bitsPerChar * 1000.0 / qMax(1, settings.baudRate);
+    const double frameMs = (8 + 7 + 7) * charMs;
+    return qMax(minimumTimeoutMs, int(std::ceil(frameMs)) + deviceTurnaroundMs);
+}
+
+bool BusScanner::start(const QString& portName, const QList<BusScanSettings>& settings, int firstID, int lastID)
+{
+    if (m_running || settings.isEmpty() || firstID < 1 || lastID > 247 || lastID < firstID) {
+        return false;
+    }
+
+    ++m_generation;
+    m_portName = portName;
+    m_settings = settings;
+    m_firstID = firstID;
+    m_lastID = lastID;
+    m_found.clear();
+    m_settingsLocked = false;
+    m_probesDone = 0;
+    m_probesTotal = int(settings.size()) * (lastID - firstID + 1);
+
+    if (!m_client) {
+        m_client = new QModbusRtuSerialClient(this);
+    }
+
+    m_running = true;
+    if (!openSettings(0)) {
+        m_running = false;
+        return false;
+    }
+    probeNextID();
+    return true;
+}
+
+void BusScanner::cancel()
+{
+    if (!m_running) {
+        return;
+    }
+    ++m_generation;
+    m_running = false;
+    if (m_client && m_client->state() != QModbusDevice::UnconnectedState) {
+        m_client->disconnectDevice();
+    }
+}
+
+bool BusScanner::openSettings(int index)
+{
+    m_settingsIndex = index;
+    m_nextID = m_firstID;
+    const BusScanSettings& settings = m_settings[index];
+
+    if (m_client->state() != QModbusDevice::UnconnectedState) {
+        m_client->disconnectDevice();
+    }
+    m_client->setConnectionParameter(QModbusDevice::SerialPortNameParameter, m_portName);
+    m_client->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, settings.baudRate);
+    m_client->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, settings.dataBits);
+    m_client->setConnectionParameter(QModbusDevice::SerialParityParameter, settings.parity);
+    m_client->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, settings.stopBits);
+    m_client->setTimeout(probeTimeout(settings));
+    m_client->setNumberOfRetries(0);
+
+    if (!m_client->connectDevice() || m_client->state() != QModbusDevice::ConnectedState) {
+        qWarning() << "Bus scan: cannot open" << m_portName << m_client->errorString();
+        emit statusChanged(tr("Cannot open %1: %2").arg(m_portName, m_client->errorString()));
+        return false;
+    }
+
+    emit statusChanged(tr("Scanning %1 at %2").arg(m_portName, settings.description()));
+    return true;
+}
+
+// Any valid frame, exceptions included, proves a slave at this ID and setting
+void BusScanner::probeNextID()
+{
+    if (!m_running) {
+        return;
+    }
+    if (m_nextID > m_lastID) {
+        finishSettings();
+        return;
+    }
+
+    const int slaveID = m_nextID++;
+    probe(ModbusConnection::HoldingRegisters, slaveID, 0, [this, slaveID](ProbeResult result) {
+        emit progress(++m_probesDone, m_probesTotal);
+
+        if (result != ProbeResult::NoResponse) {
+            BusScanResult found;
+            found.portName = m_portName;
+            found.settings = m_settings[m_settingsIndex];
+            found.slaveID = slaveID;
+            m_found.append(found);
+            qDebug() << "Bus scan: slave" << slaveID << "on" << m_portName << found.settings.description();
+            emit slaveFound(found);
+
+            // The bus setting is known now, only this pass remains
+            if (!m_settingsLocked) {
+                m_settingsLocked = true;
+                m_probesTotal = m_probesDone + (m_lastID - m_nextID + 1);
+            }
+        }
+        probeNextID();
+        });
+}
+
+void BusScanner::finishSettings()
+{
+    const int next = m_settingsIndex + 1;
+    if (!m_settingsLocked && next < m_settings.size()) {
+        if (!openSettings(next)) {
+            finish();
+            return;
+        }
+        probeNextID();
+        return;
+    }
+
+    if (m_characterize && !m_found.isEmpty()) {
+        m_resultIndex = 0;
+        m_typeIndex = 0;
+        characterizeNext();
+    }
+    else {
+        finish();
+    }
+}
+
+void BusScanner::probe(ModbusConnection::RegisterType type, int slaveID, int address, ProbeCallback done)
+{
+    QModbusReply* reply = m_client->sendReadRequest(
+        QModbusDataUnit(static_cast<QModbusDataUnit::RegisterType>(type), address, 1), slaveID);
+    if (!reply) {
+        emit statusChanged(tr("Failed to send request on %1: %2").arg(m_portName, m_client->errorString()));
+        finish();
+        return;
+    }
+
+    const quint64 generation = m_generation;
+    auto handle = [this, reply, generation, done]() {
+        reply->deleteLater();
+        if (generation != m_generation) {
+            return;
+        }
+
+        ProbeResult result = ProbeResult::NoResponse;
+        if (reply->error() == QModbusDevice::NoError) {
+            result = ProbeResult::Answered;
+        }
+        else if (reply->error() == QModbusDevice::ProtocolError && reply->rawResult().isException()) {
+            result = reply->rawResult().exceptionCode() == QModbusPdu::IllegalFunction
+                ? ProbeResult::IllegalFunction : ProbeResult::Rejected;
+        }
+        done(result);
+    };
+
+    if (reply->isFinished()) {
+        handle();
+    }
+    else {
+        connect(reply, &QModbusReply::finished, this, handle);
+    }
+}
+
+// Starts sampling the current type of the current slave
+void BusScanner::characterizeNext()
+{
+    if (!m_running) {
+        return;
+    }
+    if (m_resultIndex >= m_found.size()) {
+        finish();
+        return;
+    }
+
+    const BusScanResult& result = m_found[m_resultIndex];
+    emit statusChanged(tr("Characterising slave %1 on %2 (%3)")
+        .arg(result.slaveID).arg(m_portName).arg(QVariant::fromValue(characterizeTypes[m_typeIndex]).toString()));
+
+    m_points.clear();
+    m_sampleIndex = 0;
+    sampleNext();
+}
+
+void BusScanner::sampleNext()
+{
+    const int address = qMin(m_sampleIndex * sampleStep, 65535);
+    if (m_sampleIndex > 0 && m_points.last().address == 65535) {
+        m_edgeIndex = 0;
+        m_edgeLow = -1;
+        searchNextEdge();
+        return;
+    }
+
+    ++m_sampleIndex;
+    probe(characterizeTypes[m_typeIndex], m_found[m_resultIndex].slaveID, address, [this, address](ProbeResult result) {
+        if (result == ProbeResult::IllegalFunction) {
+            m_points.clear();   // the type is not implemented at all
+            finishType();
+            return;
+        }
+        m_points.append(Point{ address, result == ProbeResult::Answered });
+        sampleNext();
+        });
+}
+
+// Narrows the next readable/rejected transition between two samples down to one address
+void BusScanner::searchNextEdge()
+{
+    if (m_edgeLow < 0) {
+        // Find the next pair of neighbouring points that disagree
+        while (m_edgeIndex + 1 < m_points.size()
+            && (m_points[m_edgeIndex].readable == m_points[m_edgeIndex + 1].readable
+                || m_points[m_edgeIndex + 1].address - m_points[m_edgeIndex].address <= 1)) {
+            ++m_edgeIndex;
+        }
+        if (m_edgeIndex + 1 >= m_points.size()) {
+            finishType();
+            return;
+        }
+        m_edgeLow = m_points[m_edgeIndex].address;
+        m_edgeHigh = m_points[m_edgeIndex + 1].address;
+    }
+
+    if (m_edgeHigh - m_edgeLow <= 1) {
+        // Both sides of the edge become points so the ranges can be read off in order
+        const bool lowReadable = m_points[m_edgeIndex].readable;
+        if (m_points[m_edgeIndex].address != m_edgeLow) {
+            m_points.insert(++m_edgeIndex, Point{ m_edgeLow, lowReadable });
+        }
+        if (m_points[m_edgeIndex + 1].address != m_edgeHigh) {
+            m_points.insert(m_edgeIndex + 1, Point{ m_edgeHigh, !lowReadable });
+        }
+        ++m_edgeIndex;
+        m_edgeLow = -1;
+        searchNextEdge();
+        return;
+    }
+
+    const int middle = m_edgeLow + (m_edgeHigh - m_edgeLow) / 2;
+    const bool lowReadable = m_points[m_edgeIndex].readable;
+    probe(characterizeTypes[m_typeIndex], m_found[m_resultIndex].slaveID, middle,
+        [this, middle, lowReadable](ProbeResult result) {
+            if ((result == ProbeResult::Answered) == lowReadable) {
+                m_edgeLow = middle;
+            }
+            else {
+                m_edgeHigh = middle;
+            }
+            searchNextEdge();
+        });
+}
+
+// Turns the ordered points into readable ranges and moves to the next type or slave
+void BusScanner::finishType()
+{
+    QList<AddressRange> ranges;
+    int runStart = -1;
+    for (int i = 0; i < m_points.size(); ++i) {
+        if (m_points[i].readable && runStart < 0) {
+            runStart = m_points[i].address;
+        }
+        const bool runEnds = m_points[i].readable && (i + 1 == m_points.size() || !m_points[i + 1].readable);
+        if (runEnds) {
+            ranges.append(AddressRange{ runStart, m_points[i].address - runStart + 1 });
+            runStart = -1;
+        }
+    }
+
+    BusScanResult& result = m_found[m_resultIndex];
+    if (!ranges.isEmpty()) {
+        result.ranges.insert(characterizeTypes[m_typeIndex], ranges);
+    }
+
+    if (++m_typeIndex >= characterizeTypeCount) {
+        emit slaveCharacterized(result);
+        m_typeIndex = 0;
+        ++m_resultIndex;
+    }
+    characterizeNext();
+}
+
+void BusScanner::finish()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    if (m_client && m_client->state() != QModbusDevice::UnconnectedState) {
+        m_client->disconnectDevice();
+    }
+
+    emit statusChanged(tr("%1: %n slave(s) found", nullptr, int(m_found.size())).arg(m_portName));
+    emit finished(int(m_found.size()));
+}
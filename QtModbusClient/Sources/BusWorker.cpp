@@ -0,0 +1,477 @@
+#include "BusWorker.h"
+#include <QJsonArray>
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace {
+    constexpr int tickMs = 20;
+    constexpr int retryDelayMs = 5000;      // links that never came up are tried again
+    constexpr int offlineAfterFailures = 3;
+    constexpr int offlineRetryMs = 10000;   // polling interval of an offline device
+    constexpr int maxRegistersPerRead = 125;
+    constexpr int maxBitsPerRead = 2000;
+    // A TCP endpoint takes a second request while the first is answered;
+    // a serial bus carries one transaction at a time
+    constexpr int tcpPipelineDepth = 2;
+
+    QString typeKey(ModbusConnection::RegisterType type)
+    {
+        switch (type) {
+        case ModbusConnection::Coils: return QStringLiteral("COIL");
+        case ModbusConnection::DiscreteInputs: return QStringLiteral("DI");
+        case ModbusConnection::InputRegisters: return QStringLiteral("IR");
+        case ModbusConnection::HoldingRegisters: return QStringLiteral("HR");
+        }
+        return QString();
+    }
+
+    QString formatRanges(const QList<SnapshotRange>& ranges)
+    {
+        QStringList parts;
+        for (const SnapshotRange& range : ranges) {
+            parts.append(QString("%1:%2-%3").arg(typeKey(range.type)).arg(range.start).arg(range.start + range.count - 1));
+        }
+        return parts.join(QStringLiteral("; "));
+    }
+
+    QString parityKey(QSerialPort::Parity parity)
+    {
+        switch (parity) {
+        case QSerialPort::EvenParity: return QStringLiteral("even");
+        case QSerialPort::OddParity: return QStringLiteral("odd");
+        default: return QStringLiteral("none");
+        }
+    }
+
+    QSerialPort::Parity parityFromKey(const QString& key)
+    {
+        if (key == QLatin1String("even")) {
+            return QSerialPort::EvenParity;
+        }
+        if (key == QLatin1String("odd")) {
+            return QSerialPort::OddParity;
+        }
+        return QSerialPort::NoParity;
+    }
+
+    void setError(QString* errorMessage, const QString& text)
+    {
+        if (errorMessage) {
+            *errorMessage = text;
+        }
+    }
+}
+
+QString BusConfig::description() const
+{
+    if (kind == Tcp) {
+        return QString("%1:%2").arg(address).arg(tcpPort);
+    }
+
+    QChar parityChar('N');
+    if (parity == QSerialPort::EvenParity) {
+        parityChar = 'E';
+    }
+    else if (parity == QSerialPort::OddParity) {
+        parityChar = 'O';
+    }
+    return QString("%1 %2 %3%4%5").arg(address).arg(baudRate).arg(int(dataBits)).arg(parityChar)
+        .arg(stopBits == QSerialPort::TwoStop ? 2 : 1);
+}
+
+QJsonObject BusConfig::toJson() const
+{
+    QJsonArray deviceArray;
+    for (const BusDeviceConfig& device : devices) {
+        QJsonObject object;
+        object.insert("name", device.name);
+        object.insert("slave", device.slaveID);
+        object.insert("ranges", formatRanges(device.ranges));
+        object.insert("interval", device.intervalMs);
+        deviceArray.append(object);
+    }
+
+    QJsonObject object;
+    object.insert("name", name);
+    if (kind == Tcp) {
+        object.insert("type", "tcp");
+        object.insert("host", address);
+        object.insert("port", tcpPort);
+    }
+    else {
+        object.insert("type", "serial");
+        object.insert("port", address);
+        object.insert("baudRate", baudRate);
+        object.insert("dataBits", int(dataBits));
+        object.insert("parity", parityKey(parity));
+        object.insert("stopBits", int(stopBits));
+        object.insert("native", nativeTransport);
+    }
+    object.insert("adaptiveTimeout", adaptiveTimeout);
+    object.insert("devices", deviceArray);
+    return object;
+}
+
+bool BusConfig::fromJson(const QJsonObject& object, BusConfig* config, QString* errorMessage)
+{
+    BusConfig result;
+    result.name = object.value("name").toString();
+
+    const QString type = object.value("type").toString();
+    if (type == QLatin1String("tcp")) {
+        result.kind = Tcp;
+        result.address = object.value("host").toString();
+        const int port = object.value("port").toInt(502);
+        if (port < 1 || port > 65535) {
+            setError(errorMessage, QObject::tr("Invalid TCP port in bus \"%1\"").arg(result.name));
+            return false;
+        }
+        result.tcpPort = quint16(port);
+    }
+    else if (type == QLatin1String("serial")) {
+        result.kind = Serial;
+        result.address = object.value("port").toString();
+        result.baudRate = object.value("baudRate").toInt(QSerialPort::Baud9600);
+        result.dataBits = QSerialPort::DataBits(object.value("dataBits").toInt(QSerialPort::Data8));
+        result.parity = parityFromKey(object.value("parity").toString());
+        result.stopBits = object.value("stopBits").toInt(1) == 2 ? QSerialPort::TwoStop : QSerialPort::OneStop;
+        result.nativeTransport = object.value("native").toBool();
+    }
+    else {
+        setError(errorMessage, QObject::tr("Unknown bus type \"%1\"").arg(type));
+        return false;
+    }
+
+    if (result.address.isEmpty()) {
+        setError(errorMessage, QObject::tr("Bus \"%1\" has no address").arg(result.name));
+        return false;
+    }
+    if (result.name.isEmpty()) {
+        result.name = result.description();
+    }
+    result.adaptiveTimeout = object.value("adaptiveTimeout").toBool();
+
+    for (const QJsonValue& value : object.value("devices").toArray()) {
+        const QJsonObject deviceObject = value.toObject();
+        BusDeviceConfig device;
+        device.slaveID = deviceObject.value("slave").toInt(1);
+        device.name = deviceObject.value("name").toString();
+        device.intervalMs = qMax(tickMs, deviceObject.value("interval").toInt(1000));
+        if (device.slaveID < 1 || device.slaveID > 247) {
+            setError(errorMessage, QObject::tr("Invalid slave ID %1 on bus \"%2\"").arg(device.slaveID).arg(result.name));
+            return false;
+        }
+        if (device.name.isEmpty()) {
+            device.name = QObject::tr("Slave %1").arg(device.slaveID);
+        }
+        QString rangeError;
+        if (!RegisterSnapshot::parseRanges(deviceObject.value("ranges").toString(), &device.ranges, &rangeError)) {
+            setError(errorMessage, QObject::tr("%1 on bus \"%2\": %3").arg(device.name, result.name, rangeError));
+            return false;
+        }
+        result.devices.append(device);
+    }
+
+    *config = result;
+    return true;
+}
+
+QString BusSnapshot::stateName(State state)
+{
+    switch (state) {
+    case Stopped: return QObject::tr("Stopped");
+    case Connecting: return QObject::tr("Connecting");
+    case Connected: return QObject::tr("Connected");
+    case Reconnecting: return QObject::tr("Reconnecting");
+    case Failed: return QObject::tr("Failed");
+    }
+    return QString();
+}
+
+BusWorker::BusWorker(const BusConfig& config, QObject* parent)
+    : QObject(parent),
+    m_config(config)
+{
+    // Split every range into requests the protocol allows
+    m_deviceBlocks.resize(m_config.devices.size());
+    for (int device = 0; device < m_config.devices.size(); ++device) {
+        const QList<SnapshotRange>& ranges = m_config.devices[device].ranges;
+        for (int range = 0; range < ranges.size(); ++range) {
+            const SnapshotRange& r = ranges[range];
+            const bool bits = r.type == ModbusConnection::Coils || r.type == ModbusConnection::DiscreteInputs;
+            const int limit = bits ? maxBitsPerRead : maxRegistersPerRead;
+            for (int offset = 0; offset < r.count; offset += limit) {
+                Block block;
+                block.device = device;
+                block.range = range;
+                block.offset = offset;
+                block.type = r.type;
+                block.start = r.start + offset;
+                block.count = qMin(limit, r.count - offset);
+                m_deviceBlocks[device].append(int(m_blocks.size()));
+                m_blocks.append(block);
+            }
+        }
+    }
+
+    m_due = QVector<qint64>(m_config.devices.size(), 0);
+    m_outstanding = QVector<int>(m_config.devices.size(), 0);
+    m_failureRun = QVector<int>(m_config.devices.size(), 0);
+    m_maxInFlight = m_config.kind == BusConfig::Tcp ? tcpPipelineDepth : 1;
+
+    for (const BusDeviceConfig& device : m_config.devices) {
+        BusDeviceStatistics statistics;
+        for (const SnapshotRange& range : device.ranges) {
+            statistics.values.append(QVector<quint16>(range.count, 0));
+        }
+        m_snapshot.devices.append(statistics);
+    }
+}
+
+BusWorker::~BusWorker()
+{
+    stop();
+}
+
+const BusConfig& BusWorker::config() const noexcept
+{
+    return m_config;
+}
+
+BusSnapshot BusWorker::snapshot() const
+{
+    QMutexLocker locker(&m_snapshotMutex);
+    return m_snapshot;
+}
+
+void BusWorker::start()
+{
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+
+    if (!m_connection) {
+        m_connection = new ModbusConnection(this);
+        m_connection->setAutoReconnect(true);
+        m_connection->setAdaptiveTimeout(m_config.adaptiveTimeout);
+        m_connection->setSerialTransport(m_config.nativeTransport
+            ? ModbusConnection::NativeTransport : ModbusConnection::QtSerialPort);
+
+        connect(m_connection, &ModbusConnection::connectionOpened, this, [this]() {
+            setState(BusSnapshot::Connected);
+            pump();
+            });
+        connect(m_connection, &ModbusConnection::connectionLost, this, [this]() {
+            setState(BusSnapshot::Reconnecting);
+            });
+        connect(m_connection, &ModbusConnection::reconnecting, this, [this]() {
+            setState(BusSnapshot::Reconnecting);
+            });
+        connect(m_connection, &ModbusConnection::connectionError, this, [this](const QString& errorMessage) {
+            QMutexLocker locker(&m_snapshotMutex);
+            m_snapshot.lastError = errorMessage;
+            });
+        // Auto reconnect only takes over once the link was up; until then retry here
+        connect(m_connection, &ModbusConnection::connectionClosed, this, [this]() {
+            if (m_running) {
+                setState(BusSnapshot::Failed);
+                m_retryTimer->start(retryDelayMs);
+            }
+            });
+
+        m_tickTimer = new QTimer(this);
+        m_tickTimer->setInterval(tickMs);
+        connect(m_tickTimer, &QTimer::timeout, this, &BusWorker::tick);
+
+        m_retryTimer = new QTimer(this);
+        m_retryTimer->setSingleShot(true);
+        connect(m_retryTimer, &QTimer::timeout, this, &BusWorker::connectBus);
+    }
+
+    m_clock.start();
+    m_due.fill(0);
+    m_outstanding.fill(0);
+    m_failureRun.fill(0);
+    m_queue.clear();
+    m_inFlight = 0;
+
+    m_tickTimer->start();
+    connectBus();
+}
+
+void BusWorker::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    ++m_generation;
+
+    m_tickTimer->stop();
+    m_retryTimer->stop();
+    m_connection->cancelRequests(this);
+    m_connection->closeConnection();
+    m_queue.clear();
+    m_inFlight = 0;
+
+    QMutexLocker locker(&m_snapshotMutex);
+    m_snapshot.state = BusSnapshot::Stopped;
+    for (BusDeviceStatistics& statistics : m_snapshot.devices) {
+        statistics.online = false;
+    }
+}
+
+void BusWorker::connectBus()
+{
+    if (!m_running) {
+        return;
+    }
+
+    setState(BusSnapshot::Connecting);
+    // Every read names its slave, the connection's own slave ID is unused
+    const int slaveID = m_config.devices.isEmpty() ? 1 : m_config.devices.first().slaveID;
+    if (m_config.kind == BusConfig::Tcp) {
+        m_connection->connectToTcpDevice(m_config.address, m_config.tcpPort, slaveID);
+    }
+    else {
+        m_connection->connectToDevice(m_config.address, m_config.baudRate, m_config.dataBits,
+            m_config.parity, m_config.stopBits, slaveID);
+    }
+}
+
+// Starts the cycle of every device that is due and whose last cycle is complete
+void BusWorker::tick()
+{
+    if (!m_connection->isConnected() || m_connection->isReconnecting()) {
+        return;
+    }
+
+    const qint64 now = m_clock.elapsed();
+    for (int device = 0; device < m_due.size(); ++device) {
+        if (m_outstanding[device] > 0 || now < m_due[device] || m_deviceBlocks[device].isEmpty()) {
+            continue;
+        }
+
+        const bool offline = m_failureRun[device] >= offlineAfterFailures;
+        const int interval = m_config.devices[device].intervalMs;
+        m_due[device] = now + (offline ? qMax(interval, offlineRetryMs) : interval);
+
+        // An offline device is probed with its first request only
+        const QList<int>& blocks = m_deviceBlocks[device];
+        const int count = offline ? 1 : int(blocks.size());
+        for (int i = 0; i < count; ++i) {
+            m_queue.enqueue(blocks[i]);
+        }
+        m_outstanding[device] = count;
+    }
+    pump();
+}
+
+void BusWorker::pump()
+{
+    // Requests that fail synchronously finish inside the loop below
+    if (m_pumping) {
+        return;
+    }
+    m_pumping = true;
+
+    while (m_running && m_inFlight < m_maxInFlight && !m_queue.isEmpty()) {
+        const int blockIndex = m_queue.dequeue();
+        Block& block = m_blocks[blockIndex];
+        const int slaveID = m_config.devices[block.device].slaveID;
+
+        // The tag carries the run generation in the high half and the block in the low half
+        const quint64 tag = (m_generation << 32) | quint32(blockIndex);
+        block.sentAt = m_clock.elapsed();
+        {
+            QMutexLocker locker(&m_snapshotMutex);
+            ++m_snapshot.devices[block.device].requests;
+        }
+        if (m_connection->submitRead(block.type, block.start, quint16(block.count), slaveID,
+            &BusWorker::handleRead, this, tag)) {
+            ++m_inFlight;
+            continue;
+        }
+
+        ModbusConnection::RequestResult result;
+        result.slaveID = slaveID;
+        result.error = QModbusDevice::ConnectionError;
+        result.errorText = tr("Request not sent");
+        ++m_inFlight;
+        handleRead(this, tag, result);
+    }
+
+    m_pumping = false;
+}
+
+// Decodes straight into the snapshot values and updates the device statistics
+void BusWorker::handleRead(void* context, quint64 tag, const ModbusConnection::RequestResult& result)
+{
+    auto* self = static_cast<BusWorker*>(context);
+    if (quint32(tag >> 32) != quint32(self->m_generation)) {
+        return;
+    }
+
+    const int blockIndex = int(quint32(tag));
+    const Block& block = self->m_blocks[blockIndex];
+    const qint64 elapsedMs = self->m_clock.elapsed() - block.sentAt;
+    --self->m_inFlight;
+    --self->m_outstanding[block.device];
+
+    bool answered = false;
+    {
+        QMutexLocker locker(&self->m_snapshotMutex);
+        BusDeviceStatistics& statistics = self->m_snapshot.devices[block.device];
+
+        if (result.error == QModbusDevice::NoError || result.isException()) {
+            answered = true;
+            ++statistics.responses;
+            statistics.averageMs = statistics.responses == 1
+                ? double(elapsedMs) : statistics.averageMs + (elapsedMs - statistics.averageMs) / 8;
+        }
+
+        if (result.isException()) {
+            ++statistics.exceptions;
+            statistics.lastError = result.errorText;
+        }
+        else if (result.error == QModbusDevice::TimeoutError) {
+            ++statistics.timeouts;
+            statistics.lastError = result.errorText;
+        }
+        else if (result.error != QModbusDevice::NoError) {
+            ++statistics.failures;
+            statistics.lastError = result.errorText;
+        }
+        else {
+            quint16* values = statistics.values[block.range].data() + block.offset;
+            if (!ModbusConnection::decodeRead(block.type, result, values, block.count)) {
+                ++statistics.failures;
+                statistics.lastError = tr("Malformed response");
+            }
+        }
+
+        if (answered) {
+            self->m_failureRun[block.device] = 0;
+            statistics.online = true;
+        }
+        else if (++self->m_failureRun[block.device] >= offlineAfterFailures && statistics.online) {
+            qDebug() << "Device" << self->m_config.devices[block.device].name
+                << "on" << self->m_config.name << "offline:" << statistics.lastError;
+            statistics.online = false;
+        }
+    }
+
+    self->pump();
+}
+
+void BusWorker::setState(BusSnapshot::State state)
+{
+    QMutexLocker locker(&m_snapshotMutex);
+    m_snapshot.state = state;
+    if (state != BusSnapshot::Connected) {
+        for (BusDeviceStatistics& statistics : m_snapshot.devices) {
+            statistics.online = false;
+        }
+    }
+}
@@ -26,8 +26,6 @@ CoilWidget::CoilWidget(QWidget *parent)
         this, [this](int) { updateCoilsWriteTable(); });
     connect(ui.coilsWriteCountSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
         this, [this](int) { updateCoilsWriteTable(); });
-    connect(m_coilsWriteModel, &QStandardItemModel::itemChanged,
-        this, &CoilWidget::handleCoilWriteItemChanged);
 
     updateCoilsWriteTable();
 }
@@ -55,6 +53,10 @@ CoilWidget::~CoilWidget()
 void CoilWidget::setModbusConnection(ModbusConnection* connection)
 {
 	m_modbusConnection = connection;
+    if (m_modbusConnection) {
+        connect(m_modbusConnection, &ModbusConnection::coilsWriteVerified,
+            this, &CoilWidget::handleCoilsWriteVerified);
+    }
 }
 
 // Handles single coil read request
@@ -193,8 +195,8 @@ void CoilWidget::onReadMultipleCoils()
     }
 
     ui.coilsReadBtn->setEnabled(false);
-    m_multipleCoilsReply = m_modbusConnection->readRegister(
-        ModbusConnection::Coils, address, count);
+    m_multipleCoilsReply = m_modbusConnection->readBits(
+        ModbusConnection::Coils, address, quint16(count));
 
     if (m_multipleCoilsReply) {
         connect(m_multipleCoilsReply, &QModbusReply::finished,
@@ -224,40 +226,13 @@ void CoilWidget::handleMultipleCoilsReadResult()
         return;
     }
 
-    const QModbusDataUnit result = reply->result();
-    if (result.registerType() == QModbusDataUnit::Coils && result.valueCount() > 0) {
-        m_coilsReadModel->removeRows(0, m_coilsReadModel->rowCount());
-        int startAddr = result.startAddress();
-        int byteCount = (result.valueCount() + 7) / 8;
-        QVector<quint8> bytes(byteCount, 0);
-
-        for (int i = 0; i < result.valueCount(); ++i) {
-            bool value = result.value(i);
-            int addr = startAddr + i;
-
-            int byteIndex = i / 8;
-            int bitIndex = i % 8;
-            if (value) {
-                bytes[byteIndex] |= (1 << bitIndex);
-            }
-
-            QList<QStandardItem*> rowItems;
-            rowItems << new QStandardItem(QString::number(addr));
-            rowItems << new QStandardItem();
-            rowItems << new QStandardItem(value ? "1" : "0");
-            m_coilsReadModel->appendRow(rowItems);
-        }
-
-        for (int i = 0; i < byteCount; ++i) {
-            int rowIndex = i * 8;
-            if (rowIndex < m_coilsReadModel->rowCount()) {
-                QModelIndex index = m_coilsReadModel->index(rowIndex, 1);
-                m_coilsReadModel->setData(index, QString("0x%1").arg(bytes[i], 2, 16, QChar('0')).toUpper());
-            }
-        }
+    const BitBlock bits = ModbusConnection::bitsFromReply(reply);
+    if (!bits.isEmpty()) {
+        const int startAddr = ModbusConnection::startAddressOf(reply);
+        m_coilsReadModel->setBits(startAddr, bits);
 
         qDebug() << "Multiple coils read successful - Start address:"
-            << startAddr << "Count:" << result.valueCount();
+            << startAddr << "Count:" << bits.size() << "On:" << bits.count();
         QApplication::beep();
     }
     else {
@@ -277,14 +252,6 @@ void CoilWidget::onWriteMultipleCoils()
     }
 
     int startAddr = ui.coilsWriteAddressSpinBox->value();
-    int count = ui.coilsWriteCountSpinBox->value();
-
-    QVector<quint16> values;
-    for (int i = 0; i < count; ++i) {
-        QModelIndex index = m_coilsWriteModel->index(i, 1);
-        bool isChecked = (m_coilsWriteModel->data(index, Qt::CheckStateRole).toInt() == Qt::Checked);
-        values.append(isChecked ? 1 : 0);
-    }
 
     if (m_multipleCoilsWriteReply) {
         disconnect(m_multipleCoilsWriteReply, nullptr, this, nullptr);
@@ -293,10 +260,15 @@ void CoilWidget::onWriteMultipleCoils()
     }
 
     ui.coilsWriteBtn->setEnabled(false);
-    m_multipleCoilsWriteReply = m_modbusConnection->writeMultipleRegisters(
-        ModbusConnection::Coils, startAddr, values);
+    const BitBlock bits = m_coilsWriteModel->bits();
+    m_verifyStart = -1;
+    m_multipleCoilsWriteReply = m_modbusConnection->writeMultipleCoils(startAddr, bits);
 
     if (m_multipleCoilsWriteReply) {
+        if (m_modbusConnection->writeVerification() != ModbusConnection::VerifyNone) {
+            m_verifyStart = startAddr;
+            m_verifyCount = bits.size();
+        }
         connect(m_multipleCoilsWriteReply, &QModbusReply::finished,
             this, &CoilWidget::handleMultipleCoilsWriteResult);
     }
@@ -324,9 +296,9 @@ void CoilWidget::handleMultipleCoilsWriteResult()
         qDebug() << "Multiple coils write successful - Start address:"
             << startAddr << "Count:" << count;
         QApplication::beep();
-        onReadMultipleCoils();
     }
     else {
+        m_verifyStart = -1;
         qDebug() << "Multiple coils write error:" << reply->errorString();
         QMessageBox::critical(this, tr("Error"),
             tr("Write failed: %1").arg(reply->errorString()));
@@ -336,18 +308,28 @@ void CoilWidget::handleMultipleCoilsWriteResult()
     m_multipleCoilsWriteReply = nullptr;
 }
 
-// Toggles select-all state for write table
-void CoilWidget::onSelectAllChanged(int state)
+// Shows the read-back of a verified write, only issued when verification is enabled
+void CoilWidget::handleCoilsWriteVerified(int startAddr, const BitBlock& readBack, const QList<AddressRange>& mismatches)
 {
-    bool selectAll = (state == Qt::Checked);
+    if (startAddr != m_verifyStart || readBack.size() != m_verifyCount) {
+        return;
+    }
+    m_verifyStart = -1;
+
+    m_coilsReadModel->setBits(startAddr, readBack);
 
-    for (int row = 0; row < m_coilsWriteModel->rowCount(); ++row) {
-        QModelIndex index = m_coilsWriteModel->index(row, 1);
-        m_coilsWriteModel->setData(index, selectAll ? Qt::Checked : Qt::Unchecked,
-            Qt::CheckStateRole);
+    if (!mismatches.isEmpty()) {
+        QMessageBox::warning(this, tr("Warning"),
+            tr("Read-back differs from written values at: %1").arg(RegisterDiff::describe(mismatches)));
     }
 }
 
+// Toggles select-all state for write table
+void CoilWidget::onSelectAllChanged(int state)
+{
+    m_coilsWriteModel->fill(state == Qt::Checked);
+}
+
 void CoilWidget::initSingleCoilUI()
 {
     ui.coilReadAddressSpinBox->setRange(0, 65535);
@@ -376,19 +358,12 @@ void CoilWidget::initMultipleCoilsWriteUI()
 
 void CoilWidget::initTableModels()
 {
-    m_coilsReadModel = new QStandardItemModel(this);
-    m_coilsReadModel->setColumnCount(3);
-    m_coilsReadModel->setHeaderData(0, Qt::Horizontal, tr("Address"));
-    m_coilsReadModel->setHeaderData(1, Qt::Horizontal, tr("Hex"));
-    m_coilsReadModel->setHeaderData(2, Qt::Horizontal, tr("Binary"));
+    m_coilsReadModel = new BitTableModel(this);
     ui.coilsReadTableView->setModel(m_coilsReadModel);
     ui.coilsReadTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 
-    m_coilsWriteModel = new QStandardItemModel(this);
-    m_coilsWriteModel->setColumnCount(3);
-    m_coilsWriteModel->setHeaderData(0, Qt::Horizontal, tr("Address"));
-    m_coilsWriteModel->setHeaderData(1, Qt::Horizontal, tr("Hex"));
-    m_coilsWriteModel->setHeaderData(2, Qt::Horizontal, tr("Binary"));
+    m_coilsWriteModel = new BitTableModel(this);
+    m_coilsWriteModel->setCheckable(true);
     ui.coilsWriteTableView->setModel(m_coilsWriteModel);
     ui.coilsWriteTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 }
@@ -396,39 +371,5 @@ void CoilWidget::initTableModels()
 // Refreshes write table based on address/count inputs
 void CoilWidget::updateCoilsWriteTable()
 {
-    int startAddr = ui.coilsWriteAddressSpinBox->value();
-    int count = ui.coilsWriteCountSpinBox->value();
-
-    m_coilsWriteModel->removeRows(0, m_coilsWriteModel->rowCount());
-
-    for (int i = 0; i < count; ++i) {
-        QList<QStandardItem*> rowItems;
-        int address = startAddr + i;
-
-        QStandardItem* addrItem = new QStandardItem(QString::number(address));
-        addrItem->setEditable(false);
-
-        QStandardItem* valueItem = new QStandardItem();
-        valueItem->setCheckable(true);
-        valueItem->setCheckState(Qt::Unchecked);
-        valueItem->setData(address, Qt::UserRole);
-
-        QStandardItem* binItem = new QStandardItem("0");
-        binItem->setEditable(false);
-
-        rowItems << addrItem << valueItem << binItem;
-        m_coilsWriteModel->appendRow(rowItems);
-    }
+    m_coilsWriteModel->resize(ui.coilsWriteAddressSpinBox->value(), ui.coilsWriteCountSpinBox->value());
 }
-
-// Updates binary display when write table checkbox changes
-void CoilWidget::handleCoilWriteItemChanged(QStandardItem* item)
-{
-    if (item->column() == 1) {
-        int row = item->row();
-        QStandardItem* binItem = m_coilsWriteModel->item(row, 2);
-        if (binItem) {
-            binItem->setText(item->checkState() == Qt::Checked ? "1" : "0");
-        }
-    }
-}
\ No newline at end of file
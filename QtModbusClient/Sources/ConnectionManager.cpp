@@ -0,0 +1,280 @@
+#include "ConnectionManager.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+    constexpr int siteVersion = 1;
+    constexpr int maxWorkerThreads = 8;
+}
+
+ConnectionManager::ConnectionManager(QObject* parent)
+    : QObject(parent)
+{
+}
+
+ConnectionManager::~ConnectionManager()
+{
+    stop();
+}
+
+void ConnectionManager::setWorkerCount(int count)
+{
+    m_workerCount = qBound(1, count, maxWorkerThreads);
+}
+
+int ConnectionManager::workerCount() const noexcept
+{
+    return m_workerCount;
+}
+
+// The buses hardly use CPU; more threads only keep one slow link from
+// delaying the rest
+int ConnectionManager::defaultWorkerCount()
+{
+    return qBound(1, QThread::idealThreadCount(), maxWorkerThreads);
+}
+
+int ConnectionManager::addBus(const BusConfig& config)
+{
+    const int id = m_nextID++;
+    Bus& bus = m_buses[id];
+    bus.config = config;
+    for (const BusDeviceConfig& device : config.devices) {
+        BusDeviceStatistics statistics;
+        for (const SnapshotRange& range : device.ranges) {
+            statistics.values.append(QVector<quint16>(range.count, 0));
+        }
+        bus.lastSnapshot.devices.append(statistics);
+    }
+
+    if (m_running) {
+        startBus(bus);
+    }
+    emit busesChanged();
+    return id;
+}
+
+void ConnectionManager::removeBus(int id)
+{
+    auto it = m_buses.find(id);
+    if (it == m_buses.end()) {
+        return;
+    }
+    stopBus(*it);
+    m_buses.erase(it);
+    emit busesChanged();
+}
+
+void ConnectionManager::clear()
+{
+    for (Bus& bus : m_buses) {
+        stopBus(bus);
+    }
+    m_buses.clear();
+    emit busesChanged();
+}
+
+QList<int> ConnectionManager::busIds() const
+{
+    return m_buses.keys();
+}
+
+BusConfig ConnectionManager::busConfig(int id) const
+{
+    return m_buses.value(id).config;
+}
+
+BusSnapshot ConnectionManager::snapshot(int id) const
+{
+    const auto it = m_buses.constFind(id);
+    if (it == m_buses.cend()) {
+        return BusSnapshot();
+    }
+    return it->worker ? it->worker->snapshot() : it->lastSnapshot;
+}
+
+ConnectionManager::Totals ConnectionManager::totals() const
+{
+    Totals totals;
+    double weightedMs = 0;
+    for (auto it = m_buses.cbegin(); it != m_buses.cend(); ++it) {
+        const BusSnapshot busSnapshot = snapshot(it.key());
+        ++totals.buses;
+        if (busSnapshot.state == BusSnapshot::Connected) {
+            ++totals.connected;
+        }
+        for (const BusDeviceStatistics& statistics : busSnapshot.devices) {
+            ++totals.devices;
+            if (statistics.online) {
+                ++totals.online;
+            }
+            totals.requests += statistics.requests;
+            totals.responses += statistics.responses;
+            totals.exceptions += statistics.exceptions;
+            totals.timeouts += statistics.timeouts;
+            totals.failures += statistics.failures;
+            weightedMs += statistics.averageMs * statistics.responses;
+        }
+    }
+    if (totals.responses > 0) {
+        totals.averageMs = weightedMs / totals.responses;
+    }
+    return totals;
+}
+
+void ConnectionManager::start()
+{
+    if (m_running) {
+        return;
+    }
+
+    for (int i = 0; i < m_workerCount; ++i) {
+        auto* thread = new QThread(this);
+        thread->setObjectName(QString("ModbusBus-%1").arg(i));
+        thread->start();
+        m_threads.append(thread);
+        m_threadLoad.append(0);
+    }
+    m_running = true;
+
+    // Largest buses first, each onto the least loaded thread
+    QList<Bus*> order;
+    for (Bus& bus : m_buses) {
+        order.append(&bus);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const Bus* a, const Bus* b) {
+        return a->config.devices.size() > b->config.devices.size();
+        });
+    for (Bus* bus : order) {
+        startBus(*bus);
+    }
+
+    qDebug() << "Connection manager started" << m_buses.size() << "buses on" << m_threads.size() << "threads";
+}
+
+void ConnectionManager::stop()
+{
+    if (!m_running) {
+        return;
+    }
+
+    for (Bus& bus : m_buses) {
+        stopBus(bus);
+    }
+    for (QThread* thread : m_threads) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    m_threads.clear();
+    m_threadLoad.clear();
+    m_running = false;
+}
+
+bool ConnectionManager::isRunning() const noexcept
+{
+    return m_running;
+}
+
+void ConnectionManager::startBus(Bus& bus)
+{
+    const auto lightest = std::min_element(m_threadLoad.begin(), m_threadLoad.end());
+    bus.thread = int(lightest - m_threadLoad.begin());
+    *lightest += qMax(1, int(bus.config.devices.size()));
+
+    // The worker creates its connection and timers in start(), on its own thread
+    bus.worker = new BusWorker(bus.config);
+    bus.worker->moveToThread(m_threads[bus.thread]);
+    connect(m_threads[bus.thread], &QThread::finished, bus.worker, &QObject::deleteLater);
+    QMetaObject::invokeMethod(bus.worker, &BusWorker::start, Qt::QueuedConnection);
+}
+
+// Blocks until the worker has closed its link, then leaves the deletion to its thread
+void ConnectionManager::stopBus(Bus& bus)
+{
+    if (!bus.worker) {
+        return;
+    }
+
+    BusWorker* worker = bus.worker;
+    QMetaObject::invokeMethod(worker, &BusWorker::stop, Qt::BlockingQueuedConnection);
+    bus.lastSnapshot = worker->snapshot();
+    worker->deleteLater();
+
+    m_threadLoad[bus.thread] -= qMax(1, int(bus.config.devices.size()));
+    bus.worker = nullptr;
+    bus.thread = -1;
+}
+
+bool ConnectionManager::loadSite(const QString& fileName, QString* errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull()) {
+        if (errorMessage) *errorMessage = parseError.errorString();
+        return false;
+    }
+
+    const QJsonObject root = doc.object();
+    if (root.value("version").toInt() != siteVersion) {
+        if (errorMessage) *errorMessage = tr("Unsupported site file version %1").arg(root.value("version").toInt());
+        return false;
+    }
+
+    // Parse everything before replacing the current buses
+    QList<BusConfig> configs;
+    for (const QJsonValue& value : root.value("buses").toArray()) {
+        BusConfig config;
+        if (!BusConfig::fromJson(value.toObject(), &config, errorMessage)) {
+            return false;
+        }
+        configs.append(config);
+    }
+
+    const bool wasRunning = m_running;
+    stop();
+    clear();
+    if (root.contains("workers")) {
+        setWorkerCount(root.value("workers").toInt());
+    }
+    for (const BusConfig& config : configs) {
+        addBus(config);
+    }
+    if (wasRunning) {
+        start();
+    }
+
+    qDebug() << "Loaded site with" << configs.size() << "buses from" << fileName;
+    return true;
+}
+
+bool ConnectionManager::saveSite(const QString& fileName, QString* errorMessage) const
+{
+    QJsonArray buses;
+    for (const Bus& bus : m_buses) {
+        buses.append(bus.config.toJson());
+    }
+    QJsonObject root;
+    root.insert("version", siteVersion);
+    root.insert("workers", m_workerCount);
+    root.insert("buses", buses);
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(QJsonDocument(root).toJson()) < 0
+        || !file.commit()) {
+        if (errorMessage) *errorMessage = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,361 @@
+#include "ConnectionManagerDialog.h"
+#include "ModbusConfigDialog.h"
+#include "ScriptRunner.h"
+#include "NativeRtuTransport.h"
+#include <QFileDialog>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QTreeWidgetItem>
+#include <QDebug>
+
+namespace {
+    enum Column { NameColumn, AddressColumn, StateColumn, RequestsColumn, ErrorsColumn,
+        TimeoutsColumn, AverageColumn, ValuesColumn };
+
+    constexpr int busIdRole = Qt::UserRole;
+    constexpr int maxShownValues = 16;
+
+    QString typeKey(ModbusConnection::RegisterType type)
+    {
+        switch (type) {
+        case ModbusConnection::Coils: return QStringLiteral("COIL");
+        case ModbusConnection::DiscreteInputs: return QStringLiteral("DI");
+        case ModbusConnection::InputRegisters: return QStringLiteral("IR");
+        case ModbusConnection::HoldingRegisters: return QStringLiteral("HR");
+        }
+        return QString();
+    }
+
+    QString formatValues(const QVector<quint16>& values)
+    {
+        QStringList parts;
+        for (int i = 0; i < values.size() && i < maxShownValues; ++i) {
+            parts.append(QString::number(values[i]));
+        }
+        if (values.size() > maxShownValues) {
+            parts.append(QStringLiteral("..."));
+        }
+        return parts.join(' ');
+    }
+}
+
+ConnectionManagerDialog::ConnectionManagerDialog(QWidget* parent)
+    : QDialog(parent)
+{
+    ui.setupUi(this);
+    m_manager = new ConnectionManager(this);
+    initUI();
+    setupConnections();
+}
+
+ConnectionManagerDialog::~ConnectionManagerDialog()
+{
+    m_manager->stop();
+}
+
+void ConnectionManagerDialog::setPortScanner(SerialPortScanner* scanner)
+{
+    m_portScanner = scanner;
+}
+
+void ConnectionManagerDialog::initUI()
+{
+    ui.managerTreeWidget->setHeaderLabels({ tr("Name"), tr("Address"), tr("State"), tr("Requests"),
+        tr("Errors"), tr("Timeouts"), tr("Avg ms"), tr("Values") });
+    ui.managerTreeWidget->setColumnWidth(NameColumn, 180);
+    ui.managerTreeWidget->setColumnWidth(AddressColumn, 160);
+
+    ui.managerWorkersSpinBox->setRange(1, 8);
+    ui.managerWorkersSpinBox->setValue(m_manager->workerCount());
+    ui.managerNativeCheckBox->setEnabled(NativeRtuTransport::isSupported());
+
+    ui.managerStopBtn->setEnabled(false);
+    m_statusTimer.setInterval(1000);
+    updateStatus();
+}
+
+void ConnectionManagerDialog::setupConnections()
+{
+    connect(ui.managerAddSerialBtn, &QPushButton::clicked, this, &ConnectionManagerDialog::onAddSerialBus);
+    connect(ui.managerAddTcpBtn, &QPushButton::clicked, this, &ConnectionManagerDialog::onAddTcpEndpoint);
+    connect(ui.managerRemoveBtn, &QPushButton::clicked, this, &ConnectionManagerDialog::onRemove);
+    connect(ui.managerLoadBtn, &QPushButton::clicked, this, &ConnectionManagerDialog::onLoadSite);
+    connect(ui.managerSaveBtn, &QPushButton::clicked, this, &ConnectionManagerDialog::onSaveSite);
+    connect(ui.managerStartBtn, &QPushButton::clicked, this, &ConnectionManagerDialog::onStart);
+    connect(ui.managerStopBtn, &QPushButton::clicked, this, &ConnectionManagerDialog::onStop);
+    connect(ui.managerCloseBtn, &QPushButton::clicked, this, &QDialog::reject);
+    connect(ui.managerWorkersSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, [this](int count) {
+        m_manager->setWorkerCount(count);
+        });
+    connect(m_manager, &ConnectionManager::busesChanged, this, &ConnectionManagerDialog::rebuildTree);
+    connect(&m_statusTimer, &QTimer::timeout, this, &ConnectionManagerDialog::updateStatus);
+}
+
+void ConnectionManagerDialog::onAddSerialBus()
+{
+    ModbusConfigDialog configDialog(this);
+    configDialog.setPortScanner(m_portScanner);
+    if (configDialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    BusConfig config;
+    config.kind = BusConfig::Serial;
+    config.address = configDialog.getPort();
+    config.baudRate = configDialog.getBaudRate();
+    config.dataBits = configDialog.getDataBits();
+    config.parity = configDialog.getParity();
+    config.stopBits = configDialog.getStopBits();
+    config.nativeTransport = ui.managerNativeCheckBox->isChecked();
+    config.name = config.address;
+    if (config.address.isEmpty()) {
+        QMessageBox::warning(this, tr("Error"), tr("No serial port selected"));
+        return;
+    }
+
+    if (askDevices(configDialog.getSlaveID(), &config.devices)) {
+        m_manager->addBus(config);
+    }
+}
+
+void ConnectionManagerDialog::onAddTcpEndpoint()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, tr("Add TCP Endpoint"),
+        tr("Host[:port]:"), QLineEdit::Normal, QStringLiteral("192.168.1.10:502"), &ok).trimmed();
+    if (!ok || text.isEmpty()) {
+        return;
+    }
+
+    BusConfig config;
+    config.kind = BusConfig::Tcp;
+    config.address = text;
+    const int colon = text.lastIndexOf(':');
+    if (colon > 0) {
+        bool portOk = false;
+        const int port = text.mid(colon + 1).toInt(&portOk);
+        if (!portOk || port < 1 || port > 65535) {
+            QMessageBox::warning(this, tr("Error"), tr("Invalid port: %1").arg(text.mid(colon + 1)));
+            return;
+        }
+        config.address = text.left(colon);
+        config.tcpPort = quint16(port);
+    }
+    config.name = config.description();
+
+    // Unit identifier 1 is what most Ethernet devices answer to
+    if (askDevices(1, &config.devices)) {
+        m_manager->addBus(config);
+    }
+}
+
+// Devices of a new bus: one per slave ID, all with the same ranges and interval
+bool ConnectionManagerDialog::askDevices(int defaultSlaveID, QList<BusDeviceConfig>* devices)
+{
+    bool ok = false;
+    const QString slaveText = QInputDialog::getText(this, tr("Devices"),
+        tr("Slave IDs (e.g. 1,2,5-8):"), QLineEdit::Normal, QString::number(defaultSlaveID), &ok);
+    if (!ok) {
+        return false;
+    }
+    const QList<int> slaveIDs = ScriptRunner::parseSlaveList(slaveText, &ok);
+    if (!ok) {
+        QMessageBox::warning(this, tr("Error"), tr("Invalid slave list: %1").arg(slaveText));
+        return false;
+    }
+
+    const QString rangeText = QInputDialog::getText(this, tr("Devices"),
+        tr("Ranges of each device (e.g. HR:0-9; COIL:0-15):"), QLineEdit::Normal, QStringLiteral("HR:0-9"), &ok);
+    if (!ok) {
+        return false;
+    }
+    QList<SnapshotRange> ranges;
+    QString error;
+    if (!RegisterSnapshot::parseRanges(rangeText, &ranges, &error)) {
+        QMessageBox::warning(this, tr("Error"), error);
+        return false;
+    }
+
+    const int interval = QInputDialog::getInt(this, tr("Devices"), tr("Poll interval (ms):"),
+        1000, 20, 3600000, 100, &ok);
+    if (!ok) {
+        return false;
+    }
+
+    for (const int slaveID : slaveIDs) {
+        BusDeviceConfig device;
+        device.name = tr("Slave %1").arg(slaveID);
+        device.slaveID = slaveID;
+        device.ranges = ranges;
+        device.intervalMs = interval;
+        devices->append(device);
+    }
+    return true;
+}
+
+void ConnectionManagerDialog::onRemove()
+{
+    QTreeWidgetItem* item = ui.managerTreeWidget->currentItem();
+    while (item && item->parent()) {
+        item = item->parent();
+    }
+    if (!item) {
+        QMessageBox::warning(this, tr("Error"), tr("Select a bus to remove"));
+        return;
+    }
+    m_manager->removeBus(item->data(NameColumn, busIdRole).toInt());
+}
+
+void ConnectionManagerDialog::onLoadSite()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Load Site"),
+        QString(), tr("Site files (*.json);;All files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    if (!m_manager->loadSite(fileName, &error)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to load site: %1").arg(error));
+        return;
+    }
+    const QSignalBlocker blocker(ui.managerWorkersSpinBox);
+    ui.managerWorkersSpinBox->setValue(m_manager->workerCount());
+}
+
+void ConnectionManagerDialog::onSaveSite()
+{
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Save Site"),
+        QStringLiteral("site.json"), tr("Site files (*.json)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    if (!m_manager->saveSite(fileName, &error)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to save site: %1").arg(error));
+    }
+}
+
+void ConnectionManagerDialog::onStart()
+{
+    if (m_manager->busIds().isEmpty()) {
+        QMessageBox::warning(this, tr("Error"), tr("No buses configured"));
+        return;
+    }
+
+    m_manager->start();
+    m_rateClock.start();
+    m_lastRequests = m_manager->totals().requests;
+    setRunning(true);
+}
+
+void ConnectionManagerDialog::onStop()
+{
+    m_manager->stop();
+    setRunning(false);
+}
+
+void ConnectionManagerDialog::setRunning(bool running)
+{
+    ui.managerStartBtn->setEnabled(!running);
+    ui.managerStopBtn->setEnabled(running);
+    ui.managerWorkersSpinBox->setEnabled(!running);
+    if (running) {
+        m_statusTimer.start();
+    }
+    else {
+        m_statusTimer.stop();
+    }
+    updateStatus();
+}
+
+// One item per bus, device and range; updateStatus() only changes their texts
+void ConnectionManagerDialog::rebuildTree()
+{
+    ui.managerTreeWidget->clear();
+
+    for (const int id : m_manager->busIds()) {
+        const BusConfig config = m_manager->busConfig(id);
+        auto* busItem = new QTreeWidgetItem(ui.managerTreeWidget);
+        busItem->setText(NameColumn, config.name);
+        busItem->setText(AddressColumn, config.description());
+        busItem->setData(NameColumn, busIdRole, id);
+
+        for (const BusDeviceConfig& device : config.devices) {
+            auto* deviceItem = new QTreeWidgetItem(busItem);
+            deviceItem->setText(NameColumn, device.name);
+            deviceItem->setText(AddressColumn, tr("Slave %1, %2 ms").arg(device.slaveID).arg(device.intervalMs));
+
+            for (const SnapshotRange& range : device.ranges) {
+                auto* rangeItem = new QTreeWidgetItem(deviceItem);
+                rangeItem->setText(NameColumn, QString("%1:%2-%3").arg(typeKey(range.type))
+                    .arg(range.start).arg(range.start + range.count - 1));
+            }
+        }
+    }
+    updateStatus();
+}
+
+void ConnectionManagerDialog::updateStatus()
+{
+    for (int i = 0; i < ui.managerTreeWidget->topLevelItemCount(); ++i) {
+        QTreeWidgetItem* busItem = ui.managerTreeWidget->topLevelItem(i);
+        const BusSnapshot snapshot = m_manager->snapshot(busItem->data(NameColumn, busIdRole).toInt());
+
+        busItem->setText(StateColumn, BusSnapshot::stateName(snapshot.state));
+        busItem->setToolTip(StateColumn, snapshot.lastError);
+
+        quint64 requests = 0;
+        quint64 errors = 0;
+        quint64 timeouts = 0;
+        int online = 0;
+        for (int d = 0; d < busItem->childCount() && d < snapshot.devices.size(); ++d) {
+            const BusDeviceStatistics& statistics = snapshot.devices[d];
+            QTreeWidgetItem* deviceItem = busItem->child(d);
+            deviceItem->setText(StateColumn, statistics.online ? tr("Online") : tr("Offline"));
+            deviceItem->setToolTip(StateColumn, statistics.lastError);
+            deviceItem->setText(RequestsColumn, QString::number(statistics.requests));
+            deviceItem->setText(ErrorsColumn, QString::number(statistics.exceptions + statistics.failures));
+            deviceItem->setText(TimeoutsColumn, QString::number(statistics.timeouts));
+            deviceItem->setText(AverageColumn, statistics.responses > 0
+                ? QString::number(statistics.averageMs, 'f', 1) : QString());
+
+            for (int r = 0; r < deviceItem->childCount() && r < statistics.values.size(); ++r) {
+                deviceItem->child(r)->setText(ValuesColumn, formatValues(statistics.values[r]));
+            }
+
+            requests += statistics.requests;
+            errors += statistics.exceptions + statistics.failures;
+            timeouts += statistics.timeouts;
+            if (statistics.online) {
+                ++online;
+            }
+        }
+
+        busItem->setText(RequestsColumn, QString::number(requests));
+        busItem->setText(ErrorsColumn, QString::number(errors));
+        busItem->setText(TimeoutsColumn, QString::number(timeouts));
+        busItem->setText(ValuesColumn, tr("%1/%2 online").arg(online).arg(snapshot.devices.size()));
+    }
+
+    const ConnectionManager::Totals totals = m_manager->totals();
+    double rate = 0;
+    if (m_manager->isRunning() && m_rateClock.isValid()) {
+        const qint64 elapsedMs = m_rateClock.restart();
+        if (elapsedMs > 0) {
+            rate = double(totals.requests - m_lastRequests) * 1000.0 / elapsedMs;
+        }
+        m_lastRequests = totals.requests;
+    }
+
+    ui.managerStatusLabel->setText(
+        tr("Buses: %1/%2 connected  Devices: %3/%4 online  Threads: %5\n"
+            "Requests: %6 (%7/s)  Exceptions: %8  Timeouts: %9  Failures: %10  Avg: %11 ms")
+        .arg(totals.connected).arg(totals.buses)
+        .arg(totals.online).arg(totals.devices)
+        .arg(m_manager->workerCount())
+        .arg(totals.requests).arg(rate, 0, 'f', 1)
+        .arg(totals.exceptions).arg(totals.timeouts).arg(totals.failures)
+        .arg(totals.averageMs, 0, 'f', 1));
+}
@@ -0,0 +1,621 @@
+#include "ControlServer.h"
+#include "RegisterSnapshot.h"
+#include "SnapshotCapture.h"
+#include "TagDatabase.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QModbusReply>
+#include <QTimer>
+#include <QDebug>
+#include <memory>
+
+namespace {
+    // JSON-RPC 2.0 error codes
+    constexpr int parseError = -32700;
+    constexpr int invalidRequest = -32600;
+    constexpr int methodNotFound = -32601;
+    constexpr int invalidParams = -32602;
+    constexpr int deviceError = -32000;
+
+    constexpr qsizetype maxLineBytes = 1 << 20;
+    constexpr int maxRegistersPerRead = 125;
+    constexpr int maxBitsPerRead = 2000;
+
+    bool isBitType(ModbusConnection::RegisterType type)
+    {
+        return type == ModbusConnection::Coils || type == ModbusConnection::DiscreteInputs;
+    }
+
+    QString registerTypeName(ModbusConnection::RegisterType type)
+    {
+        switch (type) {
+        case ModbusConnection::Coils: return QStringLiteral("COIL");
+        case ModbusConnection::DiscreteInputs: return QStringLiteral("DI");
+        case ModbusConnection::InputRegisters: return QStringLiteral("IR");
+        case ModbusConnection::HoldingRegisters: return QStringLiteral("HR");
+        }
+        return QString();
+    }
+}
+
+ControlServer::ControlServer(QObject* parent)
+    : QObject(parent)
+{
+    m_server = new QLocalServer(this);
+    m_server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(m_server, &QLocalServer::newConnection, this, &ControlServer::handleNewConnection);
+}
+
+ControlServer::~ControlServer()
+{
+    close();
+}
+
+QString ControlServer::defaultName()
+{
+    return QStringLiteral("qtmodbusclient-control");
+}
+
+void ControlServer::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+}
+
+bool ControlServer::listen(const QString& name, QString* errorMessage)
+{
+    if (m_server->isListening()) {
+        return true;
+    }
+
+    // A socket file left behind by a crashed instance would block listen()
+    QLocalServer::removeServer(name);
+    if (!m_server->listen(name)) {
+        if (errorMessage) {
+            *errorMessage = m_server->errorString();
+        }
+        return false;
+    }
+
+    qDebug() << "Control socket listening on" << m_server->fullServerName();
+    return true;
+}
+
+void ControlServer::close()
+{
+    m_server->close();
+
+    const QList<QLocalSocket*> sockets = m_buffers.keys();
+    for (QLocalSocket* socket : sockets) {
+        socket->abort();
+    }
+}
+
+bool ControlServer::isListening() const
+{
+    return m_server->isListening();
+}
+
+QString ControlServer::fullServerName() const
+{
+    return m_server->fullServerName();
+}
+
+void ControlServer::handleNewConnection()
+{
+    while (QLocalSocket* socket = m_server->nextPendingConnection()) {
+        m_buffers.insert(socket, QByteArray());
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { handleReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { handleDisconnected(socket); });
+    }
+}
+
+void ControlServer::handleReadyRead(QLocalSocket* socket)
+{
+    QByteArray& buffer = m_buffers[socket];
+    buffer.append(socket->readAll());
+
+    qsizetype newline;
+    while ((newline = buffer.indexOf('\n')) >= 0) {
+        const QByteArray line = buffer.left(newline).trimmed();
+        buffer.remove(0, newline + 1);
+        if (!line.isEmpty()) {
+            handleMessage(socket, line);
+        }
+    }
+
+    // No request comes close; the client is broken or hostile
+    if (buffer.size() > maxLineBytes) {
+        qWarning() << "Control client sent a line over" << maxLineBytes << "bytes, disconnecting";
+        socket->abort();
+    }
+}
+
+// Drops the client's subscriptions; replies still on the bus find the socket gone
+void ControlServer::handleDisconnected(QLocalSocket* socket)
+{
+    for (auto it = m_subscriptions.begin(); it != m_subscriptions.end();) {
+        if (it->socket == socket) {
+            delete it->timer;
+            it = m_subscriptions.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    m_buffers.remove(socket);
+    socket->deleteLater();
+}
+
+void ControlServer::handleMessage(QLocalSocket* socket, const QByteArray& line)
+{
+    QJsonParseError parseResult;
+    const QJsonDocument document = QJsonDocument::fromJson(line, &parseResult);
+    if (parseResult.error != QJsonParseError::NoError) {
+        send(socket, makeResponse(QJsonValue::Null, QJsonValue(), makeError(parseError, parseResult.errorString())));
+        return;
+    }
+
+    const QPointer<QLocalSocket> target(socket);
+
+    if (document.isObject()) {
+        const QJsonObject request = document.object();
+        const QJsonValue id = request.value("id");
+        if (!isValidRequest(request)) {
+            send(socket, makeResponse(id.isUndefined() ? QJsonValue(QJsonValue::Null) : id, QJsonValue(),
+                makeError(invalidRequest, tr("Invalid request"))));
+            return;
+        }
+        dispatch(socket, request, [target, id](const QJsonValue& result, const QJsonObject& error) {
+            if (target && !id.isUndefined()) {
+                send(target, makeResponse(id, result, error));
+            }
+            });
+        return;
+    }
+
+    const QJsonArray batch = document.array();
+    if (batch.isEmpty()) {
+        send(socket, makeResponse(QJsonValue::Null, QJsonValue(), makeError(invalidRequest, tr("Empty batch"))));
+        return;
+    }
+
+    // Responses are collected in request order and sent together
+    struct Batch {
+        QJsonArray responses;
+        QList<bool> answered;
+        int remaining = 0;
+    };
+    auto state = std::make_shared<Batch>();
+    state->remaining = int(batch.size());
+    for (int i = 0; i < batch.size(); ++i) {
+        state->responses.append(QJsonValue());
+        state->answered.append(false);
+    }
+
+    for (int i = 0; i < batch.size(); ++i) {
+        const QJsonObject request = batch[i].toObject();
+        // Only a valid request without an id is a notification; an invalid one is answered with a null id
+        const bool valid = isValidRequest(batch[i]);
+        const QJsonValue id = valid || request.contains("id") ? request.value("id") : QJsonValue(QJsonValue::Null);
+        dispatch(socket, request, [target, state, i, id](const QJsonValue& result, const QJsonObject& error) {
+            if (!id.isUndefined()) {
+                state->responses[i] = makeResponse(id, result, error);
+                state->answered[i] = true;
+            }
+            if (--state->remaining > 0 || !target) {
+                return;
+            }
+
+            QJsonArray responses;
+            for (int j = 0; j < state->responses.size(); ++j) {
+                if (state->answered[j]) {
+                    responses.append(state->responses[j]);
+                }
+            }
+            if (!responses.isEmpty()) {
+                send(target, responses);
+            }
+            });
+    }
+}
+
+void ControlServer::dispatch(QLocalSocket* socket, const QJsonObject& request, const Completion& done)
+{
+    const QString method = request.value("method").toString();
+    const QJsonObject params = request.value("params").toObject();
+
+    if (!isValidRequest(request)) {
+        done(QJsonValue(), makeError(invalidRequest, tr("Invalid request")));
+        return;
+    }
+
+    if (method == QLatin1String("status")) {
+        QJsonObject status;
+        status["connected"] = m_modbusConnection && m_modbusConnection->isConnected();
+        status["port"] = m_modbusConnection ? m_modbusConnection->getPortName() : QString();
+        status["slave"] = m_modbusConnection ? m_modbusConnection->getSlaveID() : 0;
+        done(status, QJsonObject());
+        return;
+    }
+
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        done(QJsonValue(), makeError(deviceError, tr("Not connected to any device")));
+        return;
+    }
+
+    if (method == QLatin1String("read")) {
+        callRead(params, done);
+    }
+    else if (method == QLatin1String("write")) {
+        callWrite(params, done);
+    }
+    else if (method == QLatin1String("readWrite")) {
+        callReadWrite(params, done);
+    }
+    else if (method == QLatin1String("maskWrite")) {
+        callMaskWrite(params, done);
+    }
+    else if (method == QLatin1String("snapshot")) {
+        callSnapshot(params, done);
+    }
+    else if (method == QLatin1String("subscribe")) {
+        callSubscribe(socket, params, done);
+    }
+    else if (method == QLatin1String("unsubscribe")) {
+        callUnsubscribe(socket, params, done);
+    }
+    else {
+        done(QJsonValue(), makeError(methodNotFound, tr("Unknown method: %1").arg(method)));
+    }
+}
+
+void ControlServer::callRead(const QJsonObject& params, const Completion& done)
+{
+    ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+    const bool typeOk = TagDatabase::parseRegisterType(params.value("type").toString(), &type);
+    const int address = params.value("address").toInt(-1);
+    const int count = params.value("count").toInt(1);
+    const int limit = isBitType(type) ? maxBitsPerRead : maxRegistersPerRead;
+
+    if (!typeOk || address < 0 || address > 65535 || count < 1 || count > limit) {
+        done(QJsonValue(), makeError(invalidParams, tr("read needs type, address and count (max %1)").arg(limit)));
+        return;
+    }
+
+    const int slaveID = params.value("slave").toInt(m_modbusConnection->getSlaveID());
+    readValues(type, address, count, slaveID, [done](const QJsonArray& values, const QString& error) {
+        if (error.isEmpty()) {
+            done(values, QJsonObject());
+        }
+        else {
+            done(QJsonValue(), makeError(deviceError, error));
+        }
+        });
+}
+
+// Single values use FC05/FC06, longer arrays FC15/FC16
+void ControlServer::callWrite(const QJsonObject& params, const Completion& done)
+{
+    ModbusConnection::RegisterType type = ModbusConnection::HoldingRegisters;
+    const int address = params.value("address").toInt(-1);
+    const QJsonArray values = params.value("values").toArray();
+    const bool typeOk = TagDatabase::parseRegisterType(params.value("type").toString(), &type)
+        && (type == ModbusConnection::Coils || type == ModbusConnection::HoldingRegisters);
+    const int limit = type == ModbusConnection::Coils ? 1968 : 123;
+
+    if (!typeOk || address < 0 || address > 65535 || values.isEmpty() || values.size() > limit) {
+        done(QJsonValue(), makeError(invalidParams, tr("write needs a coil or HR type, address and values")));
+        return;
+    }
+
+    QModbusReply* reply = nullptr;
+    if (type == ModbusConnection::Coils) {
+        if (values.size() == 1) {
+            reply = m_modbusConnection->writeCoil(address, values[0].toInt() != 0 || values[0].toBool());
+        }
+        else {
+            BitBlock bits(int(values.size()));
+            for (int i = 0; i < values.size(); ++i) {
+                bits.setBit(i, values[i].toInt() != 0 || values[i].toBool());
+            }
+            reply = m_modbusConnection->writeMultipleCoils(address, bits);
+        }
+    }
+    else {
+        if (values.size() == 1) {
+            reply = m_modbusConnection->writeSingleRegister(address, quint16(values[0].toInt()));
+        }
+        else {
+            QVector<quint16> registers;
+            registers.reserve(values.size());
+            for (const QJsonValue& value : values) {
+                registers.append(quint16(value.toInt()));
+            }
+            reply = m_modbusConnection->writeMultipleRegisters(ModbusConnection::HoldingRegisters, address, registers);
+        }
+    }
+
+    if (!reply) {
+        done(QJsonValue(), makeError(deviceError, tr("Failed to send write request")));
+        return;
+    }
+
+    connect(reply, &QModbusReply::finished, this, [reply, done]() {
+        if (reply->error() == QModbusDevice::NoError) {
+            done(true, QJsonObject());
+        }
+        else {
+            done(QJsonValue(), makeError(deviceError, reply->errorString()));
+        }
+        reply->deleteLater();
+        });
+}
+
+// FC23: {"writeAddress", "values", "address", "count"} answers with the registers read after the write
+void ControlServer::callReadWrite(const QJsonObject& params, const Completion& done)
+{
+    const int readAddress = params.value("address").toInt(-1);
+    const int readCount = params.value("count").toInt(1);
+    const int writeAddress = params.value("writeAddress").toInt(-1);
+    const QJsonArray values = params.value("values").toArray();
+
+    if (readAddress < 0 || readAddress > 65535 || readCount < 1 || readCount > 125
+        || writeAddress < 0 || writeAddress > 65535 || values.isEmpty() || values.size() > 121) {
+        done(QJsonValue(), makeError(invalidParams,
+            tr("readWrite needs writeAddress, values (max 121), address and count (max 125)")));
+        return;
+    }
+
+    QVector<quint16> registers;
+    registers.reserve(values.size());
+    for (const QJsonValue& value : values) {
+        registers.append(quint16(value.toInt()));
+    }
+
+    const int slaveID = params.value("slave").toInt(m_modbusConnection->getSlaveID());
+    QModbusReply* reply = m_modbusConnection->readWriteMultipleRegisters(
+        readAddress, quint16(readCount), writeAddress, registers, slaveID);
+    if (!reply) {
+        done(QJsonValue(), makeError(deviceError, tr("Failed to send read/write request")));
+        return;
+    }
+
+    connect(reply, &QModbusReply::finished, this, [reply, done]() {
+        if (reply->error() == QModbusDevice::NoError) {
+            QJsonArray result;
+            for (const quint16 value : reply->result().values()) {
+                result.append(int(value));
+            }
+            done(result, QJsonObject());
+        }
+        else {
+            done(QJsonValue(), makeError(deviceError, reply->errorString()));
+        }
+        reply->deleteLater();
+        });
+}
+
+// FC22: {"address", "and", "or"}
+void ControlServer::callMaskWrite(const QJsonObject& params, const Completion& done)
+{
+    const int address = params.value("address").toInt(-1);
+    const int andMask = params.value("and").toInt(-1);
+    const int orMask = params.value("or").toInt(-1);
+
+    if (address < 0 || address > 65535 || andMask < 0 || andMask > 0xFFFF || orMask < 0 || orMask > 0xFFFF) {
+        done(QJsonValue(), makeError(invalidParams, tr("maskWrite needs address, and and or masks")));
+        return;
+    }
+
+    const int slaveID = params.value("slave").toInt(m_modbusConnection->getSlaveID());
+    QModbusReply* reply = m_modbusConnection->maskWriteRegister(address, quint16(andMask), quint16(orMask), slaveID);
+    if (!reply) {
+        done(QJsonValue(), makeError(deviceError, tr("Failed to send mask write request")));
+        return;
+    }
+
+    connect(reply, &QModbusReply::finished, this, [reply, done]() {
+        if (reply->error() == QModbusDevice::NoError) {
+            done(true, QJsonObject());
+        }
+        else {
+            done(QJsonValue(), makeError(deviceError, reply->errorString()));
+        }
+        reply->deleteLater();
+        });
+}
+
+void ControlServer::callSnapshot(const QJsonObject& params, const Completion& done)
+{
+    QList<SnapshotRange> ranges;
+    QString error;
+    if (!RegisterSnapshot::parseRanges(params.value("ranges").toString(), &ranges, &error)) {
+        done(QJsonValue(), makeError(invalidParams, error));
+        return;
+    }
+
+    auto* capture = new SnapshotCapture(this);
+    capture->setModbusConnection(m_modbusConnection);
+    connect(capture, &SnapshotCapture::finished, this, [capture, done](const RegisterSnapshot& snapshot) {
+        QJsonArray segments;
+        for (const SnapshotSegment& segment : snapshot.segments()) {
+            QJsonArray values;
+            for (int i = 0; i < segment.count(); ++i) {
+                values.append(segment.isBits() ? int(segment.bits.testBit(i)) : int(segment.registers[i]));
+            }
+            QJsonObject entry;
+            entry["type"] = registerTypeName(segment.type);
+            entry["start"] = segment.start;
+            entry["values"] = values;
+            segments.append(entry);
+        }
+        done(segments, QJsonObject());
+        capture->deleteLater();
+        });
+    connect(capture, &SnapshotCapture::failed, this, [capture, done](const QString& message) {
+        done(QJsonValue(), makeError(deviceError, message));
+        capture->deleteLater();
+        });
+
+    if (!capture->start(ranges, QStringLiteral("rpc"))) {
+        capture->deleteLater();
+        done(QJsonValue(), makeError(deviceError, tr("Failed to start snapshot")));
+    }
+}
+
+void ControlServer::callSubscribe(QLocalSocket* socket, const QJsonObject& params, const Completion& done)
+{
+    Subscription subscription;
+    subscription.socket = socket;
+    subscription.slaveID = params.value("slave").toInt(m_modbusConnection->getSlaveID());
+    subscription.address = params.value("address").toInt(-1);
+    subscription.count = params.value("count").toInt(1);
+    const int interval = params.value("interval").toInt(1000);
+
+    const bool typeOk = TagDatabase::parseRegisterType(params.value("type").toString(), &subscription.type);
+    const int limit = isBitType(subscription.type) ? maxBitsPerRead : maxRegistersPerRead;
+    if (!typeOk || subscription.address < 0 || subscription.address > 65535
+        || subscription.count < 1 || subscription.count > limit || interval < 50) {
+        done(QJsonValue(), makeError(invalidParams, tr("subscribe needs type, address, count and interval >= 50 ms")));
+        return;
+    }
+
+    const int id = m_nextSubscription++;
+    subscription.timer = new QTimer(this);
+    subscription.timer->setInterval(interval);
+    connect(subscription.timer, &QTimer::timeout, this, [this, id]() { pollSubscription(id); });
+    m_subscriptions.insert(id, subscription);
+    subscription.timer->start();
+
+    done(id, QJsonObject());
+    pollSubscription(id);
+}
+
+void ControlServer::callUnsubscribe(QLocalSocket* socket, const QJsonObject& params, const Completion& done)
+{
+    const int id = params.value("subscription").toInt();
+    const auto it = m_subscriptions.find(id);
+    if (it == m_subscriptions.end() || it->socket != socket) {
+        done(QJsonValue(), makeError(invalidParams, tr("Unknown subscription")));
+        return;
+    }
+
+    delete it->timer;
+    m_subscriptions.erase(it);
+    done(true, QJsonObject());
+}
+
+// Sends an update notification only when the values differ from the last one sent
+void ControlServer::pollSubscription(int id)
+{
+    const auto it = m_subscriptions.find(id);
+    if (it == m_subscriptions.end() || it->inFlight
+        || !m_modbusConnection || !m_modbusConnection->isConnected()) {
+        return;
+    }
+
+    it->inFlight = true;
+    readValues(it->type, it->address, it->count, it->slaveID,
+        [this, id](const QJsonArray& values, const QString& error) {
+            const auto current = m_subscriptions.find(id);
+            if (current == m_subscriptions.end()) {
+                return;
+            }
+            current->inFlight = false;
+            if (!error.isEmpty() || values == current->lastValues) {
+                return;
+            }
+            current->lastValues = values;
+
+            QJsonObject update;
+            update["subscription"] = id;
+            update["slave"] = current->slaveID;
+            update["address"] = current->address;
+            update["values"] = values;
+            QJsonObject notification;
+            notification["jsonrpc"] = QStringLiteral("2.0");
+            notification["method"] = QStringLiteral("update");
+            notification["params"] = update;
+            send(current->socket, notification);
+        });
+}
+
+void ControlServer::readValues(ModbusConnection::RegisterType type, int address, int count, int slaveID,
+    const std::function<void(const QJsonArray& values, const QString& error)>& done)
+{
+    QModbusReply* reply = isBitType(type)
+        ? m_modbusConnection->readBits(type, address, quint16(count), slaveID)
+        : m_modbusConnection->readRegister(type, address, quint16(count), slaveID);
+    if (!reply) {
+        done(QJsonArray(), tr("Failed to send read request"));
+        return;
+    }
+
+    connect(reply, &QModbusReply::finished, this, [reply, type, done]() {
+        reply->deleteLater();
+        if (reply->error() != QModbusDevice::NoError) {
+            done(QJsonArray(), reply->errorString());
+            return;
+        }
+
+        QJsonArray values;
+        if (isBitType(type)) {
+            const BitBlock bits = ModbusConnection::bitsFromReply(reply);
+            for (int i = 0; i < bits.size(); ++i) {
+                values.append(int(bits.testBit(i)));
+            }
+        }
+        else {
+            for (const quint16 value : reply->result().values()) {
+                values.append(int(value));
+            }
+        }
+        done(values, QString());
+        });
+}
+
+// A JSON object with jsonrpc "2.0" and a method name
+bool ControlServer::isValidRequest(const QJsonValue& request)
+{
+    const QJsonObject object = request.toObject();
+    const QJsonValue method = object.value("method");
+    return request.isObject() && object.value("jsonrpc").toString() == QLatin1String("2.0")
+        && method.isString() && !method.toString().isEmpty();
+}
+
+QJsonObject ControlServer::makeError(int code, const QString& message)
+{
+    QJsonObject error;
+    error["code"] = code;
+    error["message"] = message;
+    return error;
+}
+
+QJsonObject ControlServer::makeResponse(const QJsonValue& id, const QJsonValue& result, const QJsonObject& error)
+{
+    QJsonObject response;
+    response["jsonrpc"] = QStringLiteral("2.0");
+    response["id"] = id;
+    if (error.isEmpty()) {
+        response["result"] = result;
+    }
+    else {
+        response["error"] = error;
+    }
+    return response;
+}
+
+void ControlServer::send(QLocalSocket* socket, const QJsonValue& message)
+{
+    if (!socket || socket->state() != QLocalSocket::ConnectedState) {
+        return;
+    }
+
+    const QJsonDocument document = message.isArray()
+        ? QJsonDocument(message.toArray())
+        : QJsonDocument(message.toObject());
+    socket->write(document.toJson(QJsonDocument::Compact));
+    socket->write("\n", 1);
+}
@@ -0,0 +1,367 @@
+#include "Crc16.h"
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QDebug>
+#include <array>
+#include <cstring>
+
+#if defined(Q_PROCESSOR_X86) && (defined(__GNUC__) || defined(_MSC_VER))
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CRC16_CLMUL_TARGET
+#else
+#include <cpuid.h>
+#define CRC16_CLMUL_TARGET __attribute__((target("pclmul,sse2")))
+#endif
+#define CRC16_CLMUL
+#endif
+
+namespace {
+    using Kernel = quint16 (*)(const quint8*, qsizetype, quint16);
+
+    constexpr quint16 reflectedPolynomial = 0xA001;
+    constexpr quint32 polynomial = 0x18005;     // x^16 + x^15 + x^2 + 1, most significant bit first
+
+    quint16 bitwiseChecksum(const quint8* data, qsizetype size, quint16 crc)
+    {
+        for (qsizetype i = 0; i < size; ++i) {
+            crc ^= data[i];
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? quint16((crc >> 1) ^ reflectedPolynomial) : quint16(crc >> 1);
+            }
+        }
+        return crc;
+    }
+
+    // tables[k][b]: CRC of byte b followed by k zero bytes, starting from zero
+    constexpr std::array<std::array<quint16, 256>, 8> tables = [] {
+        std::array<std::array<quint16, 256>, 8> t{};
+        for (int i = 0; i < 256; ++i) {
+            quint16 crc = quint16(i);
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? quint16((crc >> 1) ^ reflectedPolynomial) : quint16(crc >> 1);
+            }
+            t[0][i] = crc;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (int i = 0; i < 256; ++i) {
+                t[k][i] = quint16((t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF]);
+            }
+        }
+        return t;
+    }();
+
+    quint16 tableChecksum(const quint8* data, qsizetype size, quint16 crc)
+    {
+        for (qsizetype i = 0; i < size; ++i) {
+            crc = quint16((crc >> 8) ^ tables[0][(crc ^ data[i]) & 0xFF]);
+        }
+        return crc;
+    }
+
+    quint16 sliceBy8Checksum(const quint8* data, qsizetype size, quint16 crc)
+    {
+        while (size >= 8) {
+            crc ^= quint16(data[0] | (data[1] << 8));
+            crc = quint16(tables[7][crc & 0xFF] ^ tables[6][crc >> 8]
+                ^ tables[5][data[2]] ^ tables[4][data[3]] ^ tables[3][data[4]]
+                ^ tables[2][data[5]] ^ tables[1][data[6]] ^ tables[0][data[7]]);
+            data += 8;
+            size -= 8;
+        }
+        return tableChecksum(data, size, crc);
+    }
+
+#if defined(CRC16_CLMUL)
+    constexpr quint32 reflect32(quint32 value)
+    {
+        quint32 result = 0;
+        for (int bit = 0; bit < 32; ++bit) {
+            result |= ((value >> bit) & 1) << (31 - bit);
+        }
+        return result;
+    }
+
+    // Multiplier that moves a 64-bit half of a 128-bit block n bits further
+    // along the message: x^(n-1) mod P, bit-reflected and placed so that the
+    // carry-less product lines up with the reflected data without a shift
+    constexpr quint64 foldConstant(int n)
+    {
+        quint32 remainder = 1;
+        for (int i = 0; i < n - 1; ++i) {
+            remainder <<= 1;
+            if (remainder & 0x10000) {
+                remainder ^= polynomial;
+            }
+        }
+        return quint64(reflect32(remainder)) << 32;
+    }
+
+    constexpr quint64 fold512Low = foldConstant(512 + 64);
+    constexpr quint64 fold512High = foldConstant(512);
+    constexpr quint64 fold128Low = foldConstant(128 + 64);
+    constexpr quint64 fold128High = foldConstant(128);
+
+    // Below this the setup costs more than the tables
+    constexpr qsizetype clmulMinimumSize = 128;
+
+    CRC16_CLMUL_TARGET inline __m128i fold(__m128i block, __m128i constants, __m128i next)
+    {
+        return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(block, constants, 0x00),
+            _mm_clmulepi64_si128(block, constants, 0x11)), next);
+    }
+
+    CRC16_CLMUL_TARGET inline __m128i load(const quint8* data)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    // Folds four 128-bit lanes over the buffer, then folds them into one and
+    // hands the 16 remaining bytes, which are congruent to the whole message
+    // modulo the polynomial, to the tables
+    CRC16_CLMUL_TARGET quint16 clmulChecksum(const quint8* data, qsizetype size, quint16 crc)
+    {
+        if (size < clmulMinimumSize) {
+            return sliceBy8Checksum(data, size, crc);
+        }
+
+        const __m128i fold512 = _mm_set_epi64x(qint64(fold512High), qint64(fold512Low));
+        const __m128i fold128 = _mm_set_epi64x(qint64(fold128High), qint64(fold128Low));
+
+        __m128i x0 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(crc));
+        __m128i x1 = load(data + 16);
+        __m128i x2 = load(data + 32);
+        __m128i x3 = load(data + 48);
+        data += 64;
+        size -= 64;
+
+        while (size >= 64) {
+            x0 = fold(x0, fold512, load(data));
+            x1 = fold(x1, fold512, load(data + 16));
+            x2 = fold(x2, fold512, load(data + 32));
+            x3 = fold(x3, fold512, load(data + 48));
+            data += 64;
+            size -= 64;
+        }
+
+        x1 = fold(x0, fold128, x1);
+        x2 = fold(x1, fold128, x2);
+        x3 = fold(x2, fold128, x3);
+        while (size >= 16) {
+            x3 = fold(x3, fold128, load(data));
+            data += 16;
+            size -= 16;
+        }
+
+        alignas(16) quint8 folded[16];
+        _mm_store_si128(reinterpret_cast<__m128i*>(folded), x3);
+        return sliceBy8Checksum(data, size, sliceBy8Checksum(folded, sizeof(folded), 0));
+    }
+
+    bool cpuHasClmul()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 1)) != 0;
+#else
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL) != 0;
+#endif
+    }
+#endif
+
+    Kernel kernelFor(Crc16::Implementation implementation)
+    {
+        switch (implementation) {
+        case Crc16::Implementation::Bitwise: return bitwiseChecksum;
+        case Crc16::Implementation::Table: return tableChecksum;
+#if defined(CRC16_CLMUL)
+        case Crc16::Implementation::Clmul: return cpuHasClmul() ? clmulChecksum : sliceBy8Checksum;
+#endif
+        default: return sliceBy8Checksum;
+        }
+    }
+
+    Crc16::Implementation detectImplementation()
+    {
+        const auto implementation = Crc16::isAvailable(Crc16::Implementation::Clmul)
+            ? Crc16::Implementation::Clmul : Crc16::Implementation::SliceBy8;
+        qDebug() << "CRC16 implementation:" << Crc16::implementationName(implementation);
+        return implementation;
+    }
+
+    Kernel activeKernel()
+    {
+        static const Kernel kernel = kernelFor(Crc16::activeImplementation());
+        return kernel;
+    }
+}
+
+quint16 Crc16::checksum(const void* data, qsizetype size, quint16 crc) noexcept
+{
+    return activeKernel()(static_cast<const quint8*>(data), size, crc);
+}
+
+quint16 Crc16::checksum(Implementation implementation, const void* data, qsizetype size, quint16 crc) noexcept
+{
+    return kernelFor(implementation)(static_cast<const quint8*>(data), size, crc);
+}
+
+Crc16::Implementation Crc16::activeImplementation() noexcept
+{
+    static const Implementation implementation = detectImplementation();
+    return implementation;
+}
+
+bool Crc16::isAvailable(Implementation implementation) noexcept
+{
+    if (implementation != Implementation::Clmul) {
+        return true;
+    }
+#if defined(CRC16_CLMUL)
+    static const bool clmul = cpuHasClmul();
+    return clmul;
+#else
+    return false;
+#endif
+}
+
+QString Crc16::implementationName(Implementation implementation)
+{
+    switch (implementation) {
+    case Implementation::Bitwise: return QStringLiteral("bitwise");
+    case Implementation::Table: return QStringLiteral("table");
+    case Implementation::SliceBy8: return QStringLiteral("slice-by-8");
+    case Implementation::Clmul: return QStringLiteral("clmul");
+    }
+    return QString();
+}
+
+QList<Crc16::Implementation> Crc16::availableImplementations()
+{
+    QList<Implementation> implementations;
+    for (const Implementation implementation : { Implementation::Bitwise, Implementation::Table,
+        Implementation::SliceBy8, Implementation::Clmul }) {
+        if (isAvailable(implementation)) {
+            implementations.append(implementation);
+        }
+    }
+    return implementations;
+}
+
+bool Crc16::selfTest()
+{
+    // Published check value of CRC-16/MODBUS
+    const char check[] = "123456789";
+    if (bitwiseChecksum(reinterpret_cast<const quint8*>(check), 9, initialValue) != 0x4B37) {
+        qWarning() << "CRC16 reference implementation fails the check value";
+        return false;
+    }
+
+    QRandomGenerator random(0x4D425553);
+    QByteArray buffer(4096 + 16, Qt::Uninitialized);
+    random.fillRange(reinterpret_cast<quint32*>(buffer.data()), buffer.size() / 4);
+    const auto* bytes = reinterpret_cast<const quint8*>(buffer.constData());
+
+    int failures = 0;
+    const auto expect = [&failures](Implementation implementation, quint16 actual, quint16 expected,
+        const char* what, qsizetype offset, qsizetype size) {
+        if (actual != expected && ++failures <= 20) {
+            qWarning().noquote() << QString("CRC16 %1 mismatch (%2, offset %3, size %4): 0x%5, expected 0x%6")
+                .arg(implementationName(implementation), QLatin1String(what)).arg(offset).arg(size)
+                .arg(actual, 4, 16, QLatin1Char('0')).arg(expected, 4, 16, QLatin1Char('0'));
+        }
+    };
+
+    for (const Implementation implementation : availableImplementations()) {
+        if (implementation == Implementation::Bitwise) {
+            continue;
+        }
+        const Kernel kernel = kernelFor(implementation);
+
+        // Every two-byte message, the shortest a register value takes
+        for (int value = 0; value <= 0xFFFF; ++value) {
+            const quint8 pair[2] = { quint8(value), quint8(value >> 8) };
+            expect(implementation, kernel(pair, 2, initialValue), bitwiseChecksum(pair, 2, initialValue),
+                "pair", 0, 2);
+        }
+
+        // Every starting value over a block long enough for the wide paths
+        for (int crc = 0; crc <= 0xFFFF; crc += 7) {
+            expect(implementation, kernel(bytes, 200, quint16(crc)), bitwiseChecksum(bytes, 200, quint16(crc)),
+                "start value", 0, 200);
+        }
+
+        // Every length up to past two folding rounds, at every alignment
+        for (qsizetype offset = 0; offset < 16; ++offset) {
+            for (qsizetype size = 0; size <= 600; ++size) {
+                expect(implementation, kernel(bytes + offset, size, initialValue),
+                    bitwiseChecksum(bytes + offset, size, initialValue), "length", offset, size);
+            }
+        }
+
+        // Large buffers continued across random split points
+        for (int round = 0; round < 200; ++round) {
+            const qsizetype size = random.bounded(4096) + 1;
+            const qsizetype split = random.bounded(int(size) + 1);
+            const quint16 expected = bitwiseChecksum(bytes, size, initialValue);
+            expect(implementation, kernel(bytes + split, size - split, kernel(bytes, split, initialValue)),
+                expected, "split", split, size);
+        }
+    }
+
+    if (failures > 0) {
+        qWarning() << "CRC16 self-test failed with" << failures << "mismatches";
+        return false;
+    }
+    qInfo() << "CRC16 self-test passed for" << availableImplementations().size() << "implementations";
+    return true;
+}
+
+QList<Crc16::BenchmarkResult> Crc16::benchmark(const QList<qsizetype>& blockSizes, qint64 millisecondsPerRun)
+{
+    qsizetype largest = 0;
+    for (const qsizetype size : blockSizes) {
+        largest = qMax(largest, size);
+    }
+    QByteArray buffer(largest, Qt::Uninitialized);
+    for (qsizetype i = 0; i < buffer.size(); ++i) {
+        buffer[i] = char(i * 131 + 7);
+    }
+    const auto* bytes = reinterpret_cast<const quint8*>(buffer.constData());
+
+    QList<BenchmarkResult> results;
+    for (const Implementation implementation : availableImplementations()) {
+        const Kernel kernel = kernelFor(implementation);
+        for (const qsizetype size : blockSizes) {
+            // Chaining the result keeps the calls from being folded away
+            quint16 crc = initialValue;
+            qint64 calls = 0;
+            QElapsedTimer timer;
+            timer.start();
+            do {
+                for (int i = 0; i < 64; ++i) {
+                    crc = kernel(bytes, size, crc);
+                }
+                calls += 64;
+            } while (timer.elapsed() < millisecondsPerRun);
+            const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+
+            BenchmarkResult result;
+            result.implementation = implementation;
+            result.blockSize = size;
+            result.nanosecondsPerCall = double(elapsedNs) / calls;
+            result.megabytesPerSecond = double(size) * calls * 1000.0 / elapsedNs;
+            results.append(result);
+
+            qInfo().noquote() << QString("CRC16 %1 %2 bytes: %3 MB/s, %4 ns/call (0x%5)")
+                .arg(implementationName(implementation), -10).arg(size, 6)
+                .arg(result.megabytesPerSecond, 9, 'f', 1).arg(result.nanosecondsPerCall, 9, 'f', 1)
+                .arg(crc, 4, 16, QLatin1Char('0'));
+        }
+    }
+    return results;
+}
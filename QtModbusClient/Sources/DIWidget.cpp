@@ -5,7 +5,6 @@
 #include <QEventLoop>
 #include <QHeaderView>
 #include <QApplication>
-#include <QStandardItem>
 
 DIWidget::DIWidget(QWidget* parent)
     : QWidget(parent)
@@ -45,9 +44,7 @@ void DIWidget::initUI()
 
 void DIWidget::initTableModel()
 {
-    m_diModel = new QStandardItemModel(this);
-    m_diModel->setColumnCount(3);
-    m_diModel->setHorizontalHeaderLabels({ tr("Address"), tr("Hex"), tr("Binary") });
+    m_diModel = new BitTableModel(this);
     ui.diReadMultipleDataTableView->setModel(m_diModel);
     ui.diReadMultipleDataTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     ui.diReadMultipleDataTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
@@ -143,8 +140,8 @@ void DIWidget::onReadMultipleDI()
     const int address = ui.diReadMultipleAddressSpinBox->value();
     const int count = ui.diReadMultipleCountSpinBox->value();
 
-    m_multipleDIReadReply = m_modbusConnection->readRegister(
-        ModbusConnection::DiscreteInputs, address, count);
+    m_multipleDIReadReply = m_modbusConnection->readBits(
+        ModbusConnection::DiscreteInputs, address, quint16(count));
 
     if (m_multipleDIReadReply) {
         connect(m_multipleDIReadReply, &QModbusReply::finished,
@@ -180,47 +177,15 @@ void DIWidget::handleMultipleDIReadResult()
 
 void DIWidget::processMultipleDIResult(QModbusReply* reply)
 {
-    const QModbusDataUnit result = reply->result();
-    if (result.registerType() != QModbusDataUnit::DiscreteInputs || result.valueCount() <= 0) {
+    const BitBlock bits = ModbusConnection::bitsFromReply(reply);
+    if (bits.isEmpty()) {
         qDebug() << "Invalid multiple DI data received";
         return;
     }
 
-    m_diModel->removeRows(0, m_diModel->rowCount());
-    const int startAddr = result.startAddress();
-    const int count = result.valueCount();
-    const int byteCount = (count + 7) / 8;
-    QVector<quint8> bytes(byteCount, 0);
-
-    for (int i = 0; i < count; ++i) {
-        const bool value = result.value(i);
-        const int addr = startAddr + i;
-        const int byteIndex = i / 8;
-        const int bitIndex = i % 8;
-
-        if (value) {
-            bytes[byteIndex] |= (1 << bitIndex);
-        }
-
-        QList<QStandardItem*> rowItems;
-        rowItems << new QStandardItem(QString::number(addr));
-        rowItems << new QStandardItem();
-        rowItems << new QStandardItem(value ? "1" : "0");
-        m_diModel->appendRow(rowItems);
-    }
-
-    updateHexColumn(bytes, byteCount);
-    qDebug() << "Multiple DI read successful - Start address:" << startAddr << "Count:" << count;
+    const int startAddr = ModbusConnection::startAddressOf(reply);
+    m_diModel->setBits(startAddr, bits);
+    qDebug() << "Multiple DI read successful - Start address:" << startAddr
+        << "Count:" << bits.size() << "On:" << bits.count();
     QApplication::beep();
 }
-
-void DIWidget::updateHexColumn(const QVector<quint8>& bytes, int byteCount)
-{
-    for (int i = 0; i < byteCount; ++i) {
-        const int rowIndex = i * 8;
-        if (rowIndex < m_diModel->rowCount()) {
-            const QModelIndex index = m_diModel->index(rowIndex, 1);
-            m_diModel->setData(index, QString("0x%1").arg(bytes[i], 2, 16, QChar('0')).toUpper());
-        }
-    }
-}
\ No newline at end of file
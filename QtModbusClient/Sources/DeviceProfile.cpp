@@ -0,0 +1,240 @@
+#include "DeviceProfile.h"
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+    constexpr int cacheVersion = 1;
+
+    QString typeKey(ModbusConnection::RegisterType type)
+    {
+        switch (type) {
+        case ModbusConnection::Coils: return QStringLiteral("COIL");
+        case ModbusConnection::DiscreteInputs: return QStringLiteral("DI");
+        case ModbusConnection::InputRegisters: return QStringLiteral("IR");
+        case ModbusConnection::HoldingRegisters: return QStringLiteral("HR");
+        }
+        return QString();
+    }
+
+    QJsonArray toArray(const QSet<int>& values)
+    {
+        QList<int> sorted = values.values();
+        std::sort(sorted.begin(), sorted.end());
+        QJsonArray array;
+        for (const int value : sorted) {
+            array.append(value);
+        }
+        return array;
+    }
+
+    QSet<int> toSet(const QJsonArray& array)
+    {
+        QSet<int> values;
+        for (const QJsonValue& value : array) {
+            values.insert(value.toInt());
+        }
+        return values;
+    }
+}
+
+bool DeviceProfile::isIdentified() const noexcept
+{
+    return !vendor.isEmpty() || !productCode.isEmpty();
+}
+
+QString DeviceProfile::description() const
+{
+    if (!isIdentified()) {
+        return QObject::tr("Unidentified device at slave %1").arg(slaveID);
+    }
+    return QStringList({ vendor, productCode, revision }).join(' ').simplified();
+}
+
+QList<AddressHole> DeviceProfile::holes() const
+{
+    QList<AddressHole> holes;
+    for (auto it = readableRanges.cbegin(); it != readableRanges.cend(); ++it) {
+        QList<AddressRange> ranges = it.value();
+        std::sort(ranges.begin(), ranges.end(), [](const AddressRange& a, const AddressRange& b) {
+            return a.start < b.start;
+            });
+
+        int next = 0;
+        for (const AddressRange& range : ranges) {
+            if (range.start > next) {
+                holes.append(AddressHole{ slaveID, it.key(), next, range.start - next });
+            }
+            next = qMax(next, range.end());
+        }
+        if (next < 65536) {
+            holes.append(AddressHole{ slaveID, it.key(), next, 65536 - next });
+        }
+    }
+    return holes;
+}
+
+QJsonObject DeviceProfile::toJson() const
+{
+    QJsonObject ranges;
+    for (auto it = readableRanges.cbegin(); it != readableRanges.cend(); ++it) {
+        QJsonArray list;
+        for (const AddressRange& range : it.value()) {
+            list.append(QJsonArray({ range.start, range.count }));
+        }
+        ranges.insert(typeKey(it.key()), list);
+    }
+
+    QJsonObject object;
+    object.insert("key", key);
+    object.insert("vendor", vendor);
+    object.insert("productCode", productCode);
+    object.insert("revision", revision);
+    object.insert("slave", slaveID);
+    object.insert("responseMs", responseMs);
+    object.insert("responseDeviationMs", responseDeviationMs);
+    object.insert("turnaroundMs", turnaroundMs);
+    object.insert("supportedFunctions", toArray(supportedFunctions));
+    object.insert("unsupportedFunctions", toArray(unsupportedFunctions));
+    object.insert("ranges", ranges);
+    object.insert("lastSeen", lastSeen.toString(Qt::ISODate));
+    return object;
+}
+
+DeviceProfile DeviceProfile::fromJson(const QJsonObject& object)
+{
+    DeviceProfile profile;
+    profile.key = object.value("key").toString();
+    profile.vendor = object.value("vendor").toString();
+    profile.productCode = object.value("productCode").toString();
+    profile.revision = object.value("revision").toString();
+    profile.slaveID = object.value("slave").toInt(1);
+    profile.responseMs = object.value("responseMs").toDouble();
+    profile.responseDeviationMs = object.value("responseDeviationMs").toDouble();
+    profile.turnaroundMs = object.value("turnaroundMs").toInt();
+    profile.supportedFunctions = toSet(object.value("supportedFunctions").toArray());
+    profile.unsupportedFunctions = toSet(object.value("unsupportedFunctions").toArray());
+    profile.lastSeen = QDateTime::fromString(object.value("lastSeen").toString(), Qt::ISODate);
+
+    const QJsonObject ranges = object.value("ranges").toObject();
+    for (auto it = ranges.constBegin(); it != ranges.constEnd(); ++it) {
+        ModbusConnection::RegisterType type;
+        if (!TagDatabase::parseRegisterType(it.key(), &type)) {
+            continue;
+        }
+        QList<AddressRange>& list = profile.readableRanges[type];
+        for (const QJsonValue& value : it.value().toArray()) {
+            const QJsonArray pair = value.toArray();
+            list.append(AddressRange{ pair.at(0).toInt(), pair.at(1).toInt() });
+        }
+    }
+    return profile;
+}
+
+QString DeviceProfile::identityKey(const QString& vendor, const QString& productCode, const QString& revision,
+    int slaveID)
+{
+    return QStringLiteral("id:%1|%2|%3|%4").arg(vendor, productCode, revision).arg(slaveID);
+}
+
+QString DeviceProfile::locationKey(const QString& adapter, int slaveID)
+{
+    return QStringLiteral("at:%1|%2").arg(adapter).arg(slaveID);
+}
+
+DeviceProfileCache::DeviceProfileCache(const QString& fileName)
+    : m_fileName(fileName)
+{
+}
+
+QString DeviceProfileCache::defaultFileName()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+        .filePath(QStringLiteral("device-profiles.json"));
+}
+
+// A missing file is an empty cache, not an error
+bool DeviceProfileCache::load(QString* errorMessage)
+{
+    m_profiles.clear();
+
+    QFile file(m_fileName);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = file.errorString();
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull()) {
+        if (errorMessage) *errorMessage = parseError.errorString();
+        return false;
+    }
+
+    const QJsonObject root = doc.object();
+    if (root.value("version").toInt() != cacheVersion) {
+        qWarning() << "Ignoring device profile cache with version" << root.value("version").toInt();
+        return true;
+    }
+
+    for (const QJsonValue& value : root.value("devices").toArray()) {
+        const DeviceProfile profile = DeviceProfile::fromJson(value.toObject());
+        if (!profile.key.isEmpty()) {
+            m_profiles.insert(profile.key, profile);
+        }
+    }
+
+    qDebug() << "Loaded" << m_profiles.size() << "device profiles from" << m_fileName;
+    return true;
+}
+
+bool DeviceProfileCache::save(QString* errorMessage) const
+{
+    QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+
+    QJsonArray devices;
+    for (const DeviceProfile& profile : m_profiles) {
+        devices.append(profile.toJson());
+    }
+    QJsonObject root;
+    root.insert("version", cacheVersion);
+    root.insert("devices", devices);
+
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(QJsonDocument(root).toJson()) < 0
+        || !file.commit()) {
+        if (errorMessage) *errorMessage = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool DeviceProfileCache::contains(const QString& key) const
+{
+    return m_profiles.contains(key);
+}
+
+DeviceProfile DeviceProfileCache::profile(const QString& key) const
+{
+    return m_profiles.value(key);
+}
+
+void DeviceProfileCache::store(const DeviceProfile& profile)
+{
+    m_profiles.insert(profile.key, profile);
+}
+
+int DeviceProfileCache::size() const noexcept
+{
+    return int(m_profiles.size());
+}
@@ -0,0 +1,237 @@
+#include "DeviceProfiler.h"
+#include <QModbusReply>
+#include <QDebug>
+
+namespace {
+    // FC43 basic object IDs
+    constexpr int vendorNameObject = 0x00;
+    constexpr int productCodeObject = 0x01;
+    constexpr int revisionObject = 0x02;
+    constexpr int maxObjectRequests = 4;
+}
+
+DeviceProfiler::DeviceProfiler(QObject* parent)
+    : QObject(parent)
+{
+}
+
+DeviceProfiler::~DeviceProfiler()
+{
+    saveProfile();
+}
+
+void DeviceProfiler::setModbusConnection(ModbusConnection* connection)
+{
+    if (m_modbusConnection) {
+        disconnect(m_modbusConnection, nullptr, this, nullptr);
+    }
+    m_modbusConnection = connection;
+    if (m_modbusConnection) {
+        connect(m_modbusConnection, &ModbusConnection::functionSupported,
+            this, &DeviceProfiler::handleFunctionSupported);
+        connect(m_modbusConnection, &ModbusConnection::connectionClosed, this, &DeviceProfiler::saveProfile);
+        connect(m_modbusConnection, &ModbusConnection::connectionLost, this, &DeviceProfiler::saveProfile);
+    }
+}
+
+bool DeviceProfiler::hasProfile() const noexcept
+{
+    return m_hasProfile;
+}
+
+const DeviceProfile& DeviceProfiler::profile() const noexcept
+{
+    return m_profile;
+}
+
+QList<AddressHole> DeviceProfiler::knownHoles() const
+{
+    return m_hasProfile ? m_profile.holes() : QList<AddressHole>();
+}
+
+void DeviceProfiler::setScanResult(const BusScanResult& result)
+{
+    if (!result.ranges.isEmpty()) {
+        m_scanResults.insert(result.slaveID, result);
+    }
+}
+
+void DeviceProfiler::identify(int slaveID, const QString& adapter)
+{
+    saveProfile();
+
+    ++m_generation;
+    m_slaveID = slaveID;
+    m_adapter = adapter;
+    m_objects.clear();
+    m_objectRequests = 0;
+    m_hasProfile = false;
+    m_profile = DeviceProfile();
+
+    // Loaded on first use so startup does not pay for it
+    if (!m_cacheLoaded) {
+        QString error;
+        if (!m_cache.load(&error)) {
+            qWarning() << "Failed to load device profile cache:" << error;
+        }
+        m_cacheLoaded = true;
+    }
+
+    requestObjects(m_generation, vendorNameObject);
+}
+
+void DeviceProfiler::requestObjects(quint64 generation, int objectID)
+{
+    if (!m_modbusConnection) {
+        return;
+    }
+
+    QModbusReply* reply = m_modbusConnection->readDeviceIdentification(m_slaveID, objectID);
+    if (!reply) {
+        resolveProfile();
+        return;
+    }
+    if (reply->isFinished()) {
+        handleObjects(generation, reply);
+        return;
+    }
+    connect(reply, &QModbusReply::finished, this, [this, generation, reply]() {
+        handleObjects(generation, reply);
+        });
+}
+
+void DeviceProfiler::handleObjects(quint64 generation, QModbusReply* reply)
+{
+    reply->deleteLater();
+    if (generation != m_generation) {
+        return;
+    }
+
+    int nextObjectID = -1;
+    const QMap<int, QByteArray> objects = ModbusConnection::deviceIdentificationFromReply(reply, &nextObjectID);
+    m_objects.insert(objects);
+
+    // Keep asking while the device has more and still makes progress
+    if (nextObjectID > 0 && !objects.isEmpty() && ++m_objectRequests < maxObjectRequests) {
+        requestObjects(generation, nextObjectID);
+        return;
+    }
+
+    if (reply->error() != QModbusDevice::NoError) {
+        qDebug() << "Device identification not available:" << reply->errorString();
+    }
+    resolveProfile();
+}
+
+// Looks the device up in the cache, or starts a new profile for it
+void DeviceProfiler::resolveProfile()
+{
+    DeviceProfile profile;
+    profile.vendor = QString::fromLatin1(m_objects.value(vendorNameObject)).trimmed();
+    profile.productCode = QString::fromLatin1(m_objects.value(productCodeObject)).trimmed();
+    profile.revision = QString::fromLatin1(m_objects.value(revisionObject)).trimmed();
+    profile.key = profile.isIdentified()
+        ? DeviceProfile::identityKey(profile.vendor, profile.productCode, profile.revision, m_slaveID)
+        : DeviceProfile::locationKey(m_adapter, m_slaveID);
+
+    const bool fromCache = m_cache.contains(profile.key);
+    if (fromCache) {
+        profile = m_cache.profile(profile.key);
+    }
+    profile.slaveID = m_slaveID;
+    profile.lastSeen = QDateTime::currentDateTime();
+
+    const auto scan = m_scanResults.constFind(m_slaveID);
+    if (scan != m_scanResults.cend()) {
+        for (auto it = scan->ranges.cbegin(); it != scan->ranges.cend(); ++it) {
+            profile.readableRanges.insert(it.key(), it.value());
+        }
+        m_scanResults.erase(scan);
+    }
+
+    m_profile = profile;
+    m_hasProfile = true;
+    m_dirty = true;
+
+    if (fromCache && m_modbusConnection) {
+        m_modbusConnection->primeResponseTime(profile.responseMs, profile.responseDeviationMs);
+        if (profile.turnaroundMs > 0) {
+            m_modbusConnection->setBroadcastTurnaround(profile.turnaroundMs);
+        }
+    }
+
+    qDebug() << "Device profile" << profile.key << (fromCache ? "loaded from cache" : "created")
+        << "- round trip" << profile.responseMs << "ms," << profile.supportedFunctions.size() << "known functions";
+
+    if (!fromCache) {
+        probeFunctions();
+    }
+    saveProfile();
+    emit profileReady(m_profile, fromCache);
+}
+
+// One single-element read per basic function; the answers arrive through functionSupported
+void DeviceProfiler::probeFunctions()
+{
+    if (!m_modbusConnection) {
+        return;
+    }
+
+    const ModbusConnection::RegisterType types[] = { ModbusConnection::Coils, ModbusConnection::DiscreteInputs,
+        ModbusConnection::InputRegisters, ModbusConnection::HoldingRegisters };
+    for (const ModbusConnection::RegisterType type : types) {
+        QModbusReply* reply = m_modbusConnection->readRegister(type, 0, 1, m_slaveID);
+        if (reply) {
+            connect(reply, &QModbusReply::finished, reply, &QObject::deleteLater);
+        }
+    }
+}
+
+void DeviceProfiler::handleFunctionSupported(int slaveID, int functionCode, bool supported)
+{
+    if (!m_hasProfile || slaveID != m_slaveID) {
+        return;
+    }
+
+    QSet<int>& add = supported ? m_profile.supportedFunctions : m_profile.unsupportedFunctions;
+    QSet<int>& remove = supported ? m_profile.unsupportedFunctions : m_profile.supportedFunctions;
+    if (!add.contains(functionCode)) {
+        add.insert(functionCode);
+        remove.remove(functionCode);
+        m_dirty = true;
+    }
+}
+
+// Stores what the session learnt, timing included; the round trip is this
+// slave's own, not the link average over every slave polled
+void DeviceProfiler::saveProfile()
+{
+    if (!m_hasProfile) {
+        return;
+    }
+
+    if (m_modbusConnection) {
+        const ModbusConnection::ResponseTimeStats stats = m_modbusConnection->responseTimeStats(m_profile.slaveID);
+        if (stats.samples > 0 && !qFuzzyCompare(stats.smoothedMs, m_profile.responseMs)) {
+            m_profile.responseMs = stats.smoothedMs;
+            m_profile.responseDeviationMs = stats.deviationMs;
+            m_dirty = true;
+        }
+        if (m_profile.turnaroundMs != m_modbusConnection->broadcastTurnaround()) {
+            m_profile.turnaroundMs = m_modbusConnection->broadcastTurnaround();
+            m_dirty = true;
+        }
+    }
+
+    if (!m_dirty) {
+        return;
+    }
+
+    m_cache.store(m_profile);
+    QString error;
+    if (!m_cache.save(&error)) {
+        qWarning() << "Failed to save device profile cache:" << error;
+        return;
+    }
+    m_dirty = false;
+}
@@ -0,0 +1,111 @@
+#include "GatewayDialog.h"
+#include <QMessageBox>
+#include <QDebug>
+
+GatewayDialog::GatewayDialog(QWidget* parent)
+    : QDialog(parent)
+{
+    ui.setupUi(this);
+    m_gateway = new ModbusGateway(this);
+    initUI();
+    setupConnections();
+}
+
+GatewayDialog::~GatewayDialog()
+{
+    m_gateway->close();
+}
+
+void GatewayDialog::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+    m_gateway->setModbusConnection(connection);
+}
+
+void GatewayDialog::initUI()
+{
+    ui.gatewayPortSpinBox->setRange(1, 65535);
+    ui.gatewayPortSpinBox->setValue(1502);
+    ui.gatewayQueueSpinBox->setRange(1, 1024);
+    ui.gatewayQueueSpinBox->setValue(32);
+    ui.gatewayCacheSpinBox->setRange(0, 60000);
+    ui.gatewayCacheSpinBox->setValue(0);
+    ui.gatewayCacheSpinBox->setSuffix(tr(" ms"));
+    ui.gatewayCacheSpinBox->setSpecialValueText(tr("Off"));
+
+    ui.gatewayStopBtn->setEnabled(false);
+    m_statusTimer.setInterval(500);
+}
+
+void GatewayDialog::setupConnections()
+{
+    connect(ui.gatewayStartBtn, &QPushButton::clicked, this, &GatewayDialog::onStart);
+    connect(ui.gatewayStopBtn, &QPushButton::clicked, this, &GatewayDialog::onStop);
+    connect(ui.gatewayCloseBtn, &QPushButton::clicked, this, &QDialog::reject);
+    connect(ui.gatewayQueueSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+        m_gateway, &ModbusGateway::setMaxQueuePerClient);
+    connect(ui.gatewayCacheSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+        m_gateway, &ModbusGateway::setCacheMaxAge);
+    connect(m_gateway, &ModbusGateway::clientsChanged, this, &GatewayDialog::updateClientList);
+    connect(&m_statusTimer, &QTimer::timeout, this, &GatewayDialog::updateStatus);
+}
+
+void GatewayDialog::onStart()
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    m_gateway->setMaxQueuePerClient(ui.gatewayQueueSpinBox->value());
+    m_gateway->setCacheMaxAge(ui.gatewayCacheSpinBox->value());
+
+    QString error;
+    if (!m_gateway->listen(quint16(ui.gatewayPortSpinBox->value()), &error)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to start gateway: %1").arg(error));
+        return;
+    }
+
+    ui.gatewayStartBtn->setEnabled(false);
+    ui.gatewayStopBtn->setEnabled(true);
+    ui.gatewayPortSpinBox->setEnabled(false);
+    m_statusTimer.start();
+    updateStatus();
+}
+
+void GatewayDialog::onStop()
+{
+    m_gateway->close();
+    m_statusTimer.stop();
+
+    ui.gatewayStartBtn->setEnabled(true);
+    ui.gatewayStopBtn->setEnabled(false);
+    ui.gatewayPortSpinBox->setEnabled(true);
+    updateStatus();
+    updateClientList();
+}
+
+void GatewayDialog::updateStatus()
+{
+    if (!m_gateway->isListening()) {
+        ui.gatewayStatusLabel->setText(tr("Stopped"));
+        return;
+    }
+
+    const ModbusGateway::Statistics statistics = m_gateway->statistics();
+    ui.gatewayStatusLabel->setText(
+        tr("Clients: %1  Queued: %2\nRequests: %3  Bus: %4  Cache hits: %5  Exceptions: %6  Rejected: %7")
+        .arg(statistics.clients)
+        .arg(statistics.queued)
+        .arg(statistics.requests)
+        .arg(statistics.busTransactions)
+        .arg(statistics.cacheHits)
+        .arg(statistics.exceptions)
+        .arg(statistics.rejected));
+}
+
+void GatewayDialog::updateClientList()
+{
+    ui.gatewayClientListWidget->clear();
+    ui.gatewayClientListWidget->addItems(m_gateway->clientAddresses());
+}
@@ -28,6 +28,10 @@ HRWidget::~HRWidget()
 void HRWidget::setModbusConnection(ModbusConnection* connection)
 {
     m_modbusConnection = connection;
+    if (m_modbusConnection) {
+        connect(m_modbusConnection, &ModbusConnection::writeVerified,
+            this, &HRWidget::handleWriteVerified);
+    }
 }
 
 void HRWidget::initUI()
@@ -42,6 +46,12 @@ void HRWidget::initUI()
 
     ui.hrReadMultipleAddressSpinBox->setRange(0, 65535);
     ui.hrReadMultipleCountSpinBox->setRange(1, 125);
+    for (const auto type : RegisterCodec::allTypes()) {
+        ui.hrReadMultipleTypeComboBox->addItem(RegisterCodec::typeName(type), int(type));
+    }
+    for (const auto order : RegisterCodec::allOrders()) {
+        ui.hrReadMultipleOrderComboBox->addItem(RegisterCodec::orderName(order), int(order));
+    }
 
     ui.hrWriteMultipleAddressSpinBox->setRange(0, 65535);
     ui.hrWriteMultipleCountSpinBox->setRange(1, 123);
@@ -53,8 +63,8 @@ void HRWidget::initUI()
 void HRWidget::initTableModels()
 {
     m_hrReadModel = new QStandardItemModel(this);
-    m_hrReadModel->setColumnCount(3);
-    m_hrReadModel->setHorizontalHeaderLabels({ tr("Address"), tr("Hex"), tr("Decimal") });
+    m_hrReadModel->setColumnCount(4);
+    m_hrReadModel->setHorizontalHeaderLabels({ tr("Address"), tr("Hex"), tr("Decimal"), tr("Value") });
     ui.hrReadMultipleTableView->setModel(m_hrReadModel);
     ui.hrReadMultipleTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 
@@ -79,6 +89,11 @@ void HRWidget::setupConnections()
         this, &HRWidget::updateWriteTable);
     connect(ui.hrWriteMultipleCountSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
         this, &HRWidget::updateWriteTable);
+
+    connect(ui.hrReadMultipleTypeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, &HRWidget::refreshReadTable);
+    connect(ui.hrReadMultipleOrderComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, &HRWidget::refreshReadTable);
 }
 
 void HRWidget::safeDeleteReply(QModbusReply* reply)
@@ -124,6 +139,36 @@ void HRWidget::updateWriteTable()
     }
 }
 
+// Rebuilds the read table from the last result using the selected format
+void HRWidget::refreshReadTable()
+{
+    m_hrReadModel->removeRows(0, m_hrReadModel->rowCount());
+    if (m_lastReadValues.isEmpty()) {
+        return;
+    }
+
+    const auto type = static_cast<RegisterCodec::DataType>(ui.hrReadMultipleTypeComboBox->currentData().toInt());
+    const auto order = static_cast<RegisterCodec::ByteOrder>(ui.hrReadMultipleOrderComboBox->currentData().toInt());
+    const QStringList decoded = RegisterCodec::formatBuffer(m_lastReadValues, type, order);
+
+    for (int i = 0; i < m_lastReadValues.size(); ++i) {
+        QList<QStandardItem*> rowItems;
+        const int addr = m_lastReadStart + i;
+        const quint16 value = m_lastReadValues[i];
+
+        rowItems << new QStandardItem(QString::number(addr))
+            << new QStandardItem(QString("0x%1").arg(value, 4, 16, QChar('0')).toUpper())
+            << new QStandardItem(QString::number(value))
+            << new QStandardItem(decoded.value(i));
+
+        for (auto item : rowItems) {
+            item->setEditable(false);
+        }
+
+        m_hrReadModel->appendRow(rowItems);
+    }
+}
+
 void HRWidget::handleWriteItemChanged(QStandardItem* item)
 {
     if (item->column() == 1 || item->column() == 2) {
@@ -308,26 +353,12 @@ void HRWidget::handleMultipleHRReadResult()
     if (reply->error() == QModbusDevice::NoError) {
         const QModbusDataUnit result = reply->result();
         if (result.registerType() == QModbusDataUnit::HoldingRegisters && result.valueCount() > 0) {
-            m_hrReadModel->removeRows(0, m_hrReadModel->rowCount());
-
             const int startAddr = result.startAddress();
             const int count = result.valueCount();
 
-            for (int i = 0; i < count; ++i) {
-                QList<QStandardItem*> rowItems;
-                const int addr = startAddr + i;
-                const quint16 value = result.value(i);
-
-                rowItems << new QStandardItem(QString::number(addr))
-                    << new QStandardItem(QString("0x%1").arg(value, 4, 16, QChar('0')).toUpper())
-                    << new QStandardItem(QString::number(value));
-
-                for (auto item : rowItems) {
-                    item->setEditable(false);
-                }
-
-                m_hrReadModel->appendRow(rowItems);
-            }
+            m_lastReadStart = startAddr;
+            m_lastReadValues = result.values();
+            refreshReadTable();
 
             qDebug() << "Multiple HR read successful - Start address:"
                 << startAddr << "Count:" << count;
@@ -355,6 +386,7 @@ void HRWidget::onWriteMultipleHR()
     }
 
     safeDeleteReply(m_multipleHRWriteReply);
+    m_verifyStart = -1;
     ui.hrWriteMultipleBtn->setEnabled(false);
 
     const int startAddr = ui.hrWriteMultipleAddressSpinBox->value();
@@ -377,6 +409,10 @@ void HRWidget::onWriteMultipleHR()
         ModbusConnection::HoldingRegisters, startAddr, values);
 
     if (m_multipleHRWriteReply) {
+        if (m_modbusConnection->writeVerification() != ModbusConnection::VerifyNone) {
+            m_verifyStart = startAddr;
+            m_verifyCount = values.size();
+        }
         connect(m_multipleHRWriteReply, &QModbusReply::finished,
             this, &HRWidget::handleMultipleHRWriteResult);
     }
@@ -401,13 +437,33 @@ void HRWidget::handleMultipleHRWriteResult()
         qDebug() << "Multiple HR write successful - Start address:"
             << startAddr << "Count:" << count;
         QApplication::beep();
-        onReadMultipleHR();
     }
     else {
+        m_verifyStart = -1;
         qDebug() << "Multiple HR write error:" << reply->errorString();
         QMessageBox::critical(this, tr("Error"),
             tr("Write failed: %1").arg(reply->errorString()));
     }
 
     safeDeleteReply(reply);
+}
+
+// Shows the read-back of a verified write, only issued when verification is enabled
+void HRWidget::handleWriteVerified(ModbusConnection::RegisterType type, int startAddr,
+    const QVector<quint16>& readBack, const QList<AddressRange>& mismatches)
+{
+    if (type != ModbusConnection::HoldingRegisters
+        || startAddr != m_verifyStart || readBack.size() != m_verifyCount) {
+        return;
+    }
+    m_verifyStart = -1;
+
+    m_lastReadStart = startAddr;
+    m_lastReadValues = readBack;
+    refreshReadTable();
+
+    if (!mismatches.isEmpty()) {
+        QMessageBox::warning(this, tr("Warning"),
+            tr("Read-back differs from written values at: %1").arg(RegisterDiff::describe(mismatches)));
+    }
 }
\ No newline at end of file
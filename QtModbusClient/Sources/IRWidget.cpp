@@ -31,6 +31,10 @@ void IRWidget::setupConnections()
 {
     connect(ui.irReadSingleBtn, &QPushButton::clicked, this, &IRWidget::onReadSingleIR);
     connect(ui.irReadMultipleBtn, &QPushButton::clicked, this, &IRWidget::onReadMultipleIR);
+    connect(ui.irReadMultipleTypeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, &IRWidget::refreshReadTable);
+    connect(ui.irReadMultipleOrderComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+        this, &IRWidget::refreshReadTable);
 }
 
 void IRWidget::initUI()
@@ -41,13 +45,19 @@ void IRWidget::initUI()
     ui.irReadMultipleAddressSpinBox->setRange(0, 65535);
     ui.irReadMultipleCountSpinBox->setRange(1, 125);
     ui.irReadMultipleCountSpinBox->setValue(10);
+    for (const auto type : RegisterCodec::allTypes()) {
+        ui.irReadMultipleTypeComboBox->addItem(RegisterCodec::typeName(type), int(type));
+    }
+    for (const auto order : RegisterCodec::allOrders()) {
+        ui.irReadMultipleOrderComboBox->addItem(RegisterCodec::orderName(order), int(order));
+    }
 }
 
 void IRWidget::initTableModel()
 {
     m_irModel = new QStandardItemModel(this);
-    m_irModel->setColumnCount(3);
-    m_irModel->setHorizontalHeaderLabels({ tr("Address"), tr("Hex"), tr("Decimal") });
+    m_irModel->setColumnCount(4);
+    m_irModel->setHorizontalHeaderLabels({ tr("Address"), tr("Hex"), tr("Decimal"), tr("Value") });
     ui.irReadMultipleDataTableView->setModel(m_irModel);
     ui.irReadMultipleDataTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     ui.irReadMultipleDataTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
@@ -192,22 +202,29 @@ void IRWidget::processMultipleIRResult(QModbusReply* reply)
         return;
     }
 
-    m_irModel->removeRows(0, m_irModel->rowCount());
     const int startAddr = result.startAddress();
     const int count = result.valueCount();
 
-    QVector<quint16> values;
-    for (int i = 0; i < count; ++i) {
-        values.append(result.value(i));
-    }
-
-    updateHexColumn(values, startAddr);
+    m_lastReadStart = startAddr;
+    m_lastReadValues = result.values();
+    refreshReadTable();
     qDebug() << "Multiple IR read successful - Start address:" << startAddr << "Count:" << count;
     QApplication::beep();
 }
 
+// Rebuilds the table from the last result using the selected format
+void IRWidget::refreshReadTable()
+{
+    m_irModel->removeRows(0, m_irModel->rowCount());
+    updateHexColumn(m_lastReadValues, m_lastReadStart);
+}
+
 void IRWidget::updateHexColumn(const QVector<quint16>& values, int startAddr)
 {
+    const auto type = static_cast<RegisterCodec::DataType>(ui.irReadMultipleTypeComboBox->currentData().toInt());
+    const auto order = static_cast<RegisterCodec::ByteOrder>(ui.irReadMultipleOrderComboBox->currentData().toInt());
+    const QStringList decoded = RegisterCodec::formatBuffer(values, type, order);
+
     for (int i = 0; i < values.size(); ++i) {
         QList<QStandardItem*> rowItems;
         const int addr = startAddr + i;
@@ -216,6 +233,7 @@ void IRWidget::updateHexColumn(const QVector<quint16>& values, int startAddr)
         rowItems << new QStandardItem(QString::number(addr));
         rowItems << new QStandardItem(QString("0x%1").arg(value, 4, 16, QChar('0')).toUpper());
         rowItems << new QStandardItem(QString::number(value));
+        rowItems << new QStandardItem(decoded.value(i));
 
         for (auto item : rowItems) {
             item->setEditable(false);
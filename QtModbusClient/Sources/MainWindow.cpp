@@ -1,5 +1,11 @@
 ﻿#include "MainWindow.h"
+#include "NativeRtuTransport.h"
 #include <QPointer>
+#include <QActionGroup>
+#include <QMessageBox>
+#include <QSignalBlocker>
+#include <QStatusBar>
+#include <QTimer>
 #include <QDebug>
 
 MainWindow::MainWindow(QWidget* parent)
@@ -8,13 +14,17 @@ MainWindow::MainWindow(QWidget* parent)
     ui.setupUi(this);
 
     m_connection = new ModbusConnection(this);
-    modbusDialog.reset(new ModbusConfigDialog(this));
+    m_portScanner = new SerialPortScanner(this);
+    m_profiler = new DeviceProfiler(this);
+    m_profiler->setModbusConnection(m_connection);
 
-    setupCoilTab();
-    setupDITab();
-    setupIRTab();
-	setupHRTab();
+    // Only the visible tab is built now, the others on first activation
+    ensureTabCreated(ui.tabWidget->currentIndex());
     setupConnections();
+
+    // Have the port list ready by the time the connect dialog is opened,
+    // then follow hotplug events for the rest of the session
+    QTimer::singleShot(0, m_portScanner, &SerialPortScanner::startMonitoring);
 }
 
 MainWindow::~MainWindow() = default;
@@ -79,11 +89,113 @@ void MainWindow::setupHRTab()
     }
 }
 
+void MainWindow::setupTagTab()
+{
+    if (auto tagPlaceholder = ui.tabTags->findChild<QWidget*>("tagWidget")) {
+        auto layout = new QVBoxLayout(tagPlaceholder);
+        layout->setContentsMargins(0, 0, 0, 0);
+
+        m_tagWidget = new TagWidget(tagPlaceholder);
+        layout->addWidget(m_tagWidget);
+        m_tagWidget->setModbusConnection(m_connection);
+        m_tagWidget->setKnownHoles(m_profiler->knownHoles());
+    }
+    else {
+        qWarning() << "Tag placeholder widget not found!";
+    }
+}
+
+void MainWindow::setupBitMapTab()
+{
+    if (auto bitMapPlaceholder = ui.tabIoMap->findChild<QWidget*>("bitMapWidget")) {
+        auto layout = new QVBoxLayout(bitMapPlaceholder);
+        layout->setContentsMargins(0, 0, 0, 0);
+
+        m_bitMapWidget = new BitMapWidget(bitMapPlaceholder);
+        layout->addWidget(m_bitMapWidget);
+        m_bitMapWidget->setModbusConnection(m_connection);
+    }
+    else {
+        qWarning() << "I/O map placeholder widget not found!";
+    }
+}
+
+// Builds the widget behind a tab page the first time it is shown
+void MainWindow::ensureTabCreated(int index)
+{
+    QWidget* page = ui.tabWidget->widget(index);
+    if (!page) {
+        return;
+    }
+
+    if (page == ui.tabCoil && !m_coilWidget) {
+        setupCoilTab();
+    }
+    else if (page == ui.tabDI && !m_diWidget) {
+        setupDITab();
+    }
+    else if (page == ui.tabIr && !m_irWidget) {
+        setupIRTab();
+    }
+    else if (page == ui.tabHR && !m_hrWidget) {
+        setupHRTab();
+    }
+    else if (page == ui.tabTags && !m_tagWidget) {
+        setupTagTab();
+    }
+    else if (page == ui.tabIoMap && !m_bitMapWidget) {
+        setupBitMapTab();
+    }
+}
+
+void MainWindow::onTabChanged(int index)
+{
+    ensureTabCreated(index);
+}
+
 void MainWindow::setupConnections()
 {
+    connect(ui.tabWidget, &QTabWidget::currentChanged, this, &MainWindow::onTabChanged);
     connect(ui.actionConnect, &QAction::triggered, this, &MainWindow::onConnectTriggered);
+    connect(m_portScanner, &SerialPortScanner::portAdded, this, &MainWindow::onPortAdded);
+    connect(ui.actionAutoReconnect, &QAction::toggled, m_connection, &ModbusConnection::setAutoReconnect);
+    m_connection->setAutoReconnect(ui.actionAutoReconnect->isChecked());
+    connect(ui.actionAdaptiveTimeout, &QAction::toggled, m_connection, &ModbusConnection::setAdaptiveTimeout);
+    m_connection->setAdaptiveTimeout(ui.actionAdaptiveTimeout->isChecked());
+    ui.actionNativeTransport->setEnabled(NativeRtuTransport::isSupported());
+    connect(ui.actionNativeTransport, &QAction::toggled, this, [this](bool checked) {
+        m_connection->setSerialTransport(checked ? ModbusConnection::NativeTransport : ModbusConnection::QtSerialPort);
+        });
+    connect(m_connection, &ModbusConnection::reconnecting, this, [this](int attempt, int delayMs) {
+        statusBar()->showMessage(tr("Connection lost, reconnect attempt %1 in %2 s (%3 requests held)")
+            .arg(attempt).arg(delayMs / 1000.0, 0, 'f', 1).arg(m_connection->heldRequestCount()));
+        });
+    connect(m_portScanner, &SerialPortScanner::portRemoved, this, &MainWindow::onPortRemoved);
     connect(ui.actionDisconnect, &QAction::triggered, this, &MainWindow::onDisconnectTriggered);
+    connect(ui.actionWriteImage, &QAction::triggered, this, &MainWindow::onWriteImageTriggered);
+    connect(ui.actionSnapshots, &QAction::triggered, this, &MainWindow::onSnapshotsTriggered);
+    connect(ui.actionScripts, &QAction::triggered, this, &MainWindow::onScriptsTriggered);
+    connect(ui.actionBusScan, &QAction::triggered, this, &MainWindow::onBusScanTriggered);
+    connect(ui.actionConnectionManager, &QAction::triggered, this, &MainWindow::onConnectionManagerTriggered);
+    connect(ui.actionBroadcast, &QAction::triggered, this, &MainWindow::onBroadcastTriggered);
+    connect(ui.actionRecordTransfer, &QAction::triggered, this, &MainWindow::onRecordTransferTriggered);
+    connect(ui.actionGateway, &QAction::triggered, this, &MainWindow::onGatewayTriggered);
+    connect(ui.actionSharedImage, &QAction::toggled, this, &MainWindow::onSharedImageToggled);
+    connect(ui.actionControlSocket, &QAction::toggled, this, &MainWindow::onControlSocketToggled);
+
+    auto verificationGroup = new QActionGroup(this);
+    verificationGroup->addAction(ui.actionVerifyNone);
+    verificationGroup->addAction(ui.actionVerifyReadBack);
+    verificationGroup->addAction(ui.actionVerifyDiff);
+    ui.actionVerifyNone->setData(ModbusConnection::VerifyNone);
+    ui.actionVerifyReadBack->setData(ModbusConnection::VerifyReadBack);
+    ui.actionVerifyDiff->setData(ModbusConnection::VerifyReadBackDiff);
+    connect(verificationGroup, &QActionGroup::triggered, this, [this](QAction* action) {
+        m_connection->setWriteVerification(
+            static_cast<ModbusConnection::WriteVerification>(action->data().toInt()));
+        });
     connect(m_connection, &ModbusConnection::connectionOpened, this, &MainWindow::onConnected);
+    connect(m_profiler, &DeviceProfiler::profileReady, this, &MainWindow::onProfileReady);
     connect(m_connection, &ModbusConnection::connectionOpened, this, [this]() {
         emit connectionStateChanged(true);
         });
@@ -92,7 +204,12 @@ void MainWindow::setupConnections()
 // Handle connect action
 void MainWindow::onConnectTriggered()
 {
+    if (!modbusDialog) {
+        modbusDialog.reset(new ModbusConfigDialog(this));
+        modbusDialog->setPortScanner(m_portScanner);
+    }
     if (modbusDialog->exec() == QDialog::Accepted) {
+        m_reconnectIdentity.clear();
         m_connection->connectToDevice(
             modbusDialog->getPort(),
             modbusDialog->getBaudRate(),
@@ -106,16 +223,199 @@ void MainWindow::onConnectTriggered()
 // Handle disconnect action
 void MainWindow::onDisconnectTriggered()
 {
+    m_reconnectIdentity.clear();
     if (m_connection) {
         m_connection->closeConnection();
     }
 }
 
+// The adapter in use was unplugged; keep its identity for auto reconnect
+void MainWindow::onPortRemoved(const SerialPortEntry& entry)
+{
+    if (entry.portName != m_connection->getPortName() || m_reconnectIdentity.isEmpty()) {
+        return;
+    }
+
+    if (ui.actionAutoReconnect->isChecked()) {
+        m_connection->notifyLinkLost();
+        statusBar()->showMessage(tr("%1 removed, waiting for it to reappear").arg(entry.portName));
+    }
+    else {
+        m_connection->closeConnection();
+    }
+}
+
+// A known adapter came back, possibly under a different port name
+void MainWindow::onPortAdded(const SerialPortEntry& entry)
+{
+    if (!ui.actionAutoReconnect->isChecked() || (m_connection->isConnected() && !m_connection->isReconnecting())
+        || m_reconnectIdentity.isEmpty() || entry.identity() != m_reconnectIdentity) {
+        return;
+    }
+
+    qDebug() << "Reconnecting to" << entry.portName << entry.details();
+    statusBar()->showMessage(tr("Reconnecting to %1").arg(entry.portName), 5000);
+    m_connection->reopen(entry.portName);
+}
+
+// Open the register image writer, created on first use
+void MainWindow::onWriteImageTriggered()
+{
+    if (!m_imageDialog) {
+        m_imageDialog = new RegisterImageDialog(this);
+        m_imageDialog->setModbusConnection(m_connection);
+    }
+    m_imageDialog->show();
+    m_imageDialog->raise();
+}
+
+// Open the snapshot tool, kept alive so captured snapshots survive closing it
+void MainWindow::onSnapshotsTriggered()
+{
+    if (!m_snapshotDialog) {
+        m_snapshotDialog = new SnapshotDialog(this);
+        m_snapshotDialog->setModbusConnection(m_connection);
+    }
+    m_snapshotDialog->show();
+    m_snapshotDialog->raise();
+}
+
+// Open the script console; the compiled script is kept between runs
+void MainWindow::onScriptsTriggered()
+{
+    if (!m_scriptDialog) {
+        m_scriptDialog = new ScriptDialog(this);
+        m_scriptDialog->setModbusConnection(m_connection);
+    }
+    m_scriptDialog->show();
+    m_scriptDialog->raise();
+}
+
+// Open the bus scanner; it shares the port list with the connect dialog
+void MainWindow::onBusScanTriggered()
+{
+    if (!m_busScanDialog) {
+        m_busScanDialog = new BusScanDialog(this);
+        m_busScanDialog->setModbusConnection(m_connection);
+        m_busScanDialog->setPortScanner(m_portScanner);
+        connect(m_busScanDialog, &BusScanDialog::slaveSelected, m_profiler, &DeviceProfiler::setScanResult);
+    }
+    m_busScanDialog->show();
+    m_busScanDialog->raise();
+}
+
+// Open the connection manager; its buses have their own connections, independent of m_connection
+void MainWindow::onConnectionManagerTriggered()
+{
+    if (!m_connectionManagerDialog) {
+        m_connectionManagerDialog = new ConnectionManagerDialog(this);
+        m_connectionManagerDialog->setPortScanner(m_portScanner);
+    }
+    m_connectionManagerDialog->show();
+    m_connectionManagerDialog->raise();
+}
+
+// Open the broadcast writer; statistics live in the connection
+void MainWindow::onBroadcastTriggered()
+{
+    if (!m_broadcastDialog) {
+        m_broadcastDialog = new BroadcastDialog(this);
+        m_broadcastDialog->setModbusConnection(m_connection);
+    }
+    m_broadcastDialog->show();
+    m_broadcastDialog->raise();
+}
+
+// Open the file record / FIFO transfer tool
+void MainWindow::onRecordTransferTriggered()
+{
+    if (!m_recordTransferDialog) {
+        m_recordTransferDialog = new RecordTransferDialog(this);
+        m_recordTransferDialog->setModbusConnection(m_connection);
+    }
+    m_recordTransferDialog->show();
+    m_recordTransferDialog->raise();
+}
+
+// Open the TCP gateway; it keeps serving clients while the dialog is hidden
+void MainWindow::onGatewayTriggered()
+{
+    if (!m_gatewayDialog) {
+        m_gatewayDialog = new GatewayDialog(this);
+        m_gatewayDialog->setModbusConnection(m_connection);
+    }
+    m_gatewayDialog->show();
+    m_gatewayDialog->raise();
+}
+
+// Publish every read into shared memory for local readers
+void MainWindow::onSharedImageToggled(bool enabled)
+{
+    if (!enabled) {
+        delete m_sharedImage;
+        statusBar()->showMessage(tr("Shared register image stopped"), 5000);
+        return;
+    }
+
+    if (!m_sharedImage) {
+        m_sharedImage = new SharedRegisterImage(this);
+    }
+
+    QString error;
+    if (!m_sharedImage->create(SharedRegisterImage::defaultName(), 4, &error)) {
+        delete m_sharedImage;
+        QMessageBox::critical(this, tr("Error"), tr("Failed to create shared register image: %1").arg(error));
+        const QSignalBlocker blocker(ui.actionSharedImage);
+        ui.actionSharedImage->setChecked(false);
+        return;
+    }
+
+    m_sharedImage->setModbusConnection(m_connection);
+    statusBar()->showMessage(tr("Shared register image published as %1").arg(m_sharedImage->nativeKey()), 5000);
+}
+
+// Accept JSON-RPC automation clients on a local socket
+void MainWindow::onControlSocketToggled(bool enabled)
+{
+    if (!enabled) {
+        delete m_controlServer;
+        statusBar()->showMessage(tr("Control socket closed"), 5000);
+        return;
+    }
+
+    if (!m_controlServer) {
+        m_controlServer = new ControlServer(this);
+        m_controlServer->setModbusConnection(m_connection);
+    }
+
+    QString error;
+    if (!m_controlServer->listen(ControlServer::defaultName(), &error)) {
+        delete m_controlServer;
+        QMessageBox::critical(this, tr("Error"), tr("Failed to open control socket: %1").arg(error));
+        const QSignalBlocker blocker(ui.actionControlSocket);
+        ui.actionControlSocket->setChecked(false);
+        return;
+    }
+
+    statusBar()->showMessage(tr("Control socket listening on %1").arg(m_controlServer->fullServerName()), 5000);
+}
+
 // Handle successful connection
 void MainWindow::onConnected()
 {
     qDebug() << "Modbus connection established";
 
+    // Remember the adapter so it can be reconnected after being unplugged
+    for (const SerialPortEntry& entry : m_portScanner->entries()) {
+        if (entry.portName == m_connection->getPortName()) {
+            m_reconnectIdentity = entry.identity();
+            break;
+        }
+    }
+
+    m_profiler->identify(m_connection->getSlaveID(),
+        m_reconnectIdentity.isEmpty() ? m_connection->getPortName() : m_reconnectIdentity);
+
     QPointer<QModbusReply> reply(m_connection->readRegister(
         ModbusConnection::HoldingRegisters, 0, 10));
 
@@ -129,4 +429,16 @@ void MainWindow::onConnected()
             reply->deleteLater();
             });
     }
-}
\ No newline at end of file
+}
+
+// A cached profile skips probing: timeout and read plan start from what was learnt before
+void MainWindow::onProfileReady(const DeviceProfile& profile, bool fromCache)
+{
+    if (m_tagWidget) {
+        m_tagWidget->setKnownHoles(profile.holes());
+    }
+
+    statusBar()->showMessage(fromCache
+        ? tr("Known device: %1, response time %2 ms").arg(profile.description()).arg(profile.responseMs, 0, 'f', 1)
+        : tr("New device: %1, learning its profile").arg(profile.description()), 5000);
+}
@@ -1,5 +1,4 @@
 #include "ModbusConfigDialog.h"
-#include <qserialportinfo.h>
 #include <qvariant.h>
 
 //baud rate mapping
@@ -14,6 +13,9 @@ namespace {
 		{QSerialPort::Baud57600,"57600"},
 		{QSerialPort::Baud115200,"115200"}
 	};
+
+	// Port list shown on open is rescanned in the background when older than this
+	constexpr int portCacheMaxAgeMs = 2000;
 }
 
 ModbusConfigDialog::ModbusConfigDialog(QWidget* parent)
@@ -26,6 +28,20 @@ ModbusConfigDialog::ModbusConfigDialog(QWidget* parent)
 
 ModbusConfigDialog::~ModbusConfigDialog() {}
 
+void ModbusConfigDialog::setPortScanner(SerialPortScanner* scanner)
+{
+	if (m_portScanner) {
+		disconnect(m_portScanner, nullptr, this, nullptr);
+	}
+	m_portScanner = scanner;
+	if (m_portScanner) {
+		connect(m_portScanner, &SerialPortScanner::portsUpdated, this, &ModbusConfigDialog::updatePortList);
+		if (m_portScanner->hasResult()) {
+			updatePortList(m_portScanner->ports());
+		}
+	}
+}
+
 //Acquire parameter configuration
 QString ModbusConfigDialog::getPort() const noexcept
 {
@@ -63,7 +79,9 @@ int ModbusConfigDialog::getSlaveID() const noexcept
 void ModbusConfigDialog::showEvent(QShowEvent* event)
 {
 	QDialog::showEvent(event);
-	refreshPorts();
+	if (m_portScanner) {
+		m_portScanner->refreshIfStale(portCacheMaxAgeMs);
+	}
 }
 
 // Slot function to apply the configuration and close the dialog
@@ -78,7 +96,6 @@ void ModbusConfigDialog::initUI()
 {
 	initComboBoxes();
 	initRefreshPortsBtn();
-	refreshPorts();
 }
 
 void ModbusConfigDialog::initComboBoxes()
@@ -133,21 +150,30 @@ void ModbusConfigDialog::setupConnections()
 // Refresh the list of available serial ports
 void ModbusConfigDialog::refreshPorts()
 {
-	const QString currentPort = ui.portComboBox->currentText();
-	ui.portComboBox->clear();
-
-	const auto ports = QSerialPortInfo::availablePorts();
-	for (const QSerialPortInfo& info : ports) {
-		ui.portComboBox->addItem(info.portName());
+	if (m_portScanner) {
+		m_portScanner->refresh();
 	}
+}
 
-	const int index = ui.portComboBox->findText(currentPort);
-	if (index != -1) {
-		ui.portComboBox->setCurrentIndex(index);
+// Fill the port combo box, keeping the current selection when it is still present
+void ModbusConfigDialog::updatePortList(const QStringList& ports)
+{
+	const QString currentPort = ui.portComboBox->currentText();
+	ui.portComboBox->clear();
+	ui.portComboBox->addItems(ports);
+
+	// Adapter details (description, VID:PID, serial number) as tooltips
+	if (m_portScanner) {
+		for (const SerialPortEntry& entry : m_portScanner->entries()) {
+			const int index = ui.portComboBox->findText(entry.portName);
+			if (index >= 0) {
+				ui.portComboBox->setItemData(index, entry.details(), Qt::ToolTipRole);
+			}
+		}
 	}
 
 	if (!currentPort.isEmpty()) {
-		int index = ui.portComboBox->findText(currentPort);
+		const int index = ui.portComboBox->findText(currentPort);
 		if (index >= 0) ui.portComboBox->setCurrentIndex(index);
 	}
-}
\ No newline at end of file
+}
@@ -1,9 +1,175 @@
 ﻿#include "ModbusConnection.h"
+#include "PduBuilder.h"
+#include "NativeRtuTransport.h"
 #include <QDebug>
 #include <QVariant>
 #include <QMutexLocker>
 #include <qmessagebox.h>
-#include <qdatastream.h>
+#include <QMetaMethod>
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <algorithm>
+#include <utility>
+#include <array>
+#include <atomic>
+
+namespace {
+    constexpr int reconnectBaseDelayMs = 500;
+    constexpr int reconnectMaxDelayMs = 30000;
+    constexpr int maxHeldRequests = 1000;
+    constexpr int baseTimeoutMs = 1000;
+
+    // Longest RTU frame; an adaptive timeout learnt from short replies must still fit it
+    constexpr int maxFrameBytes = 256;
+
+    // Custom function codes: a size function or a fixed response data size
+    // (-1 when unknown). Connections on pool threads frame answers while the
+    // GUI registers codes, so both tables are atomic.
+    std::array<std::atomic<ModbusConnection::ResponseSizeFunction>, 0x80> responseSizeFunctions{};
+    struct FixedResponseSizes
+    {
+        std::array<std::atomic<int>, 0x80> sizes;
+        FixedResponseSizes()
+        {
+            for (std::atomic<int>& size : sizes) {
+                size.store(-1, std::memory_order_relaxed);
+            }
+        }
+        std::atomic<int>& operator[](quint8 functionCode) { return sizes[functionCode]; }
+    } fixedResponseSizes;
+
+    // Function codes Qt frames itself; registering them would replace that for the whole process
+    bool isStandardFunctionCode(quint8 functionCode)
+    {
+        switch (functionCode) {
+        case QModbusPdu::ReadCoils:
+        case QModbusPdu::ReadDiscreteInputs:
+        case QModbusPdu::ReadHoldingRegisters:
+        case QModbusPdu::ReadInputRegisters:
+        case QModbusPdu::WriteSingleCoil:
+        case QModbusPdu::WriteSingleRegister:
+        case QModbusPdu::ReadExceptionStatus:
+        case QModbusPdu::Diagnostics:
+        case QModbusPdu::GetCommEventCounter:
+        case QModbusPdu::GetCommEventLog:
+        case QModbusPdu::WriteMultipleCoils:
+        case QModbusPdu::WriteMultipleRegisters:
+        case QModbusPdu::ReportServerId:
+        case QModbusPdu::ReadFileRecord:
+        case QModbusPdu::WriteFileRecord:
+        case QModbusPdu::MaskWriteRegister:
+        case QModbusPdu::ReadWriteMultipleRegisters:
+        case QModbusPdu::ReadFifoQueue:
+        case QModbusPdu::EncapsulatedInterfaceTransport:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Function code and data of a read, identifying it among held requests
+    QByteArray heldReadPdu(quint8 functionCode, int startAddr, int count)
+    {
+        PduBuilder pdu(functionCode);
+        pdu.put16(quint16(startAddr)).put16(quint16(count));
+        QByteArray bytes(1, char(functionCode));
+        bytes.append(pdu.view());
+        return bytes;
+    }
+
+    // Function codes that change data in the slave
+    bool isWriteFunctionCode(int functionCode)
+    {
+        switch (functionCode) {
+        case QModbusPdu::WriteSingleCoil:
+        case QModbusPdu::WriteSingleRegister:
+        case QModbusPdu::WriteMultipleCoils:
+        case QModbusPdu::WriteMultipleRegisters:
+        case QModbusPdu::WriteFileRecord:
+        case QModbusPdu::MaskWriteRegister:
+        case QModbusPdu::ReadWriteMultipleRegisters:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    int customResponseSize(const QModbusResponse& response)
+    {
+        // Qt strips the exception bit before looking the calculator up
+        if (response.isException()) {
+            return 1;
+        }
+        const quint8 functionCode = quint8(response.functionCode()) & 0x7F;
+        if (const auto function = responseSizeFunctions[functionCode].load(std::memory_order_acquire)) {
+            return function(response);
+        }
+        return fixedResponseSizes[functionCode].load(std::memory_order_acquire);
+    }
+
+    // Qt's calculator table is not locked, so it is filled once, before the
+    // first connection exists, and never touched afterwards
+    bool installResponseSizeCalculators()
+    {
+        for (int functionCode = 1; functionCode < 0x80; ++functionCode) {
+            if (!isStandardFunctionCode(quint8(functionCode))) {
+                QModbusResponse::registerDataSizeCalculator(QModbusPdu::FunctionCode(functionCode), &customResponseSize);
+            }
+        }
+        return true;
+    }
+
+    QModbusPdu::FunctionCode readFunctionCode(ModbusConnection::RegisterType type)
+    {
+        switch (type) {
+        case ModbusConnection::Coils: return QModbusPdu::ReadCoils;
+        case ModbusConnection::DiscreteInputs: return QModbusPdu::ReadDiscreteInputs;
+        case ModbusConnection::InputRegisters: return QModbusPdu::ReadInputRegisters;
+        default: return QModbusPdu::ReadHoldingRegisters;
+        }
+    }
+
+    QModbusRequest writeCoilRequest(int addr, bool value)
+    {
+        return PduBuilder(QModbusPdu::WriteSingleCoil)
+            .put16(quint16(addr))
+            .put16(value ? 0xFF00 : 0x0000)
+            .toRequest();
+    }
+
+    QModbusRequest writeRegisterRequest(int addr, quint16 value)
+    {
+        return PduBuilder(QModbusPdu::WriteSingleRegister)
+            .put16(quint16(addr))
+            .put16(value)
+            .toRequest();
+    }
+
+    // Protocol limits of FC15/FC16, which also keep the byte count within one byte
+    constexpr int maxWriteCoils = 1968;
+    constexpr int maxWriteRegisters = 123;
+
+    // Both return an invalid request when the PDU would not fit
+    QModbusRequest writeCoilsRequest(int startAddr, const BitBlock& bits)
+    {
+        PduBuilder pdu(QModbusPdu::WriteMultipleCoils);
+        pdu.put16(quint16(startAddr))
+            .put16(quint16(bits.size()))
+            .put8(quint8(bits.packedSize()))
+            .putBits(bits);
+        return pdu.overflowed() ? QModbusRequest() : pdu.toRequest();
+    }
+
+    QModbusRequest writeRegistersRequest(int startAddr, const QVector<quint16>& values)
+    {
+        PduBuilder pdu(QModbusPdu::WriteMultipleRegisters);
+        pdu.put16(quint16(startAddr))
+            .put16(quint16(values.size()))
+            .put8(quint8(values.size() * 2))
+            .putWords(values.constData(), int(values.size()));
+        return pdu.overflowed() ? QModbusRequest() : pdu.toRequest();
+    }
+}
 
 ModbusConnection::ModbusConnection(QObject* parent)
     : QObject(parent),
@@ -12,6 +178,16 @@ ModbusConnection::ModbusConnection(QObject* parent)
     m_parity(QSerialPort::NoParity),
     m_stopBits(QSerialPort::OneStop)
 {
+    static const bool calculatorsInstalled = installResponseSizeCalculators();
+    Q_UNUSED(calculatorsInstalled)
+
+    m_reconnectTimer.setSingleShot(true);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &ModbusConnection::attemptReconnect);
+
+    m_responseClock.start();
+
+    m_expiryTimer.setInterval(1000);
+    connect(&m_expiryTimer, &QTimer::timeout, this, &ModbusConnection::expireHeldRequests);
 }
 
 ModbusConnection::~ModbusConnection()
@@ -32,14 +208,13 @@ void ModbusConnection::connectToDevice(const QString& port,
     if (isConnected()) {
         closeConnection();
     }
+    m_userClosed = false;
+    m_everConnected = false;
+    m_responseTime = ResponseTimeStats();
+    m_slaveResponseTime.clear();
+    m_tcp = false;
 
-    if (!m_client) {
-        m_client = new QModbusRtuSerialClient(this);
-        connect(m_client, &QModbusClient::stateChanged,
-            this, &ModbusConnection::handleStateChanged);
-        connect(m_client, &QModbusClient::errorOccurred,
-            this, &ModbusConnection::handleErrorOccurred);
-    }
+    createTransport();
 
     // reset device state
     m_port = port;
@@ -48,36 +223,237 @@ void ModbusConnection::connectToDevice(const QString& port,
     m_parity = parity;
     m_stopBits = stopBits;
 
+    // try to connect
+    if (!openClient()) {
+        QString error = tr("Connect fail : ") + m_device->errorString();
+        emit connectionError(error);
+    }
+}
+
+// Modbus/TCP endpoint; slaveID becomes the unit identifier of every request
+void ModbusConnection::connectToTcpDevice(const QString& host, quint16 port, int slaveID)
+{
+    m_slaveID = slaveID;
+
+    if (isConnected()) {
+        closeConnection();
+    }
+    m_userClosed = false;
+    m_everConnected = false;
+    m_responseTime = ResponseTimeStats();
+    m_slaveResponseTime.clear();
+    m_tcp = true;
+
+    createTransport();
+
+    m_port = host;
+    m_tcpPort = port;
+
+    if (!openClient()) {
+        QString error = tr("Connect fail : ") + m_device->errorString();
+        emit connectionError(error);
+    }
+}
+
+// Applies the stored parameters and starts connecting
+bool ModbusConnection::openClient()
+{
     // configure client parameters
-    m_client->setConnectionParameter(QModbusDevice::SerialPortNameParameter, QVariant(port));
-    m_client->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, QVariant(baudRate));
-    m_client->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, QVariant(dataBits));
-    m_client->setConnectionParameter(QModbusDevice::SerialParityParameter, QVariant(parity));
-    m_client->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, QVariant(stopBits));
+    if (m_tcp) {
+        m_device->setConnectionParameter(QModbusDevice::NetworkAddressParameter, QVariant(m_port));
+        m_device->setConnectionParameter(QModbusDevice::NetworkPortParameter, QVariant(m_tcpPort));
+    }
+    else {
+        m_device->setConnectionParameter(QModbusDevice::SerialPortNameParameter, QVariant(m_port));
+        m_device->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, QVariant(m_baud));
+        m_device->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, QVariant(m_dataBits));
+        m_device->setConnectionParameter(QModbusDevice::SerialParityParameter, QVariant(m_parity));
+        m_device->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, QVariant(m_stopBits));
+    }
 
     // configure additional parameters
-    m_client->setTimeout(1000);
-    m_client->setNumberOfRetries(1);
+    setClientTimeout(m_autoTimeout && m_responseTime.samples > 0 ? m_responseTime.timeoutMs : baseTimeoutMs);
+    if (m_native) {
+        m_native->setNumberOfRetries(1);
+        m_native->setTurnaroundDelay(m_broadcastTurnaround);
+    }
+    else {
+        m_client->setNumberOfRetries(1);
+        if (auto* rtu = qobject_cast<QModbusRtuSerialClient*>(m_client)) {
+            rtu->setTurnaroundDelay(m_broadcastTurnaround);
+        }
+    }
 
-    // try to connect
-    if (!m_client->connectDevice()) {
-        QString error = tr("Connect fail : ") + m_client->errorString();
-        emit connectionError(error);
+    return m_device->connectDevice();
+}
+
+// Creates the client for the endpoint and selected serial transport, replacing one of another kind
+void ModbusConnection::createTransport()
+{
+    const bool native = !m_tcp && m_serialTransport == NativeTransport && NativeRtuTransport::isSupported();
+    const bool tcp = qobject_cast<QModbusTcpClient*>(m_client) != nullptr;
+    if (m_device && native == (m_native != nullptr) && m_tcp == tcp) {
+        return;
+    }
+
+    if (m_device) {
+        m_device->disconnect(this);
+        m_device->deleteLater();
+        m_client = nullptr;
+        m_native = nullptr;
+    }
+
+    if (native) {
+        m_native = new NativeRtuTransport(this);
+        m_device = m_native;
+    }
+    else if (m_tcp) {
+        m_client = new QModbusTcpClient(this);
+        m_device = m_client;
+    }
+    else {
+        if (m_serialTransport == NativeTransport && !m_tcp) {
+            qWarning() << "Native RTU transport not supported on this platform, using QSerialPort";
+        }
+        m_client = new QModbusRtuSerialClient(this);
+        m_device = m_client;
+    }
+    connect(m_device, &QModbusDevice::stateChanged,
+        this, &ModbusConnection::handleStateChanged);
+    connect(m_device, &QModbusDevice::errorOccurred,
+        this, &ModbusConnection::handleErrorOccurred);
+}
+
+void ModbusConnection::setClientTimeout(int msec)
+{
+    if (m_native) {
+        m_native->setTimeout(msec);
+    }
+    else if (m_client) {
+        m_client->setTimeout(msec);
     }
 }
 
+// The request side of both transports, which share no common base for it
+QModbusReply* ModbusConnection::sendReadUnit(const QModbusDataUnit& read, int slaveID)
+{
+    return m_native ? m_native->sendReadRequest(read, slaveID) : m_client->sendReadRequest(read, slaveID);
+}
+
+QModbusReply* ModbusConnection::sendWriteUnit(const QModbusDataUnit& write, int slaveID)
+{
+    return m_native ? m_native->sendWriteRequest(write, slaveID) : m_client->sendWriteRequest(write, slaveID);
+}
+
+QModbusReply* ModbusConnection::sendReadWriteUnits(const QModbusDataUnit& read, const QModbusDataUnit& write, int slaveID)
+{
+    return m_native ? m_native->sendReadWriteRequest(read, write, slaveID)
+        : m_client->sendReadWriteRequest(read, write, slaveID);
+}
+
+QModbusReply* ModbusConnection::sendRawPdu(const QModbusRequest& request, int slaveID)
+{
+    return m_native ? m_native->sendRawRequest(request, slaveID) : m_client->sendRawRequest(request, slaveID);
+}
+
+void ModbusConnection::setSerialTransport(SerialTransport transport) noexcept
+{
+    m_serialTransport = transport;
+}
+
+ModbusConnection::SerialTransport ModbusConnection::serialTransport() const noexcept
+{
+    return m_serialTransport;
+}
+
 void ModbusConnection::closeConnection()
 {
-    if (m_client) {
-        if (m_client->state() != QModbusDevice::UnconnectedState) {
-            m_client->disconnectDevice();
+    m_userClosed = true;
+    if (m_reconnecting) {
+        m_reconnecting = false;
+        m_reconnectTimer.stop();
+        failHeldRequests(QModbusDevice::ReplyAbortedError, tr("Connection closed"));
+        if (!m_device || m_device->state() == QModbusDevice::UnconnectedState) {
+            emit connectionClosed();
+        }
+    }
+
+    if (m_device) {
+        if (m_device->state() != QModbusDevice::UnconnectedState) {
+            m_device->disconnectDevice();
+        }
+    }
+}
+
+void ModbusConnection::reopen(const QString& portName)
+{
+    if (m_port.isEmpty() && portName.isEmpty()) {
+        return;
+    }
+
+    // Held requests survive a reopen while reconnecting, only the backoff restarts
+    if (m_reconnecting) {
+        if (!portName.isEmpty()) {
+            m_port = portName;
         }
+        m_reconnectTimer.stop();
+        m_reconnectAttempt = 0;
+        attemptReconnect();
+        return;
+    }
+    if (m_tcp) {
+        connectToTcpDevice(portName.isEmpty() ? m_port : portName, m_tcpPort, m_slaveID);
+        return;
     }
+    connectToDevice(portName.isEmpty() ? m_port : portName, m_baud, m_dataBits, m_parity, m_stopBits, m_slaveID);
 }
 
 bool ModbusConnection::isConnected() const
 {
-    return m_client && m_client->state() == QModbusDevice::ConnectedState;
+    return isLinkUp() || m_reconnecting;
+}
+
+bool ModbusConnection::isLinkUp() const
+{
+    return m_device && m_device->state() == QModbusDevice::ConnectedState;
+}
+
+void ModbusConnection::setAutoReconnect(bool enabled)
+{
+    m_autoReconnect = enabled;
+    if (!enabled && m_reconnecting) {
+        m_reconnecting = false;
+        m_reconnectTimer.stop();
+        failHeldRequests(QModbusDevice::ConnectionError, tr("Connection lost"));
+        emit connectionClosed();
+    }
+}
+
+bool ModbusConnection::autoReconnect() const noexcept
+{
+    return m_autoReconnect;
+}
+
+bool ModbusConnection::isReconnecting() const noexcept
+{
+    return m_reconnecting;
+}
+
+void ModbusConnection::notifyLinkLost()
+{
+    if (m_device && m_device->state() != QModbusDevice::UnconnectedState) {
+        m_device->disconnectDevice();
+    }
+}
+
+void ModbusConnection::setHoldTimeout(int msec) noexcept
+{
+    m_holdTimeout = msec;
+}
+
+int ModbusConnection::heldRequestCount() const noexcept
+{
+    return int(m_heldRequests.size());
 }
 
 QString ModbusConnection::getPortName() const noexcept
@@ -90,13 +466,39 @@ qint32 ModbusConnection::getBaudRate() const noexcept
     return m_baud;
 }
 
+quint16 ModbusConnection::getTcpPort() const noexcept
+{
+    return m_tcpPort;
+}
+
+bool ModbusConnection::isTcp() const noexcept
+{
+    return m_tcp;
+}
+
 int ModbusConnection::getSlaveID() const noexcept
 {
     return m_slaveID;
 }
 
+void ModbusConnection::setWriteVerification(WriteVerification verification) noexcept
+{
+    m_writeVerification = verification;
+}
+
+ModbusConnection::WriteVerification ModbusConnection::writeVerification() const noexcept
+{
+    return m_writeVerification;
+}
+
 // Modbus operations
 QModbusReply* ModbusConnection::readRegister(RegisterType type, int startAddr, quint16 count)
+{
+    return readRegister(type, startAddr, count, m_slaveID);
+}
+
+// Read from an explicit slave, used by the tag poller for multi-slave plans
+QModbusReply* ModbusConnection::readRegister(RegisterType type, int startAddr, quint16 count, int slaveID)
 {
     QMutexLocker locker(&m_mutex);
 
@@ -104,15 +506,30 @@ QModbusReply* ModbusConnection::readRegister(RegisterType type, int startAddr, q
     qDebug() << "Type:" << type
         << "| Start Addr:" << startAddr
         << "| Count:" << count
-        << "| Slave ID:" << m_slaveID;
+        << "| Slave ID:" << slaveID;
 
-    if (!isConnected() || !m_client) {
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Common, slaveID, [=, this]() {
+                return readRegister(type, startAddr, count, slaveID);
+                }, heldReadPdu(readFunctionCode(type), startAddr, count));
+        }
         qWarning() << "Cannot read - not connected";
         return nullptr;
     }
 
     QModbusDataUnit request(static_cast<QModbusDataUnit::RegisterType>(type), startAddr, count);
-    return m_client->sendReadRequest(request, m_slaveID);
+    QModbusReply* reply = track(sendReadUnit(request, slaveID),
+        readFunctionCode(type), slaveID);
+    if (reply && isSignalConnected(QMetaMethod::fromSignal(&ModbusConnection::registersRead))) {
+        connect(reply, &QModbusReply::finished, this, [this, reply, slaveID, type]() {
+            if (reply->error() == QModbusDevice::NoError) {
+                const QModbusDataUnit result = reply->result();
+                emit registersRead(slaveID, type, result.startAddress(), result.values());
+            }
+            });
+    }
+    return reply;
 }
 
 // Write single coil value
@@ -120,19 +537,15 @@ QModbusReply* ModbusConnection::writeCoil(int addr, bool value)
 {
     QMutexLocker locker(&m_mutex);
 
-    if (!isConnected()) {
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, m_slaveID, [=, this]() { return writeCoil(addr, value); });
+        }
         qWarning() << "Write coil failed: Not connected";
         return nullptr;
     }
 
-    QByteArray requestData;
-    QDataStream stream(&requestData, QIODevice::WriteOnly);
-    stream.setByteOrder(QDataStream::BigEndian);
-    stream << static_cast<quint16>(addr);
-    stream << static_cast<quint16>(value ? 0xFF00 : 0x0000);
-
-    QModbusRequest request(QModbusRequest::WriteSingleCoil, requestData);
-    return m_client->sendRawRequest(request, m_slaveID);
+    return track(sendRawPdu(writeCoilRequest(addr, value), m_slaveID), QModbusPdu::WriteSingleCoil, m_slaveID);
 }
 
 // Write single holding register
@@ -140,32 +553,39 @@ QModbusReply* ModbusConnection::writeSingleRegister(int addr, quint16 value)
 {
     QMutexLocker locker(&m_mutex);
 
-    if (!isConnected() || !m_client) {
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, m_slaveID, [=, this]() { return writeSingleRegister(addr, value); });
+        }
         qWarning() << "Write single register failed: Not connected";
         return nullptr;
     }
 
-    QByteArray requestData;
-    QDataStream stream(&requestData, QIODevice::WriteOnly);
-    stream.setByteOrder(QDataStream::BigEndian);
-    stream << static_cast<quint16>(addr);
-    stream << static_cast<quint16>(value);
-
-    QModbusRequest request(QModbusRequest::WriteSingleRegister, requestData);
-
     qDebug() << "\n[Modbus WriteSingleRegister Request]";
     qDebug() << "Address:" << addr
         << "| Value:" << value
         << "| Slave ID:" << m_slaveID;
 
-    return m_client->sendRawRequest(request, m_slaveID);
+    return track(sendRawPdu(writeRegisterRequest(addr, value), m_slaveID),
+        QModbusPdu::WriteSingleRegister, m_slaveID);
 }
 
-// Write multiple registers
+// Write multiple registers using the connection's verification policy
 QModbusReply* ModbusConnection::writeMultipleRegisters(RegisterType type, int startAddr, const QVector<quint16>& values)
+{
+    return writeMultipleRegisters(type, startAddr, values, m_writeVerification);
+}
+
+QModbusReply* ModbusConnection::writeMultipleRegisters(RegisterType type, int startAddr, const QVector<quint16>& values,
+    WriteVerification verification)
 {
     QMutexLocker locker(&m_mutex);
-    if (!isConnected() || !m_client) {
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Common, m_slaveID, [=, this]() {
+                return writeMultipleRegisters(type, startAddr, values, verification);
+                });
+        }
         qWarning() << "Cannot write multiple registers - not connected";
         return nullptr;
     }
@@ -183,22 +603,1181 @@ QModbusReply* ModbusConnection::writeMultipleRegisters(RegisterType type, int st
         << "| Count:" << values.size()
         << "| Slave ID:" << m_slaveID;
 
-    return m_client->sendWriteRequest(request, m_slaveID);
+    QModbusReply* reply = track(sendWriteUnit(request, m_slaveID),
+        type == Coils ? QModbusPdu::WriteMultipleCoils : QModbusPdu::WriteMultipleRegisters, m_slaveID);
+    if (reply && verification != VerifyNone) {
+        connect(reply, &QModbusReply::finished, this, [this, reply, type, startAddr, values, verification]() {
+            if (reply->error() == QModbusDevice::NoError) {
+                verifyWrite(type, startAddr, values, verification);
+            }
+            });
+    }
+    return reply;
 }
 
-// modbus state change handling
-void ModbusConnection::handleStateChanged(QModbusDevice::State state)
+// Reads back exactly the written range and compares it against the written buffer
+void ModbusConnection::verifyWrite(RegisterType type, int startAddr, const QVector<quint16>& written,
+    WriteVerification verification)
 {
-    qDebug() << "Modbus state changed:" << state;
+    QModbusReply* reply = readRegister(type, startAddr, quint16(written.size()));
+    if (!reply) {
+        emit writeVerificationFailed(type, startAddr, tr("Failed to send read-back request"));
+        return;
+    }
 
-    switch (state) {
-    case QModbusDevice::ConnectedState:
-        emit connectionOpened();
-        break;
-    case QModbusDevice::UnconnectedState:
-        emit connectionClosed();
-        break;
-    default: break;
+    connect(reply, &QModbusReply::finished, this, [this, reply, type, startAddr, written, verification]() {
+        if (reply->error() != QModbusDevice::NoError) {
+            qWarning() << "Write read-back failed:" << reply->errorString();
+            emit writeVerificationFailed(type, startAddr, reply->errorString());
+        }
+        else {
+            const QVector<quint16> readBack = reply->result().values();
+            QList<AddressRange> mismatches;
+            if (verification == VerifyReadBackDiff) {
+                mismatches = RegisterDiff::diff(written, readBack, startAddr);
+                if (!mismatches.isEmpty()) {
+                    qWarning() << "Write verification found" << RegisterDiff::totalCount(mismatches)
+                        << "mismatching values starting at" << mismatches.first().start;
+                }
+            }
+            emit writeVerified(type, startAddr, readBack, mismatches);
+        }
+        reply->deleteLater();
+        });
+}
+
+// Read coils or discrete inputs; the reply carries the range so the packed
+// response can be decoded without the caller tracking it
+QModbusReply* ModbusConnection::readBits(RegisterType type, int startAddr, quint16 count)
+{
+    return readBits(type, startAddr, count, m_slaveID);
+}
+
+QModbusReply* ModbusConnection::readBits(RegisterType type, int startAddr, quint16 count, int slaveID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, slaveID, [=, this]() {
+                return readBits(type, startAddr, count, slaveID);
+                }, heldReadPdu(readFunctionCode(type), startAddr, count));
+        }
+        qWarning() << "Cannot read bits - not connected";
+        return nullptr;
+    }
+
+    if (type != Coils && type != DiscreteInputs) {
+        qWarning() << "Invalid register type for bit read";
+        return nullptr;
+    }
+
+    qDebug() << "\n[Modbus ReadBits Request]";
+    qDebug() << "Type:" << type
+        << "| Start Addr:" << startAddr
+        << "| Count:" << count
+        << "| Slave ID:" << slaveID;
+
+    QModbusRequest request(type == Coils ? QModbusRequest::ReadCoils : QModbusRequest::ReadDiscreteInputs,
+        static_cast<quint16>(startAddr), count);
+    QModbusReply* reply = track(sendRawPdu(request, slaveID), request.functionCode(), slaveID);
+    if (reply) {
+        reply->setProperty("bitStart", startAddr);
+        reply->setProperty("bitCount", int(count));
+        if (isSignalConnected(QMetaMethod::fromSignal(&ModbusConnection::bitsRead))) {
+            connect(reply, &QModbusReply::finished, this, [this, reply, slaveID, type, startAddr]() {
+                const BitBlock bits = bitsFromReply(reply);
+                if (!bits.isEmpty()) {
+                    emit bitsRead(slaveID, type, startAddr, bits);
+                }
+                });
+        }
+    }
+    return reply;
+}
+
+// Write multiple coils straight from the packed block
+QModbusReply* ModbusConnection::writeMultipleCoils(int startAddr, const BitBlock& bits)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (bits.isEmpty() || bits.size() > maxWriteCoils) {
+        qWarning() << "Invalid coil write count:" << bits.size();
+        return nullptr;
+    }
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, m_slaveID, [=, this]() { return writeMultipleCoils(startAddr, bits); });
+        }
+        qWarning() << "Cannot write multiple coils - not connected";
+        return nullptr;
+    }
+
+    qDebug() << "\n[Modbus WriteMultipleCoils Request]";
+    qDebug() << "Start Addr:" << startAddr
+        << "| Count:" << bits.size()
+        << "| Slave ID:" << m_slaveID;
+
+    QModbusReply* reply = track(sendRawPdu(writeCoilsRequest(startAddr, bits), m_slaveID),
+        QModbusPdu::WriteMultipleCoils, m_slaveID);
+
+    const WriteVerification verification = m_writeVerification;
+    if (reply && verification != VerifyNone) {
+        connect(reply, &QModbusReply::finished, this, [this, reply, startAddr, bits, verification]() {
+            if (reply->error() == QModbusDevice::NoError) {
+                verifyCoilsWrite(startAddr, bits, verification);
+            }
+            });
+    }
+    return reply;
+}
+
+QModbusReply* ModbusConnection::readWriteMultipleRegisters(int readStart, quint16 readCount,
+    int writeStart, const QVector<quint16>& values)
+{
+    return readWriteMultipleRegisters(readStart, readCount, writeStart, values, m_slaveID);
+}
+
+QModbusReply* ModbusConnection::readWriteMultipleRegisters(int readStart, quint16 readCount,
+    int writeStart, const QVector<quint16>& values, int slaveID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Common, slaveID, [=, this]() {
+                return readWriteMultipleRegisters(readStart, readCount, writeStart, values, slaveID);
+                });
+        }
+        qWarning() << "Cannot read/write registers - not connected";
+        return nullptr;
+    }
+
+    // Protocol limits of FC23
+    if (readCount < 1 || readCount > 125 || values.isEmpty() || values.size() > 121) {
+        qWarning() << "Invalid read/write register counts:" << readCount << values.size();
+        return nullptr;
+    }
+
+    qDebug() << "\n[Modbus ReadWriteMultipleRegisters Request]";
+    qDebug() << "Read Addr:" << readStart
+        << "| Read Count:" << readCount
+        << "| Write Addr:" << writeStart
+        << "| Write Count:" << values.size()
+        << "| Slave ID:" << slaveID;
+
+    const QModbusDataUnit read(QModbusDataUnit::HoldingRegisters, readStart, readCount);
+    const QModbusDataUnit write(QModbusDataUnit::HoldingRegisters, writeStart, values);
+    QModbusReply* reply = track(sendReadWriteUnits(read, write, slaveID),
+        QModbusPdu::ReadWriteMultipleRegisters, slaveID);
+    if (reply && isSignalConnected(QMetaMethod::fromSignal(&ModbusConnection::registersRead))) {
+        connect(reply, &QModbusReply::finished, this, [this, reply, slaveID]() {
+            if (reply->error() == QModbusDevice::NoError) {
+                const QModbusDataUnit result = reply->result();
+                emit registersRead(slaveID, HoldingRegisters, result.startAddress(), result.values());
+            }
+            });
+    }
+    return reply;
+}
+
+QModbusReply* ModbusConnection::maskWriteRegister(int addr, quint16 andMask, quint16 orMask)
+{
+    return maskWriteRegister(addr, andMask, orMask, m_slaveID);
+}
+
+// The bit update happens inside the slave, so no read-modify-write round trip is needed
+QModbusReply* ModbusConnection::maskWriteRegister(int addr, quint16 andMask, quint16 orMask, int slaveID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, slaveID, [=, this]() {
+                return maskWriteRegister(addr, andMask, orMask, slaveID);
+                });
+        }
+        qWarning() << "Mask write failed: Not connected";
+        return nullptr;
+    }
+
+    const QModbusRequest request = PduBuilder(QModbusPdu::MaskWriteRegister)
+        .put16(quint16(addr)).put16(andMask).put16(orMask)
+        .toRequest();
+
+    qDebug() << "\n[Modbus MaskWriteRegister Request]";
+    qDebug() << "Address:" << addr
+        << "| AND:" << Qt::hex << andMask
+        << "| OR:" << orMask << Qt::dec
+        << "| Slave ID:" << slaveID;
+
+    return track(sendRawPdu(request, slaveID), QModbusPdu::MaskWriteRegister, slaveID);
+}
+
+QModbusReply* ModbusConnection::readFileRecord(int fileNumber, int recordNumber, quint16 length, int slaveID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, slaveID, [=, this]() {
+                return readFileRecord(fileNumber, recordNumber, length, slaveID);
+                });
+        }
+        qWarning() << "Cannot read file record - not connected";
+        return nullptr;
+    }
+
+    if (length < 1 || length > 124 || fileNumber < 1 || fileNumber > 0xFFFF || recordNumber < 0 || recordNumber > 0x270F) {
+        qWarning() << "Invalid file record read:" << fileNumber << recordNumber << length;
+        return nullptr;
+    }
+
+    const QModbusRequest request = PduBuilder(QModbusPdu::ReadFileRecord)
+        .put8(7).put8(6).put16(quint16(fileNumber)).put16(quint16(recordNumber)).put16(length)
+        .toRequest();
+
+    qDebug() << "\n[Modbus ReadFileRecord Request]";
+    qDebug() << "File:" << fileNumber
+        << "| Record:" << recordNumber
+        << "| Length:" << length
+        << "| Slave ID:" << slaveID;
+
+    QModbusReply* reply = track(sendRawPdu(request, slaveID), QModbusPdu::ReadFileRecord, slaveID);
+    if (reply) {
+        reply->setProperty("recordLength", int(length));
+    }
+    return reply;
+}
+
+QModbusReply* ModbusConnection::writeFileRecord(int fileNumber, int recordNumber, const QVector<quint16>& values, int slaveID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, slaveID, [=, this]() {
+                return writeFileRecord(fileNumber, recordNumber, values, slaveID);
+                });
+        }
+        qWarning() << "Cannot write file record - not connected";
+        return nullptr;
+    }
+
+    if (values.isEmpty() || values.size() > 122 || fileNumber < 1 || fileNumber > 0xFFFF
+        || recordNumber < 0 || recordNumber > 0x270F) {
+        qWarning() << "Invalid file record write:" << fileNumber << recordNumber << values.size();
+        return nullptr;
+    }
+
+    const QModbusRequest request = PduBuilder(QModbusPdu::WriteFileRecord)
+        .put8(quint8(7 + values.size() * 2)).put8(6)
+        .put16(quint16(fileNumber)).put16(quint16(recordNumber)).put16(quint16(values.size()))
+        .putWords(values.constData(), int(values.size()))
+        .toRequest();
+
+    qDebug() << "\n[Modbus WriteFileRecord Request]";
+    qDebug() << "File:" << fileNumber
+        << "| Record:" << recordNumber
+        << "| Length:" << values.size()
+        << "| Slave ID:" << slaveID;
+
+    return track(sendRawPdu(request, slaveID), QModbusPdu::WriteFileRecord, slaveID);
+}
+
+// Response: data length, then per sub-request a length byte, reference type 6 and the registers
+QVector<quint16> ModbusConnection::fileRecordFromReply(const QModbusReply* reply)
+{
+    if (!reply || reply->error() != QModbusDevice::NoError) {
+        return {};
+    }
+
+    const QByteArray data = reply->rawResult().data();
+    if (data.size() < 3 || quint8(data.at(2)) != 6) {
+        qWarning() << "Malformed file record response:" << data.toHex();
+        return {};
+    }
+
+    const int subLength = quint8(data.at(1));      // reference type byte plus data
+    const int count = (subLength - 1) / 2;
+    const int expected = reply->property("recordLength").toInt();
+    if (subLength < 1 || data.size() < 3 + count * 2 || (expected > 0 && count != expected)) {
+        qWarning() << "File record response length mismatch:" << count << "of" << expected;
+        return {};
+    }
+
+    QVector<quint16> values(count);
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData()) + 3;
+    for (int i = 0; i < count; ++i) {
+        values[i] = quint16((bytes[i * 2] << 8) | bytes[i * 2 + 1]);
+    }
+    return values;
+}
+
+QModbusReply* ModbusConnection::readFifoQueue(int fifoAddress, int slaveID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, slaveID, [=, this]() { return readFifoQueue(fifoAddress, slaveID); });
+        }
+        qWarning() << "Cannot read FIFO - not connected";
+        return nullptr;
+    }
+
+    qDebug() << "\n[Modbus ReadFifoQueue Request]";
+    qDebug() << "FIFO Addr:" << fifoAddress << "| Slave ID:" << slaveID;
+
+    return track(sendRawPdu(QModbusRequest(QModbusRequest::ReadFifoQueue, quint16(fifoAddress)), slaveID),
+        QModbusPdu::ReadFifoQueue, slaveID);
+}
+
+// Response: byte count (2), FIFO count (2), then the registers; ok is false on error or bad framing
+QVector<quint16> ModbusConnection::fifoFromReply(const QModbusReply* reply, bool* ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+    if (!reply || reply->error() != QModbusDevice::NoError) {
+        return {};
+    }
+
+    const QByteArray data = reply->rawResult().data();
+    const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+    if (data.size() < 4) {
+        return {};
+    }
+    const int count = (bytes[2] << 8) | bytes[3];
+    if (count > 31 || data.size() < 4 + count * 2) {
+        qWarning() << "Malformed FIFO response, count" << count << "in" << data.size() << "bytes";
+        return {};
+    }
+
+    QVector<quint16> values(count);
+    for (int i = 0; i < count; ++i) {
+        values[i] = quint16((bytes[4 + i * 2] << 8) | bytes[5 + i * 2]);
+    }
+    if (ok) {
+        *ok = true;
+    }
+    return values;
+}
+
+// FC43/14 basic device identification, starting at objectID; objects that
+// do not fit one response are fetched by asking again from the next ID
+QModbusReply* ModbusConnection::readDeviceIdentification(int slaveID, int objectID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, slaveID, [=, this]() {
+                return readDeviceIdentification(slaveID, objectID);
+                });
+        }
+        qWarning() << "Cannot read device identification - not connected";
+        return nullptr;
+    }
+
+    qDebug() << "\n[Modbus ReadDeviceIdentification Request]";
+    qDebug() << "Object ID:" << objectID << "| Slave ID:" << slaveID;
+
+    const QModbusRequest request(QModbusRequest::EncapsulatedInterfaceTransport,
+        quint8(0x0E), quint8(0x01), quint8(objectID));
+    return track(sendRawPdu(request, slaveID), request.functionCode(), slaveID);
+}
+
+// Response: MEI type, read code, conformity, more follows, next object, object count, then id/length/value
+QMap<int, QByteArray> ModbusConnection::deviceIdentificationFromReply(const QModbusReply* reply, int* nextObjectID)
+{
+    if (nextObjectID) {
+        *nextObjectID = -1;
+    }
+    if (!reply || reply->error() != QModbusDevice::NoError) {
+        return {};
+    }
+
+    const QByteArray data = reply->rawResult().data();
+    if (data.size() < 6 || quint8(data.at(0)) != 0x0E) {
+        qWarning() << "Malformed device identification response:" << data.toHex();
+        return {};
+    }
+
+    QMap<int, QByteArray> objects;
+    const int count = quint8(data.at(5));
+    int pos = 6;
+    for (int i = 0; i < count && pos + 2 <= data.size(); ++i) {
+        const int id = quint8(data.at(pos));
+        const int length = quint8(data.at(pos + 1));
+        if (pos + 2 + length > data.size()) {
+            break;
+        }
+        objects.insert(id, data.mid(pos + 2, length));
+        pos += 2 + length;
+    }
+
+    if (nextObjectID && quint8(data.at(3)) == 0xFF) {
+        *nextObjectID = quint8(data.at(4));
+    }
+    return objects;
+}
+
+// Adaptive response timeout
+void ModbusConnection::setAdaptiveTimeout(bool enabled)
+{
+    m_autoTimeout = enabled;
+    setClientTimeout(enabled && m_responseTime.samples > 0 ? m_responseTime.timeoutMs : baseTimeoutMs);
+}
+
+bool ModbusConnection::adaptiveTimeout() const noexcept
+{
+    return m_autoTimeout;
+}
+
+ModbusConnection::ResponseTimeStats ModbusConnection::responseTimeStats() const noexcept
+{
+    return m_responseTime;
+}
+
+ModbusConnection::ResponseTimeStats ModbusConnection::responseTimeStats(int slaveID) const
+{
+    return m_slaveResponseTime.value(slaveID);
+}
+
+// Starts the estimator from values learnt on an earlier connection
+void ModbusConnection::primeResponseTime(double smoothedMs, double deviationMs)
+{
+    if (smoothedMs <= 0) {
+        return;
+    }
+    m_responseTime.smoothedMs = smoothedMs;
+    m_responseTime.deviationMs = qMax(0.0, deviationMs);
+    m_responseTime.samples = qMax<quint64>(m_responseTime.samples, 1);
+    updateTimeout();
+}
+
+// Times the reply from when it could reach the wire: a request queued behind
+// others starts when the one before it finishes, since the line carries one
+// transaction at a time and replies complete in order
+QModbusReply* ModbusConnection::track(QModbusReply* reply, int functionCode, int slaveID)
+{
+    if (!reply || reply->isFinished()) {
+        return reply;
+    }
+
+    const qint64 sentAt = m_responseClock.elapsed();
+    connect(reply, &QModbusReply::finished, this, [this, reply, sentAt, functionCode, slaveID]() {
+        noteCompletion(sentAt, reply->error(), reply->rawResult().exceptionCode(), functionCode, slaveID);
+        });
+    return reply;
+}
+
+void ModbusConnection::noteCompletion(qint64 sentAt, QModbusDevice::Error error, int exceptionCode,
+    int functionCode, int slaveID)
+{
+    const qint64 now = m_responseClock.elapsed();
+    const qint64 elapsed = now - qMax(sentAt, m_lastCompletion);
+    m_lastCompletion = now;
+
+    switch (error) {
+    case QModbusDevice::NoError:
+        addResponseSample(elapsed, slaveID);
+        emit functionSupported(slaveID, functionCode, true);
+        if (isWriteFunctionCode(functionCode)) {
+            emit registersWritten(slaveID, functionCode);
+        }
+        break;
+    case QModbusDevice::ProtocolError:
+        // An exception is still an answer, and the only way to learn that a function is missing
+        addResponseSample(elapsed, slaveID);
+        emit functionSupported(slaveID, functionCode, exceptionCode != QModbusPdu::IllegalFunction);
+        break;
+    case QModbusDevice::TimeoutError:
+        // Back off until an answer arrives again, like a TCP retransmission timer
+        if (m_autoTimeout && m_responseTime.samples > 0) {
+            m_responseTime.timeoutMs = qMin(baseTimeoutMs, m_responseTime.timeoutMs * 2);
+            setClientTimeout(m_responseTime.timeoutMs);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Smoothed round trip and mean deviation as in RFC 6298
+void ModbusConnection::addResponseSample(qint64 elapsedMs, int slaveID)
+{
+    const auto smooth = [elapsedMs](ResponseTimeStats& stats) {
+        if (stats.samples == 0) {
+            stats.smoothedMs = elapsedMs;
+            stats.deviationMs = elapsedMs / 2.0;
+        }
+        else {
+            stats.deviationMs = 0.75 * stats.deviationMs + 0.25 * qAbs(stats.smoothedMs - elapsedMs);
+            stats.smoothedMs = 0.875 * stats.smoothedMs + 0.125 * elapsedMs;
+        }
+        ++stats.samples;
+    };
+    smooth(m_responseTime);
+    smooth(m_slaveResponseTime[slaveID]);
+    updateTimeout();
+}
+
+void ModbusConnection::updateTimeout()
+{
+    // Room for the longest frame on top of the estimate, which may come from short replies
+    const int frameMs = m_tcp ? 1 : int(maxFrameBytes * 11 * 1000 / qMax(1, m_baud)) + 1;
+    const int timeout = int(m_responseTime.smoothedMs + 4 * m_responseTime.deviationMs) + frameMs;
+    m_responseTime.timeoutMs = qBound(frameMs + 20, timeout, baseTimeoutMs);
+
+    if (m_autoTimeout) {
+        setClientTimeout(m_responseTime.timeoutMs);
+    }
+}
+
+QModbusReply* ModbusConnection::sendRawRequest(const QModbusRequest& request, int slaveID)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Raw, slaveID, [=, this]() { return sendRawRequest(request, slaveID); });
+        }
+        qWarning() << "Cannot send raw request - not connected";
+        return nullptr;
+    }
+
+    return track(sendRawPdu(request, slaveID), request.functionCode(), slaveID);
+}
+
+QModbusReply* ModbusConnection::sendRequest(quint8 functionCode, QByteArrayView payload, int slaveID)
+{
+    PduBuilder pdu(functionCode);
+    pdu.putBytes(payload);
+    return sendRequest(pdu, slaveID);
+}
+
+QModbusReply* ModbusConnection::sendRequest(const PduBuilder& pdu, int slaveID)
+{
+    // Bit 7 marks exception responses, so requests stay below 0x80
+    if (pdu.functionCode() == 0 || pdu.functionCode() >= 0x80 || pdu.overflowed()) {
+        qWarning() << "Invalid request PDU - function code" << pdu.functionCode() << "size" << pdu.size();
+        return nullptr;
+    }
+
+    qDebug() << "\n[Modbus Request]";
+    qDebug() << "Function:" << Qt::hex << pdu.functionCode() << Qt::dec
+        << "| Data bytes:" << pdu.size()
+        << "| Slave ID:" << slaveID;
+
+    return sendRawRequest(pdu.toRequest(), slaveID);
+}
+
+bool ModbusConnection::registerFunctionCode(quint8 functionCode, ResponseSizeFunction responseSize)
+{
+    if (functionCode == 0 || functionCode >= 0x80 || isStandardFunctionCode(functionCode) || !responseSize) {
+        qWarning() << "Function code" << functionCode << "cannot be registered";
+        return false;
+    }
+    responseSizeFunctions[functionCode].store(responseSize, std::memory_order_release);
+    return true;
+}
+
+bool ModbusConnection::registerFunctionCode(quint8 functionCode, int responseDataSize)
+{
+    if (functionCode == 0 || functionCode >= 0x80 || isStandardFunctionCode(functionCode)
+        || responseDataSize < 0 || responseDataSize > PduBuilder::MaxDataSize) {
+        qWarning() << "Invalid response size" << responseDataSize << "for function code" << functionCode;
+        return false;
+    }
+    fixedResponseSizes[functionCode].store(responseDataSize, std::memory_order_release);
+    responseSizeFunctions[functionCode].store(nullptr, std::memory_order_release);
+    return true;
+}
+
+bool ModbusConnection::isCustomFunctionCode(quint8 functionCode) noexcept
+{
+    return functionCode > 0 && functionCode < 0x80 && !isStandardFunctionCode(functionCode);
+}
+
+// Callback requests
+bool ModbusConnection::submitRead(RegisterType type, int startAddr, quint16 count, int slaveID,
+    RequestCallback callback, void* context, quint64 tag)
+{
+    PduBuilder pdu(readFunctionCode(type));
+    pdu.put16(quint16(startAddr)).put16(count);
+
+    PendingCall* call = m_calls.acquire();
+    call->callback = callback;
+    call->context = context;
+    call->tag = tag;
+    call->slaveID = slaveID;
+    call->type = type;
+    call->startAddr = startAddr;
+    call->count = count;
+    return startCall(call, pdu.functionCode(), pdu.view());
+}
+
+bool ModbusConnection::submitReadWrite(int readStart, quint16 readCount, int writeStart,
+    const QVector<quint16>& values, int slaveID, RequestCallback callback, void* context, quint64 tag)
+{
+    // Protocol limits of FC23
+    if (readCount < 1 || readCount > 125 || values.isEmpty() || values.size() > 121) {
+        qWarning() << "Invalid read/write register counts:" << readCount << values.size();
+        return false;
+    }
+
+    PduBuilder pdu(QModbusPdu::ReadWriteMultipleRegisters);
+    pdu.put16(quint16(readStart)).put16(readCount)
+        .put16(quint16(writeStart)).put16(quint16(values.size())).put8(quint8(values.size() * 2))
+        .putWords(values.constData(), int(values.size()));
+
+    PendingCall* call = m_calls.acquire();
+    call->callback = callback;
+    call->context = context;
+    call->tag = tag;
+    call->slaveID = slaveID;
+    call->type = HoldingRegisters;
+    call->startAddr = readStart;
+    call->count = readCount;
+    return startCall(call, pdu.functionCode(), pdu.view());
+}
+
+bool ModbusConnection::submitRequest(const QModbusRequest& request, int slaveID,
+    RequestCallback callback, void* context, quint64 tag)
+{
+    PendingCall* call = m_calls.acquire();
+    call->callback = callback;
+    call->context = context;
+    call->tag = tag;
+    call->slaveID = slaveID;
+    return startCall(call, quint8(request.functionCode()), request.data());
+}
+
+// Queues the call on the native transport's pooled records, or behind a reply
+bool ModbusConnection::startCall(PendingCall* call, quint8 functionCode, QByteArrayView data)
+{
+    QMutexLocker locker(&m_mutex);
+
+    call->owner = this;
+    call->functionCode = functionCode;
+    call->sentAt = m_responseClock.elapsed();
+
+    QModbusReply* reply = nullptr;
+    if (m_native && isLinkUp()) {
+        if (!m_native->submit(call->slaveID, functionCode, data, &ModbusConnection::nativeCallDone, call)) {
+            m_calls.release(call);
+            return false;
+        }
+    }
+    else {
+        const QModbusRequest request(QModbusPdu::FunctionCode(functionCode), data.toByteArray());
+        const int slaveID = call->slaveID;
+        if (isLinkUp()) {
+            reply = track(sendRawPdu(request, slaveID), functionCode, slaveID);
+        }
+        else if (m_reconnecting) {
+            const bool isRead = call->count > 0;
+            reply = holdRequest(QModbusReply::Raw, slaveID, [=, this]() { return sendRawRequest(request, slaveID); },
+                isRead ? heldReadPdu(functionCode, call->startAddr, call->count) : QByteArray());
+        }
+        if (!reply) {
+            m_calls.release(call);
+            return false;
+        }
+    }
+
+    call->next = m_activeCalls;
+    if (m_activeCalls) {
+        m_activeCalls->prev = call;
+    }
+    m_activeCalls = call;
+
+    if (reply) {
+        const auto done = [this, call, reply]() {
+            const QModbusResponse response = reply->rawResult();
+            const QByteArray responseData = response.data();
+            RequestResult result;
+            result.slaveID = call->slaveID;
+            result.error = reply->error();
+            if (result.error != QModbusDevice::NoError) {
+                result.errorText = reply->errorString();
+            }
+            result.functionCode = quint8(response.functionCode() | (response.isException() ? QModbusPdu::ExceptionByte : 0));
+            result.data = responseData;
+            reply->deleteLater();
+            finishCall(call, result);
+        };
+        if (reply->isFinished()) {
+            QMetaObject::invokeMethod(this, done, Qt::QueuedConnection);
+        }
+        else {
+            connect(reply, &QModbusReply::finished, this, done);
+        }
+    }
+    return true;
+}
+
+void ModbusConnection::nativeCallDone(void* context, const NativeRtuTransport::Transaction& transaction)
+{
+    auto* call = static_cast<PendingCall*>(context);
+    ModbusConnection* self = call->owner;
+
+    RequestResult result;
+    result.slaveID = call->slaveID;
+    result.error = transaction.error;
+    result.errorText = transaction.errorText;
+    result.functionCode = transaction.answerFunctionCode();
+    result.data = transaction.answerData();
+
+    int exceptionCode = 0;
+    if (result.error == QModbusDevice::NoError && result.isException()) {
+        exceptionCode = result.data.isEmpty() ? 0 : quint8(result.data[0]);
+        result.error = QModbusDevice::ProtocolError;
+        result.errorText = tr("Modbus exception response (code 0x%1)").arg(exceptionCode, 2, 16, QLatin1Char('0'));
+    }
+    self->noteCompletion(call->sentAt, result.error, exceptionCode, call->functionCode, call->slaveID);
+    self->finishCall(call, result);
+}
+
+void ModbusConnection::finishCall(PendingCall* call, const RequestResult& result)
+{
+    if (call->prev) {
+        call->prev->next = call->next;
+    }
+    else {
+        m_activeCalls = call->next;
+    }
+    if (call->next) {
+        call->next->prev = call->prev;
+    }
+
+    if (call->count > 0 && result.error == QModbusDevice::NoError
+        && isSignalConnected(QMetaMethod::fromSignal(&ModbusConnection::registersRead))) {
+        QVector<quint16> values(call->count);
+        if (decodeRead(call->type, result, values.data(), call->count)) {
+            emit registersRead(call->slaveID, call->type, call->startAddr, values);
+        }
+    }
+
+    if (call->callback) {
+        call->callback(call->context, call->tag, result);
+    }
+    m_calls.release(call);
+}
+
+void ModbusConnection::cancelRequests(const void* context)
+{
+    for (PendingCall* call = m_activeCalls; call; call = call->next) {
+        if (call->context == context) {
+            call->callback = nullptr;
+        }
+    }
+}
+
+bool ModbusConnection::decodeRead(RegisterType type, const RequestResult& result, quint16* values, int count)
+{
+    const QByteArrayView data = result.data;
+    if (result.error != QModbusDevice::NoError || data.isEmpty() || quint8(data[0]) != data.size() - 1) {
+        return false;
+    }
+
+    const auto* bytes = reinterpret_cast<const uchar*>(data.data()) + 1;
+    if (type == Coils || type == DiscreteInputs) {
+        if ((data.size() - 1) * 8 < count) {
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            values[i] = (bytes[i / 8] >> (i % 8)) & 1;
+        }
+    }
+    else {
+        if (data.size() - 1 < qsizetype(count) * 2) {
+            return false;
+        }
+        for (int i = 0; i < count; ++i) {
+            values[i] = qFromBigEndian<quint16>(bytes + i * 2);
+        }
+    }
+    return true;
+}
+
+QModbusReply* ModbusConnection::broadcastCoil(int addr, bool value)
+{
+    return broadcastRequest(writeCoilRequest(addr, value));
+}
+
+QModbusReply* ModbusConnection::broadcastRegister(int addr, quint16 value)
+{
+    return broadcastRequest(writeRegisterRequest(addr, value));
+}
+
+QModbusReply* ModbusConnection::broadcastCoils(int startAddr, const BitBlock& bits)
+{
+    if (bits.isEmpty() || bits.size() > maxWriteCoils) {
+        qWarning() << "Invalid broadcast coil count:" << bits.size();
+        return nullptr;
+    }
+    return broadcastRequest(writeCoilsRequest(startAddr, bits));
+}
+
+QModbusReply* ModbusConnection::broadcastRegisters(int startAddr, const QVector<quint16>& values)
+{
+    if (values.isEmpty() || values.size() > maxWriteRegisters) {
+        qWarning() << "Invalid broadcast register count:" << values.size();
+        return nullptr;
+    }
+    return broadcastRequest(writeRegistersRequest(startAddr, values));
+}
+
+// Only the write function codes may be broadcast; the client skips the
+// response wait for slave 0 and holds the bus for the turnaround delay
+QModbusReply* ModbusConnection::broadcastRequest(const QModbusRequest& request)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!request.isValid()) {
+        qWarning() << "Cannot broadcast an invalid request";
+        return nullptr;
+    }
+
+    switch (request.functionCode()) {
+    case QModbusPdu::WriteSingleCoil:
+    case QModbusPdu::WriteSingleRegister:
+    case QModbusPdu::WriteMultipleCoils:
+    case QModbusPdu::WriteMultipleRegisters:
+        break;
+    default:
+        qWarning() << "Function code" << request.functionCode() << "cannot be broadcast";
+        return nullptr;
+    }
+
+    if (!isLinkUp()) {
+        if (m_reconnecting) {
+            return holdRequest(QModbusReply::Broadcast, 0, [=, this]() { return broadcastRequest(request); });
+        }
+        qWarning() << "Cannot broadcast - not connected";
+        return nullptr;
+    }
+
+    qDebug() << "\n[Modbus Broadcast Request]";
+    qDebug() << "Function:" << request.functionCode()
+        << "| PDU bytes:" << request.size()
+        << "| Turnaround:" << m_broadcastTurnaround << "ms";
+
+    QModbusReply* reply = sendRawPdu(request, 0);
+    if (!reply) {
+        ++m_broadcastStats.failed;
+        return nullptr;
+    }
+
+    ++m_broadcastStats.frames;
+    m_broadcastStats.pduBytes += quint64(request.size());
+    m_broadcastStats.deliveries += quint64(m_broadcastFanOut);
+
+    QElapsedTimer timer;
+    timer.start();
+    const int functionCode = request.functionCode();
+    connect(reply, &QModbusReply::finished, this, [this, reply, timer, functionCode]() {
+        m_broadcastStats.busTimeMs += timer.elapsed();
+        if (reply->error() != QModbusDevice::NoError) {
+            ++m_broadcastStats.failed;
+            qWarning() << "Broadcast failed:" << reply->errorString();
+            return;
+        }
+        emit registersWritten(0, functionCode);
+        });
+    return reply;
+}
+
+void ModbusConnection::setBroadcastTurnaround(int msec)
+{
+    m_broadcastTurnaround = msec;
+    if (m_native) {
+        m_native->setTurnaroundDelay(msec);
+    }
+    else if (auto* rtu = qobject_cast<QModbusRtuSerialClient*>(m_client)) {
+        rtu->setTurnaroundDelay(msec);
+    }
+}
+
+int ModbusConnection::broadcastTurnaround() const noexcept
+{
+    return m_broadcastTurnaround;
+}
+
+void ModbusConnection::setBroadcastFanOut(int slaves) noexcept
+{
+    m_broadcastFanOut = qMax(1, slaves);
+}
+
+int ModbusConnection::broadcastFanOut() const noexcept
+{
+    return m_broadcastFanOut;
+}
+
+ModbusConnection::BroadcastStatistics ModbusConnection::broadcastStatistics() const noexcept
+{
+    return m_broadcastStats;
+}
+
+void ModbusConnection::resetBroadcastStatistics() noexcept
+{
+    m_broadcastStats = BroadcastStatistics();
+}
+
+// Decodes the byte count and packed states of a readBits reply, empty on error or short data
+BitBlock ModbusConnection::bitsFromReply(const QModbusReply* reply)
+{
+    if (!reply || reply->error() != QModbusDevice::NoError) {
+        return BitBlock();
+    }
+
+    const int count = reply->property("bitCount").toInt();
+    const QByteArray data = reply->rawResult().data();
+    const int byteCount = (count + 7) / 8;
+    if (count <= 0 || data.size() < 1 + byteCount || quint8(data.at(0)) < byteCount) {
+        qWarning() << "Bit read response too short:" << data.size() << "bytes for" << count << "bits";
+        return BitBlock();
+    }
+
+    return BitBlock::fromPackedBytes(data.constData() + 1, byteCount, count);
+}
+
+int ModbusConnection::startAddressOf(const QModbusReply* reply)
+{
+    return reply ? reply->property("bitStart").toInt() : 0;
+}
+
+// Packed counterpart of verifyWrite, the comparison runs a word at a time
+void ModbusConnection::verifyCoilsWrite(int startAddr, const BitBlock& written, WriteVerification verification)
+{
+    QModbusReply* reply = readBits(Coils, startAddr, quint16(written.size()));
+    if (!reply) {
+        emit writeVerificationFailed(Coils, startAddr, tr("Failed to send read-back request"));
+        return;
+    }
+
+    connect(reply, &QModbusReply::finished, this, [this, reply, startAddr, written, verification]() {
+        const BitBlock readBack = bitsFromReply(reply);
+        if (reply->error() != QModbusDevice::NoError || readBack.isEmpty()) {
+            qWarning() << "Coil read-back failed:" << reply->errorString();
+            emit writeVerificationFailed(Coils, startAddr, reply->errorString());
+        }
+        else {
+            QList<AddressRange> mismatches;
+            if (verification == VerifyReadBackDiff) {
+                mismatches = written.diff(readBack, startAddr);
+                if (!mismatches.isEmpty()) {
+                    qWarning() << "Coil write verification found" << RegisterDiff::totalCount(mismatches)
+                        << "mismatching coils starting at" << mismatches.first().start;
+                }
+            }
+            emit coilsWriteVerified(startAddr, readBack, mismatches);
+        }
+        reply->deleteLater();
+        });
+}
+
+// modbus state change handling
+void ModbusConnection::handleStateChanged(QModbusDevice::State state)
+{
+    qDebug() << "Modbus state changed:" << state;
+
+    switch (state) {
+    case QModbusDevice::ConnectedState:
+        m_everConnected = true;
+        if (m_reconnecting) {
+            qDebug() << "Reconnected after" << m_reconnectAttempt << "attempts,"
+                << m_heldRequests.size() << "held requests to replay";
+            m_reconnecting = false;
+            m_reconnectAttempt = 0;
+            emit connectionOpened();
+            replayHeldRequests();
+        }
+        else {
+            emit connectionOpened();
+        }
+        break;
+    case QModbusDevice::UnconnectedState:
+        if (m_reconnecting) {
+            scheduleReconnect();        // this attempt failed
+        }
+        else if (m_autoReconnect && m_everConnected && !m_userClosed) {
+            qWarning() << "Connection to" << m_port << "lost, reconnecting";
+            m_reconnecting = true;
+            m_reconnectAttempt = 0;
+            emit connectionLost();
+            scheduleReconnect();
+        }
+        else {
+            emit connectionClosed();
+        }
+        break;
+    default: break;
+    }
+}
+
+// Delay doubles from reconnectBaseDelayMs up to reconnectMaxDelayMs
+void ModbusConnection::scheduleReconnect()
+{
+    const int shift = qMin(m_reconnectAttempt, 16);
+    const int delay = int(qMin<qint64>(qint64(reconnectBaseDelayMs) << shift, reconnectMaxDelayMs));
+    ++m_reconnectAttempt;
+
+    emit reconnecting(m_reconnectAttempt, delay);
+    m_reconnectTimer.start(delay);
+}
+
+void ModbusConnection::attemptReconnect()
+{
+    if (!m_reconnecting || !m_device) {
+        return;
+    }
+    if (m_device->state() != QModbusDevice::UnconnectedState) {
+        m_device->disconnectDevice();
+    }
+
+    qDebug() << "Reconnect attempt" << m_reconnectAttempt << "on" << m_port;
+    // A synchronous failure does not always pass through UnconnectedState again
+    if (!openClient() && m_device->state() == QModbusDevice::UnconnectedState && !m_reconnectTimer.isActive()) {
+        scheduleReconnect();
+    }
+}
+
+// Returns a reply that stands in for the real one until the link is back.
+// A read equal to one already held moves that one to the back of the queue,
+// so it is still sent after any write held in between, and shares its answer.
+QModbusReply* ModbusConnection::holdRequest(QModbusReply::ReplyType type, int slaveID,
+    std::function<QModbusReply*()> send, QByteArrayView readPdu)
+{
+    auto placeholder = new QModbusReply(type, slaveID, this);
+    if (!m_expiryTimer.isActive()) {
+        m_expiryTimer.start();
+    }
+
+    QByteArray readKey;
+    if (!readPdu.isEmpty()) {
+        readKey.append(char(type)).append(char(slaveID)).append(readPdu);
+        const auto same = std::find_if(m_heldRequests.begin(), m_heldRequests.end(), [&readKey](const HeldRequest& held) {
+            return held.readKey == readKey;
+            });
+        if (same != m_heldRequests.end()) {
+            HeldRequest held = std::move(*same);
+            m_heldRequests.erase(same);
+            held.placeholders.append(placeholder);
+            held.deadline = QDeadlineTimer(m_holdTimeout);
+            m_heldRequests.append(std::move(held));
+            return placeholder;
+        }
+    }
+
+    if (m_heldRequests.size() >= maxHeldRequests) {
+        const HeldRequest oldest = m_heldRequests.takeFirst();
+        for (const QPointer<QModbusReply>& dropped : oldest.placeholders) {
+            if (dropped) {
+                dropped->setError(QModbusDevice::TimeoutError, tr("Dropped, too many requests held while reconnecting"));
+            }
+        }
+    }
+
+    m_heldRequests.append(HeldRequest{ std::move(send), { placeholder }, QDeadlineTimer(m_holdTimeout), readKey });
+    return placeholder;
+}
+
+// Sends every held request in order and forwards each real reply into its placeholders
+void ModbusConnection::replayHeldRequests()
+{
+    const QList<HeldRequest> held = std::exchange(m_heldRequests, {});
+    m_expiryTimer.stop();
+
+    for (const HeldRequest& request : held) {
+        QList<QPointer<QModbusReply>> placeholders;
+        for (const QPointer<QModbusReply>& placeholder : request.placeholders) {
+            if (placeholder) {
+                placeholders.append(placeholder);
+            }
+        }
+        if (placeholders.isEmpty()) {
+            continue;   // the callers gave up on it
+        }
+        if (request.deadline.hasExpired()) {
+            for (const QPointer<QModbusReply>& placeholder : placeholders) {
+                placeholder->setError(QModbusDevice::TimeoutError, tr("Request expired while reconnecting"));
+            }
+            continue;
+        }
+
+        QModbusReply* reply = request.send();
+        if (!reply) {
+            for (const QPointer<QModbusReply>& placeholder : placeholders) {
+                if (placeholder) {
+                    placeholder->setError(QModbusDevice::ConnectionError, tr("Failed to replay request"));
+                }
+            }
+            continue;
+        }
+
+        auto forward = [placeholders, reply]() {
+            for (const QPointer<QModbusReply>& placeholder : placeholders) {
+                if (!placeholder) {
+                    continue;
+                }
+                for (const QByteArray& name : reply->dynamicPropertyNames()) {
+                    placeholder->setProperty(name.constData(), reply->property(name.constData()));
+                }
+                placeholder->setResult(reply->result());
+                placeholder->setRawResult(reply->rawResult());
+                if (reply->error() != QModbusDevice::NoError) {
+                    placeholder->setError(reply->error(), reply->errorString());
+                }
+                else {
+                    placeholder->setFinished(true);
+                }
+            }
+            reply->deleteLater();
+        };
+        if (reply->isFinished()) {
+            forward();
+        }
+        else {
+            connect(reply, &QModbusReply::finished, this, forward);
+        }
+    }
+}
+
+void ModbusConnection::expireHeldRequests()
+{
+    for (auto it = m_heldRequests.begin(); it != m_heldRequests.end(); ) {
+        it->placeholders.removeIf([](const QPointer<QModbusReply>& placeholder) { return placeholder.isNull(); });
+        if (it->placeholders.isEmpty() || it->deadline.hasExpired()) {
+            for (const QPointer<QModbusReply>& placeholder : it->placeholders) {
+                placeholder->setError(QModbusDevice::TimeoutError, tr("Request expired while reconnecting"));
+            }
+            it = m_heldRequests.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (m_heldRequests.isEmpty()) {
+        m_expiryTimer.stop();
+    }
+}
+
+void ModbusConnection::failHeldRequests(QModbusDevice::Error error, const QString& errorText)
+{
+    const QList<HeldRequest> held = std::exchange(m_heldRequests, {});
+    m_expiryTimer.stop();
+    for (const HeldRequest& request : held) {
+        for (const QPointer<QModbusReply>& placeholder : request.placeholders) {
+            if (placeholder) {
+                placeholder->setError(error, errorText);
+            }
+        }
     }
 }
 
@@ -227,8 +1806,8 @@ void ModbusConnection::handleErrorOccurred(QModbusDevice::Error error)
         errorMsg = tr("Unknown error");
     }
 
-    if (!m_client->errorString().isEmpty()) {
-        errorMsg += ": " + m_client->errorString();
+    if (!m_device->errorString().isEmpty()) {
+        errorMsg += ": " + m_device->errorString();
     }
 
     qWarning() << "Modbus error:" << errorMsg;
@@ -0,0 +1,343 @@
+#include "ModbusGateway.h"
+#include <QTcpSocket>
+#include <QtEndian>
+#include <QDebug>
+
+namespace {
+    constexpr int mbapHeaderSize = 7;   // transaction, protocol, length, unit
+    constexpr int maxPduSize = 253;
+}
+
+ModbusGateway::ModbusGateway(QObject* parent)
+    : QObject(parent)
+{
+    m_server = new QTcpServer(this);
+    connect(m_server, &QTcpServer::newConnection, this, &ModbusGateway::handleNewConnection);
+}
+
+ModbusGateway::~ModbusGateway()
+{
+    close();
+    if (m_modbusConnection) {
+        m_modbusConnection->cancelRequests(this);
+    }
+}
+
+void ModbusGateway::setModbusConnection(ModbusConnection* connection)
+{
+    if (m_modbusConnection) {
+        m_modbusConnection->cancelRequests(this);
+    }
+    if (m_modbusConnection) {
+        disconnect(m_modbusConnection, nullptr, this, nullptr);
+    }
+    m_modbusConnection = connection;
+    m_busBusy = false;
+    m_cache.clear();
+    if (m_modbusConnection) {
+        // Writes from the rest of the application make cached reads stale too
+        connect(m_modbusConnection, &ModbusConnection::registersWritten, this, &ModbusGateway::handleRegistersWritten);
+    }
+}
+
+void ModbusGateway::handleRegistersWritten(int slaveID)
+{
+    if (slaveID == 0) {
+        m_cache.clear();
+    }
+    else {
+        m_cache.invalidate(slaveID);
+    }
+}
+
+bool ModbusGateway::listen(quint16 port, QString* errorMessage)
+{
+    if (m_server->isListening()) {
+        return true;
+    }
+
+    if (!m_server->listen(QHostAddress::Any, port)) {
+        if (errorMessage) {
+            *errorMessage = m_server->errorString();
+        }
+        return false;
+    }
+
+    qDebug() << "Modbus gateway listening on port" << port;
+    return true;
+}
+
+void ModbusGateway::close()
+{
+    m_server->close();
+
+    const QList<Client*> clients = m_clients;
+    for (Client* client : clients) {
+        client->socket->abort();
+    }
+
+    // Clients whose socket did not report the disconnect synchronously
+    for (Client* client : std::as_const(m_clients)) {
+        client->socket->deleteLater();
+    }
+    qDeleteAll(m_clients);
+    m_clients.clear();
+    m_busClient = nullptr;
+    m_nextClient = 0;
+    m_cache.clear();
+}
+
+bool ModbusGateway::isListening() const
+{
+    return m_server->isListening();
+}
+
+void ModbusGateway::setMaxQueuePerClient(int maxQueue)
+{
+    m_maxQueue = qMax(1, maxQueue);
+}
+
+void ModbusGateway::setCacheMaxAge(int maxAgeMs)
+{
+    m_cache.setMaxAge(maxAgeMs);
+}
+
+ModbusGateway::Statistics ModbusGateway::statistics() const
+{
+    Statistics statistics = m_statistics;
+    statistics.clients = int(m_clients.size());
+    statistics.queued = 0;
+    for (const Client* client : m_clients) {
+        statistics.queued += int(client->queue.size());
+    }
+    statistics.cacheHits = m_cache.hits();
+    return statistics;
+}
+
+QStringList ModbusGateway::clientAddresses() const
+{
+    QStringList addresses;
+    for (const Client* client : m_clients) {
+        addresses << QString("%1:%2").arg(client->socket->peerAddress().toString()).arg(client->socket->peerPort());
+    }
+    return addresses;
+}
+
+void ModbusGateway::handleNewConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        auto* client = new Client;
+        client->socket = socket;
+        m_clients.append(client);
+
+        connect(socket, &QTcpSocket::readyRead, this, [this, client]() { handleReadyRead(client); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, client]() { handleDisconnected(client); });
+
+        qDebug() << "Gateway client connected:" << socket->peerAddress().toString();
+    }
+    emit clientsChanged();
+}
+
+void ModbusGateway::handleReadyRead(Client* client)
+{
+    client->buffer.append(client->socket->readAll());
+    parseFrames(client);
+    schedule();
+}
+
+void ModbusGateway::handleDisconnected(Client* client)
+{
+    const int index = int(m_clients.indexOf(client));
+    if (index < 0) {
+        return;
+    }
+
+    m_clients.removeAt(index);
+    if (m_nextClient > index) {
+        --m_nextClient;
+    }
+    if (m_busClient == client) {
+        m_busClient = nullptr;
+    }
+
+    qDebug() << "Gateway client disconnected:" << client->socket->peerAddress().toString();
+    client->socket->deleteLater();
+    delete client;
+    emit clientsChanged();
+}
+
+// Splits the stream into MBAP frames and queues their PDUs
+void ModbusGateway::parseFrames(Client* client)
+{
+    QByteArray& buffer = client->buffer;
+    while (buffer.size() >= mbapHeaderSize + 1) {
+        const auto* header = reinterpret_cast<const uchar*>(buffer.constData());
+        const quint16 transactionID = qFromBigEndian<quint16>(header);
+        const quint16 protocolID = qFromBigEndian<quint16>(header + 2);
+        const quint16 length = qFromBigEndian<quint16>(header + 4);
+
+        // length covers the unit id and the PDU
+        if (length < 2 || length > maxPduSize + 1) {
+            qWarning() << "Gateway: invalid MBAP length" << length << ", dropping client";
+            client->socket->abort();
+            return;
+        }
+        if (buffer.size() < 6 + length) {
+            return;
+        }
+
+        PendingRequest pending;
+        pending.transactionID = transactionID;
+        pending.unitID = quint8(header[6]);
+        pending.request = QModbusRequest(QModbusPdu::FunctionCode(header[7]),
+            buffer.mid(mbapHeaderSize + 1, length - 2));
+
+        // Unit 255 addresses the gateway itself, forward it to the configured slave
+        pending.slaveID = pending.unitID == 0xFF && m_modbusConnection
+            ? m_modbusConnection->getSlaveID()
+            : pending.unitID;
+
+        buffer.remove(0, 6 + length);
+
+        if (protocolID != 0) {
+            continue;
+        }
+
+        ++m_statistics.requests;
+        if (client->queue.size() >= m_maxQueue) {
+            ++m_statistics.rejected;
+            respondException(client, pending, QModbusPdu::ServerDeviceBusy);
+            continue;
+        }
+        client->queue.enqueue(pending);
+    }
+}
+
+// Starts the next bus transaction, taking one request per client in turn.
+// Cache hits are answered immediately and do not use the bus.
+void ModbusGateway::schedule()
+{
+    while (!m_busBusy) {
+        Client* client = nextClient();
+        if (!client) {
+            return;
+        }
+
+        const PendingRequest pending = client->queue.dequeue();
+
+        // Broadcasts hold the bus for the turnaround delay and get no answer, not even an exception
+        if (pending.slaveID == 0) {
+            QModbusReply* reply = m_modbusConnection ? m_modbusConnection->broadcastRequest(pending.request) : nullptr;
+            if (!reply) {
+                ++m_statistics.rejected;
+                continue;
+            }
+            ++m_statistics.busTransactions;
+            m_cache.clear();
+            if (reply->isFinished()) {
+                reply->deleteLater();
+                continue;
+            }
+            m_busBusy = true;
+            connect(reply, &QModbusReply::finished, this, [this, reply]() {
+                reply->deleteLater();
+                m_busBusy = false;
+                schedule();
+                });
+            continue;
+        }
+
+        QModbusResponse cached;
+        if (m_cache.lookup(pending.slaveID, pending.request, &cached)) {
+            respond(client, pending, cached);
+            continue;
+        }
+
+        if (!m_modbusConnection || !m_modbusConnection->submitRequest(pending.request, pending.slaveID,
+            &ModbusGateway::handleBusResult, this)) {
+            respondException(client, pending, QModbusPdu::GatewayPathUnavailable);
+            continue;
+        }
+
+        ++m_statistics.busTransactions;
+        m_busBusy = true;
+        m_busClient = client;
+        m_busRequest = pending;
+    }
+}
+
+ModbusGateway::Client* ModbusGateway::nextClient()
+{
+    const int count = int(m_clients.size());
+    for (int i = 0; i < count; ++i) {
+        const int index = (m_nextClient + i) % count;
+        if (!m_clients[index]->queue.isEmpty()) {
+            m_nextClient = (index + 1) % count;
+            return m_clients[index];
+        }
+    }
+    return nullptr;
+}
+
+void ModbusGateway::handleBusResult(void* context, quint64 tag, const ModbusConnection::RequestResult& result)
+{
+    Q_UNUSED(tag)
+    auto* self = static_cast<ModbusGateway*>(context);
+    self->m_busBusy = false;
+    self->handleBusResponse(result);
+    self->schedule();
+}
+
+void ModbusGateway::handleBusResponse(const ModbusConnection::RequestResult& result)
+{
+    Client* client = m_busClient;
+    m_busClient = nullptr;
+    const PendingRequest pending = m_busRequest;
+
+    const bool answered = result.error == QModbusDevice::NoError
+        || (result.error == QModbusDevice::ProtocolError && result.isException());
+
+    if (!ResponseCache::isRead(pending.request) && answered) {
+        m_cache.invalidate(pending.slaveID);
+    }
+
+    if (!answered) {
+        qDebug() << "Gateway: bus request failed:" << result.errorText;
+        if (client) {
+            respondException(client, pending, QModbusPdu::GatewayTargetDeviceFailedToRespond);
+        }
+        return;
+    }
+
+    const QModbusResponse response(QModbusPdu::FunctionCode(result.functionCode), result.data.toByteArray());
+    m_cache.store(pending.slaveID, pending.request, response);
+    if (client) {
+        respond(client, pending, response);
+    }
+}
+
+void ModbusGateway::respond(Client* client, const PendingRequest& pending, const QModbusResponse& response)
+{
+    if (response.isException()) {
+        ++m_statistics.exceptions;
+    }
+
+    const QByteArray data = response.data();
+    QByteArray frame(mbapHeaderSize + 1, Qt::Uninitialized);
+    auto* header = reinterpret_cast<uchar*>(frame.data());
+    qToBigEndian<quint16>(pending.transactionID, header);
+    qToBigEndian<quint16>(0, header + 2);
+    qToBigEndian<quint16>(quint16(2 + data.size()), header + 4);
+    header[6] = pending.unitID;
+    header[7] = uchar(response.isException()
+        ? response.functionCode() | QModbusPdu::ExceptionByte
+        : response.functionCode());
+    frame.append(data);
+
+    client->socket->write(frame);
+}
+
+void ModbusGateway::respondException(Client* client, const PendingRequest& pending, QModbusPdu::ExceptionCode code)
+{
+    respond(client, pending, QModbusExceptionResponse(pending.request.functionCode(), code));
+}
@@ -0,0 +1,858 @@
+#include "NativeRtuTransport.h"
+#include "PduBuilder.h"
+#include "BitBlock.h"
+#include "Crc16.h"
+#include <QThread>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include <utility>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#endif
+
+namespace {
+    constexpr int maxAduSize = NativeRtuTransport::MaxAduSize;
+
+    // Full frame length once enough of the answer is in, -1 while it cannot be
+    // told yet. The common function codes are sized in place; only the rest
+    // go through a QModbusResponse.
+    int expectedAduSize(const char* frame, int size)
+    {
+        if (size < 2) {
+            return -1;
+        }
+        const quint8 functionCode = quint8(frame[1]);
+        if (functionCode & 0x80) {
+            return 5;   // address, function, exception code, CRC
+        }
+        switch (functionCode) {
+        case QModbusPdu::ReadCoils:
+        case QModbusPdu::ReadDiscreteInputs:
+        case QModbusPdu::ReadHoldingRegisters:
+        case QModbusPdu::ReadInputRegisters:
+        case QModbusPdu::ReadWriteMultipleRegisters:
+            return size < 3 ? -1 : 3 + quint8(frame[2]) + 2;
+        case QModbusPdu::WriteSingleCoil:
+        case QModbusPdu::WriteSingleRegister:
+        case QModbusPdu::WriteMultipleCoils:
+        case QModbusPdu::WriteMultipleRegisters:
+            return 8;
+        case QModbusPdu::MaskWriteRegister:
+            return 10;
+        default:
+            break;
+        }
+        const QModbusResponse response(QModbusPdu::FunctionCode(functionCode), QByteArray(frame + 2, size - 2));
+        const int dataSize = QModbusResponse::calculateDataSize(response);
+        return dataSize < 0 ? -1 : 2 + dataSize + 2;
+    }
+
+    // Fills unit with the values of a read answer; write answers leave it as written
+    bool decodeResult(const QModbusResponse& response, QModbusDataUnit& unit)
+    {
+        const QByteArray data = response.data();
+        const int count = int(unit.valueCount());
+
+        switch (response.functionCode()) {
+        case QModbusPdu::ReadCoils:
+        case QModbusPdu::ReadDiscreteInputs:
+            if (data.isEmpty() || quint8(data.at(0)) != data.size() - 1 || (data.size() - 1) * 8 < count) {
+                return false;
+            }
+            for (int i = 0; i < count; ++i) {
+                unit.setValue(i, (quint8(data.at(1 + i / 8)) >> (i % 8)) & 1);
+            }
+            return true;
+        case QModbusPdu::ReadHoldingRegisters:
+        case QModbusPdu::ReadInputRegisters:
+        case QModbusPdu::ReadWriteMultipleRegisters:
+            if (data.isEmpty() || quint8(data.at(0)) != count * 2 || data.size() < 1 + count * 2) {
+                return false;
+            }
+            for (int i = 0; i < count; ++i) {
+                unit.setValue(i, qFromBigEndian<quint16>(data.constData() + 1 + i * 2));
+            }
+            return true;
+        default:
+            return true;
+        }
+    }
+
+#ifdef Q_OS_LINUX
+    qint64 nowNs()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    timespec toTimespec(qint64 ns)
+    {
+        ns = qMax<qint64>(0, ns);
+        return timespec{ time_t(ns / 1000000000), long(ns % 1000000000) };
+    }
+
+    speed_t speedFor(qint32 baudRate)
+    {
+        switch (baudRate) {
+        case 1200: return B1200;
+        case 2400: return B2400;
+        case 4800: return B4800;
+        case 9600: return B9600;
+        case 19200: return B19200;
+        case 38400: return B38400;
+        case 57600: return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 500000: return B500000;
+        case 921600: return B921600;
+        case 1000000: return B1000000;
+        default: return B0;
+        }
+    }
+
+    bool isLinkError(int error)
+    {
+        return error == EIO || error == ENODEV || error == ENXIO || error == EBADF;
+    }
+#endif
+}
+
+NativeRtuTransport::NativeRtuTransport(QObject* parent)
+    : QModbusDevice(parent)
+{
+}
+
+NativeRtuTransport::~NativeRtuTransport()
+{
+    close();
+}
+
+bool NativeRtuTransport::isSupported() noexcept
+{
+#ifdef Q_OS_LINUX
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Modbus over serial line 2.3.1.1: fixed timers above 19200 baud, character based below
+NativeRtuTransport::Timing NativeRtuTransport::timingFor(qint32 baudRate, QSerialPort::DataBits dataBits,
+    QSerialPort::Parity parity, QSerialPort::StopBits stopBits)
+{
+    const int bits = 1 + int(dataBits) + (parity == QSerialPort::NoParity ? 0 : 1)
+        + (stopBits == QSerialPort::OneStop ? 1 : 2);
+
+    Timing timing;
+    timing.charTimeUs = int((qint64(bits) * 1000000 + qMax(1, baudRate) - 1) / qMax(1, baudRate));
+    if (baudRate > 19200) {
+        timing.t15Us = 750;
+        timing.t35Us = 1750;
+    }
+    else {
+        timing.t15Us = (timing.charTimeUs * 3 + 1) / 2;
+        timing.t35Us = (timing.charTimeUs * 7 + 1) / 2;
+    }
+    return timing;
+}
+
+void NativeRtuTransport::setTimeout(int msec)
+{
+    m_timeout = qMax(10, msec);
+}
+
+int NativeRtuTransport::timeout() const
+{
+    return m_timeout;
+}
+
+void NativeRtuTransport::setNumberOfRetries(int retries)
+{
+    m_retries = qMax(0, retries);
+}
+
+void NativeRtuTransport::setTurnaroundDelay(int msec)
+{
+    m_turnaround = qMax(0, msec);
+}
+
+void NativeRtuTransport::setStrictCharacterTiming(bool strict)
+{
+    m_strictTiming = strict;
+}
+
+void NativeRtuTransport::setRs485(bool enabled, int delayBeforeSendMs, int delayAfterSendMs)
+{
+    m_rs485 = enabled;
+    m_rs485Before = qMax(0, delayBeforeSendMs);
+    m_rs485After = qMax(0, delayAfterSendMs);
+}
+
+bool NativeRtuTransport::open()
+{
+    if (state() == ConnectedState) {
+        return true;
+    }
+
+#ifdef Q_OS_LINUX
+    const QString portName = connectionParameter(SerialPortNameParameter).toString();
+    const QString path = portName.startsWith('/') ? portName : QStringLiteral("/dev/") + portName;
+    const qint32 baudRate = connectionParameter(SerialBaudRateParameter).toInt();
+    const auto dataBits = QSerialPort::DataBits(connectionParameter(SerialDataBitsParameter).toInt());
+    const auto parity = QSerialPort::Parity(connectionParameter(SerialParityParameter).toInt());
+    const auto stopBits = QSerialPort::StopBits(connectionParameter(SerialStopBitsParameter).toInt());
+
+    const speed_t speed = speedFor(baudRate);
+    if (speed == B0) {
+        setError(tr("Unsupported baud rate %1").arg(baudRate), ConnectionError);
+        return false;
+    }
+
+    setState(ConnectingState);
+
+    const int fd = ::open(path.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        setError(tr("Cannot open %1: %2").arg(path, qt_error_string(errno)), ConnectionError);
+        setState(UnconnectedState);
+        return false;
+    }
+    ::ioctl(fd, TIOCEXCL);
+
+    termios tio;
+    if (::tcgetattr(fd, &tio) < 0) {
+        setError(tr("%1 is not a serial port: %2").arg(path, qt_error_string(errno)), ConnectionError);
+        ::close(fd);
+        setState(UnconnectedState);
+        return false;
+    }
+
+    ::cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSIZE | PARENB | PARODD | CMSPAR | CSTOPB | CRTSCTS);
+    tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+    switch (dataBits) {
+    case QSerialPort::Data5: tio.c_cflag |= CS5; break;
+    case QSerialPort::Data6: tio.c_cflag |= CS6; break;
+    case QSerialPort::Data7: tio.c_cflag |= CS7; break;
+    default: tio.c_cflag |= CS8; break;
+    }
+    switch (parity) {
+    case QSerialPort::EvenParity: tio.c_cflag |= PARENB; break;
+    case QSerialPort::OddParity: tio.c_cflag |= PARENB | PARODD; break;
+    case QSerialPort::SpaceParity: tio.c_cflag |= PARENB | CMSPAR; break;
+    case QSerialPort::MarkParity: tio.c_cflag |= PARENB | CMSPAR | PARODD; break;
+    default: break;
+    }
+    if (stopBits != QSerialPort::OneStop) {
+        tio.c_cflag |= CSTOPB;
+    }
+    // Reads never block, the worker waits in ppoll() with its own timeouts
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    ::cfsetispeed(&tio, speed);
+    ::cfsetospeed(&tio, speed);
+
+    if (::tcsetattr(fd, TCSANOW, &tio) < 0) {
+        setError(tr("Cannot configure %1: %2").arg(path, qt_error_string(errno)), ConnectionError);
+        ::close(fd);
+        setState(UnconnectedState);
+        return false;
+    }
+
+    // Without it many USB adapters hold received bytes back for up to 16 ms
+    m_savedSerialFlags = -1;
+    serial_struct serial;
+    if (::ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+        m_savedSerialFlags = serial.flags;
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (::ioctl(fd, TIOCSSERIAL, &serial) < 0) {
+            qDebug() << "Low latency mode not available on" << path;
+        }
+    }
+
+    if (m_rs485) {
+        serial_rs485 rs485 = {};
+        rs485.flags = SER_RS485_ENABLED | SER_RS485_RTS_ON_SEND;
+        rs485.delay_rts_before_send = quint32(m_rs485Before);
+        rs485.delay_rts_after_send = quint32(m_rs485After);
+        if (::ioctl(fd, TIOCSRS485, &rs485) < 0) {
+            setError(tr("RS-485 mode not supported by %1: %2").arg(path, qt_error_string(errno)), ConnectionError);
+            ::close(fd);
+            setState(UnconnectedState);
+            return false;
+        }
+    }
+
+    ::tcflush(fd, TCIOFLUSH);
+
+    m_fd = fd;
+    m_timing = timingFor(baudRate, dataBits, parity, stopBits);
+    m_lastActivityNs = 0;
+    m_stopping = false;
+
+    qDebug() << "Native RTU transport opened" << path << "- char time" << m_timing.charTimeUs
+        << "us, t1.5" << m_timing.t15Us << "us, t3.5" << m_timing.t35Us << "us";
+
+    m_worker = QThread::create([this]() { run(); });
+    m_worker->setObjectName(QStringLiteral("NativeRtuTransport"));
+    m_worker->start(QThread::TimeCriticalPriority);
+
+    setState(ConnectedState);
+    return true;
+#else
+    setError(tr("The native RTU transport is only available on Linux"), ConnectionError);
+    return false;
+#endif
+}
+
+void NativeRtuTransport::close()
+{
+    if (state() == UnconnectedState && m_fd < 0) {
+        return;
+    }
+    setState(ClosingState);
+    stopWorker();
+
+#ifdef Q_OS_LINUX
+    if (m_fd >= 0) {
+        serial_struct serial;
+        if (m_savedSerialFlags >= 0 && ::ioctl(m_fd, TIOCGSERIAL, &serial) == 0) {
+            serial.flags = m_savedSerialFlags;
+            ::ioctl(m_fd, TIOCSSERIAL, &serial);
+        }
+        // The exclusive flag outlives this descriptor while anything else holds the tty open
+        ::ioctl(m_fd, TIOCNXCL);
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif
+
+    // Answers that made it are still delivered, whatever was waiting is aborted
+    deliverCompleted();
+    Transaction* transaction = std::exchange(m_queueHead, nullptr);
+    m_queueTail = nullptr;
+    while (transaction) {
+        Transaction* next = transaction->next;
+        transaction->error = ReplyAbortedError;
+        transaction->errorText = tr("Device closed");
+        finish(transaction);
+        transaction = next;
+    }
+    setState(UnconnectedState);
+}
+
+void NativeRtuTransport::stopWorker()
+{
+    if (!m_worker) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_queueMutex);
+        m_stopping = true;
+    }
+    m_queueCondition.wakeAll();
+    m_worker->wait();
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+QModbusReply* NativeRtuTransport::sendReadRequest(const QModbusDataUnit& read, int serverAddress)
+{
+    QModbusPdu::FunctionCode functionCode;
+    switch (read.registerType()) {
+    case QModbusDataUnit::Coils: functionCode = QModbusPdu::ReadCoils; break;
+    case QModbusDataUnit::DiscreteInputs: functionCode = QModbusPdu::ReadDiscreteInputs; break;
+    case QModbusDataUnit::InputRegisters: functionCode = QModbusPdu::ReadInputRegisters; break;
+    case QModbusDataUnit::HoldingRegisters: functionCode = QModbusPdu::ReadHoldingRegisters; break;
+    default:
+        setError(tr("Invalid register type for read"), ProtocolError);
+        return nullptr;
+    }
+
+    const QModbusRequest request = PduBuilder(functionCode)
+        .put16(quint16(read.startAddress()))
+        .put16(quint16(read.valueCount()))
+        .toRequest();
+    return enqueue(request, serverAddress, QModbusReply::Common,
+        QModbusDataUnit(read.registerType(), read.startAddress(), quint16(read.valueCount())));
+}
+
+QModbusReply* NativeRtuTransport::sendWriteRequest(const QModbusDataUnit& write, int serverAddress)
+{
+    const int count = int(write.valueCount());
+    if (count < 1) {
+        setError(tr("Empty write request"), ProtocolError);
+        return nullptr;
+    }
+
+    if (write.registerType() == QModbusDataUnit::Coils) {
+        if (count == 1) {
+            const QModbusRequest request = PduBuilder(QModbusPdu::WriteSingleCoil)
+                .put16(quint16(write.startAddress()))
+                .put16(write.value(0) ? 0xFF00 : 0x0000)
+                .toRequest();
+            return enqueue(request, serverAddress, QModbusReply::Common, write);
+        }
+
+        BitBlock bits(count);
+        for (int i = 0; i < count; ++i) {
+            bits.setBit(i, write.value(i) != 0);
+        }
+        PduBuilder pdu(QModbusPdu::WriteMultipleCoils);
+        pdu.put16(quint16(write.startAddress())).put16(quint16(count)).put8(quint8(bits.packedSize())).putBits(bits);
+        if (pdu.overflowed()) {
+            setError(tr("Too many coils for one request"), ProtocolError);
+            return nullptr;
+        }
+        return enqueue(pdu.toRequest(), serverAddress, QModbusReply::Common, write);
+    }
+
+    if (write.registerType() == QModbusDataUnit::HoldingRegisters) {
+        if (count == 1) {
+            const QModbusRequest request = PduBuilder(QModbusPdu::WriteSingleRegister)
+                .put16(quint16(write.startAddress()))
+                .put16(write.value(0))
+                .toRequest();
+            return enqueue(request, serverAddress, QModbusReply::Common, write);
+        }
+
+        const QList<quint16> values = write.values();
+        PduBuilder pdu(QModbusPdu::WriteMultipleRegisters);
+        pdu.put16(quint16(write.startAddress())).put16(quint16(count)).put8(quint8(count * 2))
+            .putWords(values.constData(), count);
+        if (pdu.overflowed()) {
+            setError(tr("Too many registers for one request"), ProtocolError);
+            return nullptr;
+        }
+        return enqueue(pdu.toRequest(), serverAddress, QModbusReply::Common, write);
+    }
+
+    setError(tr("Invalid register type for write"), ProtocolError);
+    return nullptr;
+}
+
+QModbusReply* NativeRtuTransport::sendReadWriteRequest(const QModbusDataUnit& read, const QModbusDataUnit& write,
+    int serverAddress)
+{
+    if (read.registerType() != QModbusDataUnit::HoldingRegisters
+        || write.registerType() != QModbusDataUnit::HoldingRegisters) {
+        setError(tr("Read/write requests only apply to holding registers"), ProtocolError);
+        return nullptr;
+    }
+
+    const QList<quint16> values = write.values();
+    PduBuilder pdu(QModbusPdu::ReadWriteMultipleRegisters);
+    pdu.put16(quint16(read.startAddress())).put16(quint16(read.valueCount()))
+        .put16(quint16(write.startAddress())).put16(quint16(values.size())).put8(quint8(values.size() * 2))
+        .putWords(values.constData(), int(values.size()));
+    if (pdu.overflowed()) {
+        setError(tr("Too many registers for one request"), ProtocolError);
+        return nullptr;
+    }
+    return enqueue(pdu.toRequest(), serverAddress, QModbusReply::Common,
+        QModbusDataUnit(read.registerType(), read.startAddress(), quint16(read.valueCount())));
+}
+
+QModbusReply* NativeRtuTransport::sendRawRequest(const QModbusRequest& request, int serverAddress)
+{
+    return enqueue(request, serverAddress, QModbusReply::Raw, QModbusDataUnit());
+}
+
+bool NativeRtuTransport::submit(int serverAddress, quint8 functionCode, QByteArrayView data,
+    Completion completion, void* context)
+{
+    Transaction* transaction = prepare(serverAddress, functionCode, data);
+    if (!transaction) {
+        return false;
+    }
+    transaction->completion = completion;
+    transaction->context = context;
+    dispatch(transaction);
+    return true;
+}
+
+int NativeRtuTransport::pooledTransactions() const noexcept
+{
+    return m_pool.capacity();
+}
+
+// Takes a record from the pool and frames the request into it
+NativeRtuTransport::Transaction* NativeRtuTransport::prepare(int serverAddress, quint8 functionCode,
+    QByteArrayView data)
+{
+    if (state() != ConnectedState) {
+        setError(tr("Device not connected."), ConnectionError);
+        return nullptr;
+    }
+    if (serverAddress < 0 || serverAddress > 247 || functionCode == 0 || functionCode >= 0x80
+        || data.size() > maxAduSize - 4) {
+        setError(tr("Invalid request"), ProtocolError);
+        return nullptr;
+    }
+
+    Transaction* transaction = m_pool.acquire();
+    transaction->broadcast = serverAddress == 0;
+    transaction->timeoutMs = m_timeout;
+    transaction->retries = m_retries;
+    transaction->turnaroundMs = m_turnaround;
+
+    char* adu = transaction->adu.data();
+    adu[0] = char(serverAddress);
+    adu[1] = char(functionCode);
+    std::memcpy(adu + 2, data.data(), size_t(data.size()));
+    const int size = 2 + int(data.size());
+    const quint16 crc = Crc16::checksum(adu, size);
+    adu[size] = char(crc & 0xFF);
+    adu[size + 1] = char(crc >> 8);
+    transaction->aduSize = size + 2;
+    return transaction;
+}
+
+void NativeRtuTransport::dispatch(Transaction* transaction)
+{
+    {
+        QMutexLocker locker(&m_queueMutex);
+        if (m_queueTail) {
+            m_queueTail->next = transaction;
+        }
+        else {
+            m_queueHead = transaction;
+        }
+        m_queueTail = transaction;
+    }
+    m_queueCondition.wakeOne();
+}
+
+QModbusReply* NativeRtuTransport::enqueue(const QModbusRequest& request, int serverAddress,
+    QModbusReply::ReplyType type, const QModbusDataUnit& unit)
+{
+    Transaction* transaction = prepare(serverAddress, quint8(request.functionCode()), request.data());
+    if (!transaction) {
+        return nullptr;
+    }
+
+    auto reply = new QModbusReply(transaction->broadcast ? QModbusReply::Broadcast : type, serverAddress, this);
+    transaction->reply = reply;
+    transaction->unit = unit;
+    transaction->completion = &NativeRtuTransport::finishReply;
+    transaction->context = this;
+    dispatch(transaction);
+    return reply;
+}
+
+// Completion of the QModbusReply wrappers
+void NativeRtuTransport::finishReply(void* context, const Transaction& transaction)
+{
+    auto* self = static_cast<NativeRtuTransport*>(context);
+    QModbusReply* reply = transaction.reply;
+    if (!reply) {
+        return;
+    }
+
+    if (transaction.error != NoError) {
+        if (transaction.error == TimeoutError) {
+            self->setError(transaction.errorText, TimeoutError);
+        }
+        reply->setError(transaction.error, transaction.errorText);
+        return;
+    }
+    if (reply->type() == QModbusReply::Broadcast) {
+        reply->setFinished(true);
+        return;
+    }
+
+    const QModbusResponse response(QModbusPdu::FunctionCode(transaction.answerFunctionCode()),
+        transaction.answerData().toByteArray());
+    reply->setRawResult(response);
+
+    QModbusDataUnit unit = transaction.unit;
+    if (response.isException()) {
+        reply->setError(ProtocolError, tr("Modbus exception response (code 0x%1)")
+            .arg(int(response.exceptionCode()), 2, 16, QLatin1Char('0')));
+    }
+    else if (reply->type() == QModbusReply::Common && !decodeResult(response, unit)) {
+        reply->setError(ProtocolError, tr("Malformed response"));
+    }
+    else {
+        if (reply->type() == QModbusReply::Common) {
+            reply->setResult(unit);
+        }
+        reply->setFinished(true);
+    }
+}
+
+// Runs on the owning thread, queued by the worker when the completed list
+// stops being empty, and hands every finished record to its completion
+void NativeRtuTransport::deliverCompleted()
+{
+    Transaction* transaction = nullptr;
+    {
+        QMutexLocker locker(&m_queueMutex);
+        transaction = std::exchange(m_completedHead, nullptr);
+        m_completedTail = nullptr;
+    }
+
+    bool linkLost = false;
+    QString linkError;
+    while (transaction) {
+        Transaction* next = transaction->next;
+        if (transaction->linkLost) {
+            linkLost = true;
+            linkError = transaction->errorText;
+        }
+        finish(transaction);
+        transaction = next;
+    }
+
+    if (linkLost && state() == ConnectedState) {
+        setError(linkError, ConnectionError);
+        close();
+    }
+}
+
+void NativeRtuTransport::finish(Transaction* transaction)
+{
+    transaction->next = nullptr;
+    if (transaction->completion) {
+        transaction->completion(transaction->context, *transaction);
+    }
+    m_pool.release(transaction);
+}
+
+void NativeRtuTransport::run()
+{
+    while (true) {
+        Transaction* transaction = nullptr;
+        {
+            QMutexLocker locker(&m_queueMutex);
+            while (!m_queueHead && !m_stopping) {
+                m_queueCondition.wait(&m_queueMutex);
+            }
+            if (m_stopping) {
+                return;
+            }
+            transaction = m_queueHead;
+            m_queueHead = transaction->next;
+            if (!m_queueHead) {
+                m_queueTail = nullptr;
+            }
+            transaction->next = nullptr;
+        }
+
+        transact(*transaction);
+        const bool linkLost = transaction->linkLost;
+
+        bool wasEmpty = false;
+        {
+            QMutexLocker locker(&m_queueMutex);
+            wasEmpty = !m_completedHead;
+            if (m_completedTail) {
+                m_completedTail->next = transaction;
+            }
+            else {
+                m_completedHead = transaction;
+            }
+            m_completedTail = transaction;
+        }
+        if (wasEmpty) {
+            QMetaObject::invokeMethod(this, &NativeRtuTransport::deliverCompleted, Qt::QueuedConnection);
+        }
+        if (linkLost) {
+            return;
+        }
+    }
+}
+
+// Worker thread: one request/answer exchange with retries
+void NativeRtuTransport::transact(Transaction& transaction)
+{
+    transaction.error = ReplyAbortedError;
+
+#ifdef Q_OS_LINUX
+    for (int attempt = 0; attempt <= transaction.retries && !m_stopping; ++attempt) {
+        waitForSilence();
+        ::tcflush(m_fd, TCIFLUSH);     // a late answer to an earlier request must not be taken for this one
+
+        int written = 0;
+        while (written < transaction.aduSize) {
+            const ssize_t n = ::write(m_fd, transaction.adu.data() + written, size_t(transaction.aduSize - written));
+            if (n > 0) {
+                written += int(n);
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+                pollfd fds = { m_fd, POLLOUT, 0 };
+                ::poll(&fds, 1, transaction.timeoutMs);
+                continue;
+            }
+            transaction.error = ConnectionError;
+            transaction.errorText = tr("Write failed: %1").arg(qt_error_string(errno));
+            transaction.linkLost = isLinkError(errno);
+            return;
+        }
+        // Returns once the last stop bit is out, so the answer timeout starts at the right moment
+        ::tcdrain(m_fd);
+        m_lastActivityNs = nowNs();
+
+        if (transaction.broadcast) {
+            const timespec delay = toTimespec(qint64(transaction.turnaroundMs) * 1000000);
+            ::clock_nanosleep(CLOCK_MONOTONIC, 0, &delay, nullptr);
+            m_lastActivityNs = nowNs();
+            transaction.error = NoError;
+            return;
+        }
+
+        QString errorText;
+        const int result = readFrame(transaction, &errorText);
+        if (result < 0) {
+            transaction.error = ConnectionError;
+            transaction.errorText = errorText;
+            transaction.linkLost = true;
+            return;
+        }
+        if (result == 0) {
+            transaction.error = TimeoutError;
+            transaction.errorText = errorText.isEmpty() ? tr("Request timeout.") : errorText;
+            continue;
+        }
+
+        // A corrupted or foreign frame is discarded like a lost one
+        const char* frame = transaction.answer.data();
+        const int size = transaction.answerSize;
+        if (size < 4 || Crc16::checksum(frame, size - 2)
+            != quint16(quint8(frame[size - 2]) | (quint8(frame[size - 1]) << 8))) {
+            transaction.error = TimeoutError;
+            transaction.errorText = tr("Response CRC mismatch");
+            continue;
+        }
+        if (frame[0] != transaction.adu[0] || (quint8(frame[1]) & 0x7F) != quint8(transaction.adu[1])) {
+            transaction.error = TimeoutError;
+            transaction.errorText = tr("Response from unexpected slave or function");
+            continue;
+        }
+
+        transaction.error = NoError;
+        transaction.errorText.clear();
+        return;
+    }
+#endif
+
+    transaction.answerSize = 0;
+    if (transaction.error == ReplyAbortedError) {
+        transaction.errorText = NativeRtuTransport::isSupported() ? tr("Device closed")
+            : tr("The native RTU transport is only available on Linux");
+    }
+}
+
+// Keeps t3.5 of silence between the previous frame on the line and the next request
+bool NativeRtuTransport::waitForSilence()
+{
+#ifdef Q_OS_LINUX
+    const qint64 remaining = m_lastActivityNs + qint64(m_timing.t35Us) * 1000 - nowNs();
+    if (remaining > 0) {
+        const timespec delay = toTimespec(remaining);
+        ::clock_nanosleep(CLOCK_MONOTONIC, 0, &delay, nullptr);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Collects one answer into the transaction: 1 when a frame is complete, 0 on
+// timeout or a broken frame, -1 when the device is gone. The frame ends when
+// its length is known and reached, or after t3.5 of silence for answers whose
+// length is unknown.
+int NativeRtuTransport::readFrame(Transaction& transaction, QString* errorText)
+{
+    transaction.answerSize = 0;
+
+#ifdef Q_OS_LINUX
+    char* frame = transaction.answer.data();
+    int& size = transaction.answerSize;
+    const qint64 deadline = nowNs() + qint64(transaction.timeoutMs) * 1000000;
+    const qint64 charNs = qint64(m_timing.charTimeUs) * 1000;
+    qint64 lastByte = 0;
+    bool broken = false;
+    char discard[maxAduSize];
+
+    while (true) {
+        const qint64 now = nowNs();
+        const qint64 wait = size == 0 ? deadline - now : lastByte + qint64(m_timing.t35Us) * 1000 - now;
+        if (wait <= 0) {
+            if (size == 0 || broken) {
+                if (broken) *errorText = tr("Inter-character gap exceeded t1.5");
+                return 0;
+            }
+            return 1;
+        }
+
+        pollfd fds = { m_fd, POLLIN, 0 };
+        const timespec timeout = toTimespec(wait);
+        const int ready = ::ppoll(&fds, 1, &timeout, nullptr);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            *errorText = tr("Poll failed: %1").arg(qt_error_string(errno));
+            return -1;
+        }
+        if (ready == 0) {
+            continue;
+        }
+        if (fds.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            *errorText = tr("Serial device disconnected");
+            return -1;
+        }
+
+        // Bytes beyond the longest frame are drained and dropped
+        const bool full = size >= maxAduSize;
+        const ssize_t n = full ? ::read(m_fd, discard, sizeof(discard))
+            : ::read(m_fd, frame + size, size_t(maxAduSize - size));
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            *errorText = tr("Read failed: %1").arg(qt_error_string(errno));
+            return isLinkError(errno) ? -1 : 0;
+        }
+        // poll() reported data, so nothing to read means the other end is gone
+        if (n == 0) {
+            *errorText = tr("Serial device closed");
+            return -1;
+        }
+
+        // The first byte of a chunk arrived n - 1 character times before the chunk
+        const qint64 arrival = nowNs();
+        if (m_strictTiming && size > 0
+            && arrival - (n - 1) * charNs - lastByte > qint64(m_timing.t15Us) * 1000 + charNs) {
+            broken = true;
+        }
+        if (full) {
+            broken = true;
+        }
+        else {
+            size += int(n);
+        }
+        lastByte = arrival;
+        m_lastActivityNs = arrival;
+
+        const int expected = expectedAduSize(frame, size);
+        if (!broken && expected > 0 && size >= expected) {
+            size = expected;
+            return 1;
+        }
+    }
+#else
+    Q_UNUSED(errorText)
+    return -1;
+#endif
+}
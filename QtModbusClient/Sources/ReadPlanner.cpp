@@ -0,0 +1,110 @@
+#include "ReadPlanner.h"
+#include <QDebug>
+#include <algorithm>
+#include <tuple>
+
+namespace {
+    struct GroupKey
+    {
+        QString pollClass;
+        int slaveID;
+        int type;
+
+        bool operator<(const GroupKey& other) const
+        {
+            return std::tie(pollClass, slaveID, type) < std::tie(other.pollClass, other.slaveID, other.type);
+        }
+    };
+
+    // Whether [from, to) touches any hole of the given slave and register type
+    bool crossesHole(const QList<AddressHole>& holes, int slaveID,
+        ModbusConnection::RegisterType type, int from, int to)
+    {
+        for (const AddressHole& hole : holes) {
+            if (hole.slaveID == slaveID && hole.type == type
+                && from < hole.start + hole.count && hole.start < to) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+ReadPlan ReadPlanner::compile(const TagDatabase& database, const PlannerLimits& limits)
+{
+    const QList<Tag>& tags = database.tags();
+    const QList<AddressHole>& holes = database.holes();
+
+    ReadPlan plan;
+    plan.locations.resize(tags.size());
+
+    QMap<GroupKey, QVector<int>> groups;
+    for (int i = 0; i < tags.size(); ++i) {
+        const Tag& tag = tags[i];
+        groups[GroupKey{ tag.pollClass, tag.slaveID, int(tag.type) }].append(i);
+    }
+
+    for (auto it = groups.begin(); it != groups.end(); ++it) {
+        QVector<int>& members = it.value();
+        std::sort(members.begin(), members.end(), [&tags](int a, int b) {
+            return tags[a].address < tags[b].address;
+            });
+
+        const auto type = static_cast<ModbusConnection::RegisterType>(it.key().type);
+        const bool bitType = type == ModbusConnection::Coils || type == ModbusConnection::DiscreteInputs;
+        const int maxCount = bitType ? limits.maxBits : limits.maxRegisters;
+
+        int blockIndex = -1;
+        int blockEnd = 0;
+
+        for (const int tagIndex : members) {
+            const Tag& tag = tags[tagIndex];
+            const int tagEnd = tag.address + tag.width();
+
+            if (tag.width() > maxCount || tagEnd > 65536) {
+                qWarning() << "Tag" << tag.name << "exceeds the per-request limit, skipped";
+                continue;
+            }
+
+            bool fits = false;
+            if (blockIndex >= 0) {
+                const ReadBlock& block = plan.blocks[blockIndex];
+                if (tagEnd <= blockEnd) {
+                    fits = true;
+                }
+                else {
+                    const int gap = tag.address - blockEnd;
+                    fits = tagEnd - block.start <= maxCount
+                        && (limits.maxGap < 0 || gap <= limits.maxGap)
+                        && !crossesHole(holes, it.key().slaveID, type, blockEnd, tagEnd);
+                }
+            }
+
+            if (!fits) {
+                if (crossesHole(holes, it.key().slaveID, type, tag.address, tagEnd)) {
+                    qWarning() << "Tag" << tag.name << "lies inside a known unreadable range";
+                }
+
+                ReadBlock block;
+                block.pollClass = it.key().pollClass;
+                block.slaveID = it.key().slaveID;
+                block.type = type;
+                block.start = tag.address;
+                blockIndex = plan.blocks.size();
+                blockEnd = tag.address;
+                plan.blocks.append(block);
+                plan.tagsByBlock.append(QVector<int>());
+                plan.blocksByClass[block.pollClass].append(blockIndex);
+            }
+
+            blockEnd = qMax(blockEnd, tagEnd);
+            plan.blocks[blockIndex].count = blockEnd - plan.blocks[blockIndex].start;
+            plan.locations[tagIndex] = TagLocation{ blockIndex, tag.address - plan.blocks[blockIndex].start };
+            plan.tagsByBlock[blockIndex].append(tagIndex);
+        }
+    }
+
+    qDebug() << "Read plan compiled:" << tags.size() << "tags into"
+        << plan.blocks.size() << "transactions across" << plan.blocksByClass.size() << "poll classes";
+    return plan;
+}
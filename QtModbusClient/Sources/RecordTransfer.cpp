@@ -0,0 +1,312 @@
+#include "RecordTransfer.h"
+#include <QModbusReply>
+#include <QtEndian>
+#include <QDebug>
+
+RecordTransfer::RecordTransfer(QObject* parent)
+    : QObject(parent)
+{
+}
+
+void RecordTransfer::setModbusConnection(ModbusConnection* connection)
+{
+    cancel();
+    m_modbusConnection = connection;
+}
+
+void RecordTransfer::setPipelineDepth(int depth)
+{
+    m_pipelineDepth = qBound(1, depth, 16);
+}
+
+bool RecordTransfer::isRunning() const noexcept
+{
+    return m_running;
+}
+
+RecordTransfer::Mode RecordTransfer::mode() const noexcept
+{
+    return m_mode;
+}
+
+int RecordTransfer::registersTransferred() const noexcept
+{
+    return m_transferred;
+}
+
+bool RecordTransfer::startRead(int slaveID, int fileNumber, int firstRecord, int recordCount, QIODevice* sink)
+{
+    if (fileNumber < 1 || fileNumber > 0xFFFF || firstRecord < 0 || recordCount < 1
+        || firstRecord + recordCount - 1 > MaxRecordNumber) {
+        qWarning() << "Invalid file record range:" << fileNumber << firstRecord << recordCount;
+        return false;
+    }
+    if (!begin(ReadFile, slaveID)) {
+        return false;
+    }
+
+    m_fileNumber = fileNumber;
+    m_sink = sink;
+    for (int offset = 0; offset < recordCount; offset += MaxReadRecords) {
+        Chunk chunk;
+        chunk.record = firstRecord + offset;
+        chunk.offset = offset;
+        chunk.count = qMin(MaxReadRecords, recordCount - offset);
+        m_chunks.append(chunk);
+    }
+
+    qDebug() << "File record read started - file" << fileNumber << "records" << firstRecord
+        << "to" << firstRecord + recordCount - 1 << "in" << m_chunks.size() << "requests";
+    pump();
+    return true;
+}
+
+bool RecordTransfer::startWrite(int slaveID, int fileNumber, int firstRecord, const QVector<quint16>& values)
+{
+    const int recordCount = int(values.size());
+    if (fileNumber < 1 || fileNumber > 0xFFFF || firstRecord < 0 || recordCount < 1
+        || firstRecord + recordCount - 1 > MaxRecordNumber) {
+        qWarning() << "Invalid file record range:" << fileNumber << firstRecord << recordCount;
+        return false;
+    }
+    if (!begin(WriteFile, slaveID)) {
+        return false;
+    }
+
+    m_fileNumber = fileNumber;
+    m_writeValues = values;
+    for (int offset = 0; offset < recordCount; offset += MaxWriteRecords) {
+        Chunk chunk;
+        chunk.record = firstRecord + offset;
+        chunk.offset = offset;
+        chunk.count = qMin(MaxWriteRecords, recordCount - offset);
+        m_chunks.append(chunk);
+    }
+
+    qDebug() << "File record write started - file" << fileNumber << "records" << firstRecord
+        << "to" << firstRecord + recordCount - 1 << "in" << m_chunks.size() << "requests";
+    pump();
+    return true;
+}
+
+bool RecordTransfer::startFifoDrain(int slaveID, int fifoAddress, QIODevice* sink, int maxReads)
+{
+    if (fifoAddress < 0 || fifoAddress > 0xFFFF || !begin(DrainFifo, slaveID)) {
+        return false;
+    }
+
+    m_fifoAddress = fifoAddress;
+    m_maxReads = qMax(0, maxReads);
+    m_sink = sink;
+
+    qDebug() << "FIFO drain started - address" << fifoAddress << "slave" << slaveID;
+    pump();
+    return true;
+}
+
+void RecordTransfer::cancel()
+{
+    ++m_generation;
+    m_inFlight = 0;
+    m_running = false;
+}
+
+bool RecordTransfer::begin(Mode mode, int slaveID)
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        qWarning() << "Record transfer - not connected";
+        return false;
+    }
+
+    cancel();
+    m_mode = mode;
+    m_slaveID = slaveID;
+    m_running = true;
+    m_chunks.clear();
+    m_writeValues.clear();
+    m_outOfOrder.clear();
+    m_nextChunk = 0;
+    m_nextDelivery = 0;
+    m_fifoReads = 0;
+    m_transferred = 0;
+    return true;
+}
+
+// Keeps up to pipelineDepth sub-requests queued on the client. FIFO reads are
+// sent one at a time since each answer decides whether another one is needed.
+void RecordTransfer::pump()
+{
+    if (!m_running) {
+        return;
+    }
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        fail(tr("Not connected to any device"));
+        return;
+    }
+
+    const quint64 generation = m_generation;
+
+    if (m_mode == DrainFifo) {
+        QModbusReply* reply = m_modbusConnection->readFifoQueue(m_fifoAddress, m_slaveID);
+        if (!reply) {
+            fail(tr("Failed to send FIFO read at address %1").arg(m_fifoAddress));
+            return;
+        }
+        ++m_inFlight;
+        if (reply->isFinished()) {
+            handleFifoReply(generation, reply);
+            return;
+        }
+        connect(reply, &QModbusReply::finished, this, [this, generation, reply]() {
+            handleFifoReply(generation, reply);
+            });
+        return;
+    }
+
+    while (m_running && m_nextChunk < m_chunks.size() && m_inFlight < m_pipelineDepth) {
+        const int index = m_nextChunk++;
+        Chunk& chunk = m_chunks[index];
+
+        QModbusReply* reply = m_mode == ReadFile
+            ? m_modbusConnection->readFileRecord(m_fileNumber, chunk.record, quint16(chunk.count), m_slaveID)
+            : m_modbusConnection->writeFileRecord(m_fileNumber, chunk.record,
+                m_writeValues.mid(chunk.offset, chunk.count), m_slaveID);
+        if (!reply) {
+            fail(tr("Failed to send request for record %1").arg(chunk.record));
+            return;
+        }
+
+        chunk.inFlight = true;
+        ++m_inFlight;
+        if (reply->isFinished()) {
+            // The handler refills the pipeline itself
+            handleReply(generation, index, reply);
+            return;
+        }
+        connect(reply, &QModbusReply::finished, this, [this, generation, index, reply]() {
+            handleReply(generation, index, reply);
+            });
+    }
+}
+
+void RecordTransfer::handleReply(quint64 generation, int chunkIndex, QModbusReply* reply)
+{
+    reply->deleteLater();
+    if (generation != m_generation) {
+        return;
+    }
+
+    Chunk& chunk = m_chunks[chunkIndex];
+    chunk.inFlight = false;
+    --m_inFlight;
+
+    if (reply->error() != QModbusDevice::NoError) {
+        fail(tr("File %1 record %2 failed: %3").arg(m_fileNumber).arg(chunk.record).arg(reply->errorString()));
+        return;
+    }
+
+    if (m_mode == ReadFile) {
+        const QVector<quint16> values = ModbusConnection::fileRecordFromReply(reply);
+        if (values.size() != chunk.count) {
+            fail(tr("File %1 record %2: unexpected response length").arg(m_fileNumber).arg(chunk.record));
+            return;
+        }
+
+        // Serial replies complete in order, but a held or retried request may not
+        m_outOfOrder.insert(chunkIndex, values);
+        while (m_outOfOrder.contains(m_nextDelivery)) {
+            deliver(m_chunks[m_nextDelivery].offset, m_outOfOrder.take(m_nextDelivery));
+            ++m_nextDelivery;
+        }
+        if (!m_running) {
+            return;
+        }
+    }
+    else {
+        m_transferred += chunk.count;
+        ++m_nextDelivery;
+    }
+
+    emit progress(m_nextDelivery, m_chunks.size());
+
+    if (m_nextDelivery == m_chunks.size()) {
+        finish();
+    }
+    else {
+        pump();
+    }
+}
+
+void RecordTransfer::handleFifoReply(quint64 generation, QModbusReply* reply)
+{
+    reply->deleteLater();
+    if (generation != m_generation) {
+        return;
+    }
+    --m_inFlight;
+
+    if (reply->error() != QModbusDevice::NoError) {
+        fail(tr("FIFO read at address %1 failed: %2").arg(m_fifoAddress).arg(reply->errorString()));
+        return;
+    }
+
+    bool ok = false;
+    const QVector<quint16> values = ModbusConnection::fifoFromReply(reply, &ok);
+    if (!ok) {
+        fail(tr("FIFO read at address %1: malformed response").arg(m_fifoAddress));
+        return;
+    }
+
+    ++m_fifoReads;
+    if (!values.isEmpty()) {
+        deliver(m_transferred, values);
+        if (!m_running) {
+            return;
+        }
+    }
+    emit progress(m_fifoReads, m_maxReads);
+
+    if (values.isEmpty() || (m_maxReads > 0 && m_fifoReads >= m_maxReads)) {
+        finish();
+    }
+    else {
+        pump();
+    }
+}
+
+void RecordTransfer::deliver(int offset, const QVector<quint16>& values)
+{
+    if (m_sink) {
+        QByteArray bytes(values.size() * 2, Qt::Uninitialized);
+        for (int i = 0; i < values.size(); ++i) {
+            qToBigEndian(values[i], bytes.data() + i * 2);
+        }
+        if (m_sink->write(bytes) != bytes.size()) {
+            fail(tr("Failed to write to output: %1").arg(m_sink->errorString()));
+            return;
+        }
+    }
+
+    m_transferred += int(values.size());
+    emit dataReceived(offset, values);
+}
+
+void RecordTransfer::fail(const QString& errorMessage)
+{
+    if (!m_running) {
+        return;
+    }
+    qDebug() << "Record transfer" << errorMessage;
+    cancel();
+    emit failed(errorMessage);
+}
+
+void RecordTransfer::finish()
+{
+    if (!m_running) {
+        return;
+    }
+    qDebug() << "Record transfer finished -" << m_transferred << "registers";
+    cancel();
+    emit finished(m_transferred);
+}
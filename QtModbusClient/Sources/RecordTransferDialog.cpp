@@ -0,0 +1,224 @@
+#include "RecordTransferDialog.h"
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QDateTime>
+#include <QtEndian>
+
+namespace {
+    // Only the head of a transfer is shown, the file holds the rest
+    constexpr int PreviewLimit = 512;
+}
+
+RecordTransferDialog::RecordTransferDialog(QWidget* parent)
+    : QDialog(parent)
+    , m_transfer(new RecordTransfer(this))
+{
+    ui.setupUi(this);
+    initUI();
+    setupConnections();
+}
+
+RecordTransferDialog::~RecordTransferDialog()
+{
+    m_transfer->cancel();
+    closeOutput();
+}
+
+void RecordTransferDialog::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+    m_transfer->setModbusConnection(connection);
+    if (m_modbusConnection) {
+        ui.transferSlaveSpinBox->setValue(m_modbusConnection->getSlaveID());
+    }
+}
+
+void RecordTransferDialog::initUI()
+{
+    ui.transferModeComboBox->addItem(tr("Read File Records (FC20)"), RecordTransfer::ReadFile);
+    ui.transferModeComboBox->addItem(tr("Write File Records (FC21)"), RecordTransfer::WriteFile);
+    ui.transferModeComboBox->addItem(tr("Drain FIFO Queue (FC24)"), RecordTransfer::DrainFifo);
+
+    ui.transferSlaveSpinBox->setRange(1, 247);
+    ui.transferFileSpinBox->setRange(1, 65535);
+    ui.transferRecordSpinBox->setRange(0, RecordTransfer::MaxRecordNumber);
+    ui.transferCountSpinBox->setRange(1, RecordTransfer::MaxRecordNumber + 1);
+    ui.transferCountSpinBox->setValue(RecordTransfer::MaxReadRecords);
+    ui.transferFifoSpinBox->setRange(0, 65535);
+    ui.transferMaxReadsSpinBox->setRange(0, 100000);
+    ui.transferMaxReadsSpinBox->setSpecialValueText(tr("Until empty"));
+    ui.transferPathLineEdit->setPlaceholderText(tr("Optional for reads, binary big-endian words"));
+
+    setRunning(false);
+    onModeChanged();
+}
+
+void RecordTransferDialog::setupConnections()
+{
+    connect(ui.transferModeComboBox, &QComboBox::currentIndexChanged, this, &RecordTransferDialog::onModeChanged);
+    connect(ui.transferBrowseBtn, &QPushButton::clicked, this, &RecordTransferDialog::onBrowse);
+    connect(ui.transferStartBtn, &QPushButton::clicked, this, &RecordTransferDialog::onStart);
+    connect(ui.transferStopBtn, &QPushButton::clicked, this, &RecordTransferDialog::onStop);
+    connect(ui.transferCloseBtn, &QPushButton::clicked, this, &QDialog::reject);
+
+    connect(m_transfer, &RecordTransfer::progress, this, &RecordTransferDialog::handleProgress);
+    connect(m_transfer, &RecordTransfer::dataReceived, this, &RecordTransferDialog::handleData);
+    connect(m_transfer, &RecordTransfer::finished, this, &RecordTransferDialog::handleFinished);
+    connect(m_transfer, &RecordTransfer::failed, this, &RecordTransferDialog::handleFailed);
+}
+
+void RecordTransferDialog::onModeChanged()
+{
+    const auto mode = static_cast<RecordTransfer::Mode>(ui.transferModeComboBox->currentData().toInt());
+    const bool fileMode = mode != RecordTransfer::DrainFifo;
+
+    ui.transferFileSpinBox->setEnabled(fileMode);
+    ui.transferRecordSpinBox->setEnabled(fileMode);
+    // A write takes its length from the source file
+    ui.transferCountSpinBox->setEnabled(mode == RecordTransfer::ReadFile);
+    ui.transferFifoSpinBox->setEnabled(!fileMode);
+    ui.transferMaxReadsSpinBox->setEnabled(!fileMode);
+}
+
+void RecordTransferDialog::onBrowse()
+{
+    const bool writing = ui.transferModeComboBox->currentData().toInt() == RecordTransfer::WriteFile;
+    const QString filter = tr("Binary files (*.bin);;All files (*)");
+    const QString fileName = writing
+        ? QFileDialog::getOpenFileName(this, tr("Open Record Data"), QString(), filter)
+        : QFileDialog::getSaveFileName(this, tr("Save Record Data"), QString(), filter);
+    if (!fileName.isEmpty()) {
+        ui.transferPathLineEdit->setText(fileName);
+    }
+}
+
+void RecordTransferDialog::onStart()
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    const auto mode = static_cast<RecordTransfer::Mode>(ui.transferModeComboBox->currentData().toInt());
+    const QString path = ui.transferPathLineEdit->text().trimmed();
+    const int slaveID = ui.transferSlaveSpinBox->value();
+    const int fileNumber = ui.transferFileSpinBox->value();
+    const int firstRecord = ui.transferRecordSpinBox->value();
+
+    closeOutput();
+    ui.transferPreviewTextEdit->clear();
+    ui.transferProgressBar->setValue(0);
+
+    bool started = false;
+    if (mode == RecordTransfer::WriteFile) {
+        QFile input(path);
+        if (path.isEmpty() || !input.open(QIODevice::ReadOnly)) {
+            QMessageBox::warning(this, tr("Error"), tr("Cannot open data file: %1").arg(path));
+            return;
+        }
+        const QByteArray bytes = input.readAll();
+        if (bytes.isEmpty() || bytes.size() % 2) {
+            QMessageBox::warning(this, tr("Error"), tr("The data file must hold a whole number of 16-bit words"));
+            return;
+        }
+
+        QVector<quint16> values(bytes.size() / 2);
+        for (int i = 0; i < values.size(); ++i) {
+            values[i] = qFromBigEndian<quint16>(bytes.constData() + i * 2);
+        }
+        started = m_transfer->startWrite(slaveID, fileNumber, firstRecord, values);
+        if (!started) {
+            QMessageBox::warning(this, tr("Error"), tr("%1 records from record %2 exceed the last record number %3")
+                .arg(values.size()).arg(firstRecord).arg(RecordTransfer::MaxRecordNumber));
+            return;
+        }
+    }
+    else {
+        if (!path.isEmpty()) {
+            m_output.setFileName(path);
+            if (!m_output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                QMessageBox::warning(this, tr("Error"), tr("Cannot create data file: %1").arg(m_output.errorString()));
+                return;
+            }
+        }
+        QIODevice* sink = m_output.isOpen() ? &m_output : nullptr;
+
+        started = mode == RecordTransfer::ReadFile
+            ? m_transfer->startRead(slaveID, fileNumber, firstRecord, ui.transferCountSpinBox->value(), sink)
+            : m_transfer->startFifoDrain(slaveID, ui.transferFifoSpinBox->value(), sink,
+                ui.transferMaxReadsSpinBox->value());
+        if (!started) {
+            closeOutput();
+            QMessageBox::warning(this, tr("Error"), tr("Invalid record range"));
+            return;
+        }
+    }
+
+    m_startTime = QDateTime::currentMSecsSinceEpoch();
+    ui.transferStatusLabel->setText(tr("Transferring..."));
+    setRunning(true);
+}
+
+void RecordTransferDialog::onStop()
+{
+    m_transfer->cancel();
+    closeOutput();
+    ui.transferStatusLabel->setText(tr("Stopped after %1 registers").arg(m_transfer->registersTransferred()));
+    setRunning(false);
+}
+
+void RecordTransferDialog::handleProgress(int done, int total)
+{
+    // A FIFO drain has no known end, keep the bar busy instead
+    ui.transferProgressBar->setRange(0, total > 0 ? total : 0);
+    ui.transferProgressBar->setValue(done);
+}
+
+void RecordTransferDialog::handleData(int offset, const QVector<quint16>& values)
+{
+    if (offset >= PreviewLimit) {
+        return;
+    }
+
+    QStringList words;
+    for (int i = 0; i < values.size() && offset + i < PreviewLimit; ++i) {
+        words << QStringLiteral("%1").arg(values[i], 4, 16, QLatin1Char('0')).toUpper();
+    }
+    for (int i = 0; i < words.size(); i += 8) {
+        ui.transferPreviewTextEdit->appendPlainText(QStringLiteral("%1: %2")
+            .arg(offset + i, 5).arg(words.mid(i, 8).join(' ')));
+    }
+}
+
+void RecordTransferDialog::handleFinished(int registers)
+{
+    closeOutput();
+    const qint64 elapsed = qMax<qint64>(1, QDateTime::currentMSecsSinceEpoch() - m_startTime);
+    ui.transferProgressBar->setRange(0, 1);
+    ui.transferProgressBar->setValue(1);
+    ui.transferStatusLabel->setText(tr("Done: %1 registers in %2 ms (%3 bytes/s)")
+        .arg(registers).arg(elapsed).arg(registers * 2 * 1000 / elapsed));
+    setRunning(false);
+}
+
+void RecordTransferDialog::handleFailed(const QString& errorMessage)
+{
+    closeOutput();
+    ui.transferStatusLabel->setText(tr("Failed after %1 registers").arg(m_transfer->registersTransferred()));
+    setRunning(false);
+    QMessageBox::critical(this, tr("Error"), errorMessage);
+}
+
+void RecordTransferDialog::setRunning(bool running)
+{
+    ui.transferStartBtn->setEnabled(!running);
+    ui.transferStopBtn->setEnabled(running);
+    ui.transferModeComboBox->setEnabled(!running);
+}
+
+void RecordTransferDialog::closeOutput()
+{
+    if (m_output.isOpen()) {
+        m_output.close();
+    }
+}
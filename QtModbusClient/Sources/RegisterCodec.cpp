@@ -0,0 +1,337 @@
+#include "RegisterCodec.h"
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REGISTERCODEC_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define REGISTERCODEC_NEON
+#endif
+
+namespace {
+    bool hasSwappedBytes(RegisterCodec::ByteOrder order)
+    {
+        return order == RegisterCodec::ByteOrder::BADC || order == RegisterCodec::ByteOrder::DCBA;
+    }
+
+    // Whether the register sequence has to be reversed to match host memory layout
+    bool needsWordReversal(RegisterCodec::ByteOrder order)
+    {
+        const bool littleEndianWords =
+            order == RegisterCodec::ByteOrder::CDAB || order == RegisterCodec::ByteOrder::DCBA;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        return !littleEndianWords;
+#else
+        return littleEndianWords;
+#endif
+    }
+
+    inline quint16 swap16(quint16 v)
+    {
+        return static_cast<quint16>((v << 8) | (v >> 8));
+    }
+
+    template<typename T>
+    QString formatNumber(T value)
+    {
+        return QString::number(value);
+    }
+
+    template<>
+    QString formatNumber<float>(float value)
+    {
+        return QString::number(value, 'g', 7);
+    }
+
+    template<>
+    QString formatNumber<double>(double value)
+    {
+        return QString::number(value, 'g', 15);
+    }
+
+    template<typename T>
+    QStringList formatTyped(const QVector<quint16>& registers, RegisterCodec::DataType type,
+        RegisterCodec::ByteOrder order)
+    {
+        const int width = RegisterCodec::registerWidth(type);
+        const qsizetype valueCount = registers.size() / width;
+
+        QVector<T> decoded(valueCount);
+        RegisterCodec::decodeArray(registers.constData(), valueCount, type, order, decoded.data());
+
+        QStringList result;
+        result.reserve(registers.size());
+        for (qsizetype i = 0; i < valueCount; ++i) {
+            result << formatNumber(decoded[i]);
+            for (int w = 1; w < width; ++w) {
+                result << QString();
+            }
+        }
+        while (result.size() < registers.size()) {
+            result << QString();
+        }
+        return result;
+    }
+}
+
+namespace RegisterCodec
+{
+    int registerWidth(DataType type, int length) noexcept
+    {
+        switch (type) {
+        case DataType::UInt16:
+        case DataType::Int16:
+            return 1;
+        case DataType::UInt32:
+        case DataType::Int32:
+        case DataType::Float32:
+            return 2;
+        case DataType::UInt64:
+        case DataType::Int64:
+        case DataType::Float64:
+            return 4;
+        case DataType::Ascii:
+            return qMax(1, length);
+        }
+        return 1;
+    }
+
+    QString typeName(DataType type)
+    {
+        switch (type) {
+        case DataType::UInt16: return QStringLiteral("uint16");
+        case DataType::Int16: return QStringLiteral("int16");
+        case DataType::UInt32: return QStringLiteral("uint32");
+        case DataType::Int32: return QStringLiteral("int32");
+        case DataType::Float32: return QStringLiteral("float32");
+        case DataType::UInt64: return QStringLiteral("uint64");
+        case DataType::Int64: return QStringLiteral("int64");
+        case DataType::Float64: return QStringLiteral("double");
+        case DataType::Ascii: return QStringLiteral("ascii");
+        }
+        return QString();
+    }
+
+    QString orderName(ByteOrder order)
+    {
+        switch (order) {
+        case ByteOrder::ABCD: return QStringLiteral("ABCD");
+        case ByteOrder::BADC: return QStringLiteral("BADC");
+        case ByteOrder::CDAB: return QStringLiteral("CDAB");
+        case ByteOrder::DCBA: return QStringLiteral("DCBA");
+        }
+        return QString();
+    }
+
+    QList<DataType> allTypes()
+    {
+        return { DataType::UInt16, DataType::Int16, DataType::UInt32, DataType::Int32,
+            DataType::Float32, DataType::UInt64, DataType::Int64, DataType::Float64, DataType::Ascii };
+    }
+
+    QList<ByteOrder> allOrders()
+    {
+        return { ByteOrder::ABCD, ByteOrder::BADC, ByteOrder::CDAB, ByteOrder::DCBA };
+    }
+
+    // Swaps the two bytes of every register, eight registers per vector step
+    void swapBytes(quint16* data, qsizetype count) noexcept
+    {
+        qsizetype i = 0;
+#if defined(REGISTERCODEC_SSE2)
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), v);
+        }
+#elif defined(REGISTERCODEC_NEON)
+        for (; i + 8 <= count; i += 8) {
+            uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+            vst1q_u8(reinterpret_cast<uint8_t*>(data + i), vrev16q_u8(v));
+        }
+#endif
+        for (; i < count; ++i) {
+            data[i] = swap16(data[i]);
+        }
+    }
+
+    // Reverses register order inside every group of width registers (2 or 4)
+    void reverseWords(quint16* data, qsizetype count, int width) noexcept
+    {
+        if (width != 2 && width != 4) {
+            return;
+        }
+
+        qsizetype i = 0;
+#if defined(REGISTERCODEC_SSE2)
+        for (; i + 8 <= count; i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            if (width == 2) {
+                v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+                v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            }
+            else {
+                v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+                v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), v);
+        }
+#elif defined(REGISTERCODEC_NEON)
+        for (; i + 8 <= count; i += 8) {
+            uint16x8_t v = vld1q_u16(data + i);
+            v = (width == 2) ? vrev32q_u16(v) : vrev64q_u16(v);
+            vst1q_u16(data + i, v);
+        }
+#endif
+        for (; i + width <= count; i += width) {
+            std::reverse(data + i, data + i + width);
+        }
+    }
+
+    void convertOrder(quint16* data, qsizetype count, int width, ByteOrder order) noexcept
+    {
+        if (hasSwappedBytes(order)) {
+            swapBytes(data, count);
+        }
+        if (width > 1 && needsWordReversal(order)) {
+            reverseWords(data, count, width);
+        }
+    }
+
+    void decodeArray(const quint16* registers, qsizetype valueCount,
+        DataType type, ByteOrder order, void* out) noexcept
+    {
+        if (type == DataType::Ascii || valueCount <= 0) {
+            return;
+        }
+
+        const int width = registerWidth(type);
+        const qsizetype count = valueCount * width;
+        quint16* words = static_cast<quint16*>(out);
+        std::memcpy(words, registers, size_t(count) * sizeof(quint16));
+        convertOrder(words, count, width, order);
+    }
+
+    void encodeArray(const void* in, qsizetype valueCount,
+        DataType type, ByteOrder order, quint16* registers) noexcept
+    {
+        if (type == DataType::Ascii || valueCount <= 0) {
+            return;
+        }
+
+        const int width = registerWidth(type);
+        const qsizetype count = valueCount * width;
+        std::memcpy(registers, in, size_t(count) * sizeof(quint16));
+        convertOrder(registers, count, width, order);
+    }
+
+    QVariant decode(const quint16* registers, qsizetype registerCount, const FieldDescriptor& field)
+    {
+        const int width = registerWidth(field.type, field.length);
+        if (field.offset < 0 || field.offset + width > registerCount) {
+            return QVariant();
+        }
+
+        const quint16* src = registers + field.offset;
+
+        if (field.type == DataType::Ascii) {
+            QByteArray text;
+            text.reserve(width * 2);
+            const bool swapped = hasSwappedBytes(field.order);
+            for (int i = 0; i < width; ++i) {
+                const quint16 reg = swapped ? swap16(src[i]) : src[i];
+                text.append(char(reg >> 8));
+                text.append(char(reg & 0xFF));
+            }
+            const qsizetype end = text.indexOf('\0');
+            if (end >= 0) {
+                text.truncate(end);
+            }
+            return QString::fromLatin1(text);
+        }
+
+        quint16 raw[4];
+        decodeArray(src, 1, field.type, field.order, raw);
+
+        switch (field.type) {
+        case DataType::UInt16: { quint16 v; std::memcpy(&v, raw, sizeof v); return QVariant::fromValue(v); }
+        case DataType::Int16: { qint16 v; std::memcpy(&v, raw, sizeof v); return QVariant::fromValue(v); }
+        case DataType::UInt32: { quint32 v; std::memcpy(&v, raw, sizeof v); return QVariant::fromValue(v); }
+        case DataType::Int32: { qint32 v; std::memcpy(&v, raw, sizeof v); return QVariant::fromValue(v); }
+        case DataType::Float32: { float v; std::memcpy(&v, raw, sizeof v); return QVariant::fromValue(v); }
+        case DataType::UInt64: { quint64 v; std::memcpy(&v, raw, sizeof v); return QVariant::fromValue(v); }
+        case DataType::Int64: { qint64 v; std::memcpy(&v, raw, sizeof v); return QVariant::fromValue(v); }
+        case DataType::Float64: { double v; std::memcpy(&v, raw, sizeof v); return QVariant::fromValue(v); }
+        case DataType::Ascii: break;
+        }
+        return QVariant();
+    }
+
+    QVector<quint16> encode(const QVariant& value, const FieldDescriptor& field)
+    {
+        const int width = registerWidth(field.type, field.length);
+        QVector<quint16> registers(width, 0);
+
+        if (field.type == DataType::Ascii) {
+            const QByteArray text = value.toString().toLatin1();
+            const bool swapped = hasSwappedBytes(field.order);
+            for (int i = 0; i < width; ++i) {
+                const quint8 hi = (2 * i < text.size()) ? quint8(text[2 * i]) : 0;
+                const quint8 lo = (2 * i + 1 < text.size()) ? quint8(text[2 * i + 1]) : 0;
+                const quint16 reg = quint16((hi << 8) | lo);
+                registers[i] = swapped ? swap16(reg) : reg;
+            }
+            return registers;
+        }
+
+        quint16 raw[4] = {};
+        switch (field.type) {
+        case DataType::UInt16: { const quint16 v = quint16(value.toUInt()); std::memcpy(raw, &v, sizeof v); break; }
+        case DataType::Int16: { const qint16 v = qint16(value.toInt()); std::memcpy(raw, &v, sizeof v); break; }
+        case DataType::UInt32: { const quint32 v = value.toUInt(); std::memcpy(raw, &v, sizeof v); break; }
+        case DataType::Int32: { const qint32 v = value.toInt(); std::memcpy(raw, &v, sizeof v); break; }
+        case DataType::Float32: { const float v = value.toFloat(); std::memcpy(raw, &v, sizeof v); break; }
+        case DataType::UInt64: { const quint64 v = value.toULongLong(); std::memcpy(raw, &v, sizeof v); break; }
+        case DataType::Int64: { const qint64 v = value.toLongLong(); std::memcpy(raw, &v, sizeof v); break; }
+        case DataType::Float64: { const double v = value.toDouble(); std::memcpy(raw, &v, sizeof v); break; }
+        case DataType::Ascii: break;
+        }
+
+        encodeArray(raw, 1, field.type, field.order, registers.data());
+        return registers;
+    }
+
+    QStringList formatBuffer(const QVector<quint16>& registers, DataType type, ByteOrder order)
+    {
+        switch (type) {
+        case DataType::UInt16: return formatTyped<quint16>(registers, type, order);
+        case DataType::Int16: return formatTyped<qint16>(registers, type, order);
+        case DataType::UInt32: return formatTyped<quint32>(registers, type, order);
+        case DataType::Int32: return formatTyped<qint32>(registers, type, order);
+        case DataType::Float32: return formatTyped<float>(registers, type, order);
+        case DataType::UInt64: return formatTyped<quint64>(registers, type, order);
+        case DataType::Int64: return formatTyped<qint64>(registers, type, order);
+        case DataType::Float64: return formatTyped<double>(registers, type, order);
+        case DataType::Ascii: break;
+        }
+
+        // Ascii: the whole buffer is one string shown on the first row
+        QStringList result;
+        if (registers.isEmpty()) {
+            return result;
+        }
+        result.reserve(registers.size());
+        FieldDescriptor field;
+        field.type = DataType::Ascii;
+        field.order = order;
+        field.length = int(registers.size());
+        result << decode(registers.constData(), registers.size(), field).toString();
+        while (result.size() < registers.size()) {
+            result << QString();
+        }
+        return result;
+    }
+}
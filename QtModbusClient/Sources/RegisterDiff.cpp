@@ -0,0 +1,95 @@
+#include "RegisterDiff.h"
+#include <QtAlgorithms>
+#include <QStringList>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REGISTERDIFF_SSE2
+#endif
+
+namespace {
+    // Index of the first position >= from where a and b differ (or equal, when
+    // findEqual is set), or count if there is none
+    qsizetype scan(const quint16* a, const quint16* b, qsizetype from, qsizetype count, bool findEqual)
+    {
+        qsizetype i = from;
+#if defined(REGISTERDIFF_SSE2)
+        for (; i + 8 <= count; i += 8) {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi16(va, vb));
+            if (!findEqual) {
+                mask = ~mask & 0xFFFF;
+            }
+            if (mask != 0) {
+                return i + qCountTrailingZeroBits(quint32(mask)) / 2;
+            }
+        }
+#endif
+        for (; i < count; ++i) {
+            if ((a[i] == b[i]) == findEqual) {
+                return i;
+            }
+        }
+        return count;
+    }
+}
+
+namespace RegisterDiff
+{
+    QList<AddressRange> diff(const quint16* a, const quint16* b, qsizetype count, int baseAddress)
+    {
+        QList<AddressRange> ranges;
+        qsizetype i = 0;
+        while (i < count) {
+            const qsizetype first = scan(a, b, i, count, false);
+            if (first >= count) {
+                break;
+            }
+            const qsizetype last = scan(a, b, first + 1, count, true);
+            ranges.append(AddressRange{ baseAddress + int(first), int(last - first) });
+            i = last;
+        }
+        return ranges;
+    }
+
+    QList<AddressRange> diff(const QVector<quint16>& a, const QVector<quint16>& b, int baseAddress)
+    {
+        const qsizetype count = qMin(a.size(), b.size());
+        QList<AddressRange> ranges = diff(a.constData(), b.constData(), count, baseAddress);
+
+        // A length mismatch counts as a difference over the tail
+        const qsizetype longest = qMax(a.size(), b.size());
+        if (longest > count) {
+            if (!ranges.isEmpty() && ranges.last().end() == baseAddress + int(count)) {
+                ranges.last().count += int(longest - count);
+            }
+            else {
+                ranges.append(AddressRange{ baseAddress + int(count), int(longest - count) });
+            }
+        }
+        return ranges;
+    }
+
+    qsizetype totalCount(const QList<AddressRange>& ranges) noexcept
+    {
+        qsizetype total = 0;
+        for (const AddressRange& range : ranges) {
+            total += range.count;
+        }
+        return total;
+    }
+
+    QString describe(const QList<AddressRange>& ranges, int maxRanges)
+    {
+        QStringList parts;
+        for (const AddressRange& range : ranges.mid(0, maxRanges)) {
+            parts << (range.count == 1 ? QString::number(range.start)
+                : QString("%1-%2").arg(range.start).arg(range.end() - 1));
+        }
+        if (ranges.size() > maxRanges) {
+            parts << "...";
+        }
+        return parts.join(", ");
+    }
+}
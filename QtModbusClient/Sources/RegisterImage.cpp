@@ -0,0 +1,145 @@
+#include "RegisterImage.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QDebug>
+
+RegisterImage::RegisterImage(ModbusConnection::RegisterType type)
+    : m_type(type)
+{
+}
+
+bool RegisterImage::load(const QString& fileName, int startAddress, QString* errorMessage)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == "csv" || suffix == "txt") {
+        return loadCsv(fileName, errorMessage);
+    }
+    return loadBinary(fileName, startAddress, errorMessage);
+}
+
+bool RegisterImage::loadCsv(const QString& fileName, QString* errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorMessage) *errorMessage = file.errorString();
+        return false;
+    }
+
+    m_segments.clear();
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        const QStringList fields = line.split(',');
+        bool addrOk = false;
+        bool valueOk = false;
+        const int address = fields.value(0).trimmed().toInt(&addrOk, 0);
+        const uint value = fields.value(1).trimmed().toUInt(&valueOk, 0);
+
+        if (!addrOk && lineNumber == 1) {
+            continue;   // header line
+        }
+        if (!addrOk || !valueOk || address < 0 || address > 65535 || value > 0xFFFF) {
+            if (errorMessage) *errorMessage = QObject::tr("Line %1: invalid entry").arg(lineNumber);
+            return false;
+        }
+
+        const bool bitType = m_type == ModbusConnection::Coils;
+        append(address, bitType ? quint16(value != 0) : quint16(value));
+    }
+
+    qDebug() << "Register image loaded:" << valueCount() << "values in" << m_segments.size() << "segments";
+    return true;
+}
+
+bool RegisterImage::loadBinary(const QString& fileName, int startAddress, QString* errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (errorMessage) *errorMessage = file.errorString();
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+    m_segments.clear();
+
+    RegisterSegment segment;
+    segment.start = startAddress;
+
+    if (m_type == ModbusConnection::Coils) {
+        segment.values.resize(data.size() * 8);
+        for (qsizetype i = 0; i < segment.values.size(); ++i) {
+            segment.values[i] = (quint8(data[i / 8]) >> (i % 8)) & 1;
+        }
+    }
+    else {
+        segment.values.resize(data.size() / 2);
+        const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+        for (qsizetype i = 0; i < segment.values.size(); ++i) {
+            segment.values[i] = quint16((bytes[2 * i] << 8) | bytes[2 * i + 1]);
+        }
+    }
+
+    if (startAddress + segment.values.size() > 65536) {
+        if (errorMessage) *errorMessage = QObject::tr("Image exceeds the address space");
+        return false;
+    }
+
+    if (!segment.values.isEmpty()) {
+        m_segments.append(segment);
+    }
+    return true;
+}
+
+void RegisterImage::setType(ModbusConnection::RegisterType type) noexcept
+{
+    m_type = type;
+}
+
+ModbusConnection::RegisterType RegisterImage::type() const noexcept
+{
+    return m_type;
+}
+
+const QList<RegisterSegment>& RegisterImage::segments() const noexcept
+{
+    return m_segments;
+}
+
+qsizetype RegisterImage::valueCount() const noexcept
+{
+    qsizetype count = 0;
+    for (const RegisterSegment& segment : m_segments) {
+        count += segment.values.size();
+    }
+    return count;
+}
+
+bool RegisterImage::isEmpty() const noexcept
+{
+    return m_segments.isEmpty();
+}
+
+// Extends the last segment when the address follows it, otherwise starts a new one
+void RegisterImage::append(int address, quint16 value)
+{
+    if (!m_segments.isEmpty()) {
+        RegisterSegment& last = m_segments.last();
+        if (last.start + last.values.size() == address) {
+            last.values.append(value);
+            return;
+        }
+    }
+
+    RegisterSegment segment;
+    segment.start = address;
+    segment.values.append(value);
+    m_segments.append(segment);
+}
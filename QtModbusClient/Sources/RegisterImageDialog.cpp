@@ -0,0 +1,146 @@
+#include "RegisterImageDialog.h"
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QApplication>
+#include <QDebug>
+
+RegisterImageDialog::RegisterImageDialog(QWidget* parent)
+    : QDialog(parent)
+{
+    ui.setupUi(this);
+    m_writer = new RegisterImageWriter(this);
+    initUI();
+    setupConnections();
+}
+
+RegisterImageDialog::~RegisterImageDialog()
+{
+    m_writer->cancel();
+}
+
+void RegisterImageDialog::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+    m_writer->setModbusConnection(connection);
+}
+
+void RegisterImageDialog::initUI()
+{
+    ui.imageTypeComboBox->addItem(tr("Holding Registers"), ModbusConnection::HoldingRegisters);
+    ui.imageTypeComboBox->addItem(tr("Coils"), ModbusConnection::Coils);
+
+    ui.imageAddressSpinBox->setRange(0, 65535);
+    ui.imageDepthSpinBox->setRange(1, 32);
+    ui.imageDepthSpinBox->setValue(4);
+    ui.imageVerifyCheckBox->setChecked(true);
+
+    ui.imageProgressBar->setValue(0);
+    ui.imageResumeBtn->setEnabled(false);
+    ui.imageCancelBtn->setEnabled(false);
+}
+
+void RegisterImageDialog::setupConnections()
+{
+    connect(ui.imageBrowseBtn, &QPushButton::clicked, this, &RegisterImageDialog::onBrowse);
+    connect(ui.imageStartBtn, &QPushButton::clicked, this, &RegisterImageDialog::onStart);
+    connect(ui.imageResumeBtn, &QPushButton::clicked, this, &RegisterImageDialog::onResume);
+    connect(ui.imageCancelBtn, &QPushButton::clicked, this, &RegisterImageDialog::onCancel);
+    connect(ui.imageCloseBtn, &QPushButton::clicked, this, &QDialog::reject);
+
+    connect(m_writer, &RegisterImageWriter::stateChanged, this, &RegisterImageDialog::handleStateChanged);
+    connect(m_writer, &RegisterImageWriter::progress, this, &RegisterImageDialog::handleProgress);
+    connect(m_writer, &RegisterImageWriter::failed, this, &RegisterImageDialog::handleFailed);
+    connect(m_writer, &RegisterImageWriter::finished, this, &RegisterImageDialog::handleFinished);
+}
+
+void RegisterImageDialog::onBrowse()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Open Register Image"),
+        QString(), tr("Register images (*.csv *.txt *.bin);;All files (*)"));
+    if (!fileName.isEmpty()) {
+        ui.imageFileLineEdit->setText(fileName);
+    }
+}
+
+// Loads the image and starts the transfer from the first chunk
+void RegisterImageDialog::onStart()
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    const auto type = static_cast<ModbusConnection::RegisterType>(ui.imageTypeComboBox->currentData().toInt());
+    RegisterImage image(type);
+    QString error;
+    if (!image.load(ui.imageFileLineEdit->text(), ui.imageAddressSpinBox->value(), &error)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to load image: %1").arg(error));
+        return;
+    }
+    if (image.isEmpty()) {
+        QMessageBox::warning(this, tr("Warning"), tr("The image contains no values"));
+        return;
+    }
+
+    m_writer->setImage(image);
+    m_writer->setPipelineDepth(ui.imageDepthSpinBox->value());
+    m_writer->setVerify(ui.imageVerifyCheckBox->isChecked());
+    ui.imageProgressBar->setValue(0);
+    ui.imageStatusLabel->setText(tr("%1 values loaded").arg(image.valueCount()));
+    m_writer->start();
+}
+
+void RegisterImageDialog::onResume()
+{
+    m_writer->resume();
+}
+
+void RegisterImageDialog::onCancel()
+{
+    m_writer->cancel();
+}
+
+void RegisterImageDialog::handleStateChanged(RegisterImageWriter::State state)
+{
+    const bool busy = state == RegisterImageWriter::Writing || state == RegisterImageWriter::Verifying;
+    ui.imageStartBtn->setEnabled(!busy);
+    ui.imageResumeBtn->setEnabled(state == RegisterImageWriter::Failed);
+    ui.imageCancelBtn->setEnabled(busy);
+
+    switch (state) {
+    case RegisterImageWriter::Writing:
+        ui.imageStatusLabel->setText(tr("Writing..."));
+        break;
+    case RegisterImageWriter::Verifying:
+        ui.imageStatusLabel->setText(tr("Verifying..."));
+        break;
+    case RegisterImageWriter::Idle:
+        ui.imageStatusLabel->setText(tr("Cancelled"));
+        break;
+    default: break;
+    }
+}
+
+void RegisterImageDialog::handleProgress(int done, int total)
+{
+    ui.imageProgressBar->setMaximum(total);
+    ui.imageProgressBar->setValue(done);
+}
+
+void RegisterImageDialog::handleFailed(const QString& errorMessage)
+{
+    ui.imageStatusLabel->setText(tr("Stopped: %1").arg(errorMessage));
+}
+
+void RegisterImageDialog::handleFinished(const QList<AddressRange>& mismatches)
+{
+    if (mismatches.isEmpty()) {
+        ui.imageStatusLabel->setText(tr("Completed"));
+        QApplication::beep();
+        return;
+    }
+
+    ui.imageStatusLabel->setText(tr("Verification found %1 mismatching values at %2")
+        .arg(RegisterDiff::totalCount(mismatches))
+        .arg(RegisterDiff::describe(mismatches)));
+}
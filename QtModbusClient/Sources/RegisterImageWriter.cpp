@@ -0,0 +1,275 @@
+#include "RegisterImageWriter.h"
+#include <QModbusReply>
+#include <QDebug>
+
+namespace {
+    // FC16 carries 123 registers, FC15 1968 coils; reads allow 125 / 2000
+    int writeLimit(ModbusConnection::RegisterType type)
+    {
+        return type == ModbusConnection::Coils ? 1968 : 123;
+    }
+
+    int readLimit(ModbusConnection::RegisterType type)
+    {
+        return type == ModbusConnection::Coils ? 2000 : 125;
+    }
+}
+
+RegisterImageWriter::RegisterImageWriter(QObject* parent)
+    : QObject(parent)
+{
+}
+
+void RegisterImageWriter::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+}
+
+void RegisterImageWriter::setImage(const RegisterImage& image)
+{
+    cancel();
+    m_image = image;
+}
+
+void RegisterImageWriter::setPipelineDepth(int depth)
+{
+    m_pipelineDepth = qBound(1, depth, 32);
+}
+
+void RegisterImageWriter::setVerify(bool verify)
+{
+    m_verify = verify;
+}
+
+RegisterImageWriter::State RegisterImageWriter::state() const noexcept
+{
+    return m_state;
+}
+
+void RegisterImageWriter::start()
+{
+    ++m_generation;
+    m_inFlight = 0;
+    m_mismatches.clear();
+    m_writeChunks = buildChunks(writeLimit(m_image.type()));
+    m_readChunks = buildChunks(readLimit(m_image.type()));
+
+    qDebug() << "Register image write started -" << m_image.valueCount() << "values in"
+        << m_writeChunks.size() << "chunks, pipeline depth" << m_pipelineDepth;
+
+    setState(Writing);
+    pump();
+}
+
+// Continues after a failure with the chunks that were not acknowledged
+void RegisterImageWriter::resume()
+{
+    if (m_state != Failed) {
+        return;
+    }
+
+    ++m_generation;
+    m_inFlight = 0;
+    for (Chunk& chunk : m_writeChunks) {
+        chunk.inFlight = false;
+    }
+    for (Chunk& chunk : m_readChunks) {
+        chunk.inFlight = false;
+    }
+
+    const bool writesDone = countDone(m_writeChunks) == m_writeChunks.size();
+    setState(writesDone && m_verify ? Verifying : Writing);
+    pump();
+}
+
+void RegisterImageWriter::cancel()
+{
+    ++m_generation;
+    m_inFlight = 0;
+    if (m_state == Writing || m_state == Verifying) {
+        setState(Idle);
+    }
+}
+
+QVector<RegisterImageWriter::Chunk> RegisterImageWriter::buildChunks(int maxCount) const
+{
+    QVector<Chunk> chunks;
+    const QList<RegisterSegment>& segments = m_image.segments();
+    for (int s = 0; s < segments.size(); ++s) {
+        const int size = int(segments[s].values.size());
+        for (int offset = 0; offset < size; offset += maxCount) {
+            Chunk chunk;
+            chunk.segment = s;
+            chunk.offset = offset;
+            chunk.count = qMin(maxCount, size - offset);
+            chunks.append(chunk);
+        }
+    }
+    return chunks;
+}
+
+void RegisterImageWriter::setState(State state)
+{
+    if (m_state != state) {
+        m_state = state;
+        emit stateChanged(state);
+    }
+}
+
+// Keeps the pipeline filled with the next pending chunks of the current phase
+void RegisterImageWriter::pump()
+{
+    if (m_state != Writing && m_state != Verifying) {
+        return;
+    }
+
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        m_lastError = tr("Not connected to any device");
+        if (m_inFlight == 0) {
+            finishPhase();
+        }
+        return;
+    }
+
+    const bool writing = m_state == Writing;
+    QVector<Chunk>& chunks = writing ? m_writeChunks : m_readChunks;
+    const quint64 generation = m_generation;
+
+    for (int i = 0; i < chunks.size() && m_inFlight < m_pipelineDepth; ++i) {
+        Chunk& chunk = chunks[i];
+        if (chunk.done || chunk.inFlight) {
+            continue;
+        }
+
+        const RegisterSegment& segment = m_image.segments()[chunk.segment];
+        const int address = segment.start + chunk.offset;
+
+        QModbusReply* reply = writing
+            ? m_modbusConnection->writeMultipleRegisters(m_image.type(), address,
+                segment.values.mid(chunk.offset, chunk.count), ModbusConnection::VerifyNone)
+            : m_modbusConnection->readRegister(m_image.type(), address, quint16(chunk.count));
+
+        if (!reply) {
+            m_lastError = tr("Failed to send request at address %1").arg(address);
+            break;
+        }
+
+        chunk.inFlight = true;
+        ++m_inFlight;
+
+        auto handler = writing ? &RegisterImageWriter::handleWriteReply : &RegisterImageWriter::handleReadReply;
+        if (reply->isFinished()) {
+            // The handler refills the pipeline itself
+            (this->*handler)(generation, i, reply);
+            return;
+        }
+
+        connect(reply, &QModbusReply::finished, this, [this, handler, generation, i, reply]() {
+            (this->*handler)(generation, i, reply);
+            });
+    }
+
+    if (m_inFlight == 0) {
+        finishPhase();
+    }
+}
+
+void RegisterImageWriter::handleWriteReply(quint64 generation, int chunkIndex, QModbusReply* reply)
+{
+    reply->deleteLater();
+    if (generation != m_generation) {
+        return;
+    }
+
+    Chunk& chunk = m_writeChunks[chunkIndex];
+    chunk.inFlight = false;
+    --m_inFlight;
+
+    if (reply->error() == QModbusDevice::NoError) {
+        chunk.done = true;
+        emit progress(countDone(m_writeChunks), m_writeChunks.size());
+    }
+    else {
+        const int address = m_image.segments()[chunk.segment].start + chunk.offset;
+        m_lastError = tr("Write at address %1 failed: %2").arg(address).arg(reply->errorString());
+        qDebug() << "Register image" << m_lastError;
+    }
+
+    if (m_lastError.isEmpty()) {
+        pump();
+    }
+    else if (m_inFlight == 0) {
+        finishPhase();
+    }
+}
+
+void RegisterImageWriter::handleReadReply(quint64 generation, int chunkIndex, QModbusReply* reply)
+{
+    reply->deleteLater();
+    if (generation != m_generation) {
+        return;
+    }
+
+    Chunk& chunk = m_readChunks[chunkIndex];
+    chunk.inFlight = false;
+    --m_inFlight;
+
+    const RegisterSegment& segment = m_image.segments()[chunk.segment];
+    const int address = segment.start + chunk.offset;
+
+    if (reply->error() == QModbusDevice::NoError) {
+        chunk.done = true;
+        const QList<quint16> readBack = reply->result().values();
+        m_mismatches += RegisterDiff::diff(segment.values.mid(chunk.offset, chunk.count), readBack, address);
+        emit progress(countDone(m_readChunks), m_readChunks.size());
+    }
+    else {
+        m_lastError = tr("Read-back at address %1 failed: %2").arg(address).arg(reply->errorString());
+        qDebug() << "Register image" << m_lastError;
+    }
+
+    if (m_lastError.isEmpty()) {
+        pump();
+    }
+    else if (m_inFlight == 0) {
+        finishPhase();
+    }
+}
+
+// Called once no request is outstanding: fail, move on to verification, or finish
+void RegisterImageWriter::finishPhase()
+{
+    if (!m_lastError.isEmpty()) {
+        const QString error = m_lastError;
+        m_lastError.clear();
+        setState(Failed);
+        emit failed(error);
+        return;
+    }
+
+    if (m_state == Writing && countDone(m_writeChunks) == m_writeChunks.size()) {
+        if (m_verify && !m_readChunks.isEmpty()) {
+            setState(Verifying);
+            pump();
+            return;
+        }
+        setState(Finished);
+        emit finished(m_mismatches);
+        return;
+    }
+
+    if (m_state == Verifying && countDone(m_readChunks) == m_readChunks.size()) {
+        qDebug() << "Register image verified -" << RegisterDiff::totalCount(m_mismatches) << "mismatching values";
+        setState(Finished);
+        emit finished(m_mismatches);
+    }
+}
+
+int RegisterImageWriter::countDone(const QVector<Chunk>& chunks) const
+{
+    int done = 0;
+    for (const Chunk& chunk : chunks) {
+        if (chunk.done) ++done;
+    }
+    return done;
+}
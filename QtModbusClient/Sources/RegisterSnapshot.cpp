@@ -0,0 +1,280 @@
+#include "RegisterSnapshot.h"
+#include "RegisterDiff.h"
+#include "TagDatabase.h"
+#include <QDataStream>
+#include <QFile>
+#include <QObject>
+#include <QRegularExpression>
+#include <algorithm>
+
+namespace {
+    constexpr quint32 snapshotMagic = 0x4D42534E;   // "MBSN"
+    constexpr quint16 snapshotVersion = 1;
+
+    void setError(QString* errorMessage, const QString& message)
+    {
+        if (errorMessage) {
+            *errorMessage = message;
+        }
+    }
+}
+
+bool SnapshotSegment::isBits() const noexcept
+{
+    return type == ModbusConnection::Coils || type == ModbusConnection::DiscreteInputs;
+}
+
+int SnapshotSegment::count() const noexcept
+{
+    return isBits() ? bits.size() : int(registers.size());
+}
+
+void RegisterSnapshot::setName(const QString& name)
+{
+    m_name = name;
+}
+
+QString RegisterSnapshot::name() const
+{
+    return m_name;
+}
+
+void RegisterSnapshot::setSlaveID(int slaveID) noexcept
+{
+    m_slaveID = slaveID;
+}
+
+int RegisterSnapshot::slaveID() const noexcept
+{
+    return m_slaveID;
+}
+
+void RegisterSnapshot::setTimestamp(const QDateTime& timestamp)
+{
+    m_timestamp = timestamp;
+}
+
+QDateTime RegisterSnapshot::timestamp() const
+{
+    return m_timestamp;
+}
+
+void RegisterSnapshot::addSegment(const SnapshotSegment& segment)
+{
+    m_segments.append(segment);
+}
+
+const QList<SnapshotSegment>& RegisterSnapshot::segments() const noexcept
+{
+    return m_segments;
+}
+
+QList<SnapshotRange> RegisterSnapshot::ranges() const
+{
+    QList<SnapshotRange> result;
+    for (const SnapshotSegment& segment : m_segments) {
+        result.append(SnapshotRange{ segment.type, segment.start, segment.count() });
+    }
+    return result;
+}
+
+bool RegisterSnapshot::isEmpty() const noexcept
+{
+    return m_segments.isEmpty();
+}
+
+quint16 RegisterSnapshot::value(ModbusConnection::RegisterType type, int address, bool* found) const
+{
+    for (const SnapshotSegment& segment : m_segments) {
+        if (segment.type != type || address < segment.start || address >= segment.end()) {
+            continue;
+        }
+        if (found) {
+            *found = true;
+        }
+        const int offset = address - segment.start;
+        return segment.isBits() ? quint16(segment.bits.testBit(offset)) : segment.registers[offset];
+    }
+
+    if (found) {
+        *found = false;
+    }
+    return 0;
+}
+
+// Registers are stored as big-endian words and bits as packed bytes
+bool RegisterSnapshot::save(const QString& fileName, QString* errorMessage) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        setError(errorMessage, file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream << snapshotMagic << snapshotVersion;
+    stream << m_name << qint32(m_slaveID) << m_timestamp;
+    stream << quint32(m_segments.size());
+
+    for (const SnapshotSegment& segment : m_segments) {
+        stream << quint8(segment.type) << quint16(segment.start) << quint32(segment.count());
+        if (segment.isBits()) {
+            const QByteArray packed = segment.bits.toPackedBytes();
+            stream.writeRawData(packed.constData(), int(packed.size()));
+        }
+        else {
+            for (const quint16 value : segment.registers) {
+                stream << value;
+            }
+        }
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        setError(errorMessage, QObject::tr("Failed to write snapshot"));
+        return false;
+    }
+    return true;
+}
+
+bool RegisterSnapshot::load(const QString& fileName, QString* errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(errorMessage, file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint16 version = 0;
+    stream >> magic >> version;
+    if (magic != snapshotMagic || version != snapshotVersion) {
+        setError(errorMessage, QObject::tr("Not a register snapshot file"));
+        return false;
+    }
+
+    QString name;
+    qint32 slaveID = 1;
+    QDateTime timestamp;
+    quint32 segmentCount = 0;
+    stream >> name >> slaveID >> timestamp >> segmentCount;
+
+    QList<SnapshotSegment> segments;
+    for (quint32 i = 0; i < segmentCount && stream.status() == QDataStream::Ok; ++i) {
+        quint8 type = 0;
+        quint16 start = 0;
+        quint32 count = 0;
+        stream >> type >> start >> count;
+        if (count > 0x10000) {
+            break;
+        }
+
+        SnapshotSegment segment;
+        segment.type = static_cast<ModbusConnection::RegisterType>(type);
+        segment.start = start;
+        if (segment.isBits()) {
+            QByteArray packed((int(count) + 7) / 8, Qt::Uninitialized);
+            if (stream.readRawData(packed.data(), int(packed.size())) != packed.size()) {
+                stream.setStatus(QDataStream::ReadPastEnd);
+                break;
+            }
+            segment.bits = BitBlock::fromPackedBytes(packed.constData(), packed.size(), int(count));
+        }
+        else {
+            segment.registers.resize(count);
+            for (quint16& value : segment.registers) {
+                stream >> value;
+            }
+        }
+        segments.append(segment);
+    }
+
+    if (stream.status() != QDataStream::Ok || quint32(segments.size()) != segmentCount) {
+        setError(errorMessage, QObject::tr("Snapshot file is truncated or corrupt"));
+        return false;
+    }
+
+    m_name = name;
+    m_slaveID = slaveID;
+    m_timestamp = timestamp;
+    m_segments = segments;
+    return true;
+}
+
+// Every pair of overlapping segments of the same type is diffed over the
+// overlap only, registers with the SIMD register diff and bits a word at a time
+QList<SnapshotChange> RegisterSnapshot::compare(const RegisterSnapshot& before, const RegisterSnapshot& after)
+{
+    QList<SnapshotChange> changes;
+
+    for (const SnapshotSegment& a : before.m_segments) {
+        for (const SnapshotSegment& b : after.m_segments) {
+            if (a.type != b.type) {
+                continue;
+            }
+            const int start = qMax(a.start, b.start);
+            const int end = qMin(a.end(), b.end());
+            if (start >= end) {
+                continue;
+            }
+
+            QList<AddressRange> ranges;
+            if (a.isBits()) {
+                ranges = a.bits.mid(start - a.start, end - start)
+                    .diff(b.bits.mid(start - b.start, end - start), start);
+            }
+            else {
+                ranges = RegisterDiff::diff(a.registers.constData() + (start - a.start),
+                    b.registers.constData() + (start - b.start), end - start, start);
+            }
+
+            for (const AddressRange& range : ranges) {
+                changes.append(SnapshotChange{ a.type, range });
+            }
+        }
+    }
+
+    std::sort(changes.begin(), changes.end(), [](const SnapshotChange& x, const SnapshotChange& y) {
+        return x.type != y.type ? x.type < y.type : x.range.start < y.range.start;
+        });
+    return changes;
+}
+
+bool RegisterSnapshot::parseRanges(const QString& text, QList<SnapshotRange>* ranges, QString* errorMessage)
+{
+    static const QRegularExpression entryPattern(QStringLiteral("^\\s*(\\w+)\\s*:\\s*(\\d+)\\s*(?:-\\s*(\\d+))?\\s*$"));
+
+    QList<SnapshotRange> result;
+    const QStringList entries = text.split(QRegularExpression(QStringLiteral("[;,\\n]")), Qt::SkipEmptyParts);
+    for (const QString& entry : entries) {
+        if (entry.trimmed().isEmpty()) {
+            continue;
+        }
+
+        const QRegularExpressionMatch match = entryPattern.match(entry);
+        SnapshotRange range;
+        if (!match.hasMatch() || !TagDatabase::parseRegisterType(match.captured(1), &range.type)) {
+            setError(errorMessage, QObject::tr("Invalid range: %1").arg(entry.trimmed()));
+            return false;
+        }
+
+        const int first = match.captured(2).toInt();
+        const int last = match.captured(3).isEmpty() ? first : match.captured(3).toInt();
+        if (last < first || last > 65535) {
+            setError(errorMessage, QObject::tr("Invalid address range: %1").arg(entry.trimmed()));
+            return false;
+        }
+
+        range.start = first;
+        range.count = last - first + 1;
+        result.append(range);
+    }
+
+    if (result.isEmpty()) {
+        setError(errorMessage, QObject::tr("No ranges given"));
+        return false;
+    }
+
+    *ranges = result;
+    return true;
+}
@@ -0,0 +1,126 @@
+#include "ResponseCache.h"
+
+namespace {
+    // Expired entries are swept once the cache grows past this
+    constexpr int sweepThreshold = 1024;
+}
+
+ResponseCache::ResponseCache(int maxAgeMs)
+    : m_maxAge(qMax(0, maxAgeMs))
+{
+    m_clock.start();
+}
+
+void ResponseCache::setMaxAge(int maxAgeMs)
+{
+    m_maxAge = qMax(0, maxAgeMs);
+    if (m_maxAge == 0) {
+        clear();
+    }
+}
+
+int ResponseCache::maxAge() const noexcept
+{
+    return m_maxAge;
+}
+
+bool ResponseCache::lookup(int slaveID, const QModbusRequest& request, QModbusResponse* response)
+{
+    if (m_maxAge == 0 || !isRead(request)) {
+        return false;
+    }
+
+    const auto it = m_entries.constFind(key(slaveID, request));
+    if (it == m_entries.cend() || m_clock.elapsed() - it->storedAt > m_maxAge) {
+        ++m_misses;
+        return false;
+    }
+
+    ++m_hits;
+    *response = it->response;
+    return true;
+}
+
+// Only successful read responses are kept
+void ResponseCache::store(int slaveID, const QModbusRequest& request, const QModbusResponse& response)
+{
+    // The read half of FC23 shows the registers after its write, so it can
+    // answer a plain FC03 of the same range
+    if (request.functionCode() == QModbusPdu::ReadWriteMultipleRegisters) {
+        if (m_maxAge != 0 && !response.isException() && request.dataSize() >= 4) {
+            quint16 readStart = 0;
+            quint16 readCount = 0;
+            request.decodeData(&readStart, &readCount);
+            store(slaveID, QModbusRequest(QModbusPdu::ReadHoldingRegisters, readStart, readCount),
+                QModbusResponse(QModbusPdu::ReadHoldingRegisters, response.data()));
+        }
+        return;
+    }
+
+    if (m_maxAge == 0 || !isRead(request) || response.isException()) {
+        return;
+    }
+
+    if (m_entries.size() >= sweepThreshold) {
+        evictExpired();
+    }
+    m_entries.insert(key(slaveID, request), Entry{ slaveID, response, m_clock.elapsed() });
+}
+
+void ResponseCache::invalidate(int slaveID)
+{
+    m_entries.removeIf([slaveID](const QHash<QByteArray, Entry>::iterator& it) {
+        return it->slaveID == slaveID;
+        });
+}
+
+void ResponseCache::clear()
+{
+    m_entries.clear();
+}
+
+int ResponseCache::size() const noexcept
+{
+    return int(m_entries.size());
+}
+
+quint64 ResponseCache::hits() const noexcept
+{
+    return m_hits;
+}
+
+quint64 ResponseCache::misses() const noexcept
+{
+    return m_misses;
+}
+
+bool ResponseCache::isRead(const QModbusRequest& request)
+{
+    switch (request.functionCode()) {
+    case QModbusPdu::ReadCoils:
+    case QModbusPdu::ReadDiscreteInputs:
+    case QModbusPdu::ReadHoldingRegisters:
+    case QModbusPdu::ReadInputRegisters:
+        return true;
+    default:
+        return false;
+    }
+}
+
+QByteArray ResponseCache::key(int slaveID, const QModbusRequest& request)
+{
+    QByteArray bytes;
+    bytes.reserve(2 + request.dataSize());
+    bytes.append(char(slaveID));
+    bytes.append(char(request.functionCode()));
+    bytes.append(request.data());
+    return bytes;
+}
+
+void ResponseCache::evictExpired()
+{
+    const qint64 now = m_clock.elapsed();
+    m_entries.removeIf([this, now](const QHash<QByteArray, Entry>::iterator& it) {
+        return now - it->storedAt > m_maxAge;
+        });
+}
@@ -0,0 +1,229 @@
+#include "RtuBenchmark.h"
+#include "NativeRtuTransport.h"
+#include "Crc16.h"
+#include <QModbusRtuSerialClient>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDebug>
+#include <algorithm>
+#include <atomic>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr int warmupTransactions = 20;
+    constexpr int registerCount = 10;
+    constexpr int slaveID = 1;
+
+#ifdef Q_OS_LINUX
+    // False if the pty is gone; a short write is continued as in the native transport
+    bool writeAll(int fd, const QByteArray& data, const std::atomic_bool& stop)
+    {
+        qsizetype written = 0;
+        while (written < data.size() && !stop.load(std::memory_order_relaxed)) {
+            const ssize_t n = ::write(fd, data.constData() + written, size_t(data.size() - written));
+            if (n > 0) {
+                written += n;
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+                pollfd fds = { fd, POLLOUT, 0 };
+                ::poll(&fds, 1, 50);
+                continue;
+            }
+            qWarning() << "Simulated slave cannot write:" << qt_error_string(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Answers every FC03 request written to the pty with registers holding their address
+    void serveSlave(int masterFd, const std::atomic_bool& stop)
+    {
+        QByteArray pending;
+        char buffer[256];
+        while (!stop.load(std::memory_order_relaxed)) {
+            pollfd fds = { masterFd, POLLIN, 0 };
+            if (::poll(&fds, 1, 50) <= 0) {
+                continue;
+            }
+            const ssize_t n = ::read(masterFd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                if (n < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+                return;
+            }
+            pending.append(buffer, n);
+
+            while (pending.size() >= 8) {
+                const auto* request = reinterpret_cast<const uchar*>(pending.constData());
+                const int start = (request[2] << 8) | request[3];
+                const int count = (request[4] << 8) | request[5];
+                const char address = char(request[0]);
+                const bool valid = request[1] == 0x03 && count >= 1 && count <= 125
+                    && Crc16::checksum(pending.constData(), 6) == quint16(request[6] | (request[7] << 8));
+                pending.remove(0, 8);
+                if (!valid) {
+                    pending.clear();    // out of step, wait for the next request
+                    break;
+                }
+
+                QByteArray answer;
+                answer.append(address);
+                answer.append(char(0x03));
+                answer.append(char(count * 2));
+                for (int i = 0; i < count; ++i) {
+                    const quint16 value = quint16(start + i);
+                    answer.append(char(value >> 8));
+                    answer.append(char(value & 0xFF));
+                }
+                const quint16 crc = Crc16::checksum(answer.constData(), answer.size());
+                answer.append(char(crc & 0xFF));
+                answer.append(char(crc >> 8));
+                if (!writeAll(masterFd, answer, stop)) {
+                    return;
+                }
+            }
+        }
+    }
+
+    template<typename Client>
+    RtuBenchmark::Result measure(Client* client, const QString& transport, const QString& portName,
+        qint32 baudRate, int transactions)
+    {
+        RtuBenchmark::Result result;
+        result.transport = transport;
+
+        client->setConnectionParameter(QModbusDevice::SerialPortNameParameter, portName);
+        client->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, baudRate);
+        client->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, QSerialPort::Data8);
+        client->setConnectionParameter(QModbusDevice::SerialParityParameter, QSerialPort::NoParity);
+        client->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, QSerialPort::OneStop);
+        client->setTimeout(1000);
+        client->setNumberOfRetries(0);
+        if (!client->connectDevice() || client->state() != QModbusDevice::ConnectedState) {
+            qWarning().noquote() << transport << "cannot open" << portName << ":" << client->errorString();
+            result.failures = transactions;
+            return result;
+        }
+
+        QList<qint64> samples;
+        samples.reserve(transactions);
+        for (int i = 0; i < warmupTransactions + transactions; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            QModbusReply* reply = client->sendReadRequest(
+                QModbusDataUnit(QModbusDataUnit::HoldingRegisters, i % 100, registerCount), slaveID);
+            if (!reply) {
+                ++result.failures;
+                continue;
+            }
+            if (!reply->isFinished()) {
+                QEventLoop loop;
+                QObject::connect(reply, &QModbusReply::finished, &loop, &QEventLoop::quit);
+                loop.exec();
+            }
+            const qint64 elapsed = timer.nsecsElapsed();
+
+            const bool ok = reply->error() == QModbusDevice::NoError
+                && reply->result().valueCount() == registerCount
+                && reply->result().value(0) == quint16(i % 100);
+            delete reply;
+            if (i < warmupTransactions) {
+                continue;
+            }
+            if (ok) {
+                samples.append(elapsed);
+            }
+            else {
+                ++result.failures;
+            }
+        }
+        client->disconnectDevice();
+
+        result.transactions = int(samples.size());
+        if (!samples.isEmpty()) {
+            std::sort(samples.begin(), samples.end());
+            qint64 total = 0;
+            for (const qint64 sample : samples) {
+                total += sample;
+            }
+            result.meanUs = total / 1000.0 / samples.size();
+            result.medianUs = samples[samples.size() / 2] / 1000.0;
+            result.p99Us = samples[qMin(samples.size() - 1, samples.size() * 99 / 100)] / 1000.0;
+            result.maxUs = samples.last() / 1000.0;
+        }
+        return result;
+    }
+#endif
+}
+
+QList<RtuBenchmark::Result> RtuBenchmark::run(int transactions, qint32 baudRate)
+{
+    QList<Result> results;
+
+#ifdef Q_OS_LINUX
+    const int masterFd = ::posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (masterFd < 0 || ::grantpt(masterFd) < 0 || ::unlockpt(masterFd) < 0) {
+        qWarning() << "Cannot create a pseudo-terminal:" << qt_error_string(errno);
+        if (masterFd >= 0) ::close(masterFd);
+        return results;
+    }
+    const QString portName = QString::fromLocal8Bit(::ptsname(masterFd));
+
+    // Held open so the master side is not hung up between the two transports
+    const int holdFd = ::open(portName.toLocal8Bit().constData(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (holdFd >= 0) {
+        termios tio;
+        if (::tcgetattr(holdFd, &tio) == 0) {
+            ::cfmakeraw(&tio);
+            ::tcsetattr(holdFd, TCSANOW, &tio);
+        }
+    }
+
+    std::atomic_bool stop{ false };
+    QThread* slave = QThread::create([masterFd, &stop]() { serveSlave(masterFd, stop); });
+    slave->start();
+
+    qInfo().noquote() << QString("RTU round trips over %1, %2 x FC03 of %3 registers at %4 baud")
+        .arg(portName).arg(transactions).arg(registerCount).arg(baudRate);
+
+    {
+        QModbusRtuSerialClient client;
+        results.append(measure(&client, QStringLiteral("QSerialPort"), portName, baudRate, transactions));
+    }
+    {
+        NativeRtuTransport client;
+        results.append(measure(&client, QStringLiteral("Native"), portName, baudRate, transactions));
+    }
+
+    stop = true;
+    slave->wait();
+    delete slave;
+    if (holdFd >= 0) ::close(holdFd);
+    ::close(masterFd);
+
+    for (const Result& result : results) {
+        qInfo().noquote() << QString("RTU %1: mean %2 us, median %3 us, p99 %4 us, max %5 us (%6 ok, %7 failed)")
+            .arg(result.transport, -11)
+            .arg(result.meanUs, 0, 'f', 1)
+            .arg(result.medianUs, 0, 'f', 1)
+            .arg(result.p99Us, 0, 'f', 1)
+            .arg(result.maxUs, 0, 'f', 1)
+            .arg(result.transactions)
+            .arg(result.failures);
+    }
+#else
+    Q_UNUSED(transactions)
+    Q_UNUSED(baudRate)
+    qWarning() << "The RTU benchmark needs Linux pseudo-terminals";
+#endif
+    return results;
+}
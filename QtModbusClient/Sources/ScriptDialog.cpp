@@ -0,0 +1,207 @@
+#include "ScriptDialog.h"
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QHeaderView>
+#include <QCloseEvent>
+#include <QFile>
+#include <QDebug>
+
+namespace {
+    enum Column { SlaveColumn, StepColumn, OperationColumn, TimeColumn, ResultColumn };
+
+    const char* exampleScript = R"(// read(type, address, count), write(type, address, values), wait(ms),
+// readWrite(readAddress, count, writeAddress, values), maskWrite(address, and, or),
+// assert(condition, message), step(name), log(text), decode(registers, type, order)
+// "device" holds the slave ID the script is running against
+step("check firmware version");
+var version = read("HR", 0);
+assert(version >= 0x0100, "firmware too old: " + version);
+
+step("toggle output");
+write("COIL", 0, 1);
+wait(100);
+assert(read("COIL", 0) === 1, "coil 0 did not latch");
+write("COIL", 0, 0);
+)";
+}
+
+ScriptDialog::ScriptDialog(QWidget* parent)
+    : QDialog(parent)
+{
+    ui.setupUi(this);
+    m_runner = new ScriptRunner(this);
+    initUI();
+    setupConnections();
+}
+
+ScriptDialog::~ScriptDialog()
+{
+    m_runner->stop();
+}
+
+void ScriptDialog::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+    m_runner->setModbusConnection(connection);
+    if (connection && ui.scriptSlavesLineEdit->text().isEmpty()) {
+        ui.scriptSlavesLineEdit->setText(QString::number(connection->getSlaveID()));
+    }
+}
+
+void ScriptDialog::initUI()
+{
+    QFont font(QStringLiteral("Monospace"));
+    font.setStyleHint(QFont::TypeWriter);
+    ui.scriptEditor->setFont(font);
+    ui.scriptEditor->setPlainText(QString::fromLatin1(exampleScript));
+    ui.scriptOutputTextEdit->setFont(font);
+    ui.scriptOutputTextEdit->setMaximumBlockCount(10000);
+
+    m_stepModel = new QStandardItemModel(this);
+    m_stepModel->setHorizontalHeaderLabels({ tr("Slave"), tr("Step"), tr("Operation"), tr("Time (ms)"), tr("Result") });
+    ui.scriptStepTableView->setModel(m_stepModel);
+    ui.scriptStepTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui.scriptStepTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    ui.scriptSplitter->setStretchFactor(0, 3);
+    ui.scriptSplitter->setStretchFactor(1, 2);
+    setRunning(false);
+}
+
+void ScriptDialog::setupConnections()
+{
+    connect(ui.scriptLoadBtn, &QPushButton::clicked, this, &ScriptDialog::onLoad);
+    connect(ui.scriptSaveBtn, &QPushButton::clicked, this, &ScriptDialog::onSave);
+    connect(ui.scriptRunBtn, &QPushButton::clicked, this, &ScriptDialog::onRun);
+    connect(ui.scriptStopBtn, &QPushButton::clicked, this, &ScriptDialog::onStop);
+    connect(ui.scriptCloseBtn, &QPushButton::clicked, this, &QDialog::close);
+
+    connect(m_runner, &ScriptRunner::message, this, &ScriptDialog::handleMessage);
+    connect(m_runner, &ScriptRunner::stepRecorded, this, &ScriptDialog::handleStepRecorded);
+    connect(m_runner, &ScriptRunner::deviceFinished, this, &ScriptDialog::handleDeviceFinished);
+    connect(m_runner, &ScriptRunner::finished, this, &ScriptDialog::handleFinished);
+}
+
+// A running script holds nested event loops, so it has to unwind before the dialog goes away
+void ScriptDialog::closeEvent(QCloseEvent* event)
+{
+    m_runner->stop();
+    QDialog::closeEvent(event);
+}
+
+void ScriptDialog::onLoad()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Load Script"),
+        QString(), tr("Scripts (*.js);;All files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to open %1: %2").arg(fileName, file.errorString()));
+        return;
+    }
+    ui.scriptEditor->setPlainText(QString::fromUtf8(file.readAll()));
+}
+
+void ScriptDialog::onSave()
+{
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Save Script"),
+        QString(), tr("Scripts (*.js)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to save %1: %2").arg(fileName, file.errorString()));
+        return;
+    }
+    file.write(ui.scriptEditor->toPlainText().toUtf8());
+}
+
+void ScriptDialog::onRun()
+{
+    if (m_runner->isRunning()) {
+        return;
+    }
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    bool ok = false;
+    const QList<int> slaveIDs = ScriptRunner::parseSlaveList(ui.scriptSlavesLineEdit->text(), &ok);
+    if (!ok) {
+        QMessageBox::warning(this, tr("Error"), tr("Enter slave IDs between 1 and 247, e.g. 1,2,5-8"));
+        return;
+    }
+
+    // Only recompile when the source changed since the last run
+    const QString source = ui.scriptEditor->toPlainText();
+    if (source != m_compiledSource || !m_runner->isCompiled()) {
+        QString error;
+        if (!m_runner->compile(source, &error)) {
+            m_compiledSource.clear();
+            QMessageBox::critical(this, tr("Error"), tr("Script error: %1").arg(error));
+            return;
+        }
+        m_compiledSource = source;
+    }
+
+    m_stepModel->removeRows(0, m_stepModel->rowCount());
+    ui.scriptOutputTextEdit->clear();
+    setRunning(true);
+    m_runner->run(slaveIDs);
+}
+
+void ScriptDialog::onStop()
+{
+    m_runner->stop();
+}
+
+void ScriptDialog::handleMessage(const QString& text)
+{
+    ui.scriptOutputTextEdit->appendPlainText(text);
+}
+
+void ScriptDialog::handleStepRecorded(const ScriptStep& step)
+{
+    QList<QStandardItem*> row;
+    row << new QStandardItem(QString::number(step.slaveID))
+        << new QStandardItem(step.step)
+        << new QStandardItem(step.operation)
+        << new QStandardItem(QString::number(step.durationMs, 'f', 1))
+        << new QStandardItem(step.ok ? tr("OK") : step.detail);
+    if (!step.ok) {
+        row.last()->setForeground(Qt::red);
+    }
+    m_stepModel->appendRow(row);
+}
+
+void ScriptDialog::handleDeviceFinished(int slaveID, bool passed, const QString& errorMessage)
+{
+    if (passed) {
+        ui.scriptOutputTextEdit->appendPlainText(tr("[slave %1] PASSED").arg(slaveID));
+    }
+    else {
+        ui.scriptOutputTextEdit->appendPlainText(tr("[slave %1] FAILED: %2").arg(slaveID).arg(errorMessage));
+    }
+}
+
+void ScriptDialog::handleFinished(int passed, int failed)
+{
+    setRunning(false);
+    ui.scriptOutputTextEdit->appendPlainText(tr("Done: %1 passed, %2 failed").arg(passed).arg(failed));
+    qDebug() << "Script run finished," << passed << "passed," << failed << "failed";
+}
+
+void ScriptDialog::setRunning(bool running)
+{
+    ui.scriptRunBtn->setEnabled(!running);
+    ui.scriptLoadBtn->setEnabled(!running);
+    ui.scriptEditor->setReadOnly(running);
+    ui.scriptSlavesLineEdit->setEnabled(!running);
+    ui.scriptStopBtn->setEnabled(running);
+}
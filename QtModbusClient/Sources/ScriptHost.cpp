@@ -0,0 +1,391 @@
+#include "ScriptHost.h"
+#include "PduBuilder.h"
+#include "RegisterCodec.h"
+#include "TagDatabase.h"
+#include <QJSEngine>
+#include <QEventLoop>
+#include <QModbusReply>
+#include <QTimer>
+#include <QDebug>
+
+ScriptHost::ScriptHost(QJSEngine* engine, QObject* parent)
+    : QObject(parent),
+    m_engine(engine)
+{
+}
+
+void ScriptHost::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+}
+
+void ScriptHost::setSlaveID(int slaveID)
+{
+    m_slaveID = slaveID;
+}
+
+int ScriptHost::slaveID() const noexcept
+{
+    return m_slaveID;
+}
+
+void ScriptHost::beginRun()
+{
+    m_aborted = false;
+    m_engine->setInterrupted(false);
+    m_step.clear();
+}
+
+// Stops the script at its next operation and releases the one waiting now
+void ScriptHost::abort()
+{
+    m_aborted = true;
+    m_engine->setInterrupted(true);
+    if (m_loop) {
+        m_loop->quit();
+    }
+}
+
+bool ScriptHost::isAborted() const noexcept
+{
+    return m_aborted;
+}
+
+QJSValue ScriptHost::read(const QString& type, int address, int count)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const QString operation = QString("read %1 %2 x%3").arg(type).arg(address).arg(count);
+
+    ModbusConnection::RegisterType registerType;
+    if (!TagDatabase::parseRegisterType(type, &registerType) || count < 1) {
+        fail(operation, timer, tr("Invalid read arguments"));
+        return QJSValue();
+    }
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        fail(operation, timer, tr("Not connected to any device"));
+        return QJSValue();
+    }
+
+    const bool bits = registerType == ModbusConnection::Coils || registerType == ModbusConnection::DiscreteInputs;
+    QModbusReply* reply = bits
+        ? m_modbusConnection->readBits(registerType, address, quint16(count), m_slaveID)
+        : m_modbusConnection->readRegister(registerType, address, quint16(count), m_slaveID);
+    if (!awaitReply(reply)) {
+        fail(operation, timer, reply ? reply->errorString() : tr("Failed to send read request"));
+        if (reply) reply->deleteLater();
+        return QJSValue();
+    }
+
+    QJSValue result = m_engine->newArray(quint32(count));
+    if (bits) {
+        const BitBlock block = ModbusConnection::bitsFromReply(reply);
+        for (int i = 0; i < block.size(); ++i) {
+            result.setProperty(quint32(i), int(block.testBit(i)));
+        }
+    }
+    else {
+        const QList<quint16> values = reply->result().values();
+        for (int i = 0; i < values.size(); ++i) {
+            result.setProperty(quint32(i), int(values[i]));
+        }
+    }
+    reply->deleteLater();
+
+    record(operation, timer, true);
+    return count == 1 ? result.property(0) : result;
+}
+
+// Builds the write PDU here so the script's current slave is addressed
+bool ScriptHost::write(const QString& type, int address, const QJSValue& values)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<int> data;
+    if (values.isArray()) {
+        const int length = values.property("length").toInt();
+        for (int i = 0; i < length; ++i) {
+            data.append(values.property(quint32(i)).toInt());
+        }
+    }
+    else {
+        data.append(values.isBool() ? int(values.toBool()) : values.toInt());
+    }
+    const QString operation = QString("write %1 %2 x%3").arg(type).arg(address).arg(data.size());
+
+    ModbusConnection::RegisterType registerType;
+    if (!TagDatabase::parseRegisterType(type, &registerType)
+        || (registerType != ModbusConnection::Coils && registerType != ModbusConnection::HoldingRegisters)
+        || data.isEmpty()) {
+        fail(operation, timer, tr("Invalid write arguments"));
+        return false;
+    }
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        fail(operation, timer, tr("Not connected to any device"));
+        return false;
+    }
+
+    PduBuilder pdu(registerType == ModbusConnection::Coils
+        ? (data.size() == 1 ? QModbusPdu::WriteSingleCoil : QModbusPdu::WriteMultipleCoils)
+        : (data.size() == 1 ? QModbusPdu::WriteSingleRegister : QModbusPdu::WriteMultipleRegisters));
+    pdu.put16(quint16(address));
+
+    if (registerType == ModbusConnection::Coils) {
+        if (data.size() == 1) {
+            pdu.put16(data[0] ? 0xFF00 : 0x0000);
+        }
+        else {
+            BitBlock bits(int(data.size()));
+            for (int i = 0; i < data.size(); ++i) {
+                bits.setBit(i, data[i] != 0);
+            }
+            pdu.put16(quint16(data.size())).put8(quint8(bits.packedSize())).putBits(bits);
+        }
+    }
+    else {
+        if (data.size() == 1) {
+            pdu.put16(quint16(data[0]));
+        }
+        else {
+            pdu.put16(quint16(data.size())).put8(quint8(data.size() * 2));
+            for (const int value : data) {
+                pdu.put16(quint16(value));
+            }
+        }
+    }
+    if (pdu.overflowed()) {
+        fail(operation, timer, tr("Too many values for one request"));
+        return false;
+    }
+
+    QModbusReply* reply = m_modbusConnection->sendRequest(pdu, m_slaveID);
+    if (!awaitReply(reply)) {
+        fail(operation, timer, reply ? reply->errorString() : tr("Failed to send write request"));
+        if (reply) reply->deleteLater();
+        return false;
+    }
+    reply->deleteLater();
+
+    record(operation, timer, true);
+    return true;
+}
+
+// FC23, returns the registers read after the write
+QJSValue ScriptHost::readWrite(int readAddress, int count, int writeAddress, const QJSValue& values)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<quint16> data;
+    if (values.isArray()) {
+        const int length = values.property("length").toInt();
+        for (int i = 0; i < length; ++i) {
+            data.append(quint16(values.property(quint32(i)).toInt()));
+        }
+    }
+    else {
+        data.append(quint16(values.toInt()));
+    }
+    const QString operation = QString("readWrite %1 x%2 <- %3 x%4")
+        .arg(readAddress).arg(count).arg(writeAddress).arg(data.size());
+
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        fail(operation, timer, tr("Not connected to any device"));
+        return QJSValue();
+    }
+
+    QModbusReply* reply = m_modbusConnection->readWriteMultipleRegisters(
+        readAddress, quint16(count), writeAddress, data, m_slaveID);
+    if (!awaitReply(reply)) {
+        fail(operation, timer, reply ? reply->errorString() : tr("Failed to send read/write request"));
+        if (reply) reply->deleteLater();
+        return QJSValue();
+    }
+
+    const QList<quint16> result = reply->result().values();
+    reply->deleteLater();
+    QJSValue array = m_engine->newArray(quint32(result.size()));
+    for (int i = 0; i < result.size(); ++i) {
+        array.setProperty(quint32(i), int(result[i]));
+    }
+
+    record(operation, timer, true);
+    return count == 1 ? array.property(0) : array;
+}
+
+// FC22, the slave applies (value & andMask) | (orMask & ~andMask)
+bool ScriptHost::maskWrite(int address, int andMask, int orMask)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const QString operation = QString("maskWrite %1 &0x%2 |0x%3")
+        .arg(address).arg(andMask, 4, 16, QChar('0')).arg(orMask, 4, 16, QChar('0'));
+
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        fail(operation, timer, tr("Not connected to any device"));
+        return false;
+    }
+
+    QModbusReply* reply = m_modbusConnection->maskWriteRegister(address, quint16(andMask), quint16(orMask), m_slaveID);
+    if (!awaitReply(reply)) {
+        fail(operation, timer, reply ? reply->errorString() : tr("Failed to send mask write request"));
+        if (reply) reply->deleteLater();
+        return false;
+    }
+    reply->deleteLater();
+
+    record(operation, timer, true);
+    return true;
+}
+
+// Any function code with raw data bytes, returns the response data bytes. A
+// vendor-specific code needs responseSize, its fixed response data length.
+QJSValue ScriptHost::request(int functionCode, const QJSValue& bytes, int responseSize)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const QString operation = QString("request 0x%1").arg(functionCode, 2, 16, QChar('0'));
+
+    PduBuilder pdu(quint8(functionCode));
+    const int length = bytes.isArray() ? bytes.property("length").toInt() : 0;
+    for (int i = 0; i < length; ++i) {
+        pdu.put8(quint8(bytes.property(quint32(i)).toInt()));
+    }
+    if (functionCode < 1 || functionCode > 0x7F || pdu.overflowed()) {
+        fail(operation, timer, tr("Invalid request arguments"));
+        return QJSValue();
+    }
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        fail(operation, timer, tr("Not connected to any device"));
+        return QJSValue();
+    }
+
+    // Standard codes are framed by the protocol stack; only custom ones take a size
+    if (responseSize >= 0 && !ModbusConnection::registerFunctionCode(quint8(functionCode), responseSize)) {
+        fail(operation, timer, ModbusConnection::isCustomFunctionCode(quint8(functionCode))
+            ? tr("Invalid response size %1").arg(responseSize)
+            : tr("Function code 0x%1 is standard, its response size cannot be overridden").arg(functionCode, 2, 16, QChar('0')));
+        return QJSValue();
+    }
+
+    QModbusReply* reply = m_modbusConnection->sendRequest(pdu, m_slaveID);
+    if (!awaitReply(reply)) {
+        fail(operation, timer, reply ? reply->errorString() : tr("Failed to send request"));
+        if (reply) reply->deleteLater();
+        return QJSValue();
+    }
+
+    const QByteArray data = reply->rawResult().data();
+    reply->deleteLater();
+    QJSValue array = m_engine->newArray(quint32(data.size()));
+    for (int i = 0; i < data.size(); ++i) {
+        array.setProperty(quint32(i), int(quint8(data[i])));
+    }
+
+    record(operation, timer, true);
+    return array;
+}
+
+void ScriptHost::wait(int msec)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QString operation = QString("wait %1").arg(msec);
+    if (!m_aborted) {
+        QEventLoop loop;
+        m_loop = &loop;
+        QTimer::singleShot(qMax(0, msec), &loop, &QEventLoop::quit);
+        loop.exec();
+        m_loop = nullptr;
+    }
+
+    if (m_aborted) {
+        fail(operation, timer, tr("Aborted"));
+        return;
+    }
+    record(operation, timer, true);
+}
+
+void ScriptHost::check(bool condition, const QString& message)
+{
+    if (condition) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    fail(QStringLiteral("assert"), timer, message.isEmpty() ? tr("Assertion failed") : message);
+}
+
+void ScriptHost::step(const QString& name)
+{
+    m_step = name;
+    emit message(tr("[slave %1] %2").arg(m_slaveID).arg(name));
+}
+
+void ScriptHost::log(const QString& text)
+{
+    emit message(tr("[slave %1] %2").arg(m_slaveID).arg(text));
+}
+
+QJSValue ScriptHost::decode(const QJSValue& registers, const QString& dataType, const QString& order)
+{
+    RegisterCodec::FieldDescriptor field;
+    if (!TagDatabase::parseDataType(dataType, &field.type)
+        || (!order.isEmpty() && !TagDatabase::parseByteOrder(order, &field.order))) {
+        m_engine->throwError(QJSValue::TypeError, tr("Unknown data type or byte order"));
+        return QJSValue();
+    }
+
+    QVector<quint16> values;
+    const int length = registers.property("length").toInt();
+    for (int i = 0; i < length; ++i) {
+        values.append(quint16(registers.property(quint32(i)).toInt()));
+    }
+    if (field.type == RegisterCodec::DataType::Ascii) {
+        field.length = int(values.size());
+    }
+
+    return m_engine->toScriptValue(RegisterCodec::decode(values.constData(), values.size(), field));
+}
+
+// Runs a nested event loop until the reply is done; false on error or abort.
+// User input is processed meanwhile so the Stop button reaches abort().
+bool ScriptHost::awaitReply(QModbusReply* reply)
+{
+    if (!reply || m_aborted) {
+        return false;
+    }
+
+    if (!reply->isFinished()) {
+        QEventLoop loop;
+        m_loop = &loop;
+        connect(reply, &QModbusReply::finished, &loop, &QEventLoop::quit);
+        loop.exec();
+        m_loop = nullptr;
+    }
+
+    return !m_aborted && reply->isFinished() && reply->error() == QModbusDevice::NoError;
+}
+
+void ScriptHost::record(const QString& operation, const QElapsedTimer& timer, bool ok, const QString& detail)
+{
+    ScriptStep entry;
+    entry.slaveID = m_slaveID;
+    entry.step = m_step;
+    entry.operation = operation;
+    entry.durationMs = timer.nsecsElapsed() / 1e6;
+    entry.ok = ok;
+    entry.detail = detail;
+    emit stepRecorded(entry);
+}
+
+// Records the failure and raises it as a script exception
+void ScriptHost::fail(const QString& operation, const QElapsedTimer& timer, const QString& error)
+{
+    const QString detail = m_aborted ? tr("Aborted") : error;
+    record(operation, timer, false, detail);
+    m_engine->throwError(QJSValue::GenericError, QString("%1: %2").arg(operation, detail));
+}
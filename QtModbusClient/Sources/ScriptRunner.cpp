@@ -0,0 +1,140 @@
+#include "ScriptRunner.h"
+#include <QDebug>
+
+namespace {
+    // Global shorthands so scripts can call read()/write()/... directly
+    const char* prelude = R"(
+        function read(type, address, count) { return modbus.read(type, address, count === undefined ? 1 : count); }
+        function write(type, address, values) { return modbus.write(type, address, values); }
+        function readWrite(readAddress, count, writeAddress, values) { return modbus.readWrite(readAddress, count, writeAddress, values); }
+        function maskWrite(address, andMask, orMask) { return modbus.maskWrite(address, andMask, orMask); }
+        function request(functionCode, bytes, responseSize) { return modbus.request(functionCode, bytes === undefined ? [] : bytes, responseSize === undefined ? -1 : responseSize); }
+        function wait(msec) { modbus.wait(msec); }
+        function assert(condition, message) { modbus.check(!!condition, message === undefined ? "" : String(message)); }
+        function step(name) { modbus.step(String(name)); }
+        function log(message) { modbus.log(String(message)); }
+        function decode(registers, type, order) { return modbus.decode(registers, type, order === undefined ? "" : order); }
+    )";
+
+    // The wrapper puts the script one line down
+    constexpr int wrapperLines = 1;
+}
+
+ScriptRunner::ScriptRunner(QObject* parent)
+    : QObject(parent)
+{
+    m_host = new ScriptHost(&m_engine, this);
+    m_engine.globalObject().setProperty("modbus", m_engine.newQObject(m_host));
+    m_engine.evaluate(QString::fromLatin1(prelude));
+
+    connect(m_host, &ScriptHost::message, this, &ScriptRunner::message);
+    connect(m_host, &ScriptHost::stepRecorded, this, &ScriptRunner::stepRecorded);
+}
+
+void ScriptRunner::setModbusConnection(ModbusConnection* connection)
+{
+    m_host->setModbusConnection(connection);
+}
+
+bool ScriptRunner::compile(const QString& source, QString* errorMessage)
+{
+    m_function = m_engine.evaluate(QString("(function(device) {\n%1\n})").arg(source), QStringLiteral("script"));
+    if (m_function.isError() || !m_function.isCallable()) {
+        if (errorMessage) {
+            *errorMessage = describeError(m_function);
+        }
+        m_function = QJSValue();
+        return false;
+    }
+    return true;
+}
+
+bool ScriptRunner::isCompiled() const
+{
+    return m_function.isCallable();
+}
+
+void ScriptRunner::run(const QList<int>& slaveIDs)
+{
+    if (m_running || !isCompiled()) {
+        return;
+    }
+
+    m_running = true;
+    m_host->beginRun();
+
+    int passed = 0;
+    int failed = 0;
+    for (const int slaveID : slaveIDs) {
+        if (m_host->isAborted()) {
+            break;
+        }
+
+        m_host->setSlaveID(slaveID);
+        const QJSValue result = m_function.call({ QJSValue(slaveID) });
+
+        const bool ok = !result.isError() && !m_host->isAborted();
+        const QString error = ok ? QString() : (m_host->isAborted() ? tr("Stopped") : describeError(result));
+        if (ok) {
+            ++passed;
+        }
+        else {
+            ++failed;
+        }
+        emit deviceFinished(slaveID, ok, error);
+    }
+
+    m_running = false;
+    emit finished(passed, failed);
+}
+
+void ScriptRunner::stop()
+{
+    if (m_running) {
+        m_host->abort();
+    }
+}
+
+bool ScriptRunner::isRunning() const noexcept
+{
+    return m_running;
+}
+
+// Accepts "1,2,5-8"
+QList<int> ScriptRunner::parseSlaveList(const QString& text, bool* ok)
+{
+    QList<int> slaveIDs;
+    bool valid = true;
+
+    for (const QString& part : text.split(',', Qt::SkipEmptyParts)) {
+        const QStringList bounds = part.trimmed().split('-');
+        bool firstOk = false;
+        bool lastOk = true;
+        const int first = bounds.value(0).trimmed().toInt(&firstOk);
+        const int last = bounds.size() > 1 ? bounds[1].trimmed().toInt(&lastOk) : first;
+        if (!firstOk || !lastOk || bounds.size() > 2 || first < 1 || last > 247 || last < first) {
+            valid = false;
+            break;
+        }
+        for (int id = first; id <= last; ++id) {
+            slaveIDs.append(id);
+        }
+    }
+
+    if (slaveIDs.isEmpty()) {
+        valid = false;
+    }
+    if (ok) {
+        *ok = valid;
+    }
+    return valid ? slaveIDs : QList<int>();
+}
+
+QString ScriptRunner::describeError(const QJSValue& error)
+{
+    const int line = error.property("lineNumber").toInt() - wrapperLines;
+    if (line > 0) {
+        return tr("Line %1: %2").arg(line).arg(error.toString());
+    }
+    return error.toString();
+}
@@ -0,0 +1,278 @@
+#include "SerialPortScanner.h"
+#include <QPromise>
+#include <QThreadPool>
+#include <QSocketNotifier>
+#include <QSet>
+#include <QDebug>
+#include <memory>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+    constexpr int debounceMs = 300;
+    constexpr int pollIntervalMs = 2000;
+
+    QList<SerialPortEntry> scanPorts()
+    {
+        QList<SerialPortEntry> entries;
+        const auto ports = QSerialPortInfo::availablePorts();
+        for (const QSerialPortInfo& info : ports) {
+            SerialPortEntry entry;
+            entry.portName = info.portName();
+            entry.systemLocation = info.systemLocation();
+            entry.description = info.description();
+            entry.manufacturer = info.manufacturer();
+            entry.serialNumber = info.serialNumber();
+            entry.hasIds = info.hasVendorIdentifier() && info.hasProductIdentifier();
+            entry.vendorId = info.vendorIdentifier();
+            entry.productId = info.productIdentifier();
+            entries.append(entry);
+        }
+        return entries;
+    }
+}
+
+QString SerialPortEntry::identity() const
+{
+    if (hasIds && !serialNumber.isEmpty()) {
+        return QString("%1:%2:%3").arg(vendorId, 4, 16, QChar('0')).arg(productId, 4, 16, QChar('0')).arg(serialNumber);
+    }
+    return systemLocation.isEmpty() ? portName : systemLocation;
+}
+
+QString SerialPortEntry::details() const
+{
+    QStringList parts;
+    if (!description.isEmpty()) {
+        parts << description;
+    }
+    if (!manufacturer.isEmpty()) {
+        parts << manufacturer;
+    }
+    if (hasIds) {
+        parts << QString("%1:%2").arg(vendorId, 4, 16, QChar('0')).arg(productId, 4, 16, QChar('0'));
+    }
+    if (!serialNumber.isEmpty()) {
+        parts << QString("S/N %1").arg(serialNumber);
+    }
+    return parts.join(", ");
+}
+
+SerialPortScanner::SerialPortScanner(QObject* parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<QList<SerialPortEntry>>::finished, this, &SerialPortScanner::handleScanFinished);
+
+    m_debounceTimer.setSingleShot(true);
+    m_debounceTimer.setInterval(debounceMs);
+    connect(&m_debounceTimer, &QTimer::timeout, this, &SerialPortScanner::refresh);
+
+    m_pollTimer.setInterval(pollIntervalMs);
+    connect(&m_pollTimer, &QTimer::timeout, this, &SerialPortScanner::refresh);
+}
+
+// The pool task only touches its promise, so it can outlive the scanner
+SerialPortScanner::~SerialPortScanner()
+{
+    m_watcher.disconnect(this);
+    closeUeventSocket();
+}
+
+QStringList SerialPortScanner::ports() const
+{
+    QStringList names;
+    for (const SerialPortEntry& entry : m_entries) {
+        names.append(entry.portName);
+    }
+    return names;
+}
+
+QList<SerialPortEntry> SerialPortScanner::entries() const
+{
+    return m_entries;
+}
+
+bool SerialPortScanner::hasResult() const noexcept
+{
+    return m_age.isValid();
+}
+
+bool SerialPortScanner::isScanning() const
+{
+    return m_watcher.isRunning();
+}
+
+void SerialPortScanner::refreshIfStale(int maxAgeMs)
+{
+    if (!m_age.isValid() || m_age.hasExpired(maxAgeMs)) {
+        refresh();
+    }
+}
+
+void SerialPortScanner::startMonitoring()
+{
+    if (m_monitoring) {
+        return;
+    }
+    m_monitoring = true;
+
+    if (!openUeventSocket()) {
+        m_pollTimer.start();
+    }
+    refresh();
+}
+
+void SerialPortScanner::stopMonitoring()
+{
+    m_monitoring = false;
+    m_pollTimer.stop();
+    m_debounceTimer.stop();
+    closeUeventSocket();
+}
+
+bool SerialPortScanner::isMonitoring() const noexcept
+{
+    return m_monitoring;
+}
+
+void SerialPortScanner::refresh()
+{
+    // A change seen mid-scan may be missing from its result, so scan once more afterwards
+    if (isScanning()) {
+        m_rescanPending = true;
+        return;
+    }
+
+    auto promise = std::make_shared<QPromise<QList<SerialPortEntry>>>();
+    m_watcher.setFuture(promise->future());
+    promise->start();
+
+    QThreadPool::globalInstance()->start([promise]() {
+        promise->addResult(scanPorts());
+        promise->finish();
+        });
+}
+
+// Reports the difference to the previous scan, matched by port name
+void SerialPortScanner::handleScanFinished()
+{
+    const QFuture<QList<SerialPortEntry>> future = m_watcher.future();
+    if (future.resultCount() == 0) {
+        return;
+    }
+
+    const QList<SerialPortEntry> previous = m_entries;
+    const bool first = !m_age.isValid();
+    m_entries = future.result();
+    m_age.start();
+
+    if (!first) {
+        QSet<QString> oldNames;
+        for (const SerialPortEntry& entry : previous) {
+            oldNames.insert(entry.portName);
+        }
+        QSet<QString> newNames;
+        for (const SerialPortEntry& entry : m_entries) {
+            newNames.insert(entry.portName);
+        }
+
+        for (const SerialPortEntry& entry : previous) {
+            if (!newNames.contains(entry.portName)) {
+                qDebug() << "Serial port removed:" << entry.portName;
+                emit portRemoved(entry);
+            }
+        }
+        for (const SerialPortEntry& entry : m_entries) {
+            if (!oldNames.contains(entry.portName)) {
+                qDebug() << "Serial port added:" << entry.portName << entry.details();
+                emit portAdded(entry);
+            }
+        }
+    }
+
+    emit portsUpdated(ports());
+
+    if (m_rescanPending) {
+        m_rescanPending = false;
+        refresh();
+    }
+}
+
+// Kernel uevents are NUL separated "KEY=value" strings; only tty changes matter
+void SerialPortScanner::handleUevent()
+{
+#ifdef Q_OS_LINUX
+    char buffer[8192];
+    bool relevant = false;
+
+    for (;;) {
+        const ssize_t length = ::recv(m_ueventSocket, buffer, sizeof(buffer) - 1, 0);
+        if (length <= 0) {
+            if (length < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                qWarning() << "uevent socket failed, falling back to polling";
+                closeUeventSocket();
+                m_pollTimer.start();
+            }
+            break;
+        }
+        buffer[length] = '\0';
+
+        for (ssize_t offset = 0; offset < length; ) {
+            const char* field = buffer + offset;
+            const size_t fieldLength = qstrlen(field);
+            if (qstrcmp(field, "SUBSYSTEM=tty") == 0) {
+                relevant = true;
+            }
+            offset += ssize_t(fieldLength) + 1;
+        }
+    }
+
+    if (relevant) {
+        m_debounceTimer.start();
+    }
+#endif
+}
+
+bool SerialPortScanner::openUeventSocket()
+{
+#ifdef Q_OS_LINUX
+    const int fd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        qWarning() << "Failed to open uevent socket, polling serial ports instead";
+        return false;
+    }
+
+    sockaddr_nl address = {};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1;  // kernel broadcast group
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        qWarning() << "Failed to bind uevent socket, polling serial ports instead";
+        ::close(fd);
+        return false;
+    }
+
+    m_ueventSocket = fd;
+    m_ueventNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_ueventNotifier, &QSocketNotifier::activated, this, &SerialPortScanner::handleUevent);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SerialPortScanner::closeUeventSocket()
+{
+    delete m_ueventNotifier;
+    m_ueventNotifier = nullptr;
+#ifdef Q_OS_LINUX
+    if (m_ueventSocket >= 0) {
+        ::close(m_ueventSocket);
+    }
+#endif
+    m_ueventSocket = -1;
+}
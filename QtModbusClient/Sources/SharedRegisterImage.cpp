@@ -0,0 +1,351 @@
+#include "SharedRegisterImage.h"
+#include <QDateTime>
+#include <QNativeIpcKey>
+#include <QThread>
+#include <QDebug>
+#include <cstring>
+
+using namespace SharedImageLayout;
+
+namespace {
+    // A reader gives up after this many torn reads in a row
+    constexpr int maxReadAttempts = 64;
+
+    QNativeIpcKey nativeKeyFor(const QString& name)
+    {
+#if defined(Q_OS_UNIX)
+        // Plain POSIX name so non-Qt readers can shm_open() it directly
+        return QNativeIpcKey(QLatin1Char('/') + name, QNativeIpcKey::Type::PosixRealtime);
+#else
+        return QNativeIpcKey(name);
+#endif
+    }
+
+    template<typename Writer>
+    void writeLocked(SharedRegion* region, Writer write)
+    {
+        const quint32 sequence = region->sequence.load(std::memory_order_relaxed);
+        region->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        write();
+        region->updatedMsecs = QDateTime::currentMSecsSinceEpoch();
+
+        region->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    template<typename Reader>
+    bool readLocked(const SharedRegion* region, Reader read)
+    {
+        for (int attempt = 0; attempt < maxReadAttempts; ++attempt) {
+            const quint32 before = region->sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                QThread::yieldCurrentThread();
+                continue;
+            }
+
+            const bool ok = read();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (region->sequence.load(std::memory_order_relaxed) == before) {
+                return ok;
+            }
+        }
+        return false;
+    }
+
+    void markValid(quint8* valid, int start, int count)
+    {
+        for (int i = start; i < start + count; ++i) {
+            valid[i / 8] |= quint8(1u << (i % 8));
+        }
+    }
+
+    bool isValid(const quint8* valid, int start, int count)
+    {
+        for (int i = start; i < start + count; ++i) {
+            if (!(valid[i / 8] & (1u << (i % 8)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool isBitType(ModbusConnection::RegisterType type)
+    {
+        return type == ModbusConnection::Coils || type == ModbusConnection::DiscreteInputs;
+    }
+}
+
+SharedRegisterImage::SharedRegisterImage(QObject* parent)
+    : QObject(parent)
+{
+}
+
+SharedRegisterImage::~SharedRegisterImage()
+{
+    detach();
+}
+
+QString SharedRegisterImage::defaultName()
+{
+    return QStringLiteral("qtmodbusclient-image");
+}
+
+bool SharedRegisterImage::create(const QString& name, int slotCount, QString* errorMessage)
+{
+    detach();
+    slotCount = qBound(1, slotCount, 247);
+
+    const qsizetype size = qsizetype(sizeof(SharedImageHeader)) + qsizetype(slotCount) * qsizetype(sizeof(SharedSlaveImage));
+    m_memory.setNativeKey(nativeKeyFor(name));
+
+    if (!m_memory.create(size)) {
+        // Left behind by a previous run that did not shut down cleanly
+        if (m_memory.error() != QSharedMemory::AlreadyExists || !m_memory.attach()) {
+            if (errorMessage) {
+                *errorMessage = m_memory.errorString();
+            }
+            return false;
+        }
+        return adoptExisting(errorMessage);
+    }
+
+    std::memset(m_memory.data(), 0, size_t(size));
+    auto* header = static_cast<SharedImageHeader*>(m_memory.data());
+    header->slotCount = quint32(slotCount);
+    header->slotSize = quint32(sizeof(SharedSlaveImage));
+    header->version = version;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = magic;
+
+    m_writer = true;
+    qDebug() << "Shared register image created:" << m_memory.nativeIpcKey().nativeKey()
+        << "slots:" << slotCount << "size:" << size;
+    return true;
+}
+
+// Readers may already be mapped onto the segment, so its content is kept:
+// only a segment laid out as a register image is taken over, and regions a
+// dead writer left mid-update are closed
+bool SharedRegisterImage::adoptExisting(QString* errorMessage)
+{
+    auto* base = static_cast<char*>(m_memory.data());
+    const auto* header = reinterpret_cast<const SharedImageHeader*>(base);
+    const bool isImage = m_memory.size() >= qsizetype(sizeof(SharedImageHeader))
+        && header->magic == magic && header->version == version
+        && header->slotSize == sizeof(SharedSlaveImage) && header->slotCount >= 1
+        && m_memory.size() >= qsizetype(sizeof(SharedImageHeader))
+            + qsizetype(header->slotCount) * qsizetype(sizeof(SharedSlaveImage));
+    if (!isImage) {
+        m_memory.detach();
+        if (errorMessage) {
+            *errorMessage = tr("Existing shared memory segment is not a register image");
+        }
+        return false;
+    }
+
+    auto* slots = reinterpret_cast<SharedSlaveImage*>(base + sizeof(SharedImageHeader));
+    for (quint32 i = 0; i < header->slotCount; ++i) {
+        SharedRegion* const regions[] = { &slots[i].coils, &slots[i].discreteInputs,
+            &slots[i].inputRegisters, &slots[i].holdingRegisters };
+        for (SharedRegion* region : regions) {
+            const quint32 sequence = region->sequence.load(std::memory_order_relaxed);
+            if (sequence & 1) {
+                region->sequence.store(sequence + 1, std::memory_order_release);
+            }
+        }
+    }
+
+    m_writer = true;
+    qDebug() << "Shared register image taken over:" << m_memory.nativeIpcKey().nativeKey()
+        << "slots:" << header->slotCount;
+    return true;
+}
+
+bool SharedRegisterImage::attach(const QString& name, QString* errorMessage)
+{
+    detach();
+    m_memory.setNativeKey(nativeKeyFor(name));
+
+    if (!m_memory.attach(QSharedMemory::ReadOnly)) {
+        if (errorMessage) {
+            *errorMessage = m_memory.errorString();
+        }
+        return false;
+    }
+
+    const auto* header = static_cast<const SharedImageHeader*>(m_memory.constData());
+    if (m_memory.size() < qsizetype(sizeof(SharedImageHeader)) || header->magic != magic
+        || header->version != version || header->slotSize != sizeof(SharedSlaveImage)) {
+        m_memory.detach();
+        if (errorMessage) {
+            *errorMessage = tr("Shared memory segment has an unknown layout");
+        }
+        return false;
+    }
+
+    m_writer = false;
+    return true;
+}
+
+void SharedRegisterImage::detach()
+{
+    setModbusConnection(nullptr);
+    if (m_memory.isAttached()) {
+        m_memory.detach();
+    }
+    m_writer = false;
+}
+
+bool SharedRegisterImage::isAttached() const
+{
+    return m_memory.isAttached();
+}
+
+QString SharedRegisterImage::nativeKey() const
+{
+    return m_memory.nativeIpcKey().nativeKey();
+}
+
+void SharedRegisterImage::setModbusConnection(ModbusConnection* connection)
+{
+    if (m_modbusConnection) {
+        disconnect(m_modbusConnection, nullptr, this, nullptr);
+    }
+
+    m_modbusConnection = connection;
+    if (m_modbusConnection) {
+        connect(m_modbusConnection, &ModbusConnection::registersRead, this, &SharedRegisterImage::publishRegisters);
+        connect(m_modbusConnection, &ModbusConnection::bitsRead, this, &SharedRegisterImage::publishBits);
+    }
+}
+
+void SharedRegisterImage::publishRegisters(int slaveID, ModbusConnection::RegisterType type, int startAddr,
+    const QVector<quint16>& values)
+{
+    // Coils read through the data unit API arrive as one value per bit
+    if (isBitType(type)) {
+        BitBlock bits(int(values.size()));
+        for (int i = 0; i < values.size(); ++i) {
+            bits.setBit(i, values[i] != 0);
+        }
+        publishBits(slaveID, type, startAddr, bits);
+        return;
+    }
+
+    SharedSlaveImage* slave = slot(slaveID, true);
+    if (!slave || startAddr < 0) {
+        return;
+    }
+
+    auto* target = static_cast<SharedRegisterRegion*>(region(slave, type));
+    const int count = qMin(int(values.size()), addressCount - startAddr);
+    writeLocked(target, [&]() {
+        std::memcpy(target->values + startAddr, values.constData(), size_t(count) * sizeof(quint16));
+        markValid(target->valid, startAddr, count);
+        });
+}
+
+void SharedRegisterImage::publishBits(int slaveID, ModbusConnection::RegisterType type, int startAddr,
+    const BitBlock& bits)
+{
+    SharedSlaveImage* slave = slot(slaveID, true);
+    if (!slave || !isBitType(type) || startAddr < 0) {
+        return;
+    }
+
+    auto* target = static_cast<SharedBitRegion*>(region(slave, type));
+    const int count = qMin(bits.size(), addressCount - startAddr);
+    writeLocked(target, [&]() {
+        for (int i = 0; i < count; ++i) {
+            const int address = startAddr + i;
+            const quint8 mask = quint8(1u << (address % 8));
+            if (bits.testBit(i)) {
+                target->bits[address / 8] |= mask;
+            }
+            else {
+                target->bits[address / 8] &= quint8(~mask);
+            }
+        }
+        markValid(target->valid, startAddr, count);
+        });
+}
+
+bool SharedRegisterImage::readRegisters(int slaveID, ModbusConnection::RegisterType type, int startAddr, int count,
+    QVector<quint16>* values) const
+{
+    SharedSlaveImage* slave = slot(slaveID, false);
+    if (!slave || isBitType(type) || startAddr < 0 || count <= 0 || startAddr + count > addressCount) {
+        return false;
+    }
+
+    const auto* source = static_cast<const SharedRegisterRegion*>(region(slave, type));
+    values->resize(count);
+    return readLocked(source, [&]() {
+        std::memcpy(values->data(), source->values + startAddr, size_t(count) * sizeof(quint16));
+        return isValid(source->valid, startAddr, count);
+        });
+}
+
+bool SharedRegisterImage::readBits(int slaveID, ModbusConnection::RegisterType type, int startAddr, int count,
+    BitBlock* bits) const
+{
+    SharedSlaveImage* slave = slot(slaveID, false);
+    if (!slave || !isBitType(type) || startAddr < 0 || count <= 0 || startAddr + count > addressCount) {
+        return false;
+    }
+
+    const auto* source = static_cast<const SharedBitRegion*>(region(slave, type));
+    return readLocked(source, [&]() {
+        // Byte-aligned copy, then shift down to the requested start
+        const int firstByte = startAddr / 8;
+        const int lastByte = (startAddr + count - 1) / 8;
+        const BitBlock block = BitBlock::fromPackedBytes(
+            reinterpret_cast<const char*>(source->bits + firstByte), lastByte - firstByte + 1,
+            (lastByte - firstByte + 1) * 8);
+        *bits = block.mid(startAddr % 8, count);
+        return isValid(source->valid, startAddr, count);
+        });
+}
+
+// Finds the slot of a slave; the writer claims a free slot on first publish
+SharedSlaveImage* SharedRegisterImage::slot(int slaveID, bool allocate) const
+{
+    if (!m_memory.isAttached() || slaveID <= 0) {
+        return nullptr;
+    }
+
+    auto* base = static_cast<char*>(const_cast<void*>(m_memory.constData()));
+    const auto* header = reinterpret_cast<const SharedImageHeader*>(base);
+    auto* slots = reinterpret_cast<SharedSlaveImage*>(base + sizeof(SharedImageHeader));
+
+    for (quint32 i = 0; i < header->slotCount; ++i) {
+        const quint32 owner = slots[i].slaveID.load(std::memory_order_acquire);
+        if (owner == quint32(slaveID)) {
+            return &slots[i];
+        }
+        if (owner == 0) {
+            if (!allocate || !m_writer) {
+                return nullptr;
+            }
+            slots[i].slaveID.store(quint32(slaveID), std::memory_order_release);
+            return &slots[i];
+        }
+    }
+
+    if (allocate) {
+        qWarning() << "Shared register image has no free slot for slave" << slaveID;
+    }
+    return nullptr;
+}
+
+SharedRegion* SharedRegisterImage::region(SharedSlaveImage* slave, ModbusConnection::RegisterType type)
+{
+    switch (type) {
+    case ModbusConnection::Coils: return &slave->coils;
+    case ModbusConnection::DiscreteInputs: return &slave->discreteInputs;
+    case ModbusConnection::InputRegisters: return &slave->inputRegisters;
+    case ModbusConnection::HoldingRegisters: return &slave->holdingRegisters;
+    }
+    return &slave->holdingRegisters;
+}
@@ -0,0 +1,152 @@
+#include "SnapshotCapture.h"
+#include <QModbusReply>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+    constexpr int maxRegistersPerRead = 125;
+    constexpr int maxBitsPerRead = 2000;
+}
+
+SnapshotCapture::SnapshotCapture(QObject* parent)
+    : QObject(parent)
+{
+}
+
+void SnapshotCapture::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+}
+
+bool SnapshotCapture::start(const QList<SnapshotRange>& ranges, const QString& name)
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected() || ranges.isEmpty()) {
+        return false;
+    }
+
+    ++m_generation;
+    m_ranges = ranges;
+    m_segments.clear();
+    m_snapshot = RegisterSnapshot();
+    m_snapshot.setName(name);
+    m_snapshot.setSlaveID(m_modbusConnection->getSlaveID());
+    m_snapshot.setTimestamp(QDateTime::currentDateTime());
+
+    m_total = 0;
+    for (const SnapshotRange& range : m_ranges) {
+        SnapshotSegment segment;
+        segment.type = range.type;
+        segment.start = range.start;
+        if (segment.isBits()) {
+            segment.bits = BitBlock(range.count);
+        }
+        else {
+            segment.registers = QVector<quint16>(range.count, 0);
+        }
+        m_segments.append(segment);
+        m_total += range.count;
+    }
+
+    m_rangeIndex = 0;
+    m_offset = 0;
+    m_done = 0;
+    m_running = true;
+    readNextChunk();
+    return true;
+}
+
+void SnapshotCapture::cancel()
+{
+    ++m_generation;
+    m_running = false;
+}
+
+bool SnapshotCapture::isRunning() const noexcept
+{
+    return m_running;
+}
+
+void SnapshotCapture::readNextChunk()
+{
+    while (m_rangeIndex < m_ranges.size() && m_offset >= m_ranges[m_rangeIndex].count) {
+        ++m_rangeIndex;
+        m_offset = 0;
+    }
+
+    if (m_rangeIndex >= m_ranges.size()) {
+        m_running = false;
+        for (const SnapshotSegment& segment : std::as_const(m_segments)) {
+            m_snapshot.addSegment(segment);
+        }
+        emit finished(m_snapshot);
+        return;
+    }
+
+    const SnapshotRange& range = m_ranges[m_rangeIndex];
+    const bool bits = range.type == ModbusConnection::Coils || range.type == ModbusConnection::DiscreteInputs;
+    const int count = qMin(range.count - m_offset, bits ? maxBitsPerRead : maxRegistersPerRead);
+    const int address = range.start + m_offset;
+
+    QModbusReply* reply = bits
+        ? m_modbusConnection->readBits(range.type, address, quint16(count))
+        : m_modbusConnection->readRegister(range.type, address, quint16(count));
+    if (!reply) {
+        fail(tr("Failed to send read request at address %1").arg(address));
+        return;
+    }
+
+    const quint64 generation = m_generation;
+    const int rangeIndex = m_rangeIndex;
+    const int offset = m_offset;
+    m_offset += count;
+    connect(reply, &QModbusReply::finished, this, [this, generation, rangeIndex, offset, reply]() {
+        handleChunkReply(generation, rangeIndex, offset, reply);
+        });
+}
+
+// Copies a chunk into its segment; the snapshot is complete only when every chunk succeeded
+void SnapshotCapture::handleChunkReply(quint64 generation, int rangeIndex, int offset, QModbusReply* reply)
+{
+    reply->deleteLater();
+    if (generation != m_generation) {
+        return;
+    }
+
+    if (reply->error() != QModbusDevice::NoError) {
+        fail(reply->errorString());
+        return;
+    }
+
+    SnapshotSegment& segment = m_segments[rangeIndex];
+    int received = 0;
+    if (segment.isBits()) {
+        const BitBlock bits = ModbusConnection::bitsFromReply(reply);
+        for (int i = bits.nextSetBit(0); i >= 0; i = bits.nextSetBit(i + 1)) {
+            segment.bits.setBit(offset + i);
+        }
+        received = bits.size();
+    }
+    else {
+        const QList<quint16> values = reply->result().values();
+        std::copy_n(values.constBegin(), qMin<qsizetype>(values.size(), segment.registers.size() - offset),
+            segment.registers.begin() + offset);
+        received = int(values.size());
+    }
+
+    if (received == 0) {
+        fail(tr("Empty response for %1 at offset %2").arg(segment.start).arg(offset));
+        return;
+    }
+
+    m_done += received;
+    emit progress(m_done, m_total);
+    readNextChunk();
+}
+
+void SnapshotCapture::fail(const QString& errorMessage)
+{
+    ++m_generation;
+    m_running = false;
+    qWarning() << "Snapshot capture failed:" << errorMessage;
+    emit failed(errorMessage);
+}
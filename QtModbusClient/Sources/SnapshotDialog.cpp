@@ -0,0 +1,240 @@
+#include "SnapshotDialog.h"
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QHeaderView>
+#include <QDebug>
+
+namespace {
+    enum Column { TypeColumn, StartColumn, CountColumn, BeforeColumn, AfterColumn };
+
+    // Ranges longer than this only show their first values
+    constexpr int maxShownValues = 8;
+
+    QString registerTypeName(ModbusConnection::RegisterType type)
+    {
+        switch (type) {
+        case ModbusConnection::Coils: return QStringLiteral("Coil");
+        case ModbusConnection::DiscreteInputs: return QStringLiteral("DI");
+        case ModbusConnection::InputRegisters: return QStringLiteral("IR");
+        case ModbusConnection::HoldingRegisters: return QStringLiteral("HR");
+        }
+        return QString();
+    }
+
+    QString formatValues(const RegisterSnapshot& snapshot, const SnapshotChange& change)
+    {
+        const bool bits = change.type == ModbusConnection::Coils || change.type == ModbusConnection::DiscreteInputs;
+        QStringList values;
+        const int shown = qMin(change.range.count, maxShownValues);
+        for (int i = 0; i < shown; ++i) {
+            const quint16 value = snapshot.value(change.type, change.range.start + i);
+            values << (bits ? QString::number(value) : QString("0x%1").arg(value, 4, 16, QChar('0')).toUpper());
+        }
+        if (change.range.count > shown) {
+            values << QStringLiteral("...");
+        }
+        return values.join(' ');
+    }
+}
+
+SnapshotDialog::SnapshotDialog(QWidget* parent)
+    : QDialog(parent)
+{
+    ui.setupUi(this);
+    m_capture = new SnapshotCapture(this);
+    initUI();
+    setupConnections();
+}
+
+SnapshotDialog::~SnapshotDialog()
+{
+    m_capture->cancel();
+}
+
+void SnapshotDialog::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+    m_capture->setModbusConnection(connection);
+}
+
+void SnapshotDialog::initUI()
+{
+    m_diffModel = new QStandardItemModel(this);
+    m_diffModel->setHorizontalHeaderLabels({ tr("Type"), tr("Start"), tr("Count"), tr("Before"), tr("After") });
+    ui.snapshotDiffTableView->setModel(m_diffModel);
+    ui.snapshotDiffTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    ui.snapshotDiffTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+    ui.snapshotAfterComboBox->addItem(tr("Live"), -1);
+    ui.snapshotProgressBar->setValue(0);
+}
+
+void SnapshotDialog::setupConnections()
+{
+    connect(ui.snapshotCaptureBtn, &QPushButton::clicked, this, &SnapshotDialog::onCapture);
+    connect(ui.snapshotLoadBtn, &QPushButton::clicked, this, &SnapshotDialog::onLoad);
+    connect(ui.snapshotSaveBtn, &QPushButton::clicked, this, &SnapshotDialog::onSave);
+    connect(ui.snapshotCompareBtn, &QPushButton::clicked, this, &SnapshotDialog::onCompare);
+    connect(ui.snapshotCloseBtn, &QPushButton::clicked, this, &QDialog::reject);
+
+    connect(m_capture, &SnapshotCapture::progress, this, &SnapshotDialog::handleCaptureProgress);
+    connect(m_capture, &SnapshotCapture::finished, this, &SnapshotDialog::handleCaptureFinished);
+    connect(m_capture, &SnapshotCapture::failed, this, &SnapshotDialog::handleCaptureFailed);
+}
+
+void SnapshotDialog::onCapture()
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    QList<SnapshotRange> ranges;
+    QString error;
+    if (!RegisterSnapshot::parseRanges(ui.snapshotRangesLineEdit->text(), &ranges, &error)) {
+        QMessageBox::critical(this, tr("Error"), error);
+        return;
+    }
+
+    m_liveCompareIndex = -1;
+    const QString name = tr("Snapshot %1").arg(m_snapshots.size() + 1);
+    if (m_capture->start(ranges, name)) {
+        setBusy(true);
+    }
+}
+
+void SnapshotDialog::onLoad()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Load Snapshot"),
+        QString(), tr("Register snapshots (*.mbsnap);;All files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    RegisterSnapshot snapshot;
+    QString error;
+    if (!snapshot.load(fileName, &error)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to load snapshot: %1").arg(error));
+        return;
+    }
+    addSnapshot(snapshot);
+}
+
+void SnapshotDialog::onSave()
+{
+    const int row = ui.snapshotListWidget->currentRow();
+    if (row < 0 || row >= m_snapshots.size()) {
+        QMessageBox::warning(this, tr("Error"), tr("Select a snapshot to save"));
+        return;
+    }
+
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Save Snapshot"),
+        m_snapshots[row].name() + ".mbsnap", tr("Register snapshots (*.mbsnap)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QString error;
+    if (!m_snapshots[row].save(fileName, &error)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to save snapshot: %1").arg(error));
+    }
+}
+
+// Compares two stored snapshots, or captures the before snapshot's ranges again for a live compare
+void SnapshotDialog::onCompare()
+{
+    const int before = ui.snapshotBeforeComboBox->currentData().toInt();
+    const int after = ui.snapshotAfterComboBox->currentData().toInt();
+    if (before < 0 || before >= m_snapshots.size()) {
+        QMessageBox::warning(this, tr("Error"), tr("Select a snapshot to compare"));
+        return;
+    }
+
+    if (after >= 0) {
+        showComparison(m_snapshots[before], m_snapshots[after]);
+        return;
+    }
+
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    m_liveCompareIndex = before;
+    const QString name = tr("Snapshot %1").arg(m_snapshots.size() + 1);
+    if (m_capture->start(m_snapshots[before].ranges(), name)) {
+        setBusy(true);
+    }
+}
+
+void SnapshotDialog::handleCaptureProgress(int done, int total)
+{
+    ui.snapshotProgressBar->setMaximum(total);
+    ui.snapshotProgressBar->setValue(done);
+}
+
+void SnapshotDialog::handleCaptureFinished(const RegisterSnapshot& snapshot)
+{
+    setBusy(false);
+    addSnapshot(snapshot);
+
+    if (m_liveCompareIndex >= 0 && m_liveCompareIndex < m_snapshots.size()) {
+        showComparison(m_snapshots[m_liveCompareIndex], snapshot);
+    }
+    m_liveCompareIndex = -1;
+}
+
+void SnapshotDialog::handleCaptureFailed(const QString& errorMessage)
+{
+    setBusy(false);
+    m_liveCompareIndex = -1;
+    QMessageBox::critical(this, tr("Error"), tr("Snapshot capture failed: %1").arg(errorMessage));
+}
+
+void SnapshotDialog::addSnapshot(const RegisterSnapshot& snapshot)
+{
+    const int index = int(m_snapshots.size());
+    m_snapshots.append(snapshot);
+
+    const QString label = tr("%1 - slave %2 - %3")
+        .arg(snapshot.name())
+        .arg(snapshot.slaveID())
+        .arg(snapshot.timestamp().toString("yyyy-MM-dd hh:mm:ss"));
+    ui.snapshotListWidget->addItem(label);
+    ui.snapshotListWidget->setCurrentRow(index);
+    ui.snapshotBeforeComboBox->addItem(label, index);
+    ui.snapshotAfterComboBox->addItem(label, index);
+}
+
+void SnapshotDialog::showComparison(const RegisterSnapshot& before, const RegisterSnapshot& after)
+{
+    const QList<SnapshotChange> changes = RegisterSnapshot::compare(before, after);
+
+    m_diffModel->removeRows(0, m_diffModel->rowCount());
+    int changedCount = 0;
+    for (const SnapshotChange& change : changes) {
+        QList<QStandardItem*> rowItems;
+        rowItems << new QStandardItem(registerTypeName(change.type));
+        rowItems << new QStandardItem(QString::number(change.range.start));
+        rowItems << new QStandardItem(QString::number(change.range.count));
+        rowItems << new QStandardItem(formatValues(before, change));
+        rowItems << new QStandardItem(formatValues(after, change));
+        m_diffModel->appendRow(rowItems);
+        changedCount += change.range.count;
+    }
+
+    ui.snapshotResultLabel->setText(changes.isEmpty()
+        ? tr("No differences")
+        : tr("%1 changed addresses in %2 ranges").arg(changedCount).arg(changes.size()));
+    qDebug() << "Snapshot compare:" << before.name() << "->" << after.name()
+        << changes.size() << "changed ranges";
+}
+
+void SnapshotDialog::setBusy(bool busy)
+{
+    ui.snapshotCaptureBtn->setEnabled(!busy);
+    ui.snapshotCompareBtn->setEnabled(!busy);
+    if (busy) {
+        ui.snapshotProgressBar->setValue(0);
+    }
+}
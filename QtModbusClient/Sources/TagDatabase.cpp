@@ -0,0 +1,285 @@
+#include "TagDatabase.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+
+namespace {
+    const QString defaultPollClass = QStringLiteral("normal");
+    const int defaultPollInterval = 1000;
+
+    void setError(QString* errorMessage, const QString& text)
+    {
+        if (errorMessage) {
+            *errorMessage = text;
+        }
+    }
+}
+
+int Tag::width() const noexcept
+{
+    if (type == ModbusConnection::Coils || type == ModbusConnection::DiscreteInputs) {
+        return 1;
+    }
+    return RegisterCodec::registerWidth(dataType, length);
+}
+
+TagDatabase::TagDatabase()
+{
+    clear();
+}
+
+bool TagDatabase::load(const QString& fileName, QString* errorMessage)
+{
+    if (QFileInfo(fileName).suffix().compare("json", Qt::CaseInsensitive) == 0) {
+        return loadJson(fileName, errorMessage);
+    }
+    return loadCsv(fileName, errorMessage);
+}
+
+// CSV columns: name,slave,type,address,datatype,order,scale,offset,pollclass[,length]
+bool TagDatabase::loadCsv(const QString& fileName, QString* errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        setError(errorMessage, file.errorString());
+        return false;
+    }
+
+    clear();
+
+    QTextStream in(&file);
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        ++lineNumber;
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+
+        const QStringList fields = line.split(',');
+        if (fields.value(0).trimmed().compare("name", Qt::CaseInsensitive) == 0) {
+            continue;
+        }
+        if (fields.size() < 4) {
+            setError(errorMessage, QObject::tr("Line %1: expected at least 4 columns").arg(lineNumber));
+            return false;
+        }
+
+        Tag tag;
+        bool ok = true;
+        tag.name = fields[0].trimmed();
+        tag.slaveID = fields[1].trimmed().toInt(&ok);
+        if (ok) ok = parseRegisterType(fields[2].trimmed(), &tag.type);
+        if (ok) tag.address = fields[3].trimmed().toInt(&ok);
+        if (ok && fields.size() > 4 && !fields[4].trimmed().isEmpty())
+            ok = parseDataType(fields[4].trimmed(), &tag.dataType);
+        if (ok && fields.size() > 5 && !fields[5].trimmed().isEmpty())
+            ok = parseByteOrder(fields[5].trimmed(), &tag.order);
+        if (ok && fields.size() > 6 && !fields[6].trimmed().isEmpty())
+            tag.scale = fields[6].trimmed().toDouble(&ok);
+        if (ok && fields.size() > 7 && !fields[7].trimmed().isEmpty())
+            tag.offset = fields[7].trimmed().toDouble(&ok);
+        if (ok && fields.size() > 8)
+            tag.pollClass = fields[8].trimmed();
+        if (ok && fields.size() > 9 && !fields[9].trimmed().isEmpty())
+            tag.length = fields[9].trimmed().toInt(&ok);
+
+        if (!ok || tag.name.isEmpty()) {
+            setError(errorMessage, QObject::tr("Line %1: invalid tag definition").arg(lineNumber));
+            return false;
+        }
+        addTag(tag);
+    }
+
+    qDebug() << "Loaded" << m_tags.size() << "tags from" << fileName;
+    return true;
+}
+
+// JSON layout: { "pollClasses": { "fast": 200 }, "holes": [...], "tags": [...] }
+bool TagDatabase::loadJson(const QString& fileName, QString* errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(errorMessage, file.errorString());
+        return false;
+    }
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (doc.isNull()) {
+        setError(errorMessage, parseError.errorString());
+        return false;
+    }
+
+    clear();
+    const QJsonObject root = doc.object();
+
+    const QJsonObject classes = root.value("pollClasses").toObject();
+    for (auto it = classes.constBegin(); it != classes.constEnd(); ++it) {
+        setPollInterval(it.key(), it.value().toInt(defaultPollInterval));
+    }
+
+    const QJsonArray holes = root.value("holes").toArray();
+    for (const QJsonValue& value : holes) {
+        const QJsonObject obj = value.toObject();
+        AddressHole hole;
+        hole.slaveID = obj.value("slave").toInt(1);
+        hole.start = obj.value("start").toInt();
+        hole.count = obj.value("count").toInt(1);
+        if (!parseRegisterType(obj.value("type").toString(), &hole.type)) {
+            setError(errorMessage, QObject::tr("Invalid hole register type"));
+            return false;
+        }
+        addHole(hole);
+    }
+
+    const QJsonArray tags = root.value("tags").toArray();
+    for (const QJsonValue& value : tags) {
+        const QJsonObject obj = value.toObject();
+        Tag tag;
+        tag.name = obj.value("name").toString();
+        tag.slaveID = obj.value("slave").toInt(1);
+        tag.address = obj.value("address").toInt();
+        tag.length = obj.value("length").toInt(1);
+        tag.scale = obj.value("scale").toDouble(1.0);
+        tag.offset = obj.value("offset").toDouble(0.0);
+        tag.pollClass = obj.value("pollClass").toString();
+
+        bool ok = !tag.name.isEmpty()
+            && parseRegisterType(obj.value("type").toString(), &tag.type);
+        if (ok && obj.contains("dataType"))
+            ok = parseDataType(obj.value("dataType").toString(), &tag.dataType);
+        if (ok && obj.contains("order"))
+            ok = parseByteOrder(obj.value("order").toString(), &tag.order);
+
+        if (!ok) {
+            setError(errorMessage, QObject::tr("Invalid tag definition: %1").arg(tag.name));
+            return false;
+        }
+        addTag(tag);
+    }
+
+    qDebug() << "Loaded" << m_tags.size() << "tags and" << m_holes.size() << "holes from" << fileName;
+    return true;
+}
+
+void TagDatabase::clear()
+{
+    m_tags.clear();
+    m_holes.clear();
+    m_index.clear();
+    m_pollIntervals.clear();
+    m_pollIntervals.insert("fast", 250);
+    m_pollIntervals.insert(defaultPollClass, defaultPollInterval);
+    m_pollIntervals.insert("slow", 5000);
+}
+
+void TagDatabase::addTag(const Tag& tag)
+{
+    Tag entry = tag;
+    if (entry.pollClass.isEmpty()) {
+        entry.pollClass = defaultPollClass;
+    }
+    m_index.insert(entry.name, m_tags.size());
+    m_tags.append(entry);
+}
+
+void TagDatabase::addHole(const AddressHole& hole)
+{
+    if (hole.count > 0) {
+        m_holes.append(hole);
+    }
+}
+
+void TagDatabase::setPollInterval(const QString& pollClass, int intervalMs)
+{
+    m_pollIntervals.insert(pollClass, qMax(10, intervalMs));
+}
+
+const QList<Tag>& TagDatabase::tags() const noexcept
+{
+    return m_tags;
+}
+
+const QList<AddressHole>& TagDatabase::holes() const noexcept
+{
+    return m_holes;
+}
+
+int TagDatabase::pollInterval(const QString& pollClass) const
+{
+    return m_pollIntervals.value(pollClass, defaultPollInterval);
+}
+
+QStringList TagDatabase::pollClasses() const
+{
+    QStringList classes;
+    for (const Tag& tag : m_tags) {
+        if (!classes.contains(tag.pollClass)) {
+            classes << tag.pollClass;
+        }
+    }
+    return classes;
+}
+
+int TagDatabase::indexOf(const QString& name) const
+{
+    return m_index.value(name, -1);
+}
+
+bool TagDatabase::parseRegisterType(const QString& text, ModbusConnection::RegisterType* type)
+{
+    const QString key = text.trimmed().toLower();
+    if (key == "coil" || key == "coils" || key == "0x") {
+        *type = ModbusConnection::Coils;
+    }
+    else if (key == "di" || key == "discreteinputs" || key == "1x") {
+        *type = ModbusConnection::DiscreteInputs;
+    }
+    else if (key == "ir" || key == "inputregisters" || key == "3x") {
+        *type = ModbusConnection::InputRegisters;
+    }
+    else if (key == "hr" || key == "holdingregisters" || key == "4x") {
+        *type = ModbusConnection::HoldingRegisters;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+bool TagDatabase::parseDataType(const QString& text, RegisterCodec::DataType* type)
+{
+    const QString key = text.trimmed().toLower();
+    for (const auto candidate : RegisterCodec::allTypes()) {
+        if (RegisterCodec::typeName(candidate) == key) {
+            *type = candidate;
+            return true;
+        }
+    }
+    if (key == "float" || key == "real") {
+        *type = RegisterCodec::DataType::Float32;
+        return true;
+    }
+    if (key == "bool") {
+        *type = RegisterCodec::DataType::UInt16;
+        return true;
+    }
+    return false;
+}
+
+bool TagDatabase::parseByteOrder(const QString& text, RegisterCodec::ByteOrder* order)
+{
+    const QString key = text.trimmed().toUpper();
+    for (const auto candidate : RegisterCodec::allOrders()) {
+        if (RegisterCodec::orderName(candidate) == key) {
+            *order = candidate;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,286 @@
+#include "TagPoller.h"
+#include <QDebug>
+#include <algorithm>
+#include <utility>
+
+TagPoller::TagPoller(QObject* parent)
+    : QObject(parent)
+{
+}
+
+TagPoller::~TagPoller()
+{
+    stop();
+    if (m_modbusConnection) {
+        m_modbusConnection->cancelRequests(this);
+    }
+}
+
+void TagPoller::setModbusConnection(ModbusConnection* connection)
+{
+    if (m_modbusConnection) {
+        m_modbusConnection->cancelRequests(this);
+    }
+    m_modbusConnection = connection;
+    m_inFlight.fill(false);
+    m_writingTag.fill(-1);
+}
+
+void TagPoller::setDatabase(const TagDatabase& database, const ReadPlan& plan)
+{
+    const bool wasRunning = isRunning();
+    stop();
+
+    ++m_generation;
+    m_database = database;
+    m_plan = plan;
+    m_buffers = QVector<QVector<quint16>>(m_plan.blocks.size());
+    m_inFlight = QVector<bool>(m_plan.blocks.size(), false);
+    m_pendingWrites = QVector<QList<PendingWrite>>(m_plan.blocks.size());
+    m_writingTag = QVector<int>(m_plan.blocks.size(), -1);
+
+    if (wasRunning) {
+        start();
+    }
+}
+
+void TagPoller::start()
+{
+    stop();
+
+    for (auto it = m_plan.blocksByClass.cbegin(); it != m_plan.blocksByClass.cend(); ++it) {
+        const QString pollClassName = it.key();
+        auto* timer = new QTimer(this);
+        timer->setInterval(m_database.pollInterval(pollClassName));
+        connect(timer, &QTimer::timeout, this, [this, pollClassName]() {
+            pollClass(pollClassName);
+            });
+        timer->start();
+        m_timers.append(timer);
+
+        pollClass(pollClassName);
+    }
+}
+
+void TagPoller::stop()
+{
+    qDeleteAll(m_timers);
+    m_timers.clear();
+}
+
+bool TagPoller::isRunning() const noexcept
+{
+    return !m_timers.isEmpty();
+}
+
+const TagDatabase& TagPoller::database() const noexcept
+{
+    return m_database;
+}
+
+const ReadPlan& TagPoller::plan() const noexcept
+{
+    return m_plan;
+}
+
+QVariant TagPoller::value(int tagIndex) const
+{
+    if (tagIndex < 0 || tagIndex >= m_plan.locations.size()) {
+        return QVariant();
+    }
+
+    const TagLocation& location = m_plan.locations[tagIndex];
+    if (location.block < 0) {
+        return QVariant();
+    }
+
+    const QVector<quint16>& buffer = m_buffers[location.block];
+    const Tag& tag = m_database.tags()[tagIndex];
+
+    if (tag.type == ModbusConnection::Coils || tag.type == ModbusConnection::DiscreteInputs) {
+        if (location.offset >= buffer.size()) {
+            return QVariant();
+        }
+        return buffer[location.offset] != 0;
+    }
+
+    RegisterCodec::FieldDescriptor field;
+    field.offset = location.offset;
+    field.type = tag.dataType;
+    field.order = tag.order;
+    field.length = tag.length;
+
+    const QVariant raw = RegisterCodec::decode(buffer.constData(), buffer.size(), field);
+    if (!raw.isValid() || tag.dataType == RegisterCodec::DataType::Ascii
+        || (tag.scale == 1.0 && tag.offset == 0.0)) {
+        return raw;
+    }
+    return raw.toDouble() * tag.scale + tag.offset;
+}
+
+bool TagPoller::writeTag(int tagIndex, const QVariant& value)
+{
+    if (tagIndex < 0 || tagIndex >= m_plan.locations.size() || m_plan.locations[tagIndex].block < 0
+        || !m_modbusConnection || !m_modbusConnection->isConnected()) {
+        return false;
+    }
+    const Tag& tag = m_database.tags()[tagIndex];
+    if (tag.type != ModbusConnection::HoldingRegisters || tag.width() > 121) {
+        return false;
+    }
+
+    // Back from engineering units to the raw value
+    QVariant raw = value;
+    if (tag.dataType != RegisterCodec::DataType::Ascii && (tag.scale != 1.0 || tag.offset != 0.0)) {
+        bool ok = false;
+        const double scaled = value.toDouble(&ok);
+        if (!ok || tag.scale == 0.0) {
+            return false;
+        }
+        const double unscaled = (scaled - tag.offset) / tag.scale;
+        const bool isFloat = tag.dataType == RegisterCodec::DataType::Float32
+            || tag.dataType == RegisterCodec::DataType::Float64;
+        raw = isFloat ? QVariant(unscaled) : QVariant(qRound64(unscaled));
+    }
+
+    RegisterCodec::FieldDescriptor field;
+    field.type = tag.dataType;
+    field.order = tag.order;
+    field.length = tag.length;
+    const QVector<quint16> values = RegisterCodec::encode(raw, field);
+
+    const int blockIndex = m_plan.locations[tagIndex].block;
+    QList<PendingWrite>& writes = m_pendingWrites[blockIndex];
+    const auto queued = std::find_if(writes.begin(), writes.end(), [tagIndex](const PendingWrite& write) {
+        return write.tagIndex == tagIndex;
+        });
+    if (queued != writes.end()) {
+        queued->values = values;
+    }
+    else {
+        writes.append(PendingWrite{ tagIndex, values });
+    }
+
+    // Out now rather than at the next poll unless the block is on the bus
+    if (!m_inFlight[blockIndex]) {
+        issueBlock(blockIndex);
+    }
+    return true;
+}
+
+bool TagPoller::writeTagBits(int tagIndex, quint16 andMask, quint16 orMask)
+{
+    if (tagIndex < 0 || tagIndex >= m_plan.locations.size() || m_plan.locations[tagIndex].block < 0
+        || !m_modbusConnection || !m_modbusConnection->isConnected()) {
+        return false;
+    }
+    const Tag& tag = m_database.tags()[tagIndex];
+    if (tag.type != ModbusConnection::HoldingRegisters
+        || (tag.dataType != RegisterCodec::DataType::UInt16 && tag.dataType != RegisterCodec::DataType::Int16)) {
+        return false;
+    }
+
+    const QModbusRequest request = PduBuilder(QModbusPdu::MaskWriteRegister)
+        .put16(quint16(tag.address)).put16(andMask).put16(orMask)
+        .toRequest();
+    const quint64 callTag = (m_generation << 32) | quint32(tagIndex);
+    return m_modbusConnection->submitRequest(request, tag.slaveID, &TagPoller::handleMaskWrite, this, callTag);
+}
+
+// Issues every block of a poll class that is not still waiting for a reply
+void TagPoller::pollClass(const QString& pollClass)
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        return;
+    }
+
+    for (const int blockIndex : m_plan.blocksByClass.value(pollClass)) {
+        if (!m_inFlight[blockIndex]) {
+            issueBlock(blockIndex);
+        }
+    }
+}
+
+// Reads the block, as FC23 when a write to one of its tags is waiting
+bool TagPoller::issueBlock(int blockIndex)
+{
+    // The tag carries the plan generation in the high half and the block in the low half
+    const ReadBlock& block = m_plan.blocks[blockIndex];
+    const quint64 tag = (m_generation << 32) | quint32(blockIndex);
+
+    QList<PendingWrite>& writes = m_pendingWrites[blockIndex];
+    if (!writes.isEmpty()) {
+        const PendingWrite& write = writes.first();
+        const int address = m_database.tags()[write.tagIndex].address;
+        if (!m_modbusConnection->submitReadWrite(block.start, quint16(block.count), address, write.values,
+            block.slaveID, &TagPoller::handleBlockRead, this, tag)) {
+            return false;
+        }
+        m_writingTag[blockIndex] = write.tagIndex;
+        writes.removeFirst();
+    }
+    else if (!m_modbusConnection->submitRead(block.type, block.start, quint16(block.count), block.slaveID,
+        &TagPoller::handleBlockRead, this, tag)) {
+        return false;
+    }
+    m_inFlight[blockIndex] = true;
+    return true;
+}
+
+// Decodes straight from the response into the block buffer, which keeps its
+// allocation from one poll to the next
+void TagPoller::handleBlockRead(void* context, quint64 tag, const ModbusConnection::RequestResult& result)
+{
+    auto* self = static_cast<TagPoller*>(context);
+
+    // The plan was replaced while this read was on the bus
+    if (quint32(tag >> 32) != quint32(self->m_generation)) {
+        return;
+    }
+
+    const int blockIndex = int(quint32(tag));
+    self->m_inFlight[blockIndex] = false;
+
+    const int writtenTag = std::exchange(self->m_writingTag[blockIndex], -1);
+    if (writtenTag >= 0) {
+        emit self->tagWritten(writtenTag, result.error == QModbusDevice::NoError, result.errorText);
+    }
+
+    const ReadBlock& block = self->m_plan.blocks[blockIndex];
+    QVector<quint16>& buffer = self->m_buffers[blockIndex];
+    const qsizetype previousSize = buffer.size();
+    buffer.resize(block.count);
+    if (ModbusConnection::decodeRead(block.type, result, buffer.data(), block.count)) {
+        emit self->blockUpdated(blockIndex);
+    }
+    else {
+        // decodeRead() writes nothing when it fails, so the last good values stay
+        buffer.resize(previousSize);
+        const QString error = result.error == QModbusDevice::NoError ? tr("Malformed response") : result.errorText;
+        qDebug() << "Tag block" << blockIndex << "read error:" << error;
+        emit self->blockFailed(blockIndex, error);
+    }
+
+    // Further writes to the block go straight out instead of waiting for the poll interval
+    if (!self->m_inFlight[blockIndex] && !self->m_pendingWrites[blockIndex].isEmpty()
+        && self->m_modbusConnection && self->m_modbusConnection->isConnected()) {
+        self->issueBlock(blockIndex);
+    }
+}
+
+// A mask write changes the register behind the poller's back, so its block is read again
+void TagPoller::handleMaskWrite(void* context, quint64 tag, const ModbusConnection::RequestResult& result)
+{
+    auto* self = static_cast<TagPoller*>(context);
+    if (quint32(tag >> 32) != quint32(self->m_generation)) {
+        return;
+    }
+
+    const int tagIndex = int(quint32(tag));
+    emit self->tagWritten(tagIndex, result.error == QModbusDevice::NoError, result.errorText);
+
+    const int blockIndex = self->m_plan.locations[tagIndex].block;
+    if (!self->m_inFlight[blockIndex] && self->m_modbusConnection && self->m_modbusConnection->isConnected()) {
+        self->issueBlock(blockIndex);
+    }
+}
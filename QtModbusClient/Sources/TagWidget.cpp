@@ -0,0 +1,185 @@
+#include "TagWidget.h"
+#include <QMessageBox>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QDebug>
+
+namespace {
+    enum Column { NameColumn, SlaveColumn, TypeColumn, AddressColumn, DataTypeColumn, ClassColumn, ValueColumn };
+
+    QString registerTypeName(ModbusConnection::RegisterType type)
+    {
+        switch (type) {
+        case ModbusConnection::Coils: return QStringLiteral("Coil");
+        case ModbusConnection::DiscreteInputs: return QStringLiteral("DI");
+        case ModbusConnection::InputRegisters: return QStringLiteral("IR");
+        case ModbusConnection::HoldingRegisters: return QStringLiteral("HR");
+        }
+        return QString();
+    }
+}
+
+TagWidget::TagWidget(QWidget* parent)
+    : QWidget(parent)
+{
+    ui.setupUi(this);
+    m_poller = new TagPoller(this);
+    initTableModel();
+    setupConnections();
+    ui.tagStopBtn->setEnabled(false);
+}
+
+TagWidget::~TagWidget()
+{
+    m_poller->stop();
+}
+
+void TagWidget::setModbusConnection(ModbusConnection* connection)
+{
+    m_modbusConnection = connection;
+    m_poller->setModbusConnection(connection);
+}
+
+void TagWidget::initTableModel()
+{
+    m_tagModel = new QStandardItemModel(this);
+    m_tagModel->setHorizontalHeaderLabels({ tr("Name"), tr("Slave"), tr("Type"), tr("Address"),
+        tr("Data Type"), tr("Poll Class"), tr("Value") });
+    ui.tagTableView->setModel(m_tagModel);
+    ui.tagTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    // Only the value of holding register tags is editable; an edit is written to the device
+    ui.tagTableView->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
+}
+
+void TagWidget::setupConnections()
+{
+    connect(ui.tagLoadBtn, &QPushButton::clicked, this, &TagWidget::onLoadTags);
+    connect(ui.tagStartBtn, &QPushButton::clicked, this, &TagWidget::onStartPolling);
+    connect(ui.tagStopBtn, &QPushButton::clicked, this, &TagWidget::onStopPolling);
+    connect(m_poller, &TagPoller::blockUpdated, this, &TagWidget::handleBlockUpdated);
+    connect(m_poller, &TagPoller::tagWritten, this, &TagWidget::handleTagWritten);
+    connect(m_tagModel, &QStandardItemModel::itemChanged, this, &TagWidget::handleValueEdited);
+}
+
+// Loads a tag file and compiles it into a read plan
+void TagWidget::onLoadTags()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Load Tag Database"),
+        QString(), tr("Tag files (*.csv *.json);;All files (*)"));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    TagDatabase database;
+    QString error;
+    if (!database.load(fileName, &error)) {
+        QMessageBox::critical(this, tr("Error"), tr("Failed to load tags: %1").arg(error));
+        return;
+    }
+
+    m_database = database;
+    compilePlan();
+    populateTable();
+}
+
+void TagWidget::setKnownHoles(const QList<AddressHole>& holes)
+{
+    m_knownHoles = holes;
+    if (!m_database.tags().isEmpty()) {
+        compilePlan();
+    }
+}
+
+// Compiles the loaded tags together with the holes of the device profile
+void TagWidget::compilePlan()
+{
+    TagDatabase database = m_database;
+    for (const AddressHole& hole : m_knownHoles) {
+        database.addHole(hole);
+    }
+
+    const ReadPlan plan = ReadPlanner::compile(database);
+    m_poller->setDatabase(database, plan);
+
+    ui.tagSummaryLabel->setText(tr("%1 tags, %2 read transactions, %3 poll classes")
+        .arg(database.tags().size())
+        .arg(plan.blocks.size())
+        .arg(plan.blocksByClass.size()));
+}
+
+void TagWidget::onStartPolling()
+{
+    if (!m_modbusConnection || !m_modbusConnection->isConnected()) {
+        QMessageBox::warning(this, tr("Error"), tr("Not connected to any device"));
+        return;
+    }
+
+    m_poller->start();
+    ui.tagStartBtn->setEnabled(false);
+    ui.tagStopBtn->setEnabled(true);
+}
+
+void TagWidget::onStopPolling()
+{
+    m_poller->stop();
+    ui.tagStartBtn->setEnabled(true);
+    ui.tagStopBtn->setEnabled(false);
+}
+
+// Refreshes only the rows served by the updated block
+void TagWidget::handleBlockUpdated(int blockIndex)
+{
+    m_updatingValues = true;
+    for (const int tagIndex : m_poller->plan().tagsByBlock.value(blockIndex)) {
+        const QVariant value = m_poller->value(tagIndex);
+        if (QStandardItem* item = m_tagModel->item(tagIndex, ValueColumn)) {
+            item->setText(value.toString());
+        }
+    }
+    m_updatingValues = false;
+}
+
+// The written value shows once the FC23 that carries it has read the block back
+void TagWidget::handleValueEdited(QStandardItem* item)
+{
+    if (m_updatingValues || item->column() != ValueColumn) {
+        return;
+    }
+
+    const int tagIndex = item->row();
+    if (!m_poller->writeTag(tagIndex, item->text())) {
+        QMessageBox::warning(this, tr("Error"), tr("Cannot write tag %1").arg(m_poller->database().tags()[tagIndex].name));
+    }
+    m_updatingValues = true;
+    item->setText(m_poller->value(tagIndex).toString());
+    m_updatingValues = false;
+}
+
+void TagWidget::handleTagWritten(int tagIndex, bool ok, const QString& errorMessage)
+{
+    if (!ok) {
+        QMessageBox::warning(this, tr("Error"), tr("Write to tag %1 failed: %2")
+            .arg(m_poller->database().tags()[tagIndex].name, errorMessage));
+    }
+}
+
+void TagWidget::populateTable()
+{
+    m_tagModel->removeRows(0, m_tagModel->rowCount());
+
+    for (const Tag& tag : m_poller->database().tags()) {
+        QList<QStandardItem*> rowItems;
+        rowItems << new QStandardItem(tag.name)
+            << new QStandardItem(QString::number(tag.slaveID))
+            << new QStandardItem(registerTypeName(tag.type))
+            << new QStandardItem(QString::number(tag.address))
+            << new QStandardItem(RegisterCodec::typeName(tag.dataType))
+            << new QStandardItem(tag.pollClass)
+            << new QStandardItem();
+        for (QStandardItem* item : rowItems) {
+            item->setEditable(false);
+        }
+        rowItems[ValueColumn]->setEditable(tag.type == ModbusConnection::HoldingRegisters);
+        m_tagModel->appendRow(rowItems);
+    }
+}
@@ -1,9 +1,48 @@
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QStatusBar>
+#include <QTimer>
+#include <QDebug>
 #include "MainWindow.h"
+#include "Crc16.h"
+#include "RtuBenchmark.h"
 
 int main(int argc, char* argv[]) {
+	QElapsedTimer startupTimer;
+	startupTimer.start();
+
 	QApplication a(argc, argv);
+	// --startup-time exits as soon as the window is up, for timing cold starts from a script
+	const bool startupTimeOnly = a.arguments().contains(QStringLiteral("--startup-time"));
+
+	// --crc-selftest and --crc-benchmark exercise the CRC16 implementations and exit
+	if (a.arguments().contains(QStringLiteral("--crc-selftest"))) {
+		return Crc16::selfTest() ? 0 : 1;
+	}
+	if (a.arguments().contains(QStringLiteral("--crc-benchmark"))) {
+		qInfo().noquote() << "Active CRC16 implementation:" << Crc16::implementationName(Crc16::activeImplementation());
+		Crc16::benchmark({ 8, 64, 256, 4096, 65536 });
+		return 0;
+	}
+	// --rtu-benchmark compares request latency of QSerialPort and the native transport over a pty pair
+	if (a.arguments().contains(QStringLiteral("--rtu-benchmark"))) {
+		const QList<RtuBenchmark::Result> results = RtuBenchmark::run();
+		return results.size() == 2 && results[0].transactions > 0 && results[1].transactions > 0 ? 0 : 1;
+	}
+
 	MainWindow w;
 	w.show();
+
+	// Runs once the first show and paint events have been processed
+	QTimer::singleShot(0, &w, [&w, &startupTimer, startupTimeOnly]() {
+		const qint64 elapsed = startupTimer.elapsed();
+		qInfo().noquote() << QString("Startup took %1 ms").arg(elapsed);
+		if (startupTimeOnly) {
+			QCoreApplication::quit();
+			return;
+		}
+		w.statusBar()->showMessage(QObject::tr("Started in %1 ms").arg(elapsed), 5000);
+		});
+
 	return a.exec();
-}
\ No newline at end of file
+}